@@ -110,6 +110,7 @@ enum bind_actions {
     BIND_EMULATOR_SETTINGS,
     BIND_EMULATOR_ALT_SPEED_HOLD,
     BIND_EMULATOR_ALT_SPEED_TOGGLE,
+    BIND_EMULATOR_REWIND,
     BIND_EMULATOR_QUICKSAVE_1,
     BIND_EMULATOR_QUICKSAVE_2,
     BIND_EMULATOR_QUICKSAVE_3,
@@ -203,6 +204,32 @@ struct settings {
         // Enable the emulation of the prefetch buffer
         bool prefetch_buffer;
 
+        // The way the core executes instructions
+        enum core_backends core_backend;
+
+        // Skip loops that only wait for the next scheduler event
+        bool idle_loop_detection;
+
+        // Let the host's MMU handle the mirrors of the memory (Linux only)
+        bool mmu_mirrors;
+
+        // Emulate the BIOS' SWIs natively, making the BIOS dump optional
+        bool hle_bios;
+
+        // Rewind
+        struct {
+            bool enabled;
+
+            // Amount of frames between two captures
+            uint32_t interval;
+
+            // Size of the history, in MiB
+            uint32_t buffer_size;
+        } rewind;
+
+        // Amount of frames to run ahead to hide the game's input lag, 0 to disable
+        uint32_t run_ahead;
+
         // Start the last played game on startup, when no game is provided
         bool start_last_played_game_on_startup;
 
@@ -315,6 +342,9 @@ struct app {
         struct launch_config *launch_config;
         struct game_entry *game_entry;
 
+        // Set when `launch_config->rom.data` is a read-only mapping of the ROM file instead of a heap buffer
+        bool is_rom_mapped;
+
         char *game_path;
 
         FILE *backup_file;
@@ -621,6 +651,7 @@ void app_emulator_run(struct app *app);
 void app_emulator_pause(struct app *app);
 void app_emulator_exit(struct app *app);
 void app_emulator_key(struct app *app, enum keys key, bool pressed);
+void app_emulator_rewind(struct app *app, bool enabled);
 void app_emulator_settings(struct app *app);
 void app_emulator_export_save_to_path(struct app *app, char const *);
 void app_emulator_update_backup(struct app *app);
@@ -19,6 +19,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <io.h>
+#include <malloc.h>
 #include <fileapi.h>
 #include <stdio.h>
 #include <stringapiset.h>
@@ -28,6 +29,8 @@
 #include <shellapi.h>
 
 #define hs_isatty(x)            false
+#define hs_aligned_alloc(a, sz) _aligned_malloc((sz), (a))
+#define hs_aligned_free(ptr)    _aligned_free(ptr)
 
 static inline
 wchar_t *
@@ -155,6 +158,73 @@ end:
     return (out);
 }
 
+static inline
+struct tm *
+hs_localtime(
+    time_t const *t,
+    struct tm *tm
+) {
+    return (localtime_s(tm, t) ? NULL : tm);
+}
+
+/*
+** Map the given file in memory, read-only.
+** Return NULL on failure.
+*/
+static inline
+void *
+hs_map_file(
+    char const *path,
+    size_t *size
+) {
+    HANDLE file;
+    HANDLE mapping;
+    LARGE_INTEGER file_size;
+    wchar_t *wpath;
+    void *data;
+
+    data = NULL;
+    wpath = hs_convert_to_wchar(path);
+    if (!wpath) {
+        return (NULL);
+    }
+
+    file = CreateFileW(wpath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    free(wpath);
+
+    if (file == INVALID_HANDLE_VALUE) {
+        return (NULL);
+    }
+
+    if (!GetFileSizeEx(file, &file_size) || !file_size.QuadPart) {
+        goto end;
+    }
+
+    mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping) {
+        goto end;
+    }
+
+    data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data) {
+        *size = file_size.QuadPart;
+    }
+
+    CloseHandle(mapping);
+end:
+    CloseHandle(file);
+    return (data);
+}
+
+static inline
+void
+hs_unmap_file(
+    void *data,
+    size_t size __unused
+) {
+    UnmapViewOfFile(data);
+}
+
 static inline
 void
 hs_usleep(
@@ -195,7 +265,9 @@ hs_open_url(
 
 #else
 
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <time.h>
 
@@ -204,6 +276,27 @@ hs_open_url(
 #define hs_fopen(path, mode)    fopen((char const *)(path), (mode))
 #define hs_usleep(x)            usleep(x)
 #define hs_fexists(path)        (access((path), F_OK) == 0)
+#define hs_localtime(t, tm)     localtime_r((t), (tm))
+#define hs_unmap_file(d, sz)    munmap((d), (sz))
+#define hs_aligned_free(ptr)    free(ptr)
+
+/*
+** Allocate `size` bytes aligned on `align`, a power of two multiple of `sizeof(void *)`.
+** Return NULL on failure.
+*/
+static inline
+void *
+hs_aligned_alloc(
+    size_t align,
+    size_t size
+) {
+    void *ptr;
+
+    if (posix_memalign(&ptr, align, size)) {
+        return (NULL);
+    }
+    return (ptr);
+}
 
 static inline
 char const *
@@ -227,6 +320,40 @@ hs_time(
     return (ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
 }
 
+/*
+** Map the given file in memory, read-only.
+** Return NULL on failure.
+*/
+static inline
+void *
+hs_map_file(
+    char const *path,
+    size_t *size
+) {
+    struct stat stbuf;
+    void *data;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return (NULL);
+    }
+
+    data = NULL;
+    if (!fstat(fd, &stbuf) && stbuf.st_size > 0) {
+        // Shared, so that the GBA can map the ROM a second time (see `mem_mirror_map_rom()`)
+        data = mmap(NULL, stbuf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) {
+            data = NULL;
+        } else {
+            *size = stbuf.st_size;
+        }
+    }
+
+    close(fd);
+    return (data);
+}
+
 static inline
 char *
 hs_fmtime(
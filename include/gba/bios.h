@@ -0,0 +1,59 @@
+/******************************************************************************\
+**
+**  This file is part of the Hades GBA Emulator, and is made available under
+**  the terms of the GNU General Public License version 2.
+**
+**  Copyright (C) 2021-2024 - The Hades Authors
+**
+\******************************************************************************/
+
+#pragma once
+
+#include "hades.h"
+
+struct gba;
+
+/*
+** The SWIs the HLE BIOS implements natively.
+** The other ones are forwarded to the BIOS' code.
+*/
+enum bios_swis {
+    BIOS_SWI_SOFT_RESET             = 0x00,
+    BIOS_SWI_REGISTER_RAM_RESET     = 0x01,
+    BIOS_SWI_HALT                   = 0x02,
+    BIOS_SWI_INTR_WAIT              = 0x04,
+    BIOS_SWI_VBLANK_INTR_WAIT       = 0x05,
+    BIOS_SWI_DIV                    = 0x06,
+    BIOS_SWI_DIV_ARM                = 0x07,
+    BIOS_SWI_SQRT                   = 0x08,
+    BIOS_SWI_ARCTAN                 = 0x09,
+    BIOS_SWI_ARCTAN2                = 0x0A,
+    BIOS_SWI_CPU_SET                = 0x0B,
+    BIOS_SWI_CPU_FAST_SET           = 0x0C,
+    BIOS_SWI_BG_AFFINE_SET          = 0x0E,
+    BIOS_SWI_OBJ_AFFINE_SET         = 0x0F,
+    BIOS_SWI_LZ77_UNCOMP_WRAM       = 0x11,
+    BIOS_SWI_LZ77_UNCOMP_VRAM       = 0x12,
+    BIOS_SWI_HUFF_UNCOMP            = 0x13,
+    BIOS_SWI_RL_UNCOMP_WRAM         = 0x14,
+    BIOS_SWI_RL_UNCOMP_VRAM         = 0x15,
+    BIOS_SWI_DIFF8_UNFILTER_WRAM    = 0x16,
+    BIOS_SWI_DIFF8_UNFILTER_VRAM    = 0x17,
+    BIOS_SWI_DIFF16_UNFILTER        = 0x18,
+
+    BIOS_SWI_LEN,
+};
+
+/*
+** The amount of cycles the real BIOS roughly takes to complete a SWI:
+** `base` cycles plus `per_unit` cycles for each unit of work (word copied, byte decompressed,
+** matrix computed, etc.).
+*/
+struct bios_swi_cost {
+    uint32_t base;
+    uint32_t per_unit;
+};
+
+/* gba/bios/hle.c */
+void bios_hle_load(struct gba *gba);
+bool bios_hle_swi(struct gba *gba, uint32_t swi);
@@ -30,6 +30,25 @@ enum core_states {
     CORE_STOP = 2,
 };
 
+/*
+** The different ways the core can execute instructions.
+*/
+enum core_backends {
+    CORE_BACKEND_INTERPRETER = 0,
+    CORE_BACKEND_CACHED_INTERPRETER = 1,
+    CORE_BACKEND_JIT = 2,                   // Falls back to the cached interpreter on hosts other than x86-64
+
+    CORE_BACKEND_MIN = CORE_BACKEND_INTERPRETER,
+    CORE_BACKEND_MAX = CORE_BACKEND_JIT,
+    CORE_BACKEND_LEN = CORE_BACKEND_MAX + 1,
+};
+
+static char const * const core_backend_names[] = {
+    [CORE_BACKEND_INTERPRETER] = "Interpreter",
+    [CORE_BACKEND_CACHED_INTERPRETER] = "Cached Interpreter",
+    [CORE_BACKEND_JIT] = "JIT",
+};
+
 struct psr {
     union {
         struct {
@@ -124,8 +143,134 @@ struct core {
     bool reenter_dma_transfer_loop;
 
     bool irq_line;                          // Set when there's an IRQ available
+
+    bool bios_intr_wait;                    // Set while the HLE BIOS waits for an interrupt in IntrWait
+};
+
+/*
+** The cache of pre-decoded blocks of instructions.
+**
+** Runs of instructions located in plain memory (ROM, IWRAM and EWRAM) are decoded once into
+** an array of micro-ops holding the handler to call and the opcode it's called with.
+**
+** RAM is split in pages of `CORE_CACHE_PAGE_SIZE` bytes. Each page has a generation counter that
+** is incremented when a page holding cached code is written to, invalidating all the blocks
+** built from that page.
+*/
+
+#define CORE_CACHE_BLOCK_LEN        32      // Maximum amount of instructions within a block
+#define CORE_CACHE_BLOCKS           2048    // Must be a power of two
+#define CORE_CACHE_PAGE_SHIFT       8
+#define CORE_CACHE_PAGE_SIZE        (1 << CORE_CACHE_PAGE_SHIFT)
+#define CORE_CACHE_EWRAM_PAGES      (EWRAM_SIZE >> CORE_CACHE_PAGE_SHIFT)
+#define CORE_CACHE_IWRAM_PAGES      (IWRAM_SIZE >> CORE_CACHE_PAGE_SHIFT)
+#define CORE_CACHE_NO_PAGE          (CORE_CACHE_EWRAM_PAGES + CORE_CACHE_IWRAM_PAGES) // Used for read-only memory
+#define CORE_CACHE_PAGES            (CORE_CACHE_NO_PAGE + 1)
+
+#define CORE_CACHE_EWRAM_PAGE(addr) (((addr) & EWRAM_MASK) >> CORE_CACHE_PAGE_SHIFT)
+#define CORE_CACHE_IWRAM_PAGE(addr) (CORE_CACHE_EWRAM_PAGES + (((addr) & IWRAM_MASK) >> CORE_CACHE_PAGE_SHIFT))
+
+struct core_uop {
+    union {
+        void (*arm)(struct gba *gba, uint32_t op);
+        void (*thumb)(struct gba *gba, uint16_t op);
+    } handler;
+
+    uint32_t op;
+    uint32_t cond;                          // ARM only, the condition of the instruction
+};
+
+struct core_block {
+    uint32_t key;                           // Address of the first instruction, with bit 0 set in Thumb mode. 0 if unused.
+    uint32_t len;
+
+    // The pages the block was built from and their generation at that time.
+    uint32_t pages[2];
+    uint32_t gens[2];
+
+    // The last two entries only hold the words prefetched while executing the last instructions of the block.
+    struct core_uop uops[CORE_CACHE_BLOCK_LEN + 2];
+
+    // The native code the JIT compiled the block to, if any (see `core/jit.c`).
+    uint32_t hits;                          // Times the block was entered since it was built
+    uint8_t const *native;
+    uint16_t entries[CORE_CACHE_BLOCK_LEN]; // Offset within `native` of each instruction, 0 if it must be interpreted
+};
+
+struct core_cache {
+    struct core_block *blocks;
+
+    // The next micro-op to execute if the core keeps running the current block.
+    struct core_block *block;
+    struct core_uop const *next;
+    struct core_uop const *end;
+    uint32_t next_key;
+
+    // Incremented each time a block is invalidated.
+    uint32_t epoch;
+
+    bool code[CORE_CACHE_PAGES];            // True if the page holds cached code
+    uint32_t gens[CORE_CACHE_PAGES];
+
+    // The executable memory the JIT compiles the blocks to, allocated the first time it's needed.
+    uint8_t *jit_code;
+    size_t jit_code_len;
+    bool jit_unavailable;                   // Set if that memory couldn't be allocated
+};
+
+/*
+** Invalidate the cached blocks built from the given page, if any.
+** Must be called each time IWRAM or EWRAM is written to.
+*/
+#define core_cache_notify_write(gba, page)                                      \
+    do {                                                                        \
+        if (unlikely((gba)->core_cache.code[(page)])) {                         \
+            core_cache_invalidate_page((gba), (page));                          \
+        }                                                                       \
+    } while (0)
+
+/*
+** Idle loop detection.
+**
+** A short loop is considered idle if, after a full iteration, it didn't write to memory,
+** didn't read any register that changes on its own (timers, EEPROM) and the registers of the
+** core are the same than at the beginning of the iteration.
+** Such a loop can't exit before the next scheduler event, so we can skip directly to it.
+*/
+
+#define CORE_IDLE_LOOP_MAX_SIZE     64      // Maximum size of a loop, in bytes
+#define CORE_IDLE_LOOP_MAX_LOGGED   32      // Maximum amount of detected loops that are logged
+
+enum idle_loop_modes {
+    IDLE_LOOP_AUTODETECT = 0,               // Detect idle loops using the heuristic above
+    IDLE_LOOP_DISABLED = 1,                 // Never skip any loop
+    IDLE_LOOP_FORCED = 2,                   // Only skip the loop starting at the given address
+};
+
+struct idle_loop_config {
+    enum idle_loop_modes mode;
+    uint32_t addr;                          // Only used with `IDLE_LOOP_FORCED`
+};
+
+struct core_idle_loop {
+    struct idle_loop_config config;
+
+    // The loop being watched and the state of the core at the beginning of the current iteration.
+    uint32_t head;
+    uint32_t registers[16];
+    uint32_t cpsr;
+    bool tainted;                           // Set if the current iteration had a side effect
+
+    // Addresses of the loops already logged, to avoid flooding the logs.
+    uint32_t logged[CORE_IDLE_LOOP_MAX_LOGGED];
+    size_t logged_len;
 };
 
+/*
+** Mark the current iteration of the watched loop as having a side effect.
+*/
+#define core_idle_loop_taint(gba)   ((gba)->core_idle_loop.tainted = true)
+
 /*
 ** The fifteen possible conditions that prefixes an instruction.
 */
@@ -207,6 +352,21 @@ static char const * const arm_modes_name[] = {
     [MODE_SYS]          = "sys"
 };
 
+/* gba/core/cache.c */
+void core_cache_init(struct core_cache *cache);
+void core_cache_cleanup(struct core_cache *cache);
+void core_cache_flush(struct gba *gba);
+void core_cache_invalidate_page(struct gba *gba, uint32_t page);
+struct core_uop const *core_cache_lookup(struct gba *gba, uint32_t key);
+
+/* gba/core/jit.c */
+void core_jit_cleanup(struct core_cache *cache);
+bool core_jit_run(struct gba *gba, uint64_t target);
+
+/* gba/core/idle.c */
+void core_idle_loop_reset(struct gba *gba);
+void core_idle_loop_eval(struct gba *gba, uint32_t head);
+
 /* gba/core/core.c */
 void core_run(struct gba *gba);
 void core_next(struct gba *gba);
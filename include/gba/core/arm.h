@@ -14,22 +14,25 @@
 
 struct gba;
 
-struct hs_arm_insn {
-    char const *name;
-    char const *mask;
-    void (*op)(struct gba *gba, uint32_t op);
+#define CORE_ARM_LUT_LEN        4096
+#define CORE_COND_LUT_LEN       256
+
+/*
+** The different kinds of second operand of the Data Processing instructions.
+*/
+enum arm_alu_operands {
+    ARM_ALU_OPERAND_IMM,                // Rotated immediate value
+    ARM_ALU_OPERAND_REG_IMM_SHIFT,      // Register shifted by an immediate amount
+    ARM_ALU_OPERAND_REG_REG_SHIFT,      // Register shifted by the content of another register
+
+    ARM_ALU_OPERAND_LEN,
 };
 
-struct hs_arm_decoded_insn {
-    uint32_t mask;
-    uint32_t value;
-};
-
-extern void (*arm_lut[4096])(struct gba *gba, uint32_t op);
-extern bool cond_lut[256];
-
-/* core/arm/alu.c */
-void core_arm_alu(struct gba *gba, uint32_t op);
+/*
+** Generated at build time from `gba/core/arm/insns.h` (see `gba/core/gen_tables.c`).
+*/
+extern void (* const arm_lut[CORE_ARM_LUT_LEN])(struct gba *gba, uint32_t op);
+extern bool const cond_lut[CORE_COND_LUT_LEN];
 
 /* core/arm/bdt.c */
 void core_arm_bdt(struct gba *gba, uint32_t op);
@@ -38,9 +41,6 @@ void core_arm_bdt(struct gba *gba, uint32_t op);
 void core_arm_branch(struct gba *gba, uint32_t op);
 void core_arm_branch_xchg(struct gba *gba, uint32_t op);
 
-/* core/arm/core.c */
-void core_arm_decode_insns(void);
-
 /* core/arm/mul.c */
 void core_arm_mul(struct gba *gba, uint32_t op);
 void core_arm_mull(struct gba *gba, uint32_t op);
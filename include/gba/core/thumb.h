@@ -14,18 +14,12 @@
 
 struct gba;
 
-struct hs_thumb_insn {
-    char const *name;
-    char const *mask;
-    void (*op)(struct gba *gba, uint16_t op);
-};
+#define CORE_THUMB_LUT_LEN      1024
 
-struct hs_thumb_decoded_insn {
-    uint16_t mask;
-    uint16_t value;
-};
-
-extern void (*thumb_lut[256])(struct gba *gba, uint16_t op);
+/*
+** Generated at build time from `gba/core/thumb/insns.h` (see `gba/core/gen_tables.c`).
+*/
+extern void (* const thumb_lut[CORE_THUMB_LUT_LEN])(struct gba *gba, uint16_t op);
 
 /* gba/thumb/alu.c */
 void core_thumb_lo_add(struct gba *gba, uint16_t op);
@@ -40,7 +34,22 @@ void core_thumb_hi_mov(struct gba *gba, uint16_t op);
 void core_thumb_add_sp_imm(struct gba *gba, uint16_t op);
 void core_thumb_add_pc_imm(struct gba *gba, uint16_t op);
 void core_thumb_add_sp_s_imm(struct gba *gba, uint16_t op);
-void core_thumb_alu(struct gba *gba, uint16_t op);
+void core_thumb_alu_and(struct gba *gba, uint16_t op);
+void core_thumb_alu_eor(struct gba *gba, uint16_t op);
+void core_thumb_alu_lsl(struct gba *gba, uint16_t op);
+void core_thumb_alu_lsr(struct gba *gba, uint16_t op);
+void core_thumb_alu_asr(struct gba *gba, uint16_t op);
+void core_thumb_alu_adc(struct gba *gba, uint16_t op);
+void core_thumb_alu_sbc(struct gba *gba, uint16_t op);
+void core_thumb_alu_ror(struct gba *gba, uint16_t op);
+void core_thumb_alu_tst(struct gba *gba, uint16_t op);
+void core_thumb_alu_neg(struct gba *gba, uint16_t op);
+void core_thumb_alu_cmp(struct gba *gba, uint16_t op);
+void core_thumb_alu_cmn(struct gba *gba, uint16_t op);
+void core_thumb_alu_orr(struct gba *gba, uint16_t op);
+void core_thumb_alu_mul(struct gba *gba, uint16_t op);
+void core_thumb_alu_bic(struct gba *gba, uint16_t op);
+void core_thumb_alu_mvn(struct gba *gba, uint16_t op);
 
 /* gba/thumb/branch.c */
 void core_thumb_branch(struct gba *gba, uint16_t op);
@@ -48,9 +57,6 @@ void core_thumb_branch_link(struct gba *gba, uint16_t op);
 void core_thumb_branch_xchg(struct gba *gba, uint16_t op);
 void core_thumb_branch_cond(struct gba *gba, uint16_t op);
 
-/* gba/thumb/gba.c */
-void core_thumb_decode_insns(void);
-
 /* gba/thumb/logical.c */
 void core_thumb_lsl(struct gba *gba, uint16_t op);
 void core_thumb_lsr(struct gba *gba, uint16_t op);
@@ -61,12 +67,23 @@ void core_thumb_push(struct gba *gba, uint16_t op);
 void core_thumb_pop(struct gba *gba, uint16_t op);
 void core_thumb_ldmia(struct gba *gba, uint16_t op);
 void core_thumb_stmia(struct gba *gba, uint16_t op);
-void core_thumb_sdt_imm(struct gba *gba, uint16_t op);
-void core_thumb_sdt_h_imm(struct gba *gba, uint16_t op);
-void core_thumb_sdt_wb_reg(struct gba *gba, uint16_t op);
-void core_thumb_sdt_sbh_reg(struct gba *gba, uint16_t op);
+void core_thumb_str_imm(struct gba *gba, uint16_t op);
+void core_thumb_strb_imm(struct gba *gba, uint16_t op);
+void core_thumb_ldr_imm(struct gba *gba, uint16_t op);
+void core_thumb_ldrb_imm(struct gba *gba, uint16_t op);
+void core_thumb_str_reg(struct gba *gba, uint16_t op);
+void core_thumb_strb_reg(struct gba *gba, uint16_t op);
+void core_thumb_ldr_reg(struct gba *gba, uint16_t op);
+void core_thumb_ldrb_reg(struct gba *gba, uint16_t op);
+void core_thumb_strh_imm(struct gba *gba, uint16_t op);
+void core_thumb_ldrh_imm(struct gba *gba, uint16_t op);
+void core_thumb_strh_reg(struct gba *gba, uint16_t op);
+void core_thumb_ldrh_reg(struct gba *gba, uint16_t op);
+void core_thumb_ldsb_reg(struct gba *gba, uint16_t op);
+void core_thumb_ldsh_reg(struct gba *gba, uint16_t op);
 void core_thumb_ldr_pc(struct gba *gba, uint16_t op);
-void core_thumb_sdt_sp(struct gba *gba, uint16_t op);
+void core_thumb_str_sp(struct gba *gba, uint16_t op);
+void core_thumb_ldr_sp(struct gba *gba, uint16_t op);
 
 /* gba/thumb/swi.c */
 void core_thumb_swi(struct gba *gba, uint16_t op);
@@ -25,6 +25,7 @@ enum message_kind {
     MESSAGE_QUICKSAVE,
     MESSAGE_QUICKLOAD,
     MESSAGE_SETTINGS,
+    MESSAGE_REWIND,
 
 #ifdef WITH_DEBUGGER
     MESSAGE_FRAME,
@@ -66,6 +67,11 @@ struct message_quickload {
     size_t size;
 };
 
+struct message_rewind {
+    struct event_header header;
+    bool enabled;
+};
+
 #ifdef WITH_DEBUGGER
 
 struct message_step {
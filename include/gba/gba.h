@@ -14,7 +14,7 @@
 #define GBA_SCREEN_REAL_WIDTH           308
 #define GBA_SCREEN_REAL_HEIGHT          228
 #define GBA_CYCLES_PER_PIXEL            4
-#define GBA_CYCLES_PER_FRAME            (CYCLES_PER_PIXEL * GBA_SCREEN_REAL_WIDTH * GBA_SCREEN_REAL_HEIGHT)
+#define GBA_CYCLES_PER_FRAME            (GBA_CYCLES_PER_PIXEL * GBA_SCREEN_REAL_WIDTH * GBA_SCREEN_REAL_HEIGHT)
 #define GBA_CYCLES_PER_SECOND           ((uint64_t)(16 * 1024 * 1024))
 
 #include "hades.h"
@@ -26,6 +26,8 @@
 #include "gba/apu.h"
 #include "gba/io.h"
 #include "gba/gpio.h"
+#include "gba/rewind.h"
+#include "gba/runahead.h"
 #include "gba/debugger.h"
 
 enum gba_states {
@@ -88,6 +90,29 @@ struct gba_settings {
     // Enable the emulation of the prefetch buffer
     bool prefetch_buffer;
 
+    // The way the core executes instructions
+    enum core_backends core_backend;
+
+    // Skip loops that only wait for the next scheduler event
+    bool idle_loop_detection;
+
+    // Let the host's MMU handle the mirrors of EWRAM, IWRAM, VRAM and the ROM (Linux only, see `struct mem_mirror`)
+    bool mmu_mirrors;
+
+    // Rewind (see `gba/rewind.h`)
+    struct {
+        bool enabled;
+
+        // Amount of frames between two captures
+        uint32_t interval;
+
+        // Size, in bytes, of the history
+        size_t buffer_size;
+    } rewind;
+
+    // Amount of frames to run ahead of the real timeline to hide the game's input lag, 0 to disable (see `gba/runahead.h`)
+    uint32_t run_ahead;
+
     struct {
         bool enable_bg_layers[4];
         bool enable_oam;
@@ -104,6 +129,9 @@ struct game_entry {
     enum backup_storage_types storage;
     enum gpio_device_types gpio;
     char *title;
+
+    // Override of the idle loop detection for games where the heuristic is wrong or too slow.
+    struct idle_loop_config idle_loop;
 };
 
 struct gba {
@@ -112,6 +140,10 @@ struct gba {
     // The current state of the GBA
     enum gba_states state;
 
+    // Set when the GBA is stepped by the caller's thread through the synchronous API (see `gba/sync.h`)
+    // instead of `gba_run()`. No lock is taken and no notification is sent in that mode.
+    bool synchronous;
+
     // The channel used to communicate with the frontend
     struct channels channels;
 
@@ -123,20 +155,52 @@ struct gba {
 
     // The different components of the GBA
     struct core core;
+    struct core_cache core_cache;
+    struct core_idle_loop core_idle_loop;
     struct scheduler scheduler;
     struct memory memory;
+    struct mem_page_table memory_pages;
+    struct mem_dirty memory_dirty;
+    struct mem_mirror memory_mirror;
+
+    // The Game Pak's ROM, owned by the frontend (see `launch_config.rom`).
+    // It's never written to and can be shared by all the instances running the same game.
+    struct {
+        uint8_t const *data;
+        size_t size;
+        uint64_t hash;  // Identifies the game in save states (see `quicksave_rom_hash()`)
+        bool hashed;    // Set once `hash` was computed, which is only done when it's first needed
+    } rom;
+
     struct ppu ppu;
     struct apu apu;
     struct io io;
     struct gpio gpio;
 
+    // The kernels used by the PPU to compose the scanlines, picked according to the host's CPU.
+    struct ppu_compositor const *compositor;
+
+    // The tiles of VRAM decoded by the PPU
+    struct ppu_tile_cache tile_cache;
+
+    // The content of OAM decoded by the PPU
+    struct ppu_oam_cache oam_cache;
+
+    // The history of the previous states, used to walk back in time.
+    struct rewind rewind;
+
+    // The speculative frames run to hide the game's input lag.
+    struct runahead runahead;
+
 #ifdef WITH_DEBUGGER
     struct debugger debugger;
 #endif
 };
 
 struct launch_config {
-    // The game ROM and its size
+    // The game ROM and its size.
+    // It isn't copied: it must stay valid, and unmodified, until the GBA is reset, stopped or deleted.
+    // Any read-only mapping works, like a `mmap()`ed file.
     struct {
         uint8_t *data;
         size_t size;
@@ -151,6 +215,10 @@ struct launch_config {
     // True if the BIOS should be skipped
     bool skip_bios;
 
+    // True if the BIOS' SWIs should be emulated natively.
+    // Implied if `bios.data` is NULL, in which case a minimal built-in BIOS is used.
+    bool hle_bios;
+
     // Set to the frontend's audio frequency.
     // Can be 0 if the frontend has no audio.
     uint32_t audio_frequency;
@@ -158,6 +226,9 @@ struct launch_config {
     // GPIO device attached to the cartridge.
     enum gpio_device_types gpio_device_type;
 
+    // Per-game override of the idle loop detection.
+    struct idle_loop_config idle_loop;
+
     // The kind of storage type to use.
     struct {
         enum backup_storage_types type;
@@ -176,6 +247,8 @@ enum notification_kind;
 ** The following functions are part of the public API of libgba.
 **
 ** TODO FIXME: Make a public header for libgba.
+**
+** The synchronous API, for frontends stepping the emulator from their own thread, is in `gba/sync.h`.
 */
 
 /* source/gba/gba.c */
@@ -200,5 +273,8 @@ struct game_entry *db_autodetect_game_features(uint8_t const *rom, size_t rom_si
 
 /* source/gba/gba.c */
 void gba_send_notification(struct gba *gba, enum notification_kind notif);
+void gba_state_stop(struct gba *gba);
 void gba_state_pause(struct gba *);
+void gba_state_run(struct gba *gba);
+void gba_state_reset(struct gba *gba, struct launch_config const *config);
 void gba_send_notification_raw(struct gba *gba, struct event_header const *notif_header);
@@ -203,23 +203,42 @@ struct prefetch_buffer {
     bool enabled;
 };
 
+/*
+** The mirror view (Linux only, see `gba/memory/mirror.c`).
+**
+** EWRAM, IWRAM and VRAM are backed by a memfd that is mapped both in place of their arrays in
+** `struct memory` and, with all their mirrors, at their GBA address within a 4GiB reservation.
+** The ROM is mapped there too when the frontend `mmap()`ed it, at its three wait-state mirrors.
+** The rest of the reservation is PROT_NONE.
+**
+** Reads of these regions are then a single load at `view + addr`, with no mask nor branch.
+** Writes still go through the page table, for the notifications of `template_write()`.
+*/
+#define MEM_MIRROR_VIEW_SIZE    (0x100000000ull)
+#define MEM_MIRROR_ALIGN        (0x4000)        // Of the arrays backed by the memfd, must be a multiple of the host's page size
+
+struct mem_mirror {
+    bool enabled;
+    int fd;
+    uint8_t *view;
+    size_t rom_size;        // Bytes of the ROM mapped at each of its mirrors, 0 if it isn't
+};
+
 /*
 ** The overall memory of the Gameboy Advance.
 */
 struct memory {
     // General Internal Memory
     uint8_t bios[BIOS_SIZE];
-    uint8_t ewram[EWRAM_SIZE];
-    uint8_t iwram[IWRAM_SIZE];
+    uint8_t ewram[EWRAM_SIZE] __aligned(MEM_MIRROR_ALIGN);
+    uint8_t iwram[IWRAM_SIZE] __aligned(MEM_MIRROR_ALIGN);
 
     // Internal Display Memory
     uint8_t palram[PALRAM_SIZE];
-    uint8_t vram[VRAM_SIZE];
+    uint8_t vram[VRAM_SIZE] __aligned(MEM_MIRROR_ALIGN);
     uint8_t oam[OAM_SIZE];
 
-    // External Memory (Game Pak)
-    uint8_t rom[CART_SIZE];
-    size_t rom_size;
+    // The Game Pak's ROM isn't part of the saved state (see `gba->rom`)
 
     // Backup Storage
     struct {
@@ -237,9 +256,16 @@ struct memory {
     // Prefetch buffer
     struct prefetch_buffer pbuffer;
 
+    // Access times, in cycles, indexed by access type and memory region (see `mem_update_waitstates()`)
+    uint32_t access_time16[2][16];
+    uint32_t access_time32[2][16];
+
     // BIOS Open Bus
     uint32_t bios_bus;
 
+    // Set when the BIOS' SWIs are emulated natively (see `gba/bios/hle.c`)
+    bool hle_bios;
+
     // DMA Open Bus
     uint32_t dma_bus;
 
@@ -251,6 +277,73 @@ struct memory {
     bool gamepak_bus_in_use;
 };
 
+/*
+** The fastmem page table.
+**
+** The first 256MiB of the address space are split in pages of `MEM_PAGE_SIZE` bytes.
+** Each page either points to the host memory backing it, in which case accesses are a single
+** masked load/store, or is NULL and must go through the slow path (IO, BIOS, backup storage,
+** GPIO, EEPROM, open bus, etc.).
+**
+** The table isn't part of the saved state and must be rebuilt with `mem_update_page_table()`
+** each time the memory layout changes (reset, quickload).
+**
+** Mirrors are handled by the per-page `mask`. When the host's MMU mirrors EWRAM, IWRAM, VRAM and the
+** ROM instead (see `struct mem_mirror`), the read pages of these regions point to the mirror view with
+** a mask of all ones. PALRAM and OAM mirror every 1KiB, below the size of a host page, so they're
+** always masked.
+*/
+#define MEM_PAGE_SHIFT          (14)
+#define MEM_PAGE_SIZE           (1 << MEM_PAGE_SHIFT)
+#define MEM_PAGE_MASK           (MEM_PAGE_SIZE - 1)
+#define MEM_PAGE_TABLE_END      (0x10000000)
+#define MEM_PAGE_COUNT          (MEM_PAGE_TABLE_END >> MEM_PAGE_SHIFT)
+
+struct mem_page {
+    uint8_t *data;
+    uint32_t mask;          // Applied to the address before indexing `data`
+    uint16_t cache_base;    // The `core_cache` page of `data`, or `CORE_CACHE_NO_PAGE` if there's no code to invalidate
+    uint16_t dirty_base;    // The first dirty block of `data`, or `MEM_DIRTY_NO_BLOCK` if writes aren't tracked (VRAM and OAM always are, for the PPU)
+};
+
+struct mem_page_table {
+    struct mem_page read[MEM_PAGE_COUNT];
+    struct mem_page write[MEM_PAGE_COUNT];
+};
+
+/*
+** Dirty-block tracking.
+**
+** When enabled, every write to EWRAM, IWRAM, PALRAM, VRAM or OAM sets the bit of the
+** `MEM_DIRTY_BLOCK_SIZE` bytes block it lands in, until the frontend clears the bitmap.
+** It lets incremental snapshots (rewind, run-ahead, netplay) and renderer caches skip the
+** memory that didn't change.
+**
+** Blocks of all regions are numbered in a single space, each region starting at its `MEM_DIRTY_*_BLOCK`.
+**
+** Tracking is disabled by default. The only cost it has then is a test on the `dirty_base` of
+** the page, which sits in the same cache line as the rest of the page's entry.
+*/
+#define MEM_DIRTY_SHIFT         (8)
+#define MEM_DIRTY_BLOCK_SIZE    (1 << MEM_DIRTY_SHIFT)
+#define MEM_DIRTY_EWRAM_BLOCK   (0)
+#define MEM_DIRTY_IWRAM_BLOCK   (MEM_DIRTY_EWRAM_BLOCK + (EWRAM_SIZE >> MEM_DIRTY_SHIFT))
+#define MEM_DIRTY_PALRAM_BLOCK  (MEM_DIRTY_IWRAM_BLOCK + (IWRAM_SIZE >> MEM_DIRTY_SHIFT))
+#define MEM_DIRTY_VRAM_BLOCK    (MEM_DIRTY_PALRAM_BLOCK + (PALRAM_SIZE >> MEM_DIRTY_SHIFT))
+#define MEM_DIRTY_OAM_BLOCK     (MEM_DIRTY_VRAM_BLOCK + (VRAM_SIZE >> MEM_DIRTY_SHIFT))
+#define MEM_DIRTY_BLOCKS        (MEM_DIRTY_OAM_BLOCK + (OAM_SIZE >> MEM_DIRTY_SHIFT))
+#define MEM_DIRTY_NO_BLOCK      (UINT16_MAX)
+
+static_assert(MEM_DIRTY_BLOCKS < MEM_DIRTY_NO_BLOCK);
+
+struct mem_dirty {
+    bool enabled;
+    uint64_t bits[(MEM_DIRTY_BLOCKS + 63) / 64];
+};
+
+#define mem_dirty_mark(gba, block)          ((gba)->memory_dirty.bits[(block) / 64] |= (1ull << ((block) % 64)))
+#define mem_dirty_test(gba, block)          (!!((gba)->memory_dirty.bits[(block) / 64] & (1ull << ((block) % 64))))
+
 /*
 ** The different timings at which a DMA transfer can occur.
 */
@@ -274,12 +367,21 @@ void mem_dma_do_all_pending_transfers(struct gba *gba);
 void mem_dma_add_to_pending(struct gba *gba, struct event_args args);
 
 /* gba/memory/io.c */
+uint16_t mem_io_read16(struct gba const *gba, uint32_t addr);
+uint32_t mem_io_read32(struct gba const *gba, uint32_t addr);
 uint8_t mem_io_read8(struct gba const *gba, uint32_t addr);
+void mem_io_write32(struct gba *gba, uint32_t addr, uint32_t val);
+void mem_io_write16(struct gba *gba, uint32_t addr, uint16_t val);
 void mem_io_write8(struct gba *gba, uint32_t addr, uint8_t val);
 
 /* gba/memory/memory.c */
 void mem_access(struct gba *gba, uint32_t addr, uint32_t size, enum access_types access_type);
-void mem_update_waitstates(struct gba const *gba);
+void mem_update_waitstates(struct gba *gba);
+void mem_update_page_table(struct gba *gba);
+void mem_dirty_enable(struct gba *gba, bool enable);
+void mem_dirty_clear(struct gba *gba);
+void mem_dirty_mark_range(struct gba *gba, uint32_t base, uint32_t offset, uint32_t size);
+void mem_dirty_mark_all(struct gba *gba);
 void mem_prefetch_buffer_access(struct gba *gba, uint32_t addr, uint32_t intended_cycles);
 void mem_prefetch_buffer_step(struct gba *gba, uint32_t cycles);
 uint32_t mem_openbus_read(struct gba const *gba, uint32_t addr);
@@ -298,6 +400,10 @@ void mem_write16_raw(struct gba *gba, uint32_t addr, uint16_t val);
 void mem_write32(struct gba *gba, uint32_t addr, uint32_t val, enum access_types access_type);
 void mem_write32_raw(struct gba *gba, uint32_t addr, uint32_t val);
 
+/* gba/memory/mirror.c */
+bool mem_mirror_enable(struct gba *gba, bool enable);
+void mem_mirror_map_rom(struct gba *gba);
+
 /* gba/memory/storage/eeprom.c */
 uint8_t mem_eeprom_read8(struct gba *gba);
 void mem_eeprom_write8(struct gba *gba, bool val);
@@ -312,7 +418,8 @@ void mem_backup_storage_write8(struct gba *gba, uint32_t addr, uint8_t value);
 void mem_backup_storage_write_to_disk(struct gba *gba);
 
 /* gba/quicksave.c */
-void quicksave(struct gba const *gba, uint8_t **data, size_t *size);
+uint64_t quicksave_rom_hash(uint8_t const *rom, size_t size);
+void quicksave(struct gba *gba, uint8_t **data, size_t *size);
 bool quickload(struct gba *gba, uint8_t *data, size_t size);
 
 /*
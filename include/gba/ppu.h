@@ -46,20 +46,81 @@ union color {
 
 static_assert(sizeof(union color) == sizeof(uint16_t));
 
-struct rich_color {
-    union color;
-    uint8_t idx: 6; // 0-3 for bgs, 4 for OAM, 5 for BD
-    uint8_t visible: 1;
-    uint8_t force_blend: 1; // Only useful for OAM
-} __packed;
+#define PPU_LAYER_VISIBLE       (1 << 0)
+#define PPU_LAYER_FORCE_BLEND   (1 << 1)    // Only useful for OBJ
+
+#define PPU_WIN_BLEND           (1 << 5)    // The bit of WININ/WINOUT enabling the color special effects
 
+/*
+** The working set of the PPU while it renders a scanline.
+**
+** Each layer is a plane of BGR555 colors and a plane of flags (`PPU_LAYER_*`, 0 for transparent
+** pixels), so the renderers and the kernels of `gba/ppu/compositor.c` only read and write whole
+** words. It is small enough to stay in the L1 cache.
+*/
 struct scanline {
-    struct rich_color bot[GBA_SCREEN_WIDTH];
-    struct rich_color bg[GBA_SCREEN_WIDTH];
-    struct rich_color oam[4][GBA_SCREEN_WIDTH];
-    struct rich_color result[GBA_SCREEN_WIDTH];
-    bool win_obj_mask[GBA_SCREEN_WIDTH];
+    // The BG being rendered, `top_idx` being its index (or 5 for the backdrop).
+    uint16_t bg[GBA_SCREEN_WIDTH] __aligned(32);
+    uint8_t bg_flags[GBA_SCREEN_WIDTH] __aligned(32);
     uint32_t top_idx;
+
+    // The OBJ layer: only the front-most sprite pixel of each column is kept, along with its priority.
+    uint16_t obj[GBA_SCREEN_WIDTH] __aligned(32);
+    uint8_t obj_flags[GBA_SCREEN_WIDTH] __aligned(32);
+    uint8_t obj_prio[GBA_SCREEN_WIDTH] __aligned(32);
+    uint8_t obj_prios;                                      // A bitmask of the priorities found in `obj_prio`
+    bool win_obj_mask[GBA_SCREEN_WIDTH] __aligned(32);
+
+    // The state of the compositor
+    uint16_t result[GBA_SCREEN_WIDTH] __aligned(32);        // The colors of the layers merged so far
+    uint16_t bot[GBA_SCREEN_WIDTH] __aligned(32);           // The color of the last layer merged
+    uint8_t bot_target[GBA_SCREEN_WIDTH] __aligned(32);     // Set if that layer is a second target of BLDCNT
+    uint8_t win_opts[GBA_SCREEN_WIDTH] __aligned(32);       // The WININ/WINOUT flags of the window covering each pixel
+};
+
+/*
+** The parameters of the color special effects for the layer being merged.
+*/
+struct ppu_blend {
+    // The mode of BLDCNT if the layer is one of its first targets, `BLEND_OFF` otherwise.
+    enum blend_mode mode;
+
+    // Set if the layer is one of the second targets of BLDCNT.
+    bool bot_target;
+
+    // Set if the windows are enabled, in which case `win_bit` must be set in `scanline->win_opts`
+    // for the layer to be shown.
+    bool windowed;
+    uint8_t win_bit;
+
+    // When merging the OBJ layer, only the pixels of that priority are merged.
+    uint8_t prio;
+
+    uint16_t eva;
+    uint16_t evb;
+    uint16_t evy;
+};
+
+/*
+** The kernels composing the scanlines.
+** `ppu_compositor_select()` picks the fastest set supported by the host's CPU.
+*/
+struct ppu_compositor {
+    // Fill `scanline->win_opts`
+    void (*build_win_opts)(struct scanline *scanline, bool const *win0, bool const *win1, uint8_t const opts[WIN_MAX + 1]);
+
+    // Merge the given layer with the layers below it.
+    // `prios` is NULL for the BGs and `scanline->obj_prio` for the OBJ layer.
+    void (*merge)(
+        struct scanline *scanline,
+        uint16_t const *colors,
+        uint8_t const *flags,
+        uint8_t const *prios,
+        struct ppu_blend const *blend
+    );
+
+    // Convert `scanline->result` from BGR555 to RGBA8888
+    void (*draw)(uint32_t *pixels, struct scanline const *scanline);
 };
 
 union tile {
@@ -110,6 +171,86 @@ union oam_entry {
 
 static_assert(sizeof(union oam_entry) == 3 * sizeof(uint16_t));
 
+/*
+** The cache of decoded tiles.
+**
+** Each 8x8 tile of VRAM is expanded to one byte per pixel (its palette index, without the
+** palette bank for 4bpp tiles), so each row of 8 pixels is a single `uint64_t`, the leftmost
+** pixel being the lowest byte. Horizontally flipped rows are obtained by reversing the bytes
+** of a row, and vertically flipped tiles by reading their rows backward.
+**
+** Tiles are indexed by their offset in VRAM divided by 32. They are decoded the first time they
+** are used and stay valid until any byte they are made of is written to.
+*/
+#define PPU_TILE_CACHE_SHIFT        (5)
+#define PPU_TILE_CACHE_TILES        (VRAM_SIZE >> PPU_TILE_CACHE_SHIFT)
+
+struct ppu_tile_cache {
+    uint64_t (*tiles_4bpp)[8];
+    uint64_t (*tiles_8bpp)[8];
+
+    uint64_t valid_4bpp[PPU_TILE_CACHE_TILES / 64];
+    uint64_t valid_8bpp[PPU_TILE_CACHE_TILES / 64];
+};
+
+/*
+** Return the rows of the tile at the given address of VRAM, which must be aligned on 32 bytes.
+*/
+#define ppu_tile_cache_get(gba, addr, color_256)                                                    \
+    ({                                                                                              \
+        struct ppu_tile_cache *_cache;                                                              \
+        uint64_t const *_valid;                                                                     \
+        uint32_t _tile;                                                                             \
+                                                                                                    \
+        _cache = &(gba)->tile_cache;                                                                \
+        _tile = ((addr) & (((addr) & 0x10000) ? VRAM_MASK_1 : VRAM_MASK_2)) >> PPU_TILE_CACHE_SHIFT;  \
+        _valid = (color_256) ? _cache->valid_8bpp : _cache->valid_4bpp;                             \
+        if (unlikely(!(_valid[_tile / 64] & (1ull << (_tile % 64))))) {                             \
+            ppu_tile_cache_decode((gba), _tile, (color_256));                                       \
+        }                                                                                           \
+        (uint64_t const *)((color_256) ? _cache->tiles_8bpp[_tile] : _cache->tiles_4bpp[_tile]);    \
+    })
+
+/*
+** A sprite, as decoded from OAM.
+*/
+struct ppu_sprite {
+    union oam_entry oam;
+
+    int32_t win_ox;         // Coordinates of the sprite's bounding box on screen
+    int32_t win_oy;
+    int32_t win_sx;         // Size of the bounding box (twice the sprite's size for double-sized affine sprites)
+    int32_t win_sy;
+    int32_t sprite_sx;      // Size of the sprite
+    int32_t sprite_sy;
+    int32_t x_start;        // Part of the bounding box that is on screen, relative to `win_ox`
+    int32_t x_end;
+
+    int16_t pa;             // Affine matrix, identity for regular sprites
+    int16_t pb;
+    int16_t pc;
+    int16_t pd;
+};
+
+/*
+** The sprites decoded from OAM and, for each visible line, the indexes of the sprites it crosses,
+** from the last to the first.
+**
+** Rebuilt lazily by the PPU when OAM was written to since the last time it was used.
+*/
+struct ppu_oam_cache {
+    bool dirty;
+
+    struct ppu_sprite sprites[128];
+    uint8_t lines[GBA_SCREEN_HEIGHT][128];
+    uint8_t lines_len[GBA_SCREEN_HEIGHT];
+};
+
+/*
+** Must be called each time OAM is written to.
+*/
+#define ppu_oam_cache_invalidate(gba)       ((gba)->oam_cache.dirty = true)
+
 struct ppu {
     /* The emulator's screen as it is being rendered. */
     uint32_t framebuffer[GBA_SCREEN_WIDTH * GBA_SCREEN_HEIGHT];
@@ -131,13 +272,23 @@ void ppu_render_background_bitmap(struct gba const *gba, struct scanline *scanli
 void ppu_render_background_bitmap_small(struct gba const *gba, struct scanline *scanline);
 
 /* gba/ppu/background/text.c */
-void ppu_render_background_text(struct gba const *gba, struct scanline *scanline, uint32_t line, uint32_t bg_idx);
+void ppu_render_background_text(struct gba *gba, struct scanline *scanline, uint32_t line, uint32_t bg_idx);
 
 /* gba/ppu/background/affine.c */
 void ppu_render_background_affine(struct gba *gba, struct scanline *scanline, uint32_t line, uint32_t bg_idx);
 void ppu_reload_affine_internal_registers(struct gba *gba, uint32_t idx);
 void ppu_step_affine_internal_registers(struct gba *gba);
 
+/* gba/ppu/cache.c */
+void ppu_tile_cache_init(struct ppu_tile_cache *cache);
+void ppu_tile_cache_cleanup(struct ppu_tile_cache *cache);
+void ppu_tile_cache_flush(struct gba *gba);
+void ppu_tile_cache_invalidate(struct gba *gba, uint32_t offset, uint32_t size);
+void ppu_tile_cache_decode(struct gba *gba, uint32_t tile, bool color_256);
+
+/* gba/ppu/compositor.c */
+struct ppu_compositor const *ppu_compositor_select(void);
+
 /* gba/ppu/oam.c */
 void ppu_prerender_oam(struct gba *gba, struct scanline *scanline, int32_t line);
 
@@ -148,4 +299,4 @@ void ppu_hdraw(struct gba *gba, struct event_args args);
 
 /* gba/ppu/window.c */
 void ppu_window_build_masks(struct gba *gba, uint32_t y);
-uint8_t ppu_find_top_window(struct gba const *gba, struct scanline const *, uint32_t x);
+void ppu_window_build_opts(struct gba const *gba, struct scanline *scanline);
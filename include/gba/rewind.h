@@ -0,0 +1,69 @@
+/******************************************************************************\
+**
+**  This file is part of the Hades GBA Emulator, and is made available under
+**  the terms of the GNU General Public License version 2.
+**
+**  Copyright (C) 2021-2024 - The Hades Authors
+**
+\******************************************************************************/
+
+#pragma once
+
+#include "hades.h"
+
+/*
+** Rewind.
+**
+** Every `settings.rewind.interval` frames, the state of the GBA is compared against the previous
+** capture, kept in `image`, and the differences are pushed to a ring buffer of `settings.rewind.buffer_size`
+** bytes. Walking back in time pops the newest delta and applies it to `image`, which is then copied
+** back to the GBA.
+**
+** A delta is the XOR of the two states, stored as a list of runs of non-zero 8-byte words:
+**
+**     u32 offset (in `image`) | u32 length | `length` bytes of XOR
+**
+** Only the RAM blocks marked as dirty since the previous capture are compared (see `struct mem_dirty`),
+** so a capture usually takes a few microseconds and a few kilobytes.
+**
+** When the ring buffer is full, the oldest deltas are dropped.
+*/
+
+struct rewind {
+    // Set while the frontend walks back in time
+    bool rewinding;
+
+    // Frames run since the last capture
+    uint32_t frames;
+
+    // Index of the frame the GBA was in when `rewind_update()` was last called
+    uint64_t frame;
+
+    // The state of the GBA at the last capture (or restore)
+    uint8_t *image;
+    size_t image_size;
+    size_t image_events;            // Amount of scheduler events `image` can hold
+
+    // Scratch buffers used to build a delta and a copy of the scheduler's events
+    uint8_t *delta;
+    uint8_t *events;
+
+    // The ring buffer of deltas.
+    // Each delta is written as `u32 size | delta | u32 size` so the buffer can be walked both ways.
+    uint8_t *ring;
+    size_t ring_size;
+    size_t head;                    // End of the newest delta
+    size_t tail;                    // Start of the oldest delta
+    size_t wrap;                    // End of the data before `head` wrapped around, if `wrapped` is set
+    bool wrapped;
+    size_t count;
+};
+
+struct gba;
+
+/* gba/rewind.c */
+void rewind_reset(struct gba *gba);
+void rewind_cleanup(struct gba *gba);
+void rewind_update(struct gba *gba);
+void rewind_capture(struct gba *gba);
+bool rewind_restore(struct gba *gba);
@@ -0,0 +1,50 @@
+/******************************************************************************\
+**
+**  This file is part of the Hades GBA Emulator, and is made available under
+**  the terms of the GNU General Public License version 2.
+**
+**  Copyright (C) 2021-2024 - The Hades Authors
+**
+\******************************************************************************/
+
+#pragma once
+
+#include "hades.h"
+
+/*
+** Run-ahead.
+**
+** Most games only react to the keys pressed one or more frames later. To hide that lag, each time
+** a frame is finished, the state of the GBA is saved, `settings.run_ahead` more frames are run with
+** the current keys, the last one is shown to the frontend and the saved state is brought back.
+**
+** Nothing but the last speculative frame is ever published to the frontend: the audio of the
+** speculative frames is dropped and the frames rendered in the real timeline are hidden.
+**
+** The state is saved to a buffer allocated once, when run-ahead is enabled, so saving and restoring
+** it only costs a few `memcpy()`.
+*/
+
+struct runahead_state;
+
+struct runahead {
+    // Set while the speculative frames are running
+    bool speculating;
+
+    // Set when the frame rendered must not be shown to the frontend
+    bool hide_frame;
+
+    // Index of the VBlank the GBA was in when `runahead_update()` was last called
+    uint64_t vblank;
+
+    // The state saved before running the speculative frames.
+    // NULL if run-ahead is disabled.
+    struct runahead_state *state;
+};
+
+struct gba;
+
+/* gba/runahead.c */
+void runahead_reset(struct gba *gba);
+void runahead_cleanup(struct gba *gba);
+void runahead_update(struct gba *gba);
@@ -29,6 +29,10 @@ enum sched_event_kind {
     SCHED_EVENT_DMA_ADD_PENDING,
     SCHED_EVENT_IO_WRITE,
     SCHED_EVENT_CORE_UPDATE_IRQ_LINE,
+
+    SCHED_EVENT_MIN = SCHED_EVENT_FRAME_LIMITER,
+    SCHED_EVENT_MAX = SCHED_EVENT_CORE_UPDATE_IRQ_LINE,
+    SCHED_EVENT_LEN = SCHED_EVENT_MAX + 1,
 };
 
 enum sched_event_type {
@@ -61,6 +65,17 @@ struct scheduler_event {
 
     // The "argument" given to the event callback.
     struct event_args args;
+
+    // Position of the event within the heap it currently belongs to (`active` or `free`).
+    size_t heap_idx;
+};
+
+/*
+** A binary min-heap of event handles.
+*/
+struct scheduler_heap {
+    event_handler_t *handles;
+    size_t len;
 };
 
 struct scheduler {
@@ -68,9 +83,17 @@ struct scheduler {
 
     uint64_t next_event;            // The next event should occure when cycles == next_event
 
+    // The events, indexed by their handle. An event never moves within this array
+    // so its handle stays valid until it is cancelled or fired.
     struct scheduler_event *events;
     size_t events_size;
 
+    // The handles of all active events, ordered by `at` (the earliest being at the top).
+    struct scheduler_heap active;
+
+    // The handles of all inactive events, ordered by index so the lowest slot is reused first.
+    struct scheduler_heap free;
+
     uint64_t time_per_frame;        // In usec
     uint64_t time_last_frame;       // In usec
     uint64_t accumulated_time;
@@ -129,6 +152,8 @@ struct gba;
 /* gba/scheduler.c */
 event_handler_t sched_add_event(struct gba *gba, struct scheduler_event event);
 void sched_cancel_event(struct gba *gba, event_handler_t handler);
+void sched_rebuild(struct gba *gba);
+void sched_cleanup(struct gba *gba);
 void sched_process_events(struct gba *gba);
 void sched_run_for(struct gba *gba, uint64_t cycles);
 void sched_frame_limiter(struct gba *gba,struct event_args args);
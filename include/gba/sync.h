@@ -0,0 +1,47 @@
+/******************************************************************************\
+**
+**  This file is part of the Hades GBA Emulator, and is made available under
+**  the terms of the GNU General Public License version 2.
+**
+**  Copyright (C) 2021-2024 - The Hades Authors
+**
+\******************************************************************************/
+
+#pragma once
+
+#include "hades.h"
+#include "gba/gba.h"
+
+/*
+** Synchronous API of libgba.
+**
+** It lets the caller step the emulator from its own thread, which is what batch runners,
+** benchmarks and test drivers want: there's no channel, no message, no lock and no frame limiter.
+**
+** A typical use looks like:
+**
+**     gba = gba_sync_create();
+**     gba_sync_reset(gba, &config);
+**     while (...) {
+**         gba_set_key(gba, KEY_A, true);
+**         gba_run_frame(gba);
+**         gba_read_framebuffer(gba, pixels);
+**         gba_read_audio(gba, samples, array_length(samples) / 2);
+**     }
+**     gba_delete(gba);
+**
+** A GBA created with `gba_sync_create()` must never be given to `gba_run()`.
+** Different GBAs can be stepped concurrently on different threads.
+*/
+
+/* source/gba/sync.c */
+struct gba *gba_sync_create(void);
+void gba_sync_reset(struct gba *gba, struct launch_config const *config);
+void gba_run_frame(struct gba *gba);
+void gba_run_cycles(struct gba *gba, uint64_t cycles);
+void gba_set_key(struct gba *gba, enum keys key, bool pressed);
+void gba_set_rewind(struct gba *gba, bool enabled);
+void gba_read_framebuffer(struct gba const *gba, uint32_t *pixels);
+size_t gba_read_audio(struct gba *gba, int16_t *samples, size_t max_frames);
+void gba_snapshot(struct gba *gba, uint8_t **data, size_t *size);
+bool gba_restore(struct gba *gba, uint8_t *data, size_t size);
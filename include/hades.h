@@ -33,6 +33,9 @@
 #ifndef __packed
 # define __packed           __attribute__((packed))
 #endif /* !__packed */
+#ifndef __aligned
+# define __aligned(x)       __attribute__((aligned(x)))
+#endif /* !__aligned */
 #ifndef likely
 # define likely(x)          __builtin_expect((x), 1)
 #endif /* !likely */
@@ -42,6 +45,9 @@
 #ifndef __noreturn
 # define __noreturn         __attribute__((noreturn))
 #endif /* !__noreturn */
+#ifndef __always_inline
+# define __always_inline    inline __attribute__((always_inline))
+#endif /* !__always_inline */
 
 /* Panic if the given constant expression evaluates to `false`. */
 #undef static_assert
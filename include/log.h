@@ -54,8 +54,8 @@ extern char const *g_light_magenta;
 extern char const *g_light_cyan;
 extern char const *g_white;
 
-extern bool g_verbose[HS_END];
-extern bool g_verbose_global;
+extern atomic_bool g_verbose[HS_END];
+extern atomic_bool g_verbose_global;
 
 static char const * const modules_str[] = {
     [HS_INFO]       = " INFO  ",
@@ -71,8 +71,41 @@ static char const * const modules_str[] = {
     [HS_DEBUG]      = " DEBUG ",
 };
 
+/*
+** The modules from `HS_CORE` onward trace the emulation and can only be enabled through the debugger.
+** They are compiled out of the builds without it.
+*/
+#ifdef WITH_DEBUGGER
+# define LOG_TRACE_MODULES      true
+#else
+# define LOG_TRACE_MODULES      false
+#endif
+
+/* Return `true` if the given module is being logged. */
+#define log_enabled(module)                                                                 \
+    (                                                                                       \
+        ((module) < HS_CORE || LOG_TRACE_MODULES)                                           \
+        && atomic_load_explicit(&g_verbose_global, memory_order_relaxed)                    \
+        && atomic_load_explicit(&g_verbose[(module)], memory_order_relaxed)                 \
+    )
+
+/*
+** Log the given formatted string, followed by a `\n`.
+**
+** The arguments are only evaluated if the module is being logged.
+*/
+#define logln(module, ...)                                                                  \
+    do {                                                                                    \
+        if (unlikely(log_enabled(module))) {                                                \
+            log_print((module), __VA_ARGS__);                                               \
+        }                                                                                   \
+    } while (0)
+
 /* log.c */
-void logln(enum modules module, char const *fmt, ...) __attribute__ ((format (printf, 2, 3)));
+void log_print(enum modules module, char const *fmt, ...) __attribute__ ((format (printf, 2, 3)));
+void log_deferred_start(void);
+void log_deferred_stop(void);
+bool log_deferred_running(void);
 void panic(enum modules module, char const *fmt, ...) __attribute__ ((format (printf, 2, 3))) __attribute__((noreturn));
 void unimplemented(enum modules module, char const *fmt, ...) __attribute__ ((format (printf, 2, 3))) __attribute__((noreturn));
 void disable_colors(void);
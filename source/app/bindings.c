@@ -45,6 +45,7 @@ app_bindings_setup_default(
     app_bindings_keyboard_binding_build(&app->binds.keyboard[BIND_EMULATOR_SCREENSHOT], SDL_GetKeyFromName("F12"), false, false, false);
     app_bindings_keyboard_binding_build(&app->binds.keyboard[BIND_EMULATOR_ALT_SPEED_HOLD], SDL_GetKeyFromName("Space"), false, false, false);
     app_bindings_keyboard_binding_build(&app->binds.keyboard[BIND_EMULATOR_ALT_SPEED_TOGGLE], SDL_GetKeyFromName("Space"), true, false, false);
+    app_bindings_keyboard_binding_build(&app->binds.keyboard[BIND_EMULATOR_REWIND], SDL_GetKeyFromName("`"), false, false, false);
 
     for (i = 0; i < MAX_QUICKSAVES && i < 10; ++i) {
         app_bindings_keyboard_binding_build(&app->binds.keyboard[BIND_EMULATOR_QUICKSAVE_1 + i], SDL_GetKeyFromName("F1") + i, false, false, false);
@@ -73,6 +74,7 @@ app_bindings_setup_default(
     app->binds.controller[BIND_GBA_SELECT] = SDL_CONTROLLER_BUTTON_BACK;
     app->binds.controller[BIND_EMULATOR_SCREENSHOT] = SDL_CONTROLLER_BUTTON_GUIDE;
     app->binds.controller[BIND_EMULATOR_ALT_SPEED_TOGGLE] = SDL_CONTROLLER_BUTTON_RIGHTSTICK;
+    app->binds.controller[BIND_EMULATOR_REWIND] = SDL_CONTROLLER_BUTTON_LEFTSTICK;
 #if SDL_VERSION_ATLEAST(2, 0, 14)
     app->binds.controller[BIND_EMULATOR_ALT_SPEED_HOLD] = SDL_CONTROLLER_BUTTON_TOUCHPAD;
 #endif
@@ -207,6 +209,12 @@ app_bindings_process(
             app_emulator_settings(app);
             break;
         };
+        case BIND_EMULATOR_REWIND: {
+            if (app->emulation.is_started) {
+                app_emulator_rewind(app, pressed);
+            }
+            break;
+        };
         default: break;
     }
 
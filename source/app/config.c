@@ -96,6 +96,38 @@ app_config_load(
             app->settings.emulation.prefetch_buffer = b;
         }
 
+        if (mjson_get_number(data, data_len, "$.emulation.core_backend", &d)) {
+            app->settings.emulation.core_backend = max(CORE_BACKEND_MIN, min((int)d, CORE_BACKEND_MAX));
+        }
+
+        if (mjson_get_bool(data, data_len, "$.emulation.idle_loop_detection", &b)) {
+            app->settings.emulation.idle_loop_detection = b;
+        }
+
+        if (mjson_get_bool(data, data_len, "$.emulation.mmu_mirrors", &b)) {
+            app->settings.emulation.mmu_mirrors = b;
+        }
+
+        if (mjson_get_bool(data, data_len, "$.emulation.hle_bios", &b)) {
+            app->settings.emulation.hle_bios = b;
+        }
+
+        if (mjson_get_bool(data, data_len, "$.emulation.rewind.enabled", &b)) {
+            app->settings.emulation.rewind.enabled = b;
+        }
+
+        if (mjson_get_number(data, data_len, "$.emulation.rewind.interval", &d)) {
+            app->settings.emulation.rewind.interval = max(1, min((int)d, 60));
+        }
+
+        if (mjson_get_number(data, data_len, "$.emulation.rewind.buffer_size", &d)) {
+            app->settings.emulation.rewind.buffer_size = max(8, min((int)d, 1024));
+        }
+
+        if (mjson_get_number(data, data_len, "$.emulation.run_ahead", &d)) {
+            app->settings.emulation.run_ahead = max(0, min((int)d, 4));
+        }
+
         if (mjson_get_bool(data, data_len, "$.emulation.start_last_played_game_on_startup", &b)) {
             app->settings.emulation.start_last_played_game_on_startup = b;
         }
@@ -329,6 +361,16 @@ app_config_save(
                 "speed": %g,
                 "alt_speed": %g,
                 "prefetch_buffer": %B,
+                "core_backend": %d,
+                "idle_loop_detection": %B,
+                "mmu_mirrors": %B,
+                "hle_bios": %B,
+                "rewind": {
+                    "enabled": %B,
+                    "interval": %d,
+                    "buffer_size": %d
+                },
+                "run_ahead": %d,
                 "start_last_played_game_on_startup": %B,
                 "pause_when_window_inactive": %B,
                 "pause_when_game_resets": %B,
@@ -381,6 +423,14 @@ app_config_save(
         app->settings.emulation.speed,
         app->settings.emulation.alt_speed,
         (int)app->settings.emulation.prefetch_buffer,
+        (int)app->settings.emulation.core_backend,
+        (int)app->settings.emulation.idle_loop_detection,
+        (int)app->settings.emulation.mmu_mirrors,
+        (int)app->settings.emulation.hle_bios,
+        (int)app->settings.emulation.rewind.enabled,
+        (int)app->settings.emulation.rewind.interval,
+        (int)app->settings.emulation.rewind.buffer_size,
+        (int)app->settings.emulation.run_ahead,
         (int)app->settings.emulation.start_last_played_game_on_startup,
         (int)app->settings.emulation.pause_when_window_inactive,
         (int)app->settings.emulation.pause_when_game_resets,
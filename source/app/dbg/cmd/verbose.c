@@ -14,7 +14,7 @@
 
 struct verbosity_arg {
     char const *name;
-    bool *flag;
+    atomic_bool *flag;
 };
 
 struct verbosity_arg verbosities[] = {
@@ -54,6 +54,14 @@ debugger_cmd_verbose(
                 g_reset
             );
         }
+
+        printf(
+            "%6s: %s%s%s\n",
+            "deferred",
+            log_deferred_running() ? g_light_green : g_light_red,
+            log_deferred_running() ? "true" : "false",
+            g_reset
+        );
     } else if (argc == 1) {
         uint32_t i;
 
@@ -61,6 +69,24 @@ debugger_cmd_verbose(
             return;
         }
 
+        // Toggle the deferred logging, formatted and printed by a separate thread
+        if (!strcmp("deferred", argv[0].value.s)) {
+            if (log_deferred_running()) {
+                log_deferred_stop();
+            } else {
+                log_deferred_start();
+            }
+
+            printf(
+                "Deferred logging set to %s%s%s\n",
+                g_light_magenta,
+                log_deferred_running() ? "true" : "false",
+                g_reset
+            );
+
+            return;
+        }
+
         // Easily toggle all verbosities on or off
         if (!strcmp("all", argv[0].value.s)) {
             bool all;
@@ -111,8 +111,8 @@ struct command g_commands[] = {
     [CMD_VERBOSE] = {
         .name = "verbose",
         .alias = "v",
-        .usage = "verbose [NAME|all]",
-        .description = "Inverse the verbosity of module NAME.",
+        .usage = "verbose [NAME|all|deferred]",
+        .description = "Inverse the verbosity of module NAME, or toggle the logging from a separate thread (deferred).",
         .func = debugger_cmd_verbose,
     },
     [CMD_RESET] = {
@@ -197,6 +197,14 @@ app_emulator_fill_gba_settings(
     }
 
     settings->prefetch_buffer = app->settings.emulation.prefetch_buffer;
+    settings->core_backend = app->settings.emulation.core_backend;
+    settings->idle_loop_detection = app->settings.emulation.idle_loop_detection;
+    settings->mmu_mirrors = app->settings.emulation.mmu_mirrors;
+
+    settings->rewind.enabled = app->settings.emulation.rewind.enabled;
+    settings->rewind.interval = app->settings.emulation.rewind.interval;
+    settings->rewind.buffer_size = (size_t)app->settings.emulation.rewind.buffer_size * 1024 * 1024;
+    settings->run_ahead = app->settings.emulation.run_ahead;
 
     settings->ppu.enable_oam = app->settings.video.enable_oam;
     memcpy(settings->ppu.enable_bg_layers, app->settings.video.enable_bg_layers, sizeof(settings->ppu.enable_bg_layers));
@@ -205,6 +213,29 @@ app_emulator_fill_gba_settings(
     memcpy(settings->apu.enable_fifo_channels, app->settings.audio.enable_fifo_channels, sizeof(settings->apu.enable_fifo_channels));
 }
 
+/*
+** Stop the emulation and wait until the GBA acknowledges it.
+**
+** The GBA uses the ROM of the launch configuration in place, so this must be done before releasing it.
+*/
+static
+void
+app_emulator_stop_and_wait(
+    struct app *app
+) {
+    struct message event;
+
+    event.header.kind = MESSAGE_STOP;
+    event.header.size = sizeof(event);
+
+    app_emulator_process_all_notifs(app);
+    channel_lock(&app->emulation.gba->channels.messages);
+    channel_push(&app->emulation.gba->channels.messages, &event.header);
+    channel_release(&app->emulation.gba->channels.messages);
+
+    app_emulator_wait_for_notification(app, NOTIFICATION_STOP);
+}
+
 static
 void
 app_emulator_unconfigure(
@@ -212,7 +243,14 @@ app_emulator_unconfigure(
 ) {
     if (app->emulation.launch_config) {
         free(app->emulation.launch_config->bios.data);
-        free(app->emulation.launch_config->rom.data);
+
+        if (app->emulation.is_rom_mapped) {
+            hs_unmap_file(app->emulation.launch_config->rom.data, app->emulation.launch_config->rom.size);
+        } else {
+            free(app->emulation.launch_config->rom.data);
+        }
+        app->emulation.is_rom_mapped = false;
+
         free(app->emulation.launch_config);
         app->emulation.launch_config = NULL;
     }
@@ -243,6 +281,13 @@ app_emulator_configure_bios(
     void *data;
 
     bios_path = app->args.bios_path ?: app->settings.emulation.bios_path;
+
+    // The HLE BIOS doesn't need a BIOS dump, but uses it if there's one.
+    if (app->settings.emulation.hle_bios && (!bios_path || !hs_fexists(bios_path))) {
+        logln(HS_WARNING, "No BIOS found, using the built-in HLE BIOS instead.");
+        return (false);
+    }
+
     if (!bios_path) {
         app_new_notification(
             app,
@@ -391,12 +436,16 @@ app_emulator_configure_rom(
     struct app *app,
     char const *rom_path
 ) {
-    FILE *file;
     size_t file_len;
     void *data;
 
-    file = hs_fopen(rom_path, "rb");
-    if (!file) {
+    /*
+    ** The ROM is mapped instead of read: the GBA uses it in place, so it's never copied and
+    ** its pages are shared with the page cache.
+    */
+    file_len = 0;
+    data = hs_map_file(rom_path, &file_len);
+    if (!data) {
         app_new_notification(
             app,
             UI_NOTIFICATION_ERROR,
@@ -407,36 +456,19 @@ app_emulator_configure_rom(
         return (true);
     }
 
-    fseek(file, 0, SEEK_END);
-    file_len = ftell(file);
     if (file_len > CART_SIZE || file_len < 192) {
         app_new_notification(
             app,
             UI_NOTIFICATION_ERROR,
             "The ROM is invalid."
         );
-        return (true);
-    }
-
-    rewind(file);
-
-    data = calloc(1, file_len);
-    hs_assert(data);
-
-    if (fread(data, 1, file_len, file) != file_len) {
-        app_new_notification(
-            app,
-            UI_NOTIFICATION_ERROR,
-            "Failed to read %s: %s.",
-            rom_path,
-            strerror(errno)
-        );
-        free(data);
+        hs_unmap_file(data, file_len);
         return (true);
     }
 
     app->emulation.launch_config->rom.data = data;
     app->emulation.launch_config->rom.size = file_len;
+    app->emulation.is_rom_mapped = true;
 
     return (false);
 }
@@ -588,6 +620,10 @@ app_emulator_configure_and_run(
     size_t i;
     uint8_t *code;
 
+    if (app->emulation.launch_config) {
+        app_emulator_stop_and_wait(app);
+    }
+
     app_emulator_unconfigure(app);
 
     logln(HS_INFO, "Loading game at \"%s%s%s\".", g_light_green, rom_path, g_reset);
@@ -664,6 +700,7 @@ app_emulator_configure_and_run(
 
     app->emulation.game_path = strdup(rom_path);
     app->emulation.launch_config->skip_bios = app->settings.emulation.skip_bios;
+    app->emulation.launch_config->hle_bios = app->settings.emulation.hle_bios;
     app->emulation.launch_config->audio_frequency = GBA_CYCLES_PER_SECOND / app->audio.resample_frequency;
 
     if (app->settings.emulation.backup_storage.autodetect) {
@@ -678,10 +715,13 @@ app_emulator_configure_and_run(
         app->emulation.launch_config->gpio_device_type = app->settings.emulation.gpio_device.type;
     }
 
+    app->emulation.launch_config->idle_loop = app->emulation.game_entry->idle_loop;
+
     app_emulator_fill_gba_settings(app, &app->emulation.launch_config->settings);
 
     logln(HS_INFO, "Emulator's configuration:");
     logln(HS_INFO, "    Skip BIOS: %s", app->emulation.launch_config->skip_bios ? "true" : "false");
+    logln(HS_INFO, "    HLE BIOS: %s", app->emulation.launch_config->hle_bios ? "true" : "false");
     logln(HS_INFO, "    Backup storage: %s", backup_storage_names[app->emulation.launch_config->backup_storage.type]);
     logln(HS_INFO, "    GPIO: %s", gpio_device_names[app->emulation.launch_config->gpio_device_type]);
     if (app->emulation.launch_config->settings.fast_forward) {
@@ -690,6 +730,11 @@ app_emulator_configure_and_run(
         logln(HS_INFO, "    Speed: %.0f%%", app->emulation.launch_config->settings.speed * 100.f);
     }
     logln(HS_INFO, "    Audio Frequency: %iHz (%i cycles)", app->audio.resample_frequency, app->emulation.launch_config->audio_frequency);
+    if (app->emulation.launch_config->idle_loop.mode == IDLE_LOOP_FORCED) {
+        logln(HS_INFO, "    Idle loop: 0x%08x", app->emulation.launch_config->idle_loop.addr);
+    } else if (app->emulation.launch_config->idle_loop.mode == IDLE_LOOP_DISABLED) {
+        logln(HS_INFO, "    Idle loop: Disabled");
+    }
 
     event.header.kind = MESSAGE_RESET;
     event.header.size = sizeof(event);
@@ -740,16 +785,8 @@ void
 app_emulator_stop(
     struct app *app
 ) {
-    struct message event;
-
+    app_emulator_stop_and_wait(app);
     app_emulator_unconfigure(app);
-
-    event.header.kind = MESSAGE_STOP;
-    event.header.size = sizeof(event);
-
-    channel_lock(&app->emulation.gba->channels.messages);
-    channel_push(&app->emulation.gba->channels.messages, &event.header);
-    channel_release(&app->emulation.gba->channels.messages);
 }
 
 /*
@@ -827,6 +864,25 @@ app_emulator_key(
     channel_release(&app->emulation.gba->channels.messages);
 }
 
+/*
+** Start or stop walking back in time.
+*/
+void
+app_emulator_rewind(
+    struct app *app,
+    bool enabled
+) {
+    struct message_rewind event;
+
+    event.header.kind = MESSAGE_REWIND;
+    event.header.size = sizeof(event);
+    event.enabled = enabled;
+
+    channel_lock(&app->emulation.gba->channels.messages);
+    channel_push(&app->emulation.gba->channels.messages, &event.header);
+    channel_release(&app->emulation.gba->channels.messages);
+}
+
 /*
 ** Update the emulator's runtime settings.
 */
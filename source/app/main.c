@@ -58,6 +58,14 @@ app_settings_default(
     settings->emulation.speed = 1.0;
     settings->emulation.alt_speed = -1.0;
     settings->emulation.prefetch_buffer = true;
+    settings->emulation.core_backend = CORE_BACKEND_CACHED_INTERPRETER;
+    settings->emulation.idle_loop_detection = true;
+    settings->emulation.mmu_mirrors = false;
+    settings->emulation.hle_bios = false;
+    settings->emulation.rewind.enabled = false;
+    settings->emulation.rewind.interval = 1;
+    settings->emulation.rewind.buffer_size = 64;
+    settings->emulation.run_ahead = 0;
     settings->emulation.start_last_played_game_on_startup = false;
     settings->emulation.pause_when_window_inactive = false;
     settings->emulation.pause_when_game_resets = false;
@@ -348,6 +356,7 @@ main(
     pthread_join(gba_thread, NULL);
 
 #ifdef WITH_DEBUGGER
+    log_deferred_stop();
     debugger_reset_terminal();
 #endif
 
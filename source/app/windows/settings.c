@@ -81,6 +81,7 @@ char const * const binds_pretty_name[] = {
     [BIND_EMULATOR_SETTINGS] = "Toggle Settings",
     [BIND_EMULATOR_ALT_SPEED_TOGGLE] = "Alt. Speed (Toggle)",
     [BIND_EMULATOR_ALT_SPEED_HOLD] = "Alt. Speed (Hold)",
+    [BIND_EMULATOR_REWIND] = "Rewind (Hold)",
     [BIND_EMULATOR_QUICKSAVE_1] = "Quicksave 1",
     [BIND_EMULATOR_QUICKSAVE_2] = "Quicksave 2",
     [BIND_EMULATOR_QUICKSAVE_3] = "Quicksave 3",
@@ -124,6 +125,7 @@ char const * const binds_slug[] = {
     [BIND_EMULATOR_SETTINGS] = "toggle_settings",
     [BIND_EMULATOR_ALT_SPEED_TOGGLE] = "alternative_speed_toggle",
     [BIND_EMULATOR_ALT_SPEED_HOLD] = "alternative_speed_hold",
+    [BIND_EMULATOR_REWIND] = "rewind",
     [BIND_EMULATOR_QUICKSAVE_1] = "quicksave_1",
     [BIND_EMULATOR_QUICKSAVE_2] = "quicksave_2",
     [BIND_EMULATOR_QUICKSAVE_3] = "quicksave_3",
@@ -341,6 +343,75 @@ app_win_settings_emulation(
         igEndTable();
     }
 
+    igSeparatorText("Rewind");
+
+    if (igBeginTable("##EmulationSettingsRewind", 2, ImGuiTableFlags_None, (ImVec2){ .x = 0.f, .y = 0.f }, 0.f)) {
+        igTableSetupColumn("##EmulationSettingsRewindLabel", ImGuiTableColumnFlags_WidthFixed, vp->WorkSize.x / 5.f, 0);
+        igTableSetupColumn("##EmulationSettingsRewindValue", ImGuiTableColumnFlags_WidthStretch, 0.f, 0);
+
+        // Enable Rewind
+        igTableNextRow(ImGuiTableRowFlags_None, 0.f);
+        igTableNextColumn();
+        igTextWrapped("Enable rewind");
+
+        igTableNextColumn();
+        if (igCheckbox("##RewindEnabled", &app->settings.emulation.rewind.enabled)) {
+            app_emulator_settings(app);
+        }
+
+        igBeginDisabled(!app->settings.emulation.rewind.enabled);
+
+        // Rewind Interval
+        igTableNextRow(ImGuiTableRowFlags_None, 0.f);
+        igTableNextColumn();
+        igTextWrapped("Frames between snapshots");
+
+        igTableNextColumn();
+        if (igSliderInt("##RewindInterval", (int *)&app->settings.emulation.rewind.interval, 1, 60, "%d", ImGuiSliderFlags_AlwaysClamp)) {
+            app_emulator_settings(app);
+        }
+
+        // Rewind Buffer Size
+        igTableNextRow(ImGuiTableRowFlags_None, 0.f);
+        igTableNextColumn();
+        igTextWrapped("History size");
+
+        igTableNextColumn();
+        if (igSliderInt("##RewindBufferSize", (int *)&app->settings.emulation.rewind.buffer_size, 8, 1024, "%d MiB", ImGuiSliderFlags_AlwaysClamp)) {
+            app_emulator_settings(app);
+        }
+
+        igEndDisabled();
+
+        igEndTable();
+    }
+
+    igSeparatorText("Run-Ahead");
+
+    if (igBeginTable("##EmulationSettingsRunAhead", 2, ImGuiTableFlags_None, (ImVec2){ .x = 0.f, .y = 0.f }, 0.f)) {
+        igTableSetupColumn("##EmulationSettingsRunAheadLabel", ImGuiTableColumnFlags_WidthFixed, vp->WorkSize.x / 5.f, 0);
+        igTableSetupColumn("##EmulationSettingsRunAheadValue", ImGuiTableColumnFlags_WidthStretch, 0.f, 0);
+
+        // Run-Ahead Frames
+        igTableNextRow(ImGuiTableRowFlags_None, 0.f);
+        igTableNextColumn();
+        igTextWrapped("Frames to run ahead");
+
+        igTableNextColumn();
+        if (igSliderInt(
+            "##RunAheadFrames",
+            (int *)&app->settings.emulation.run_ahead,
+            0,
+            4,
+            app->settings.emulation.run_ahead ? "%d" : "Disabled",
+            ImGuiSliderFlags_AlwaysClamp
+        )) {
+            app_emulator_settings(app);
+        }
+
+        igEndTable();
+    }
+
     igSeparatorText("Misc");
 
     if (igBeginTable("##EmulationSettingsMisc", 2, ImGuiTableFlags_None, (ImVec2){ .x = 0.f, .y = 0.f }, 0.f)) {
@@ -355,6 +426,46 @@ app_win_settings_emulation(
         igTableNextColumn();
         igCheckbox("##PrefetchBuffer", &app->settings.emulation.prefetch_buffer);
 
+        // Core Backend
+        igTableNextRow(ImGuiTableRowFlags_None, 0.f);
+        igTableNextColumn();
+        igTextWrapped("CPU Backend");
+
+        igTableNextColumn();
+        if (igCombo_Str_arr("##CoreBackend", (int *)&app->settings.emulation.core_backend, core_backend_names, array_length(core_backend_names), 0)) {
+            app_emulator_settings(app);
+        }
+
+        // Skip idle loops
+        igTableNextRow(ImGuiTableRowFlags_None, 0.f);
+        igTableNextColumn();
+        igTextWrapped("Skip idle loops");
+
+        igTableNextColumn();
+        if (igCheckbox("##IdleLoopDetection", &app->settings.emulation.idle_loop_detection)) {
+            app_emulator_settings(app);
+        }
+
+#ifdef __linux__
+        // Mirror the memory with the host's MMU
+        igTableNextRow(ImGuiTableRowFlags_None, 0.f);
+        igTableNextColumn();
+        igTextWrapped("Mirror the memory with the host's MMU");
+
+        igTableNextColumn();
+        if (igCheckbox("##MMUMirrors", &app->settings.emulation.mmu_mirrors)) {
+            app_emulator_settings(app);
+        }
+#endif
+
+        // HLE BIOS
+        igTableNextRow(ImGuiTableRowFlags_None, 0.f);
+        igTableNextColumn();
+        igTextWrapped("Emulate the BIOS' functions (HLE)");
+
+        igTableNextColumn();
+        igCheckbox("##HLEBios", &app->settings.emulation.hle_bios);
+
         // Show FPS
         igTableNextRow(ImGuiTableRowFlags_None, 0.f);
         igTableNextColumn();
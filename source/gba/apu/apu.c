@@ -18,8 +18,8 @@
 **   - https://nightshade256.github.io/2021/03/27/gb-sound-emulation.html
 */
 
-static int32_t fifo_volume[2] = {2, 4};
-static int32_t psg_volume[4] = {1, 2, 4, 0};
+static int32_t const fifo_volume[2] = {2, 4};
+static int32_t const psg_volume[4] = {1, 2, 4, 0};
 
 static
 void
@@ -66,6 +66,11 @@ apu_resample(
     int32_t sample_l;
     int32_t sample_r;
 
+    // The audio of the speculative frames (see `gba/runahead.h`) is never heard
+    if (gba->runahead.speculating) {
+        return ;
+    }
+
     sample_l = 0;
     sample_r = 0;
 
@@ -108,7 +113,11 @@ apu_resample(
     sample_l *= 32; // Otherwise we can't hear much
     sample_r *= 32;
 
-    pthread_mutex_lock(&gba->shared_data.audio_rbuffer_mutex);
-    apu_rbuffer_push(&gba->shared_data.audio_rbuffer, (int16_t)sample_l, (int16_t)sample_r);
-    pthread_mutex_unlock(&gba->shared_data.audio_rbuffer_mutex);
+    if (gba->synchronous) {
+        apu_rbuffer_push(&gba->shared_data.audio_rbuffer, (int16_t)sample_l, (int16_t)sample_r);
+    } else {
+        pthread_mutex_lock(&gba->shared_data.audio_rbuffer_mutex);
+        apu_rbuffer_push(&gba->shared_data.audio_rbuffer, (int16_t)sample_l, (int16_t)sample_r);
+        pthread_mutex_unlock(&gba->shared_data.audio_rbuffer_mutex);
+    }
 }
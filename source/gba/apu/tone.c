@@ -12,7 +12,7 @@
 ** Reference:
 **   - https://gbdev.gg8.se/wiki/articles/Gameboy_sound_hardware#Square_Wave
 */
-static int16_t duty_lut[4][8] = {
+static int16_t const duty_lut[4][8] = {
     [0] = {  1,  1,  1,  1,  1,  1,  1, -1}, // 12.5%
     [1] = { -1,  1,  1,  1,  1,  1,  1, -1}, // 25%
     [2] = { -1,  1,  1,  1,  1, -1, -1, -1}, // 50%
@@ -12,7 +12,7 @@
 #include "gba/apu.h"
 #include "gba/scheduler.h"
 
-static int16_t volume_lut[4] = { 0, 4, 2, 1};
+static int16_t const volume_lut[4] = { 0, 4, 2, 1};
 
 #define CHANNEL_FREQUENCY_AS_CYCLES(x)      ((GBA_CYCLES_PER_SECOND / 2097152) * (2048 - (x)))
 
@@ -0,0 +1,910 @@
+/******************************************************************************\
+**
+**  This file is part of the Hades GBA Emulator, and is made available under
+**  the terms of the GNU General Public License version 2.
+**
+**  Copyright (C) 2021-2024 - The Hades Authors
+**
+\******************************************************************************/
+
+/*
+** High-level emulation of the BIOS' software interrupts.
+**
+** References:
+**   * GBATEK
+**      https://problemkaputt.de/gbatek.htm#biosfunctions
+*/
+
+#include <string.h>
+#include "hades.h"
+#include "gba/gba.h"
+#include "gba/bios.h"
+
+/*
+** A minimal BIOS used when no BIOS dump is available.
+**
+** It only holds the exception vectors and the IRQ handler, which calls the
+** game's handler stored at 0x03007FFC like the real BIOS does.
+** SWIs are handled natively and those that aren't simply return.
+*/
+static uint32_t const bios_hle_image[] = {
+    0xE3A0F302,     // 0x00: mov pc, #0x08000000         Reset
+    0xE1B0F00E,     // 0x04: movs pc, lr                 Undefined instruction
+    0xE1B0F00E,     // 0x08: movs pc, lr                 SWI
+    0xE25EF004,     // 0x0C: subs pc, lr, #4             Prefetch abort
+    0xE25EF008,     // 0x10: subs pc, lr, #8             Data abort
+    0xEAFFFFFE,     // 0x14: b .                         Reserved
+    0xEA000000,     // 0x18: b 0x20                      IRQ
+    0xE25EF004,     // 0x1C: subs pc, lr, #4             FIQ
+    0xE92D500F,     // 0x20: push {r0-r3, r12, lr}
+    0xE3A00301,     // 0x24: mov r0, #0x04000000
+    0xE28FE000,     // 0x28: add lr, pc, #0
+    0xE510F004,     // 0x2C: ldr pc, [r0, #-4]
+    0xE8BD500F,     // 0x30: pop {r0-r3, r12, lr}
+    0xE25EF004,     // 0x34: subs pc, lr, #4
+};
+
+/*
+** Approximations of the time the real BIOS takes to run each SWI.
+*/
+static struct bios_swi_cost const bios_swi_costs[BIOS_SWI_LEN] = {
+    [BIOS_SWI_SOFT_RESET]           = { .base = 200, .per_unit = 0 },
+    [BIOS_SWI_REGISTER_RAM_RESET]   = { .base = 100, .per_unit = 2 },   // Per word cleared
+    [BIOS_SWI_HALT]                 = { .base = 40,  .per_unit = 0 },
+    [BIOS_SWI_INTR_WAIT]            = { .base = 60,  .per_unit = 0 },
+    [BIOS_SWI_VBLANK_INTR_WAIT]     = { .base = 60,  .per_unit = 0 },
+    [BIOS_SWI_DIV]                  = { .base = 90,  .per_unit = 0 },
+    [BIOS_SWI_DIV_ARM]              = { .base = 93,  .per_unit = 0 },
+    [BIOS_SWI_SQRT]                 = { .base = 160, .per_unit = 0 },
+    [BIOS_SWI_ARCTAN]               = { .base = 120, .per_unit = 0 },
+    [BIOS_SWI_ARCTAN2]              = { .base = 200, .per_unit = 0 },
+    [BIOS_SWI_CPU_SET]              = { .base = 40,  .per_unit = 10 },  // Per unit copied
+    [BIOS_SWI_CPU_FAST_SET]         = { .base = 40,  .per_unit = 3 },   // Per word copied
+    [BIOS_SWI_BG_AFFINE_SET]        = { .base = 30,  .per_unit = 110 }, // Per matrix
+    [BIOS_SWI_OBJ_AFFINE_SET]       = { .base = 30,  .per_unit = 60 },  // Per matrix
+    [BIOS_SWI_LZ77_UNCOMP_WRAM]     = { .base = 50,  .per_unit = 14 },  // Per byte decompressed
+    [BIOS_SWI_LZ77_UNCOMP_VRAM]     = { .base = 50,  .per_unit = 16 },
+    [BIOS_SWI_HUFF_UNCOMP]          = { .base = 50,  .per_unit = 40 },
+    [BIOS_SWI_RL_UNCOMP_WRAM]       = { .base = 50,  .per_unit = 10 },
+    [BIOS_SWI_RL_UNCOMP_VRAM]       = { .base = 50,  .per_unit = 12 },
+    [BIOS_SWI_DIFF8_UNFILTER_WRAM]  = { .base = 40,  .per_unit = 10 },
+    [BIOS_SWI_DIFF8_UNFILTER_VRAM]  = { .base = 40,  .per_unit = 12 },
+    [BIOS_SWI_DIFF16_UNFILTER]      = { .base = 40,  .per_unit = 12 },
+};
+
+/*
+** sin(i * 2 * PI / 256) in 1.14 fixed point, like the table of the real BIOS.
+*/
+static int16_t const bios_sin_lut[256] = {
+         0,    402,    804,   1205,   1606,   2006,   2404,   2801,
+      3196,   3590,   3981,   4370,   4756,   5139,   5520,   5897,
+      6270,   6639,   7005,   7366,   7723,   8076,   8423,   8765,
+      9102,   9434,   9760,  10080,  10394,  10702,  11003,  11297,
+     11585,  11866,  12140,  12406,  12665,  12916,  13160,  13395,
+     13623,  13842,  14053,  14256,  14449,  14635,  14811,  14978,
+     15137,  15286,  15426,  15557,  15679,  15791,  15893,  15986,
+     16069,  16143,  16207,  16261,  16305,  16340,  16364,  16379,
+     16384,  16379,  16364,  16340,  16305,  16261,  16207,  16143,
+     16069,  15986,  15893,  15791,  15679,  15557,  15426,  15286,
+     15137,  14978,  14811,  14635,  14449,  14256,  14053,  13842,
+     13623,  13395,  13160,  12916,  12665,  12406,  12140,  11866,
+     11585,  11297,  11003,  10702,  10394,  10080,   9760,   9434,
+      9102,   8765,   8423,   8076,   7723,   7366,   7005,   6639,
+      6270,   5897,   5520,   5139,   4756,   4370,   3981,   3590,
+      3196,   2801,   2404,   2006,   1606,   1205,    804,    402,
+         0,   -402,   -804,  -1205,  -1606,  -2006,  -2404,  -2801,
+     -3196,  -3590,  -3981,  -4370,  -4756,  -5139,  -5520,  -5897,
+     -6270,  -6639,  -7005,  -7366,  -7723,  -8076,  -8423,  -8765,
+     -9102,  -9434,  -9760, -10080, -10394, -10702, -11003, -11297,
+    -11585, -11866, -12140, -12406, -12665, -12916, -13160, -13395,
+    -13623, -13842, -14053, -14256, -14449, -14635, -14811, -14978,
+    -15137, -15286, -15426, -15557, -15679, -15791, -15893, -15986,
+    -16069, -16143, -16207, -16261, -16305, -16340, -16364, -16379,
+    -16384, -16379, -16364, -16340, -16305, -16261, -16207, -16143,
+    -16069, -15986, -15893, -15791, -15679, -15557, -15426, -15286,
+    -15137, -14978, -14811, -14635, -14449, -14256, -14053, -13842,
+    -13623, -13395, -13160, -12916, -12665, -12406, -12140, -11866,
+    -11585, -11297, -11003, -10702, -10394, -10080,  -9760,  -9434,
+     -9102,  -8765,  -8423,  -8076,  -7723,  -7366,  -7005,  -6639,
+     -6270,  -5897,  -5520,  -5139,  -4756,  -4370,  -3981,  -3590,
+     -3196,  -2801,  -2404,  -2006,  -1606,  -1205,   -804,   -402,
+};
+
+/*
+** An output stream used by the decompression functions.
+**
+** The VRAM variants can't write single bytes, so they are buffered and
+** written by half-words instead.
+*/
+struct bios_stream {
+    uint32_t addr;
+    uint16_t half;
+    bool wide;
+};
+
+static
+void
+bios_stream_put(
+    struct gba *gba,
+    struct bios_stream *out,
+    uint8_t byte
+) {
+    if (out->wide) {
+        if (out->addr & 0b1) {
+            mem_write16_raw(gba, out->addr - 1, out->half | (byte << 8));
+        } else {
+            out->half = byte;
+        }
+    } else {
+        mem_write8_raw(gba, out->addr, byte);
+    }
+    ++out->addr;
+}
+
+/*
+** Return the byte written `disp` bytes before the current position of the stream.
+*/
+static
+uint8_t
+bios_stream_peek(
+    struct gba *gba,
+    struct bios_stream const *out,
+    uint32_t disp
+) {
+    uint32_t addr;
+
+    addr = out->addr - disp;
+    if (out->wide && (out->addr & 0b1) && addr == out->addr - 1) {
+        return (out->half);
+    }
+    return (mem_read8_raw(gba, addr));
+}
+
+/*
+** Load the minimal BIOS used when no BIOS dump is available.
+*/
+void
+bios_hle_load(
+    struct gba *gba
+) {
+    memset(gba->memory.bios, 0, sizeof(gba->memory.bios));
+    memcpy(gba->memory.bios, bios_hle_image, sizeof(bios_hle_image));
+}
+
+static
+void
+bios_hle_soft_reset(
+    struct gba *gba
+) {
+    struct core *core;
+    bool ewram;
+
+    core = &gba->core;
+    ewram = mem_read8_raw(gba, 0x03007FFA);
+    memset(gba->memory.iwram + IWRAM_SIZE - 0x200, 0, 0x200);
+    mem_dirty_mark_range(gba, MEM_DIRTY_IWRAM_BLOCK, IWRAM_SIZE - 0x200, 0x200);
+    core_cache_flush(gba);
+
+    core_switch_mode(core, MODE_IRQ);
+    core->sp = 0x03007FA0;
+    core->lr = 0;
+    core->spsr_irq.raw = 0;
+
+    core_switch_mode(core, MODE_SVC);
+    core->sp = 0x03007FE0;
+    core->lr = 0;
+    core->spsr_svc.raw = 0;
+
+    core_switch_mode(core, MODE_SYS);
+    memset(core->registers, 0, sizeof(core->registers[0]) * 13);
+    core->sp = 0x03007F00;
+    core->lr = 0;
+    core->cpsr.raw = MODE_SYS;
+
+    core->pc = ewram ? 0x02000000 : 0x08000000;
+    core_reload_pipeline(gba);
+}
+
+static
+void
+bios_hle_clear_io(
+    struct gba *gba,
+    uint32_t start,
+    uint32_t end
+) {
+    uint32_t addr;
+
+    for (addr = start; addr < end; addr += 2) {
+        mem_write16_raw(gba, addr, 0);
+    }
+}
+
+static
+uint32_t
+bios_hle_register_ram_reset(
+    struct gba *gba
+) {
+    uint32_t flags;
+    uint32_t cleared;
+
+    flags = gba->core.r0;
+    cleared = 0;
+
+    mem_write16_raw(gba, IO_REG_DISPCNT, 0x0080);
+
+    if (flags & 0b00000001) {
+        memset(gba->memory.ewram, 0, EWRAM_SIZE);
+        mem_dirty_mark_range(gba, MEM_DIRTY_EWRAM_BLOCK, 0, EWRAM_SIZE);
+        cleared += EWRAM_SIZE;
+    }
+
+    // The last 0x200 bytes of IWRAM are used by the BIOS and never cleared.
+    if (flags & 0b00000010) {
+        memset(gba->memory.iwram, 0, IWRAM_SIZE - 0x200);
+        mem_dirty_mark_range(gba, MEM_DIRTY_IWRAM_BLOCK, 0, IWRAM_SIZE - 0x200);
+        cleared += IWRAM_SIZE - 0x200;
+    }
+
+    if (flags & 0b00000100) {
+        memset(gba->memory.palram, 0, PALRAM_SIZE);
+        mem_dirty_mark_range(gba, MEM_DIRTY_PALRAM_BLOCK, 0, PALRAM_SIZE);
+        cleared += PALRAM_SIZE;
+    }
+
+    if (flags & 0b00001000) {
+        memset(gba->memory.vram, 0, VRAM_SIZE);
+        mem_dirty_mark_range(gba, MEM_DIRTY_VRAM_BLOCK, 0, VRAM_SIZE);
+        cleared += VRAM_SIZE;
+    }
+
+    if (flags & 0b00010000) {
+        memset(gba->memory.oam, 0, OAM_SIZE);
+        mem_dirty_mark_range(gba, MEM_DIRTY_OAM_BLOCK, 0, OAM_SIZE);
+        cleared += OAM_SIZE;
+    }
+
+    if (flags & 0b00100000) {
+        bios_hle_clear_io(gba, 0x04000120, 0x04000130);
+        mem_write16_raw(gba, IO_REG_RCNT, 0x8000);
+        bios_hle_clear_io(gba, 0x04000140, 0x0400015C);
+    }
+
+    if (flags & 0b01000000) {
+        bios_hle_clear_io(gba, IO_REG_SOUND1CNT_L, 0x040000A8);
+        mem_write16_raw(gba, IO_REG_SOUNDBIAS, 0x0200);
+    }
+
+    if (flags & 0b10000000) {
+        bios_hle_clear_io(gba, IO_REG_DISPCNT + 2, IO_REG_SOUND1CNT_L);
+        mem_write16_raw(gba, IO_REG_BG2PA, 0x0100);
+        mem_write16_raw(gba, IO_REG_BG2PD, 0x0100);
+        mem_write16_raw(gba, IO_REG_BG3PA, 0x0100);
+        mem_write16_raw(gba, IO_REG_BG3PD, 0x0100);
+        bios_hle_clear_io(gba, IO_REG_DMA0SAD, 0x040000E0);
+        bios_hle_clear_io(gba, IO_REG_TM0CNT, 0x04000110);
+        mem_write16_raw(gba, IO_REG_IE, 0);
+        mem_write16_raw(gba, IO_REG_IF, 0xFFFF);
+        mem_write16_raw(gba, IO_REG_WAITCNT, 0);
+        mem_write16_raw(gba, IO_REG_IME, 0);
+    }
+
+    if (flags & 0b00000011) {
+        core_cache_flush(gba);
+    }
+
+    return (cleared / sizeof(uint32_t));
+}
+
+/*
+** Wait until one of the interrupts in `flags` is acknowledged by the game's IRQ handler
+** in the BIOS' interrupt flags (at 0x03007FF8).
+**
+** The core is halted and the SWI is executed again once the IRQ handler returns.
+** Return false if the core has to wait.
+*/
+static
+bool
+bios_hle_intr_wait(
+    struct gba *gba,
+    bool discard,
+    uint32_t flags
+) {
+    struct core *core;
+    uint16_t bios_if;
+
+    core = &gba->core;
+    mem_write16_raw(gba, IO_REG_IME, 1);
+
+    bios_if = mem_read16_raw(gba, 0x03007FF8);
+
+    // Old flags are only discarded the first time the SWI is executed
+    if (discard && !core->bios_intr_wait) {
+        bios_if &= ~flags;
+        mem_write16_raw(gba, 0x03007FF8, bios_if);
+    }
+
+    if (bios_if & flags) {
+        mem_write16_raw(gba, 0x03007FF8, bios_if & ~flags);
+        core->bios_intr_wait = false;
+        return (true);
+    }
+
+    core->bios_intr_wait = true;
+    core->pc -= core->cpsr.thumb ? 4 : 8;
+    core_reload_pipeline(gba);
+
+    // Don't halt if an interrupt is already pending, it's about to be serviced.
+    if (!(gba->io.int_enabled.raw & gba->io.int_flag.raw)) {
+        mem_write8_raw(gba, IO_REG_HALTCNT, 0);
+    }
+    return (false);
+}
+
+static
+uint32_t
+bios_hle_div(
+    struct gba *gba,
+    int32_t num,
+    int32_t den
+) {
+    struct core *core;
+
+    core = &gba->core;
+    if (unlikely(den == 0)) {
+        logln(HS_CORE, "Division by zero in the Div SWI (pc=0x%08x).", core->pc);
+        core->r0 = (num < 0) ? -1 : 1;
+        core->r1 = num;
+        core->r3 = 1;
+    } else if (unlikely(num == INT32_MIN && den == -1)) {
+        core->r0 = INT32_MIN;
+        core->r1 = 0;
+        core->r3 = INT32_MIN;
+    } else {
+        int32_t quot;
+
+        quot = num / den;
+        core->r0 = quot;
+        core->r1 = num % den;
+        core->r3 = quot < 0 ? -(uint32_t)quot : (uint32_t)quot;
+    }
+    return (0);
+}
+
+static
+uint32_t
+bios_hle_sqrt(
+    struct gba *gba
+) {
+    uint32_t val;
+    uint32_t res;
+    uint32_t bit;
+
+    val = gba->core.r0;
+    res = 0;
+    bit = 1u << 30;
+
+    while (bit > val) {
+        bit >>= 2;
+    }
+
+    while (bit) {
+        if (val >= res + bit) {
+            val -= res + bit;
+            res = (res >> 1) + bit;
+        } else {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    gba->core.r0 = res;
+    return (0);
+}
+
+/*
+** The polynomial approximation used by the BIOS.
+** `tan` is in 1.14 fixed point, the result ranges from -0x4000 (-PI/2) to 0x4000 (PI/2).
+*/
+static
+int32_t
+bios_arctan(
+    struct gba *gba,
+    int32_t tan
+) {
+    int32_t a;
+    int32_t b;
+
+    a = -((tan * tan) >> 14);
+    b = ((0xA9 * a) >> 14) + 0x390;
+    b = ((b * a) >> 14) + 0x91C;
+    b = ((b * a) >> 14) + 0xFB6;
+    b = ((b * a) >> 14) + 0x16AA;
+    b = ((b * a) >> 14) + 0x2081;
+    b = ((b * a) >> 14) + 0x3651;
+    b = ((b * a) >> 14) + 0xA2F9;
+
+    gba->core.r1 = a;
+    gba->core.r3 = b;
+    return ((tan * b) >> 16);
+}
+
+static
+uint32_t
+bios_hle_arctan2(
+    struct gba *gba
+) {
+    int32_t x;
+    int32_t y;
+    int32_t res;
+
+    x = gba->core.r0;
+    y = gba->core.r1;
+
+    if (!y) {
+        res = (x >= 0) ? 0x0000 : 0x8000;
+    } else if (!x) {
+        res = (y >= 0) ? 0x4000 : 0xC000;
+    } else if (y >= 0) {
+        if (x >= 0 && x >= y) {
+            res = bios_arctan(gba, (y << 14) / x);
+        } else if (x < 0 && -x >= y) {
+            res = bios_arctan(gba, (y << 14) / x) + 0x8000;
+        } else {
+            res = 0x4000 - bios_arctan(gba, (x << 14) / y);
+        }
+    } else {
+        if (x <= 0 && -x > -y) {
+            res = bios_arctan(gba, (y << 14) / x) + 0x8000;
+        } else if (x > 0 && x >= -y) {
+            res = bios_arctan(gba, (y << 14) / x) + 0x10000;
+        } else {
+            res = 0xC000 - bios_arctan(gba, (x << 14) / y);
+        }
+    }
+
+    gba->core.r0 = (uint16_t)res;
+    return (0);
+}
+
+static
+uint32_t
+bios_hle_cpu_set(
+    struct gba *gba
+) {
+    uint32_t src;
+    uint32_t dst;
+    uint32_t count;
+    bool fill;
+    uint32_t i;
+
+    src = gba->core.r0;
+    dst = gba->core.r1;
+    count = bitfield_get_range(gba->core.r2, 0, 21);
+    fill = bitfield_get(gba->core.r2, 24);
+
+    // The BIOS refuses to read its own memory
+    if (!(src & 0x0E000000)) {
+        return (0);
+    }
+
+    if (bitfield_get(gba->core.r2, 26)) {
+        src = align(uint32_t, src);
+        dst = align(uint32_t, dst);
+        for (i = 0; i < count; ++i) {
+            mem_write32_raw(gba, dst, mem_read32_raw(gba, src));
+            src += fill ? 0 : sizeof(uint32_t);
+            dst += sizeof(uint32_t);
+        }
+    } else {
+        src = align(uint16_t, src);
+        dst = align(uint16_t, dst);
+        for (i = 0; i < count; ++i) {
+            mem_write16_raw(gba, dst, mem_read16_raw(gba, src));
+            src += fill ? 0 : sizeof(uint16_t);
+            dst += sizeof(uint16_t);
+        }
+    }
+    return (count);
+}
+
+static
+uint32_t
+bios_hle_cpu_fast_set(
+    struct gba *gba
+) {
+    uint32_t src;
+    uint32_t dst;
+    uint32_t count;
+    bool fill;
+    uint32_t i;
+
+    src = align(uint32_t, gba->core.r0);
+    dst = align(uint32_t, gba->core.r1);
+    count = align_on(bitfield_get_range(gba->core.r2, 0, 21) + 7, 8);
+    fill = bitfield_get(gba->core.r2, 24);
+
+    if (!(src & 0x0E000000)) {
+        return (0);
+    }
+
+    for (i = 0; i < count; ++i) {
+        mem_write32_raw(gba, dst, mem_read32_raw(gba, src));
+        src += fill ? 0 : sizeof(uint32_t);
+        dst += sizeof(uint32_t);
+    }
+    return (count);
+}
+
+static
+uint32_t
+bios_hle_bg_affine_set(
+    struct gba *gba
+) {
+    uint32_t src;
+    uint32_t dst;
+    uint32_t count;
+    uint32_t i;
+
+    src = gba->core.r0;
+    dst = gba->core.r1;
+    count = gba->core.r2;
+
+    for (i = 0; i < count; ++i) {
+        int32_t ox, oy;
+        int32_t cx, cy;
+        int32_t sx, sy;
+        int32_t pa, pb, pc, pd;
+        int32_t sin, cos;
+        uint8_t angle;
+
+        ox = (int32_t)mem_read32_raw(gba, src);
+        oy = (int32_t)mem_read32_raw(gba, src + 4);
+        cx = (int16_t)mem_read16_raw(gba, src + 8);
+        cy = (int16_t)mem_read16_raw(gba, src + 10);
+        sx = (int16_t)mem_read16_raw(gba, src + 12);
+        sy = (int16_t)mem_read16_raw(gba, src + 14);
+        angle = mem_read16_raw(gba, src + 16) >> 8;
+
+        sin = bios_sin_lut[angle];
+        cos = bios_sin_lut[(uint8_t)(angle + 64)];
+
+        pa = (sx * cos) >> 14;
+        pb = -((sx * sin) >> 14);
+        pc = (sy * sin) >> 14;
+        pd = (sy * cos) >> 14;
+
+        mem_write16_raw(gba, dst, pa);
+        mem_write16_raw(gba, dst + 2, pb);
+        mem_write16_raw(gba, dst + 4, pc);
+        mem_write16_raw(gba, dst + 6, pd);
+        mem_write32_raw(gba, dst + 8, ox - (pa * cx + pb * cy));
+        mem_write32_raw(gba, dst + 12, oy - (pc * cx + pd * cy));
+
+        src += 20;
+        dst += 16;
+    }
+    return (count);
+}
+
+static
+uint32_t
+bios_hle_obj_affine_set(
+    struct gba *gba
+) {
+    uint32_t src;
+    uint32_t dst;
+    uint32_t count;
+    uint32_t offset;
+    uint32_t i;
+
+    src = gba->core.r0;
+    dst = gba->core.r1;
+    count = gba->core.r2;
+    offset = gba->core.r3;
+
+    for (i = 0; i < count; ++i) {
+        int32_t sx, sy;
+        int32_t sin, cos;
+        uint8_t angle;
+
+        sx = (int16_t)mem_read16_raw(gba, src);
+        sy = (int16_t)mem_read16_raw(gba, src + 2);
+        angle = mem_read16_raw(gba, src + 4) >> 8;
+
+        sin = bios_sin_lut[angle];
+        cos = bios_sin_lut[(uint8_t)(angle + 64)];
+
+        mem_write16_raw(gba, dst, (sx * cos) >> 14);
+        mem_write16_raw(gba, dst + offset, -((sx * sin) >> 14));
+        mem_write16_raw(gba, dst + offset * 2, (sy * sin) >> 14);
+        mem_write16_raw(gba, dst + offset * 3, (sy * cos) >> 14);
+
+        src += 8;
+        dst += offset * 4;
+    }
+    return (count);
+}
+
+static
+uint32_t
+bios_hle_lz77_uncomp(
+    struct gba *gba,
+    bool wide
+) {
+    struct bios_stream out;
+    uint32_t src;
+    uint32_t size;
+    uint32_t remaining;
+
+    src = gba->core.r0;
+    out = (struct bios_stream){ .addr = gba->core.r1, .wide = wide };
+    size = mem_read32_raw(gba, src) >> 8;
+    src += 4;
+
+    remaining = size;
+    while (remaining) {
+        uint8_t flags;
+        uint32_t i;
+
+        flags = mem_read8_raw(gba, src++);
+        for (i = 0; i < 8 && remaining; ++i) {
+            if (flags & (0x80 >> i)) {
+                uint8_t b0;
+                uint8_t b1;
+                uint32_t len;
+                uint32_t disp;
+
+                b0 = mem_read8_raw(gba, src);
+                b1 = mem_read8_raw(gba, src + 1);
+                src += 2;
+
+                len = (b0 >> 4) + 3;
+                disp = (((b0 & 0xF) << 8) | b1) + 1;
+                while (len-- && remaining) {
+                    bios_stream_put(gba, &out, bios_stream_peek(gba, &out, disp));
+                    --remaining;
+                }
+            } else {
+                bios_stream_put(gba, &out, mem_read8_raw(gba, src++));
+                --remaining;
+            }
+        }
+    }
+    return (size);
+}
+
+static
+uint32_t
+bios_hle_rl_uncomp(
+    struct gba *gba,
+    bool wide
+) {
+    struct bios_stream out;
+    uint32_t src;
+    uint32_t size;
+    uint32_t remaining;
+
+    src = gba->core.r0;
+    out = (struct bios_stream){ .addr = gba->core.r1, .wide = wide };
+    size = mem_read32_raw(gba, src) >> 8;
+    src += 4;
+
+    remaining = size;
+    while (remaining) {
+        uint8_t flag;
+        uint32_t len;
+
+        flag = mem_read8_raw(gba, src++);
+        if (flag & 0x80) {
+            uint8_t byte;
+
+            len = (flag & 0x7F) + 3;
+            byte = mem_read8_raw(gba, src++);
+            while (len-- && remaining) {
+                bios_stream_put(gba, &out, byte);
+                --remaining;
+            }
+        } else {
+            len = (flag & 0x7F) + 1;
+            while (len-- && remaining) {
+                bios_stream_put(gba, &out, mem_read8_raw(gba, src++));
+                --remaining;
+            }
+        }
+    }
+    return (size);
+}
+
+static
+uint32_t
+bios_hle_huff_uncomp(
+    struct gba *gba
+) {
+    uint32_t src;
+    uint32_t dst;
+    uint32_t header;
+    uint32_t size;
+    uint32_t remaining;
+    uint32_t data_bits;
+    uint32_t tree;
+    uint32_t node;
+    uint8_t node_val;
+    uint32_t out;
+    uint32_t out_bits;
+
+    src = gba->core.r0;
+    dst = align(uint32_t, gba->core.r1);
+    header = mem_read32_raw(gba, src);
+    size = header >> 8;
+    data_bits = header & 0xF;
+
+    if (data_bits != 4 && data_bits != 8) {
+        logln(HS_CORE, "Invalid data size %u in the HuffUnComp SWI.", data_bits);
+        return (0);
+    }
+
+    tree = src + 5;
+    src += 4 + ((mem_read8_raw(gba, src + 4) + 1) << 1);
+
+    node = tree;
+    node_val = mem_read8_raw(gba, node);
+    out = 0;
+    out_bits = 0;
+    remaining = size;
+
+    while (remaining) {
+        uint32_t bitstream;
+        int32_t bit;
+
+        bitstream = mem_read32_raw(gba, src);
+        src += 4;
+
+        for (bit = 31; bit >= 0 && remaining; --bit) {
+            uint32_t child;
+            bool dir;
+
+            dir = (bitstream >> bit) & 0b1;
+            child = (node & ~0b1) + (node_val & 0x3F) * 2 + 2 + dir;
+
+            if (node_val & (dir ? 0x40 : 0x80)) {
+                out |= (uint32_t)mem_read8_raw(gba, child) << out_bits;
+                out_bits += data_bits;
+
+                node = tree;
+                node_val = mem_read8_raw(gba, node);
+
+                if (out_bits == 32) {
+                    mem_write32_raw(gba, dst, out);
+                    dst += 4;
+                    remaining = remaining > 4 ? remaining - 4 : 0;
+                    out = 0;
+                    out_bits = 0;
+                }
+            } else {
+                node = child;
+                node_val = mem_read8_raw(gba, node);
+            }
+        }
+    }
+    return (size);
+}
+
+static
+uint32_t
+bios_hle_diff8_unfilter(
+    struct gba *gba,
+    bool wide
+) {
+    struct bios_stream out;
+    uint32_t src;
+    uint32_t size;
+    uint32_t i;
+    uint8_t val;
+
+    src = gba->core.r0;
+    out = (struct bios_stream){ .addr = gba->core.r1, .wide = wide };
+    size = mem_read32_raw(gba, src) >> 8;
+    src += 4;
+
+    val = 0;
+    for (i = 0; i < size; ++i) {
+        val += mem_read8_raw(gba, src + i);
+        bios_stream_put(gba, &out, val);
+    }
+    return (size);
+}
+
+static
+uint32_t
+bios_hle_diff16_unfilter(
+    struct gba *gba
+) {
+    uint32_t src;
+    uint32_t dst;
+    uint32_t size;
+    uint32_t i;
+    uint16_t val;
+
+    src = gba->core.r0;
+    dst = gba->core.r1;
+    size = mem_read32_raw(gba, src) >> 8;
+    src += 4;
+
+    val = 0;
+    for (i = 0; i < size; i += 2) {
+        val += mem_read16_raw(gba, src + i);
+        mem_write16_raw(gba, dst + i, val);
+    }
+    return (size / 2);
+}
+
+/*
+** Run the given SWI natively.
+**
+** Return false if the SWI isn't implemented, in which case the BIOS' code must be executed instead.
+*/
+bool
+bios_hle_swi(
+    struct gba *gba,
+    uint32_t swi
+) {
+    struct core *core;
+    uint32_t units;
+
+    core = &gba->core;
+
+    // The loop calling the SWI can't be considered idle
+    core_idle_loop_taint(gba);
+
+    switch (swi) {
+        case BIOS_SWI_SOFT_RESET: {
+            bios_hle_soft_reset(gba);
+            core_idle_for(gba, bios_swi_costs[swi].base);
+            return (true);
+        };
+        case BIOS_SWI_INTR_WAIT:
+        case BIOS_SWI_VBLANK_INTR_WAIT: {
+            bool done;
+
+            if (swi == BIOS_SWI_VBLANK_INTR_WAIT) {
+                done = bios_hle_intr_wait(gba, true, 0b1);
+            } else {
+                done = bios_hle_intr_wait(gba, core->r0, core->r1);
+            }
+
+            if (!done) {
+                return (true);
+            }
+            units = 0;
+            break;
+        };
+        case BIOS_SWI_REGISTER_RAM_RESET:   units = bios_hle_register_ram_reset(gba); break;
+        case BIOS_SWI_HALT:                 mem_write8_raw(gba, IO_REG_HALTCNT, 0); units = 0; break;
+        case BIOS_SWI_DIV:                  units = bios_hle_div(gba, core->r0, core->r1); break;
+        case BIOS_SWI_DIV_ARM:              units = bios_hle_div(gba, core->r1, core->r0); break;
+        case BIOS_SWI_SQRT:                 units = bios_hle_sqrt(gba); break;
+        case BIOS_SWI_ARCTAN:               core->r0 = bios_arctan(gba, (int32_t)core->r0); units = 0; break;
+        case BIOS_SWI_ARCTAN2:              units = bios_hle_arctan2(gba); break;
+        case BIOS_SWI_CPU_SET:              units = bios_hle_cpu_set(gba); break;
+        case BIOS_SWI_CPU_FAST_SET:         units = bios_hle_cpu_fast_set(gba); break;
+        case BIOS_SWI_BG_AFFINE_SET:        units = bios_hle_bg_affine_set(gba); break;
+        case BIOS_SWI_OBJ_AFFINE_SET:       units = bios_hle_obj_affine_set(gba); break;
+        case BIOS_SWI_LZ77_UNCOMP_WRAM:     units = bios_hle_lz77_uncomp(gba, false); break;
+        case BIOS_SWI_LZ77_UNCOMP_VRAM:     units = bios_hle_lz77_uncomp(gba, true); break;
+        case BIOS_SWI_HUFF_UNCOMP:          units = bios_hle_huff_uncomp(gba); break;
+        case BIOS_SWI_RL_UNCOMP_WRAM:       units = bios_hle_rl_uncomp(gba, false); break;
+        case BIOS_SWI_RL_UNCOMP_VRAM:       units = bios_hle_rl_uncomp(gba, true); break;
+        case BIOS_SWI_DIFF8_UNFILTER_WRAM:  units = bios_hle_diff8_unfilter(gba, false); break;
+        case BIOS_SWI_DIFF8_UNFILTER_VRAM:  units = bios_hle_diff8_unfilter(gba, true); break;
+        case BIOS_SWI_DIFF16_UNFILTER:      units = bios_hle_diff16_unfilter(gba); break;
+        default: {
+            logln(HS_CORE, "SWI 0x%02x isn't implemented by the HLE BIOS (pc=0x%08x).", swi, core->pc);
+            return (false);
+        };
+    }
+
+    core->pc += core->cpsr.thumb ? 2 : 4;
+    core->prefetch_access_type = SEQUENTIAL;
+    core_idle_for(gba, bios_swi_costs[swi].base + bios_swi_costs[swi].per_unit * units);
+    return (true);
+}
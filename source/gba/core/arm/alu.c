@@ -9,15 +9,23 @@
 
 #include "hades.h"
 #include "gba/gba.h"
+#include "gba/core/arm.h"
 #include "gba/core/helpers.h"
 
 /*
 ** Execute the Data Processing instructions (ADD, SUB, MOV, etc.).
+**
+** This is a template instantiated for each combination of opcode, kind of second operand and S bit
+** (see `gen_tables.c`), so that all the decoding below is resolved at compile time.
 */
+static __always_inline
 void
-core_arm_alu(
+core_arm_alu_template(
     struct gba *gba,
-    uint32_t op
+    uint32_t op,
+    uint32_t opcode,
+    enum arm_alu_operands operand,
+    bool set_flags
 ) {
     struct core *core;
     uint32_t rd;
@@ -31,7 +39,7 @@ core_arm_alu(
     early_pc_inc = false;
     rd = (op >> 12) & 0xF;
     rn = (op >> 16) & 0xF;
-    cond = bitfield_get(op, 20);
+    cond = set_flags;
 
     core = &gba->core;
     core->prefetch_access_type = SEQUENTIAL;
@@ -41,7 +49,7 @@ core_arm_alu(
     ** The second operand is either an immediate value or obtained through
     ** anoter register, possibly shifted.
     */
-    if (bitfield_get(op, 25)) { // Immediate
+    if (operand == ARM_ALU_OPERAND_IMM) {
         bool carry_out;
         uint32_t rot;
 
@@ -57,7 +65,7 @@ core_arm_alu(
                 shift_carry = carry_out;
             }
         }
-    } else { // Register
+    } else {
         uint32_t rm;
         uint32_t shift;
 
@@ -70,7 +78,7 @@ core_arm_alu(
         **   - If the shift amount is specified in the instruction, the PC will be 8 bytes ahead.
         **   - If a register is used to specify the shift amount the PC will be 12 bytes ahead
         */
-        if (bitfield_get(shift, 0)) {
+        if (operand == ARM_ALU_OPERAND_REG_REG_SHIFT) {
             early_pc_inc = true;
             core->pc += 4;
             core_idle(gba);
@@ -84,48 +92,35 @@ core_arm_alu(
     /*
     ** Execute the correct data processing instruction.
     */
-    switch ((op >> 21) & 0xF) {
+    switch (opcode) {
         case 0: // AND (op1 AND op2)
             core->registers[rd] = op1 & op2;
             if (cond && rd != 15) {
-                core->cpsr.zero = !(core->registers[rd]);
-                core->cpsr.negative = bitfield_get(core->registers[rd], 31);
-                core->cpsr.carry = shift_carry;
+                core_flags_set_nzc(core, core->registers[rd], shift_carry);
             }
             break;
         case 1: // EOR (op1 XOR op2)
             core->registers[rd] = op1 ^ op2;
             if (cond && rd != 15) {
-                core->cpsr.zero = !(core->registers[rd]);
-                core->cpsr.negative = bitfield_get(core->registers[rd], 31);
-                core->cpsr.carry = shift_carry;
+                core_flags_set_nzc(core, core->registers[rd], shift_carry);
             }
             break;
         case 2: // SUB (op1 - op2)
             core->registers[rd] = op1 - op2;
             if (cond && rd != 15) {
-                core->cpsr.zero = !(core->registers[rd]);
-                core->cpsr.negative = bitfield_get(core->registers[rd], 31);
-                core->cpsr.carry = usub32(op1, op2, 0);
-                core->cpsr.overflow = isub32(op1, op2, 0);
+                core_flags_set_nzcv(core, core->registers[rd], usub32(op1, op2, 0), isub32(op1, op2, 0));
             }
             break;
         case 3: // RSB (op2 - op1)
             core->registers[rd] = op2 - op1;
             if (cond && rd != 15) {
-                core->cpsr.zero = !(core->registers[rd]);
-                core->cpsr.negative = bitfield_get(core->registers[rd], 31);
-                core->cpsr.carry = usub32(op2, op1, 0);
-                core->cpsr.overflow = isub32(op2, op1, 0);
+                core_flags_set_nzcv(core, core->registers[rd], usub32(op2, op1, 0), isub32(op2, op1, 0));
             }
             break;
         case 4: // ADD (op1 + op2)
             core->registers[rd] = op1 + op2;
             if (cond && rd != 15) {
-                core->cpsr.zero = !(core->registers[rd]);
-                core->cpsr.negative = bitfield_get(core->registers[rd], 31);
-                core->cpsr.carry = uadd32(op1, op2, 0);
-                core->cpsr.overflow = iadd32(op1, op2, 0);
+                core_flags_set_nzcv(core, core->registers[rd], uadd32(op1, op2, 0), iadd32(op1, op2, 0));
             }
             break;
         case 5: // ADC (op1 + op2 + carry)
@@ -134,10 +129,7 @@ core_arm_alu(
                 bool carry;
 
                 carry = core->cpsr.carry;
-                core->cpsr.zero = !(core->registers[rd]);
-                core->cpsr.negative = bitfield_get(core->registers[rd], 31);
-                core->cpsr.carry = uadd32(op1, op2, carry);
-                core->cpsr.overflow = iadd32(op1, op2, carry);
+                core_flags_set_nzcv(core, core->registers[rd], uadd32(op1, op2, carry), iadd32(op1, op2, carry));
             }
             break;
         case 6: // SBC (op1 - op2 - !carry)
@@ -146,10 +138,7 @@ core_arm_alu(
                 bool carry;
 
                 carry = core->cpsr.carry;
-                core->cpsr.zero = !(core->registers[rd]);
-                core->cpsr.negative = bitfield_get(core->registers[rd], 31);
-                core->cpsr.carry = usub32(op1, op2, !carry);
-                core->cpsr.overflow = isub32(op1, op2, !carry);
+                core_flags_set_nzcv(core, core->registers[rd], usub32(op1, op2, !carry), isub32(op1, op2, !carry));
             }
             break;
         case 7: // RSC (op2 - op1 - !carry)
@@ -158,68 +147,47 @@ core_arm_alu(
                 bool carry;
 
                 carry = core->cpsr.carry;
-                core->cpsr.zero = !(core->registers[rd]);
-                core->cpsr.negative = bitfield_get(core->registers[rd], 31);
-                core->cpsr.carry = usub32(op2, op1, !carry);
-                core->cpsr.overflow = isub32(op2, op1, !carry);
+                core_flags_set_nzcv(core, core->registers[rd], usub32(op2, op1, !carry), isub32(op2, op1, !carry));
             }
             break;
         case 8: // TST (as AND, but result is not written)
-            core->cpsr.zero = !(op1 & op2);
-            core->cpsr.negative = bitfield_get(op1 & op2, 31);
-            core->cpsr.carry = shift_carry;
+            core_flags_set_nzc(core, op1 & op2, shift_carry);
             break;
         case 9: // TEQ (as EOR, but result is not written)
-            core->cpsr.zero = !(op1 ^ op2);
-            core->cpsr.negative = bitfield_get(op1 ^ op2, 31);
-            core->cpsr.carry = shift_carry;
+            core_flags_set_nzc(core, op1 ^ op2, shift_carry);
             break;
         case 10: // CMP (as SUB, but result is not written)
             if (cond && rd != 15) {
-                core->cpsr.zero = !(op1 - op2);
-                core->cpsr.negative = bitfield_get(op1 - op2, 31);
-                core->cpsr.carry = usub32(op1, op2, 0);
-                core->cpsr.overflow = isub32(op1, op2, 0);
+                core_flags_set_nzcv(core, op1 - op2, usub32(op1, op2, 0), isub32(op1, op2, 0));
             }
             break;
         case 11: // CMN (as ADD, but result is not written)
             if (cond && rd != 15) {
-                core->cpsr.zero = !(op1 + op2);
-                core->cpsr.negative = bitfield_get(op1 + op2, 31);
-                core->cpsr.carry = uadd32(op1, op2, 0);
-                core->cpsr.overflow = iadd32(op1, op2, 0);
+                core_flags_set_nzcv(core, op1 + op2, uadd32(op1, op2, 0), iadd32(op1, op2, 0));
             }
             break;
         case 12: // ORR (op1 OR op2)
             core->registers[rd] = op1 | op2;
             if (cond && rd != 15) {
-                core->cpsr.zero = !(core->registers[rd]);
-                core->cpsr.negative = bitfield_get(core->registers[rd], 31);
-                core->cpsr.carry = shift_carry;
+                core_flags_set_nzc(core, core->registers[rd], shift_carry);
             }
             break;
         case 13: // MOV (op2, op1 is ignored)
             core->registers[rd] = op2;
             if (cond && rd != 15) {
-                core->cpsr.zero = !(core->registers[rd]);
-                core->cpsr.negative = bitfield_get(core->registers[rd], 31);
-                core->cpsr.carry = shift_carry;
+                core_flags_set_nzc(core, core->registers[rd], shift_carry);
             }
             break;
         case 14: // BIC (op1 AND NOT op2)
             core->registers[rd] = op1 & ~op2;
             if (cond && rd != 15) {
-                core->cpsr.zero = !(core->registers[rd]);
-                core->cpsr.negative = bitfield_get(core->registers[rd], 31);
-                core->cpsr.carry = shift_carry;
+                core_flags_set_nzc(core, core->registers[rd], shift_carry);
             }
             break;
         case 15: // MVN (NOT op2, op1 is ignored)
             core->registers[rd] = ~op2;
             if (cond && rd != 15) {
-                core->cpsr.zero = !(core->registers[rd]);
-                core->cpsr.negative = bitfield_get(core->registers[rd], 31);
-                core->cpsr.carry = shift_carry;
+                core_flags_set_nzc(core, core->registers[rd], shift_carry);
             }
             break;
         default:
@@ -241,7 +209,7 @@ core_arm_alu(
         }
 
         // Read-Only operations do not flush the pipeline
-        switch ((op >> 21) & 0xF) {
+        switch (opcode) {
             case 8: // TST
             case 9: // TEQ
             case 10: // CMP
@@ -258,3 +226,41 @@ core_arm_alu(
         core->pc += 4;
     }
 }
+
+#define CORE_ARM_ALU_DEFINE(name, opcode, operand, set_flags)                   \
+    void                                                                        \
+    name(                                                                       \
+        struct gba *gba,                                                        \
+        uint32_t op                                                             \
+    ) {                                                                         \
+        core_arm_alu_template(gba, op, (opcode), (operand), (set_flags));       \
+    }
+
+#define CORE_ARM_ALU_DEFINE_OPCODE(mnemonic, opcode)                                                                \
+    CORE_ARM_ALU_DEFINE(core_arm_##mnemonic##_imm, opcode, ARM_ALU_OPERAND_IMM, false)                              \
+    CORE_ARM_ALU_DEFINE(core_arm_##mnemonic##s_imm, opcode, ARM_ALU_OPERAND_IMM, true)                              \
+    CORE_ARM_ALU_DEFINE(core_arm_##mnemonic##_reg_imm_shift, opcode, ARM_ALU_OPERAND_REG_IMM_SHIFT, false)          \
+    CORE_ARM_ALU_DEFINE(core_arm_##mnemonic##s_reg_imm_shift, opcode, ARM_ALU_OPERAND_REG_IMM_SHIFT, true)          \
+    CORE_ARM_ALU_DEFINE(core_arm_##mnemonic##_reg_reg_shift, opcode, ARM_ALU_OPERAND_REG_REG_SHIFT, false)          \
+    CORE_ARM_ALU_DEFINE(core_arm_##mnemonic##s_reg_reg_shift, opcode, ARM_ALU_OPERAND_REG_REG_SHIFT, true)
+
+/*
+** The specialized Data Processing handlers, named `core_arm_<mnemonic>[s]_<operand>`.
+** Referenced by the generated `arm_lut`.
+*/
+CORE_ARM_ALU_DEFINE_OPCODE(and, 0)
+CORE_ARM_ALU_DEFINE_OPCODE(eor, 1)
+CORE_ARM_ALU_DEFINE_OPCODE(sub, 2)
+CORE_ARM_ALU_DEFINE_OPCODE(rsb, 3)
+CORE_ARM_ALU_DEFINE_OPCODE(add, 4)
+CORE_ARM_ALU_DEFINE_OPCODE(adc, 5)
+CORE_ARM_ALU_DEFINE_OPCODE(sbc, 6)
+CORE_ARM_ALU_DEFINE_OPCODE(rsc, 7)
+CORE_ARM_ALU_DEFINE_OPCODE(tst, 8)
+CORE_ARM_ALU_DEFINE_OPCODE(teq, 9)
+CORE_ARM_ALU_DEFINE_OPCODE(cmp, 10)
+CORE_ARM_ALU_DEFINE_OPCODE(cmn, 11)
+CORE_ARM_ALU_DEFINE_OPCODE(orr, 12)
+CORE_ARM_ALU_DEFINE_OPCODE(mov, 13)
+CORE_ARM_ALU_DEFINE_OPCODE(bic, 14)
+CORE_ARM_ALU_DEFINE_OPCODE(mvn, 15)
@@ -0,0 +1,139 @@
+/******************************************************************************\
+**
+**  This file is part of the Hades GBA Emulator, and is made available under
+**  the terms of the GNU General Public License version 2.
+**
+**  Copyright (C) 2021-2024 - The Hades Authors
+**
+\******************************************************************************/
+
+/*
+** The ARM instruction set, as a list of `ARM_INSN(name, mask, handler)`.
+**
+** The mask is a string of 32 characters (`_` are ignored as separators) where `0` and `1` are the
+** bits that identify the instruction and any other character is a don't-care bit.
+**
+** This is the single source of truth used by `gen_tables.c` to build `arm_lut` at compile time.
+** Include it after defining `ARM_INSN`.
+**
+** `core_arm_alu` isn't a real handler: Data Processing instructions are dispatched to the handler
+** specialized for their opcode, operand and S bit (see `arm/alu.c`).
+*/
+
+// Data processing
+ARM_INSN("and_reg1",        "xxxx_000_0000_s_xxxxxxxxxxxxxxx0xxxx",    core_arm_alu)
+ARM_INSN("and_reg2",        "xxxx_000_0000_s_xxxxxxxxxxxx0xx1xxxx",    core_arm_alu)
+ARM_INSN("and_val",         "xxxx_001_0000_s_xxxxxxxxxxxxxxxxxxxx",    core_arm_alu)
+
+ARM_INSN("eor_reg1",        "xxxx_000_0001_s_xxxxxxxxxxxxxxx0xxxx",    core_arm_alu)
+ARM_INSN("eor_reg2",        "xxxx_000_0001_s_xxxxxxxxxxxx0xx1xxxx",    core_arm_alu)
+ARM_INSN("eor_val",         "xxxx_001_0001_s_xxxxxxxxxxxxxxxxxxxx",    core_arm_alu)
+
+ARM_INSN("sub_reg1",        "xxxx_000_0010_s_xxxxxxxxxxxxxxx0xxxx",    core_arm_alu)
+ARM_INSN("sub_reg2",        "xxxx_000_0010_s_xxxxxxxxxxxx0xx1xxxx",    core_arm_alu)
+ARM_INSN("sub_val",         "xxxx_001_0010_s_xxxxxxxxxxxxxxxxxxxx",    core_arm_alu)
+
+ARM_INSN("rsb_reg1",        "xxxx_000_0011_s_xxxxxxxxxxxxxxx0xxxx",    core_arm_alu)
+ARM_INSN("rsb_reg2",        "xxxx_000_0011_s_xxxxxxxxxxxx0xx1xxxx",    core_arm_alu)
+ARM_INSN("rsb_val",         "xxxx_001_0011_s_xxxxxxxxxxxxxxxxxxxx",    core_arm_alu)
+
+ARM_INSN("add_reg1",        "xxxx_000_0100_s_xxxxxxxxxxxxxxx0xxxx",    core_arm_alu)
+ARM_INSN("add_reg2",        "xxxx_000_0100_s_xxxxxxxxxxxx0xx1xxxx",    core_arm_alu)
+ARM_INSN("add_val",         "xxxx_001_0100_s_xxxxxxxxxxxxxxxxxxxx",    core_arm_alu)
+
+ARM_INSN("adc_reg1",        "xxxx_000_0101_s_xxxxxxxxxxxxxxx0xxxx",    core_arm_alu)
+ARM_INSN("adc_reg2",        "xxxx_000_0101_s_xxxxxxxxxxxx0xx1xxxx",    core_arm_alu)
+ARM_INSN("adc_val",         "xxxx_001_0101_s_xxxxxxxxxxxxxxxxxxxx",    core_arm_alu)
+
+ARM_INSN("sbc_reg1",        "xxxx_000_0110_s_xxxxxxxxxxxxxxx0xxxx",    core_arm_alu)
+ARM_INSN("sbc_reg2",        "xxxx_000_0110_s_xxxxxxxxxxxx0xx1xxxx",    core_arm_alu)
+ARM_INSN("sbc_val",         "xxxx_001_0110_s_xxxxxxxxxxxxxxxxxxxx",    core_arm_alu)
+
+ARM_INSN("rsc_reg1",        "xxxx_000_0111_s_xxxxxxxxxxxxxxx0xxxx",    core_arm_alu)
+ARM_INSN("rsc_reg2",        "xxxx_000_0111_s_xxxxxxxxxxxx0xx1xxxx",    core_arm_alu)
+ARM_INSN("rsc_val",         "xxxx_001_0111_s_xxxxxxxxxxxxxxxxxxxx",    core_arm_alu)
+
+ARM_INSN("tst_reg1",        "xxxx_000_1000_1_xxxxxxxxxxxxxxx0xxxx",    core_arm_alu)
+ARM_INSN("tst_reg2",        "xxxx_000_1000_1_xxxxxxxxxxxx0xx1xxxx",    core_arm_alu)
+ARM_INSN("tst_val",         "xxxx_001_1000_1_xxxxxxxxxxxxxxxxxxxx",    core_arm_alu)
+
+ARM_INSN("teq_reg1",        "xxxx_000_1001_1_xxxxxxxxxxxxxxx0xxxx",    core_arm_alu)
+ARM_INSN("teq_reg2",        "xxxx_000_1001_1_xxxxxxxxxxxx0xx1xxxx",    core_arm_alu)
+ARM_INSN("teq_val",         "xxxx_001_1001_1_xxxxxxxxxxxxxxxxxxxx",    core_arm_alu)
+
+ARM_INSN("cmp_reg1",        "xxxx_000_1010_1_xxxxxxxxxxxxxxx0xxxx",    core_arm_alu)
+ARM_INSN("cmp_reg2",        "xxxx_000_1010_1_xxxxxxxxxxxx0xx1xxxx",    core_arm_alu)
+ARM_INSN("cmp_val",         "xxxx_001_1010_1_xxxxxxxxxxxxxxxxxxxx",    core_arm_alu)
+
+ARM_INSN("cmn_reg1",        "xxxx_000_1011_1_xxxxxxxxxxxxxxx0xxxx",    core_arm_alu)
+ARM_INSN("cmn_reg2",        "xxxx_000_1011_1_xxxxxxxxxxxx0xx1xxxx",    core_arm_alu)
+ARM_INSN("cmn_val",         "xxxx_001_1011_1_xxxxxxxxxxxxxxxxxxxx",    core_arm_alu)
+
+ARM_INSN("orr_reg1",        "xxxx_000_1100_s_xxxxxxxxxxxxxxx0xxxx",    core_arm_alu)
+ARM_INSN("orr_reg2",        "xxxx_000_1100_s_xxxxxxxxxxxx0xx1xxxx",    core_arm_alu)
+ARM_INSN("orr_val",         "xxxx_001_1100_s_xxxxxxxxxxxxxxxxxxxx",    core_arm_alu)
+
+ARM_INSN("mov_reg1",        "xxxx_000_1101_s_xxxxxxxxxxxxxxx0xxxx",    core_arm_alu)
+ARM_INSN("mov_reg2",        "xxxx_000_1101_s_xxxxxxxxxxxx0xx1xxxx",    core_arm_alu)
+ARM_INSN("mov_val",         "xxxx_001_1101_s_xxxxxxxxxxxxxxxxxxxx",    core_arm_alu)
+
+ARM_INSN("bic_reg1",        "xxxx_000_1110_s_xxxxxxxxxxxxxxx0xxxx",    core_arm_alu)
+ARM_INSN("bic_reg2",        "xxxx_000_1110_s_xxxxxxxxxxxx0xx1xxxx",    core_arm_alu)
+ARM_INSN("bic_val",         "xxxx_001_1110_s_xxxxxxxxxxxxxxxxxxxx",    core_arm_alu)
+
+ARM_INSN("mvn_reg1",        "xxxx_000_1111_s_xxxxxxxxxxxxxxx0xxxx",    core_arm_alu)
+ARM_INSN("mvn_reg2",        "xxxx_000_1111_s_xxxxxxxxxxxx0xx1xxxx",    core_arm_alu)
+ARM_INSN("mvn_val",         "xxxx_001_1111_s_xxxxxxxxxxxxxxxxxxxx",    core_arm_alu)
+
+// PSR Transfers
+ARM_INSN("mrs",             "xxxx_00010_p_001111_dddd_000000000000",   core_arm_mrs)
+ARM_INSN("msr_imm",         "xxxx_00110_p_10_xxxx_1111_rrrr_iiiiiiii", core_arm_msr)
+ARM_INSN("msr_reg",         "xxxx_00010_p_10_xxxx_1111_00000000_mmmm", core_arm_msr)
+
+// Multiply and Multiply-Accumulate (MUL, MLA)
+ARM_INSN("mul",             "xxxx_000000_0_s_ddddnnnnssss_1001_mmmm",  core_arm_mul)
+ARM_INSN("mla",             "xxxx_000000_1_s_ddddnnnnssss_1001_mmmm",  core_arm_mul)
+
+// Multiply Long and Multiply-Accumulate Long ({U,I}MULL, {U,I}MLAL)
+ARM_INSN("umull",           "xxxx_00001_00_s_ddddnnnnssss_1001_mmmm",  core_arm_mull)
+ARM_INSN("umlal",           "xxxx_00001_01_s_ddddnnnnssss_1001_mmmm",  core_arm_mull)
+ARM_INSN("imull",           "xxxx_00001_10_s_ddddnnnnssss_1001_mmmm",  core_arm_mull)
+ARM_INSN("imlal",           "xxxx_00001_11_s_ddddnnnnssss_1001_mmmm",  core_arm_mull)
+
+// Branch
+ARM_INSN("b",               "xxxx_101_0_xxxxxxxxxxxxxxxxxxxxxxxx",     core_arm_branch)
+ARM_INSN("bl",              "xxxx_101_1_xxxxxxxxxxxxxxxxxxxxxxxx",     core_arm_branch)
+ARM_INSN("bx",              "xxxx_0001_0010_1111_1111_1111_0001_xxxx", core_arm_branch_xchg)
+
+// Block data transfer
+ARM_INSN("push",            "xxxx_100_pusw0_xxxx_xxxxxxxxxxxxxxxx",    core_arm_bdt)
+ARM_INSN("pop",             "xxxx_100_pusw1_xxxx_xxxxxxxxxxxxxxxx",    core_arm_bdt)
+
+// Single Data Transfer
+ARM_INSN("str",             "xxxx_01_ipubw0_xxxx_xxxx_xxxxxxxxxxxx",   core_arm_sdt)
+ARM_INSN("ldr",             "xxxx_01_ipubw1_xxxx_xxxx_xxxxxxxxxxxx",   core_arm_sdt)
+
+// Halfword and Signed Data Transfer
+ARM_INSN("strh_imm",        "xxxx_000_pu0w0_xxxx_xxxx_0000_1011xxxx",  core_arm_hsdt)
+ARM_INSN("strh_reg",        "xxxx_000_pu1w0_xxxx_xxxx_xxxx_1011xxxx",  core_arm_hsdt)
+
+ARM_INSN("strsb_imm",       "xxxx_000_pu0w0_xxxx_xxxx_0000_1101xxxx",  core_arm_hsdt)
+ARM_INSN("strsb_reg",       "xxxx_000_pu1w0_xxxx_xxxx_xxxx_1101xxxx",  core_arm_hsdt)
+
+ARM_INSN("strsh_imm",       "xxxx_000_pu0w0_xxxx_xxxx_0000_1111xxxx",  core_arm_hsdt)
+ARM_INSN("strsh_reg",       "xxxx_000_pu1w0_xxxx_xxxx_xxxx_1111xxxx",  core_arm_hsdt)
+
+ARM_INSN("ldrh_imm",        "xxxx_000_pu0w1_xxxx_xxxx_0000_1011xxxx",  core_arm_hsdt)
+ARM_INSN("ldrh_reg",        "xxxx_000_pu1w1_xxxx_xxxx_xxxx_1011xxxx",  core_arm_hsdt)
+
+ARM_INSN("ldrsb_imm",       "xxxx_000_pu0w1_xxxx_xxxx_0000_1101xxxx",  core_arm_hsdt)
+ARM_INSN("ldrsb_reg",       "xxxx_000_pu1w1_xxxx_xxxx_xxxx_1101xxxx",  core_arm_hsdt)
+
+ARM_INSN("ldrsh_imm",       "xxxx_000_pu0w1_xxxx_xxxx_0000_1111xxxx",  core_arm_hsdt)
+ARM_INSN("ldrsh_reg",       "xxxx_000_pu1w1_xxxx_xxxx_xxxx_1111xxxx",  core_arm_hsdt)
+
+// Software Interrupt
+ARM_INSN("swi",             "xxxx_1111_xxxxxxxxxxxxxxxxxxxxxxxx",      core_arm_swi)
+
+// Single Data Swap
+ARM_INSN("swp",             "xxxx_00010_b_00nnnndddd00001001mmmm",     core_arm_swp)
@@ -9,6 +9,7 @@
 
 #include "hades.h"
 #include "gba/gba.h"
+#include "gba/core/helpers.h"
 
 static
 void
@@ -98,8 +99,7 @@ core_arm_mul(
     }
 
     if (s) {
-        core->cpsr.zero = !(core->registers[rd]);
-        core->cpsr.negative = bitfield_get(core->registers[rd], 31);
+        core_flags_set_nz(core, core->registers[rd]);
     }
 
     core->pc += 4;
@@ -176,8 +176,8 @@ core_arm_mull(
     core->registers[rd_hi] = (ures >> 32) & 0xFFFFFFFF;
 
     if (s) {
-        core->cpsr.zero = !(core->registers[rd_hi]) && !(core->registers[rd_lo]);
-        core->cpsr.negative = bitfield_get(core->registers[rd_hi], 31);
+        // N is the top bit of the 64-bit result and Z is set only if both halves are null
+        core_flags_set_nz(core, core->registers[rd_hi] | (core->registers[rd_lo] != 0));
     }
 
     core->pc += 4;
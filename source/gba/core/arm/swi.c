@@ -9,11 +9,16 @@
 
 #include "hades.h"
 #include "gba/gba.h"
+#include "gba/bios.h"
 
 void
 core_arm_swi(
     struct gba *gba,
     uint32_t op
 ) {
+    if (gba->memory.hle_bios && bios_hle_swi(gba, bitfield_get_range(op, 16, 24))) {
+        return;
+    }
+
     core_interrupt(gba, VEC_SVC, MODE_SVC, false);
 }
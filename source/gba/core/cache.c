@@ -0,0 +1,261 @@
+/******************************************************************************\
+**
+**  This file is part of the Hades GBA Emulator, and is made available under
+**  the terms of the GNU General Public License version 2.
+**
+**  Copyright (C) 2021-2024 - The Hades Authors
+**
+\******************************************************************************/
+
+#include <string.h>
+#include "hades.h"
+#include "gba/gba.h"
+#include "gba/core.h"
+#include "gba/core/arm.h"
+#include "gba/core/thumb.h"
+
+void
+core_cache_init(
+    struct core_cache *cache
+) {
+    memset(cache, 0, sizeof(*cache));
+    cache->blocks = calloc(CORE_CACHE_BLOCKS, sizeof(struct core_block));
+    hs_assert(cache->blocks);
+}
+
+void
+core_cache_cleanup(
+    struct core_cache *cache
+) {
+    core_jit_cleanup(cache);
+    free(cache->blocks);
+    cache->blocks = NULL;
+}
+
+/*
+** Drop all the cached blocks.
+** Must be called when the content of the memory is replaced (reset, save state, etc.).
+*/
+void
+core_cache_flush(
+    struct gba *gba
+) {
+    struct core_cache *cache;
+
+    cache = &gba->core_cache;
+    memset(cache->blocks, 0, CORE_CACHE_BLOCKS * sizeof(struct core_block));
+    memset(cache->code, 0, sizeof(cache->code));
+    cache->block = NULL;
+    cache->next = NULL;
+    cache->end = NULL;
+    cache->jit_code_len = 0;
+    ++cache->epoch;
+}
+
+/*
+** Invalidate all the blocks built from the given page.
+*/
+void
+core_cache_invalidate_page(
+    struct gba *gba,
+    uint32_t page
+) {
+    struct core_cache *cache;
+
+    cache = &gba->core_cache;
+    cache->code[page] = false;
+    ++cache->gens[page];
+    ++cache->epoch;
+    cache->next = NULL;
+}
+
+/*
+** Return the page the given address belongs to, or `CORE_CACHE_NO_PAGE` if it's read-only.
+*/
+static
+uint32_t
+core_cache_page(
+    uint32_t addr
+) {
+    switch (addr >> 24) {
+        case EWRAM_REGION:  return (CORE_CACHE_EWRAM_PAGE(addr));
+        case IWRAM_REGION:  return (CORE_CACHE_IWRAM_PAGE(addr));
+        default:            return (CORE_CACHE_NO_PAGE);
+    }
+}
+
+/*
+** Return true if reading the given address has no side effect and returns data that
+** can only change through `template_write`.
+**
+** The conditions for the cartridge mirror the ones of `template_read`.
+*/
+static
+bool
+core_cache_is_plain(
+    struct gba const *gba,
+    uint32_t addr
+) {
+    switch (addr >> 24) {
+        case EWRAM_REGION:
+        case IWRAM_REGION:
+            return (true);
+        case CART_REGION_START ... CART_REGION_END: {
+            if (
+                (gba->memory.backup_storage.type == BACKUP_EEPROM_4K || gba->memory.backup_storage.type == BACKUP_EEPROM_64K)
+                && (addr & gba->memory.backup_storage.chip.eeprom.mask) == gba->memory.backup_storage.chip.eeprom.range
+            ) {
+                return (false);
+            }
+
+            if (addr >= GPIO_REG_START && addr <= GPIO_REG_END) {
+                return (false);
+            }
+
+            return ((addr & CART_MASK) < gba->rom.size);
+        };
+        default:
+            return (false);
+    }
+}
+
+/*
+** Return true if the given instruction always leaves the block, in which case there's
+** no point decoding the instructions that follow it.
+*/
+static
+bool
+core_cache_is_block_end(
+    struct core_uop const *uop,
+    bool thumb
+) {
+    if (thumb) {
+        return (
+               uop->handler.thumb == NULL
+            || uop->handler.thumb == core_thumb_branch
+            || uop->handler.thumb == core_thumb_branch_xchg
+            || uop->handler.thumb == core_thumb_swi
+        );
+    } else {
+        return (
+               uop->handler.arm == NULL
+            || (uop->cond == COND_AL && (
+                   uop->handler.arm == core_arm_branch
+                || uop->handler.arm == core_arm_branch_xchg
+                || uop->handler.arm == core_arm_swi
+            ))
+        );
+    }
+}
+
+/*
+** Decode the block starting at the address held by `key` into `block`.
+**
+** Return false if no block could be built at that address.
+*/
+static
+bool
+core_cache_build(
+    struct gba *gba,
+    struct core_block *block,
+    uint32_t key
+) {
+    struct core_cache *cache;
+    uint32_t addr;
+    uint32_t size;
+    uint32_t limit;
+    uint32_t i;
+    bool thumb;
+
+    cache = &gba->core_cache;
+    thumb = key & 0b1;
+    addr = key & ~0b1;
+    size = thumb ? sizeof(uint16_t) : sizeof(uint32_t);
+
+    /*
+    ** The two words following the last instruction of the block are fetched
+    ** while it is executed, so they must be plain memory too.
+    */
+    limit = CORE_CACHE_BLOCK_LEN + 2;
+    for (i = 0; i < limit; ++i) {
+        struct core_uop *uop;
+        uint32_t uop_addr;
+
+        uop_addr = addr + i * size;
+        if (!core_cache_is_plain(gba, uop_addr)) {
+            break;
+        }
+
+        uop = block->uops + i;
+        if (thumb) {
+            uop->op = mem_read16_raw(gba, uop_addr);
+            uop->cond = COND_AL;
+            uop->handler.thumb = thumb_lut[uop->op >> 6];
+        } else {
+            uop->op = mem_read32_raw(gba, uop_addr);
+            uop->cond = bitfield_get_range(uop->op, 28, 32);
+            uop->handler.arm = arm_lut[((uop->op >> 16) & 0xFF0) | ((uop->op >> 4) & 0x00F)];
+        }
+
+        if (i < CORE_CACHE_BLOCK_LEN && core_cache_is_block_end(uop, thumb)) {
+            limit = min(limit, i + 3);
+        }
+    }
+
+    if (i <= 2) {
+        block->key = 0;
+        return (false);
+    }
+
+    block->key = key;
+    block->len = i - 2;
+    block->hits = 0;
+    block->native = NULL;
+    block->pages[0] = core_cache_page(addr);
+    block->pages[1] = core_cache_page(addr + (i - 1) * size);
+    block->gens[0] = cache->gens[block->pages[0]];
+    block->gens[1] = cache->gens[block->pages[1]];
+
+    // Read-only memory can't be written to so there's no need to watch it.
+    if (block->pages[0] != CORE_CACHE_NO_PAGE) {
+        cache->code[block->pages[0]] = true;
+    }
+    if (block->pages[1] != CORE_CACHE_NO_PAGE) {
+        cache->code[block->pages[1]] = true;
+    }
+
+    return (true);
+}
+
+/*
+** Find, or build, the block starting at the address held by `key` and make it the current one.
+**
+** Return the first micro-op of the block or NULL if the instructions at that address
+** can't be cached.
+*/
+struct core_uop const *
+core_cache_lookup(
+    struct gba *gba,
+    uint32_t key
+) {
+    struct core_cache *cache;
+    struct core_block *block;
+
+    cache = &gba->core_cache;
+    block = cache->blocks + ((key >> ((key & 0b1) ? 1 : 2)) & (CORE_CACHE_BLOCKS - 1));
+
+    if (
+           block->key != key
+        || block->gens[0] != cache->gens[block->pages[0]]
+        || block->gens[1] != cache->gens[block->pages[1]]
+    ) {
+        if (!core_cache_build(gba, block, key)) {
+            cache->next = NULL;
+            return (NULL);
+        }
+    }
+
+    cache->block = block;
+    cache->end = block->uops + block->len;
+    return (block->uops);
+}
@@ -24,6 +24,84 @@
 #include "gba/core/thumb.h"
 #include "gba/core/helpers.h"
 
+/*
+** Return the cached micro-op of the instruction at the address held by `key`, or NULL if
+** that instruction isn't cached.
+**
+** Consecutive instructions of the same block are found without any lookup.
+*/
+static inline
+struct core_uop const *
+core_cache_next(
+    struct gba *gba,
+    uint32_t key
+) {
+    struct core_cache *cache;
+    struct core_uop const *uop;
+
+    cache = &gba->core_cache;
+    if (likely(cache->next && cache->next_key == key)) {
+        uop = cache->next;
+    } else {
+        uop = core_cache_lookup(gba, key);
+        if (!uop) {
+            return (NULL);
+        }
+    }
+
+    cache->next = (uop + 1 < cache->end) ? uop + 1 : NULL;
+    cache->next_key = key + ((key & 0b1) ? sizeof(uint16_t) : sizeof(uint32_t));
+    return (uop);
+}
+
+/*
+** Fetch the instruction at the given address, which the cache already holds in `uop`.
+**
+** The access still goes through `mem_access()` so the timings are the same, but the
+** value is only re-read if the memory was written in the meantime.
+*/
+static inline
+uint32_t
+core_cache_fetch(
+    struct gba *gba,
+    struct core_uop const *uop,
+    uint32_t addr,
+    uint32_t size
+) {
+    uint32_t epoch;
+
+    epoch = gba->core_cache.epoch;
+
+#ifdef WITH_DEBUGGER
+    debugger_eval_read_watchpoints(gba, addr, size);
+#endif
+
+    mem_access(gba, addr, size, gba->core.prefetch_access_type);
+
+    if (likely(gba->core_cache.epoch == epoch)) {
+        return (uop->op);
+    }
+    return (size == sizeof(uint16_t) ? mem_read16_raw(gba, addr) : mem_read32_raw(gba, addr));
+}
+
+/*
+** Called after an instruction located at `addr` changed the PC.
+** Look for a short backward branch and give it to the idle loop detector.
+*/
+static inline
+void
+core_idle_loop_check(
+    struct gba *gba,
+    uint32_t addr
+) {
+    uint32_t head;
+
+    head = gba->core.pc - (gba->core.cpsr.thumb ? 4 : 8);
+    if (head <= addr && addr - head <= CORE_IDLE_LOOP_MAX_SIZE) {
+        core_idle_loop_eval(gba, head);
+    }
+}
+
 /*
 ** Fetch, decode and execute the next instruction.
 **
@@ -34,6 +112,10 @@
 **   - Run: Fetch, decode and execute the next instruction
 **   - Halt: Idle until the next event
 **
+** When the cached interpreter or the JIT is selected, instructions executed from plain memory
+** are decoded once and kept in `gba->core_cache`. Other ones are decoded using the Lookup
+** Tables each time.
+**
 ** The `Stop` state isn't handled here, hence why it isn't mentioned.
 */
 void
@@ -52,29 +134,67 @@ core_next(
 
     if (likely(core->state == CORE_RUN)) {
         if (core->cpsr.thumb) {
+            struct core_uop const *uop;
+            void (*handler)(struct gba *gba, uint16_t op);
+            uint32_t pc;
             uint16_t op;
 
+            pc = core->pc;
             op = core->prefetch[0];
             core->prefetch[0] = core->prefetch[1];
-            core->prefetch[1] = mem_read16(gba, core->pc, core->prefetch_access_type);
+
+            uop = NULL;
+            if (gba->settings.core_backend != CORE_BACKEND_INTERPRETER) {
+                uop = core_cache_next(gba, (core->pc - 4) | 0b1);
+            }
+
+            if (likely(uop && uop->op == op)) {
+                handler = uop->handler.thumb;
+                core->prefetch[1] = core_cache_fetch(gba, uop + 2, core->pc, sizeof(uint16_t));
+            } else {
+                handler = thumb_lut[op >> 6];
+                core->prefetch[1] = mem_read16(gba, core->pc, core->prefetch_access_type);
+            }
             gba->memory.was_last_access_from_dma = false;
 
             // Build a unique index based on the instruction's opcode, which is then used to index
             // the Lookup Table (LUT) of Thumb instructions.
             //
             // NOTE: We need to properly handle unknown instructions instead of crashing.
-            if (unlikely(thumb_lut[op >> 8] == NULL)) {
+            if (unlikely(handler == NULL)) {
                 panic(HS_CORE, "Unknown Thumb op-code 0x%04x (pc=0x%08x).", op, core->pc);
             }
 
-            thumb_lut[op >> 8](gba, op);
+            handler(gba, op);
+
+            if (unlikely(core->pc != pc + 2) && gba->settings.idle_loop_detection) {
+                core_idle_loop_check(gba, pc - 4);
+            }
         } else {
+            struct core_uop const *uop;
+            void (*handler)(struct gba *gba, uint32_t op);
             size_t idx;
+            uint32_t pc;
             uint32_t op;
 
+            pc = core->pc;
             op = core->prefetch[0];
             core->prefetch[0] = core->prefetch[1];
-            core->prefetch[1] = mem_read32(gba, core->pc, core->prefetch_access_type);
+
+            uop = NULL;
+            if (gba->settings.core_backend != CORE_BACKEND_INTERPRETER) {
+                uop = core_cache_next(gba, core->pc - 8);
+            }
+
+            if (likely(uop && uop->op == op)) {
+                handler = uop->handler.arm;
+                core->prefetch[1] = core_cache_fetch(gba, uop + 2, core->pc, sizeof(uint32_t));
+            } else {
+                // Build a unique index based on the instruction's opcode, which is then used to index
+                // the Lookup Table (LUT) of ARM instructions.
+                handler = arm_lut[((op >> 16) & 0xFF0) | ((op >> 4) & 0x00F)];
+                core->prefetch[1] = mem_read32(gba, core->pc, core->prefetch_access_type);
+            }
             gba->memory.was_last_access_from_dma = false;
 
             // Test if the conditions required to execute the instruction are met using a Lookup Table (LUT).
@@ -88,16 +208,16 @@ core_next(
                 goto end;
             }
 
-            // Build a unique index based on the instruction's opcode, which is then used to index
-            // the Lookup Table (LUT) of ARM instructions.
-            //
             // NOTE: We need to properly handle unknown instructions instead of crashing.
-            idx = ((op >> 16) & 0xFF0) | ((op >> 4) & 0x00F);
-            if (unlikely(arm_lut[idx] == NULL)) {
+            if (unlikely(handler == NULL)) {
                 panic(HS_CORE, "Unknown ARM op-code 0x%08x (pc=0x%08x).", op, core->pc);
             }
 
-            arm_lut[idx](gba, op);
+            handler(gba, op);
+
+            if (unlikely(core->pc != pc + 4) && gba->settings.idle_loop_detection) {
+                core_idle_loop_check(gba, pc - 8);
+            }
         }
     } else if (core->state == CORE_HALT) {
         if (gba->scheduler.next_event > gba->scheduler.cycles) {
@@ -0,0 +1,337 @@
+/******************************************************************************\
+**
+**  This file is part of the Hades GBA Emulator, and is made available under
+**  the terms of the GNU General Public License version 2.
+**
+**  Copyright (C) 2021-2024 - The Hades Authors
+**
+\******************************************************************************/
+
+/*
+** Build-time generator of the core's decoding tables (`arm_lut`, `thumb_lut` and `cond_lut`).
+**
+** It reads the instruction sets described in `arm/insns.h` and `thumb/insns.h`, ensures no two
+** instructions collide and writes the resulting lookup tables as `const` C arrays to the file
+** given as argument.
+**
+** This program runs on the build machine and must not depend on the rest of libgba.
+*/
+
+#include <string.h>
+#include "hades.h"
+#include "gba/core.h"
+#include "gba/core/arm.h"
+#include "gba/core/thumb.h"
+
+struct insn {
+    char const *name;
+    char const *mask;
+    char const *handler;
+};
+
+struct decoded_insn {
+    uint32_t mask;
+    uint32_t value;
+};
+
+static struct insn const arm_insns[] = {
+#define ARM_INSN(name, mask, handler) { name, mask, #handler },
+#include "gba/core/arm/insns.h"
+#undef ARM_INSN
+};
+
+static struct insn const thumb_insns[] = {
+#define THUMB_INSN(name, mask, handler) { name, mask, #handler },
+#include "gba/core/thumb/insns.h"
+#undef THUMB_INSN
+};
+
+/*
+** The mnemonics of the Data Processing instructions, indexed by opcode.
+** Must match the handlers defined in `arm/alu.c`.
+*/
+static char const * const arm_alu_mnemonics[16] = {
+    "and", "eor", "sub", "rsb", "add", "adc", "sbc", "rsc",
+    "tst", "teq", "cmp", "cmn", "orr", "mov", "bic", "mvn",
+};
+
+static char const * const arm_alu_operands[ARM_ALU_OPERAND_LEN] = {
+    [ARM_ALU_OPERAND_IMM] = "imm",
+    [ARM_ALU_OPERAND_REG_IMM_SHIFT] = "reg_imm_shift",
+    [ARM_ALU_OPERAND_REG_REG_SHIFT] = "reg_reg_shift",
+};
+
+static __noreturn
+void
+fatal(
+    char const *fmt,
+    ...
+) {
+    va_list va;
+
+    va_start(va, fmt);
+    fprintf(stderr, "gen_tables: ");
+    vfprintf(stderr, fmt, va);
+    fprintf(stderr, "\n");
+    va_end(va);
+    exit(EXIT_FAILURE);
+}
+
+/*
+** Decode the user-friendly string masks into a mask and a value, and ensure there's no
+** collision between two instructions.
+*/
+static
+void
+decode_insns(
+    struct insn const *insns,
+    struct decoded_insn *decoded_insns,
+    size_t len,
+    size_t bits
+) {
+    size_t i;
+
+    for (i = 0; i < len; ++i) {
+        struct insn const *encoded_insn;
+        struct decoded_insn *decoded_insn;
+        size_t j;
+        size_t k;
+
+        encoded_insn = insns + i;
+        decoded_insn = decoded_insns + i;
+        decoded_insn->mask = 0;
+        decoded_insn->value = 0;
+
+        j = 0; // Iterator over all the chars of `encoded_insn->mask`
+        k = 0; // Counter of non-separator characters of `encoded_insn->mask`
+        while (encoded_insn->mask[j]) {
+            if (encoded_insn->mask[j] != '_') { // Skip separators
+
+                decoded_insn->mask <<= 1;
+                decoded_insn->value <<= 1;
+
+                if (encoded_insn->mask[j] == '0' || encoded_insn->mask[j] == '1') {
+                    decoded_insn->mask |= 1;
+                    decoded_insn->value |= (encoded_insn->mask[j] - '0');
+                }
+                ++k;
+            }
+            ++j;
+        }
+
+        if (k != bits) {
+            fatal("instruction \"%s\" doesn't have a length of %zu bits", encoded_insn->name, bits);
+        }
+
+        /*
+        ** Ensure we don't have a collision with an existing instruction.
+        **
+        ** To do that, we must verify that there's at least one difference between
+        ** the instruction we want to add and all other instructions.
+        **
+        ** By difference, we mean at least one bit in common in the mask of both
+        ** instructions that maps to different values.
+        */
+        for (j = 0; j < i; ++j) {
+            if (!(((decoded_insn->value ^ decoded_insns[j].value) & decoded_insn->mask) & decoded_insns[j].mask)) {
+                fatal("instruction \"%s\" collides with \"%s\".", encoded_insn->name, insns[j].name);
+            }
+        }
+    }
+}
+
+/*
+** Find the handler of the instruction matching `op` on the bits covered by `lut_mask`.
+** Return NULL if there's none.
+*/
+static
+struct insn const *
+lookup_insn(
+    struct insn const *insns,
+    struct decoded_insn const *decoded_insns,
+    size_t len,
+    uint32_t op,
+    uint32_t lut_mask
+) {
+    struct insn const *match;
+    size_t j;
+
+    match = NULL;
+    for (j = 0; j < len; ++j) {
+        if ((op & decoded_insns[j].mask & lut_mask) == (decoded_insns[j].value & lut_mask)) {
+
+            // Check for double matches, which means the LUT is too small and ambiguous.
+            if (match) {
+                fatal("op-code 0x%08x is ambiguous between \"%s\" and \"%s\".", op, match->name, insns[j].name);
+            }
+            match = insns + j;
+        }
+    }
+    return (match);
+}
+
+/*
+** Return the name of the handler of the given ARM instruction.
+**
+** Data Processing instructions are dispatched straight to the handler specialized for their opcode,
+** kind of second operand and S bit.
+*/
+static
+void
+arm_handler_name(
+    char *buffer,
+    size_t size,
+    struct insn const *insn,
+    uint32_t op
+) {
+    if (!strcmp(insn->handler, "core_arm_alu")) {
+        enum arm_alu_operands operand;
+
+        if (bitfield_get(op, 25)) {
+            operand = ARM_ALU_OPERAND_IMM;
+        } else if (bitfield_get(op, 4)) {
+            operand = ARM_ALU_OPERAND_REG_REG_SHIFT;
+        } else {
+            operand = ARM_ALU_OPERAND_REG_IMM_SHIFT;
+        }
+
+        snprintf(
+            buffer,
+            size,
+            "core_arm_%s%s_%s",
+            arm_alu_mnemonics[(op >> 21) & 0xF],
+            bitfield_get(op, 20) ? "s" : "",
+            arm_alu_operands[operand]
+        );
+    } else {
+        snprintf(buffer, size, "%s", insn->handler);
+    }
+}
+
+static
+bool
+cond_eval(
+    uint32_t i
+) {
+    bool o;
+    bool c;
+    bool z;
+    bool n;
+
+    o = bitfield_get(i, 4);
+    c = bitfield_get(i, 5);
+    z = bitfield_get(i, 6);
+    n = bitfield_get(i, 7);
+    switch (bitfield_get_range(i, 0, 4)) {
+        case COND_EQ: return (z);
+        case COND_NE: return (!z);
+        case COND_CS: return (c);
+        case COND_CC: return (!c);
+        case COND_MI: return (n);
+        case COND_PL: return (!n);
+        case COND_VS: return (o);
+        case COND_VC: return (!o);
+        case COND_HI: return (c && !z);
+        case COND_LS: return (!c || z);
+        case COND_GE: return (n == o);
+        case COND_LT: return (n != o);
+        case COND_GT: return (!z && (n == o));
+        case COND_LE: return (z || (n != o));
+        case COND_AL: return (true);
+        default:      return (false);
+    }
+}
+
+int
+main(
+    int argc,
+    char *argv[]
+) {
+    struct decoded_insn arm_decoded_insns[array_length(arm_insns)];
+    struct decoded_insn thumb_decoded_insns[array_length(thumb_insns)];
+    char (*arm_handlers)[64];
+    char (*thumb_handlers)[64];
+    FILE *out;
+    uint32_t i;
+
+    if (argc != 2) {
+        fatal("usage: %s <output.c>", argv[0]);
+    }
+
+    decode_insns(arm_insns, arm_decoded_insns, array_length(arm_insns), 32);
+    decode_insns(thumb_insns, thumb_decoded_insns, array_length(thumb_insns), 16);
+
+    arm_handlers = calloc(CORE_ARM_LUT_LEN, sizeof(*arm_handlers));
+    thumb_handlers = calloc(CORE_THUMB_LUT_LEN, sizeof(*thumb_handlers));
+    if (!arm_handlers || !thumb_handlers) {
+        fatal("out of memory");
+    }
+
+    for (i = 0; i < CORE_ARM_LUT_LEN; ++i) {
+        struct insn const *insn;
+        uint32_t op;
+
+        op = ((i & 0xFF0) << 16) | ((i & 0xF) << 4);
+        insn = lookup_insn(arm_insns, arm_decoded_insns, array_length(arm_insns), op, 0x0FF000F0);
+        if (insn) {
+            arm_handler_name(arm_handlers[i], sizeof(*arm_handlers), insn, op);
+        }
+    }
+
+    for (i = 0; i < CORE_THUMB_LUT_LEN; ++i) {
+        struct insn const *insn;
+
+        insn = lookup_insn(thumb_insns, thumb_decoded_insns, array_length(thumb_insns), i << 6, 0xFFC0);
+        if (insn) {
+            snprintf(thumb_handlers[i], sizeof(*thumb_handlers), "%s", insn->handler);
+        }
+    }
+
+    out = fopen(argv[1], "w");
+    if (!out) {
+        fatal("can't open \"%s\"", argv[1]);
+    }
+
+    fprintf(out, "/* Generated by gen_tables.c from arm/insns.h and thumb/insns.h. Do not edit. */\n\n");
+    fprintf(out, "#include \"gba/gba.h\"\n");
+    fprintf(out, "#include \"gba/core/arm.h\"\n");
+    fprintf(out, "#include \"gba/core/thumb.h\"\n\n");
+
+    // Declare the specialized Data Processing handlers, which aren't in a header.
+    for (i = 0; i < 16 * ARM_ALU_OPERAND_LEN * 2; ++i) {
+        fprintf(
+            out,
+            "void core_arm_%s%s_%s(struct gba *gba, uint32_t op);\n",
+            arm_alu_mnemonics[i / (ARM_ALU_OPERAND_LEN * 2)],
+            (i % 2) ? "s" : "",
+            arm_alu_operands[(i / 2) % ARM_ALU_OPERAND_LEN]
+        );
+    }
+
+    fprintf(out, "\nvoid (* const arm_lut[CORE_ARM_LUT_LEN])(struct gba *gba, uint32_t op) = {\n");
+    for (i = 0; i < CORE_ARM_LUT_LEN; ++i) {
+        fprintf(out, "    [0x%03x] = %s,\n", i, *arm_handlers[i] ? arm_handlers[i] : "NULL");
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "void (* const thumb_lut[CORE_THUMB_LUT_LEN])(struct gba *gba, uint16_t op) = {\n");
+    for (i = 0; i < CORE_THUMB_LUT_LEN; ++i) {
+        fprintf(out, "    [0x%03x] = %s,\n", i, *thumb_handlers[i] ? thumb_handlers[i] : "NULL");
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "bool const cond_lut[CORE_COND_LUT_LEN] = {\n");
+    for (i = 0; i < CORE_COND_LUT_LEN; ++i) {
+        fprintf(out, "    [0x%02x] = %s,\n", i, cond_eval(i) ? "true" : "false");
+    }
+    fprintf(out, "};\n");
+
+    if (fclose(out)) {
+        fatal("can't write \"%s\"", argv[1]);
+    }
+
+    free(arm_handlers);
+    free(thumb_handlers);
+
+    return (EXIT_SUCCESS);
+}
@@ -0,0 +1,121 @@
+/******************************************************************************\
+**
+**  This file is part of the Hades GBA Emulator, and is made available under
+**  the terms of the GNU General Public License version 2.
+**
+**  Copyright (C) 2021-2024 - The Hades Authors
+**
+\******************************************************************************/
+
+#include <string.h>
+#include "hades.h"
+#include "gba/gba.h"
+#include "gba/core.h"
+
+/*
+** Forget about the loop being watched.
+** Must be called when the state of the core is replaced (save state, etc.).
+*/
+void
+core_idle_loop_reset(
+    struct gba *gba
+) {
+    struct core_idle_loop *idle_loop;
+
+    idle_loop = &gba->core_idle_loop;
+    idle_loop->head = 0;
+    idle_loop->tainted = true;
+}
+
+/*
+** Log the address of the given idle loop, unless it was already logged before.
+*/
+static
+void
+core_idle_loop_log(
+    struct gba *gba,
+    uint32_t head
+) {
+    struct core_idle_loop *idle_loop;
+    size_t i;
+
+    idle_loop = &gba->core_idle_loop;
+    for (i = 0; i < idle_loop->logged_len; ++i) {
+        if (idle_loop->logged[i] == head) {
+            return;
+        }
+    }
+
+    if (idle_loop->logged_len < CORE_IDLE_LOOP_MAX_LOGGED) {
+        idle_loop->logged[idle_loop->logged_len++] = head;
+        logln(HS_CORE, "Idle loop detected at 0x%08x.", head);
+    }
+}
+
+/*
+** Fast-forward to the next scheduler event, the same way `core_next()` does when the core is halted.
+*/
+static
+void
+core_idle_loop_skip(
+    struct gba *gba,
+    uint32_t head
+) {
+    // An IRQ is about to be serviced, the loop will be left before the next event.
+    if (gba->core.irq_line && !gba->core.cpsr.irq_disable) {
+        return;
+    }
+
+    core_idle_loop_log(gba, head);
+
+    if (gba->scheduler.next_event > gba->scheduler.cycles) {
+        core_idle_for(gba, gba->scheduler.next_event - gba->scheduler.cycles);
+    }
+}
+
+/*
+** Called each time the core branches backward to `head`, a few instructions before the branch.
+**
+** If the previous iteration of the loop started at the same address, had no side effect and left
+** the core in the exact same state, the loop can't exit until something else changes the memory,
+** which can only happen during a scheduler event.
+*/
+void
+core_idle_loop_eval(
+    struct gba *gba,
+    uint32_t head
+) {
+    struct core_idle_loop *idle_loop;
+    struct core *core;
+
+    idle_loop = &gba->core_idle_loop;
+    core = &gba->core;
+
+    switch (idle_loop->config.mode) {
+        case IDLE_LOOP_DISABLED: {
+            return;
+        };
+        case IDLE_LOOP_FORCED: {
+            if (head == idle_loop->config.addr) {
+                core_idle_loop_skip(gba, head);
+            }
+            return;
+        };
+        case IDLE_LOOP_AUTODETECT: {
+            if (
+                   head == idle_loop->head
+                && !idle_loop->tainted
+                && core->cpsr.raw == idle_loop->cpsr
+                && !memcmp(core->registers, idle_loop->registers, sizeof(core->registers))
+            ) {
+                core_idle_loop_skip(gba, head);
+            }
+
+            idle_loop->head = head;
+            idle_loop->cpsr = core->cpsr.raw;
+            idle_loop->tainted = false;
+            memcpy(idle_loop->registers, core->registers, sizeof(core->registers));
+            break;
+        };
+    }
+}
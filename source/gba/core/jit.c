@@ -0,0 +1,1686 @@
+/******************************************************************************\
+**
+**  This file is part of the Hades GBA Emulator, and is made available under
+**  the terms of the GNU General Public License version 2.
+**
+**  Copyright (C) 2021-2024 - The Hades Authors
+**
+\******************************************************************************/
+
+/*
+** References:
+**   * Intel 64 and IA-32 Architectures Software Developer's Manual, Volume 2
+**      https://www.intel.com/content/www/us/en/developer/articles/technical/intel-sdm.html
+*/
+
+/*
+** A JIT compiling the hot blocks of `core_cache` to x86-64.
+**
+** Only the blocks located in EWRAM and IWRAM are compiled, and only the Data Processing instructions
+** that don't write to the PC or shift by a register and the loads and stores of a single word, halfword
+** or byte are translated. Any other instruction, as well as the accesses that land outside of EWRAM and
+** IWRAM, are left to the interpreter: the native code returns right before them. With the mirror view
+** (see `struct mem_mirror`), loads skip the masks and read the view directly.
+**
+** The native code keeps the state of the core in `struct gba` and updates it after each instruction,
+** so leaving it never requires more than telling where it stopped. It also stops before any
+** instruction that would reach the next scheduler event or the end of the current run, leaving to the
+** interpreter the job of running the events in the middle of the instruction, at the exact same cycle.
+**
+** The ROM isn't handled: the timing of its accesses depends on the state of the prefetch buffer.
+*/
+
+#include <stddef.h>
+#include <string.h>
+#include "hades.h"
+#include "gba/gba.h"
+#include "gba/core.h"
+#include "gba/core/helpers.h"
+#include "gba/core/arm.h"
+#include "gba/core/thumb.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+# define CORE_JIT_X64
+#endif
+
+#ifdef CORE_JIT_X64
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+# include <windows.h>
+#else
+# include <sys/mman.h>
+#endif
+
+#define CORE_JIT_CODE_SIZE          (4 * 1024 * 1024)   // Size of the executable memory
+#define CORE_JIT_BLOCK_MAX_SIZE     (16 * 1024)         // More than the native code of the largest block
+#define CORE_JIT_THRESHOLD          16                  // Times a block must be entered before being compiled
+
+#define CORE_JIT_MAX_LABELS         256
+#define CORE_JIT_MAX_FIXUPS         512
+
+/*
+** The registers of the host.
+**
+** While the native code runs, `RBX` holds the GBA, `R12` the scheduler's cycle counter, `R13` its next event,
+** `R14` the cycle at which the run must end and `R15` the access type of the next fetch, multiplied by the size
+** of a row of `access_time16` and `access_time32`.
+** They are all callee-saved, so they survive the calls to the C functions.
+*/
+enum x64_regs {
+    X64_RAX = 0,
+    X64_RCX = 1,
+    X64_RDX = 2,
+    X64_RBX = 3,
+    X64_RSP = 4,
+    X64_RBP = 5,
+    X64_RSI = 6,
+    X64_RDI = 7,
+    X64_R8  = 8,
+    X64_R9  = 9,
+    X64_R10 = 10,
+    X64_R11 = 11,
+    X64_R12 = 12,
+    X64_R13 = 13,
+    X64_R14 = 14,
+    X64_R15 = 15,
+
+    X64_NO_INDEX = X64_RSP,                 // RSP can't be used as an index, so its encoding means "none"
+};
+
+/*
+** The condition codes of `Jcc` and `SETcc`.
+*/
+enum x64_conds {
+    X64_CC_O    = 0x0,
+    X64_CC_C    = 0x2,
+    X64_CC_NC   = 0x3,
+    X64_CC_Z    = 0x4,
+    X64_CC_NZ   = 0x5,
+    X64_CC_A    = 0x7,
+    X64_CC_S    = 0x8,
+};
+
+/*
+** The operations of the `ALU r/m32, r32` (their opcode) and `ALU r/m32, imm32` (their `/digit`) instructions.
+*/
+enum x64_alu_ops {
+    X64_ADD = 0x01,
+    X64_OR  = 0x09,
+    X64_ADC = 0x11,
+    X64_SBB = 0x19,
+    X64_AND = 0x21,
+    X64_SUB = 0x29,
+    X64_XOR = 0x31,
+    X64_CMP = 0x39,
+    X64_TEST = 0x85,
+    X64_MOV = 0x89,
+};
+
+#define X64_ALU_DIGIT(op)           ((op) >> 3)
+
+/*
+** The `/digit` of the shift instructions.
+*/
+enum x64_shifts {
+    X64_ROR = 1,
+    X64_RCR = 3,
+    X64_SHL = 4,
+    X64_SHR = 5,
+    X64_SAR = 7,
+};
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+# define X64_ARG0                   X64_RCX
+# define X64_ARG1                   X64_RDX
+# define X64_ARG2                   X64_R8
+#else
+# define X64_ARG0                   X64_RDI
+# define X64_ARG1                   X64_RSI
+# define X64_ARG2                   X64_RDX
+#endif
+
+#define JIT_OFFSET(field)           ((int32_t)offsetof(struct gba, field))
+#define JIT_REG(reg)                (JIT_OFFSET(core.registers) + (int32_t)(reg) * (int32_t)sizeof(uint32_t))
+#define JIT_ACCESS_TIME(size, type, page)                                       \
+    (                                                                           \
+        ((size) == sizeof(uint32_t) ? JIT_OFFSET(memory.access_time32) : JIT_OFFSET(memory.access_time16)) \
+        + (int32_t)(((type) * 16 + (page)) * sizeof(uint32_t))                  \
+    )
+#define JIT_SEQUENTIAL              (SEQUENTIAL * 16 * sizeof(uint32_t))    // The value of `R15` when the next fetch is sequential
+
+/*
+** An operand of an instruction: a register or a value known at compile time, like the PC.
+*/
+struct jit_operand {
+    bool is_const;
+    uint32_t value;                         // The index of the register or the constant
+};
+
+enum jit_insn_kinds {
+    JIT_INSN_ALU,
+    JIT_INSN_LOAD,
+    JIT_INSN_STORE,
+};
+
+/*
+** A decoded instruction, expressed in terms of the ARM instruction set whether it's an ARM or a Thumb one.
+*/
+struct jit_insn {
+    enum jit_insn_kinds kind;
+    uint32_t cond;
+
+    // The first operand (Data Processing) or the base (Transfers)
+    struct jit_operand rn;
+
+    // The second operand (Data Processing) or the offset (Transfers), shifted as in ARM's encoding
+    struct jit_operand rm;
+    uint32_t shift_type;
+    uint32_t shift;
+    int32_t imm_carry;                      // The carry out of a constant `rm`, -1 to leave the carry flag untouched
+
+    // Data Processing
+    uint32_t opcode;
+    bool set_flags;
+    uint32_t rd;
+
+    // Transfers
+    struct jit_operand value;               // The register loaded or stored (stores may store a constant)
+    uint32_t size;
+    bool sign;
+    bool up;
+    bool pre;
+    bool writeback;
+};
+
+struct jit_fixup {
+    uint32_t at;                            // Offset of the `rel32` to patch
+    uint32_t label;
+};
+
+/*
+** The state of the emitter while it compiles a block.
+*/
+struct jit {
+    uint8_t *code;
+    size_t len;
+    size_t size;
+
+    int32_t labels[CORE_JIT_MAX_LABELS];    // Offset of each label, -1 if not bound yet
+    size_t labels_len;
+
+    struct jit_fixup fixups[CORE_JIT_MAX_FIXUPS];
+    size_t fixups_len;
+
+    bool mirror;                            // Loads go through the mirror view (see `struct mem_mirror`)
+};
+
+/*
+** Emitter
+*/
+
+static inline
+void
+jit_emit8(
+    struct jit *jit,
+    uint8_t byte
+) {
+    hs_assert(jit->len < jit->size);
+    jit->code[jit->len++] = byte;
+}
+
+static inline
+void
+jit_emit32(
+    struct jit *jit,
+    uint32_t val
+) {
+    jit_emit8(jit, val);
+    jit_emit8(jit, val >> 8);
+    jit_emit8(jit, val >> 16);
+    jit_emit8(jit, val >> 24);
+}
+
+static inline
+void
+jit_emit64(
+    struct jit *jit,
+    uint64_t val
+) {
+    jit_emit32(jit, val);
+    jit_emit32(jit, val >> 32);
+}
+
+/*
+** Emit the opcode, one byte or `0x0F` followed by one byte.
+*/
+static inline
+void
+jit_emit_opcode(
+    struct jit *jit,
+    uint32_t opcode
+) {
+    if (opcode > 0xFF) {
+        jit_emit8(jit, opcode >> 8);
+    }
+    jit_emit8(jit, opcode);
+}
+
+/*
+** Emit the REX prefix of an instruction, if it needs one.
+*/
+static inline
+void
+jit_emit_rex(
+    struct jit *jit,
+    bool wide,
+    uint32_t reg,
+    uint32_t index,
+    uint32_t base
+) {
+    uint8_t rex;
+
+    rex = 0x40 | (wide << 3) | (((reg >> 3) & 1) << 2) | (((index >> 3) & 1) << 1) | ((base >> 3) & 1);
+    if (rex != 0x40) {
+        jit_emit8(jit, rex);
+    }
+}
+
+/*
+** Emit `opcode reg, [base + index * (1 << scale) + disp]`.
+*/
+static
+void
+jit_emit_op_mem(
+    struct jit *jit,
+    uint32_t opcode,
+    bool wide,
+    uint32_t reg,
+    uint32_t base,
+    uint32_t index,
+    uint32_t scale,
+    int32_t disp
+) {
+    jit_emit_rex(jit, wide, reg, index, base);
+    jit_emit_opcode(jit, opcode);
+
+    if (index == X64_NO_INDEX && (base & 7) != X64_RSP) {
+        jit_emit8(jit, 0x80 | ((reg & 7) << 3) | (base & 7));
+    } else {
+        jit_emit8(jit, 0x80 | ((reg & 7) << 3) | X64_RSP);
+        jit_emit8(jit, (scale << 6) | ((index & 7) << 3) | (base & 7));
+    }
+    jit_emit32(jit, disp);
+}
+
+/*
+** Emit `opcode reg, [RBX + disp]`, a field of the GBA.
+*/
+static inline
+void
+jit_emit_op_gba(
+    struct jit *jit,
+    uint32_t opcode,
+    uint32_t reg,
+    int32_t disp
+) {
+    jit_emit_op_mem(jit, opcode, false, reg, X64_RBX, X64_NO_INDEX, 0, disp);
+}
+
+/*
+** Emit `opcode rm, reg` (or `opcode reg, rm`, depending on the opcode) between two registers.
+*/
+static
+void
+jit_emit_op_reg(
+    struct jit *jit,
+    uint32_t opcode,
+    bool wide,
+    uint32_t reg,
+    uint32_t rm
+) {
+    jit_emit_rex(jit, wide, reg, 0, rm);
+    jit_emit_opcode(jit, opcode);
+    jit_emit8(jit, 0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+/*
+** `op dst, src`, with `op` one of `enum x64_alu_ops`.
+*/
+static inline
+void
+jit_emit_alu(
+    struct jit *jit,
+    enum x64_alu_ops op,
+    uint32_t dst,
+    uint32_t src
+) {
+    jit_emit_op_reg(jit, op, false, src, dst);
+}
+
+/*
+** `op reg, imm32`, with `op` one of `enum x64_alu_ops` but `TEST` and `MOV`.
+*/
+static inline
+void
+jit_emit_alu_imm(
+    struct jit *jit,
+    enum x64_alu_ops op,
+    uint32_t reg,
+    uint32_t imm
+) {
+    jit_emit_op_reg(jit, 0x81, false, X64_ALU_DIGIT(op), reg);
+    jit_emit32(jit, imm);
+}
+
+/*
+** `mov reg, imm32`
+*/
+static inline
+void
+jit_emit_mov_imm(
+    struct jit *jit,
+    uint32_t reg,
+    uint32_t imm
+) {
+    jit_emit_rex(jit, false, 0, 0, reg);
+    jit_emit8(jit, 0xB8 + (reg & 7));
+    jit_emit32(jit, imm);
+}
+
+/*
+** `mov reg, imm64`
+*/
+static inline
+void
+jit_emit_mov_imm64(
+    struct jit *jit,
+    uint32_t reg,
+    uint64_t imm
+) {
+    jit_emit_rex(jit, true, 0, 0, reg);
+    jit_emit8(jit, 0xB8 + (reg & 7));
+    jit_emit64(jit, imm);
+}
+
+/*
+** `op reg, amount`, with `op` one of `enum x64_shifts`.
+*/
+static inline
+void
+jit_emit_shift(
+    struct jit *jit,
+    enum x64_shifts op,
+    uint32_t reg,
+    uint32_t amount
+) {
+    jit_emit_op_reg(jit, 0xC1, false, op, reg);
+    jit_emit8(jit, amount);
+}
+
+/*
+** `setcc reg8`
+*/
+static inline
+void
+jit_emit_setcc(
+    struct jit *jit,
+    enum x64_conds cc,
+    uint32_t reg
+) {
+    jit_emit_op_reg(jit, 0x0F90 | cc, false, 0, reg);
+}
+
+/*
+** `lea dst, [base + index * (1 << scale)]`, on 64 bits if `wide` is set.
+*/
+static inline
+void
+jit_emit_lea(
+    struct jit *jit,
+    bool wide,
+    uint32_t dst,
+    uint32_t base,
+    uint32_t index,
+    uint32_t scale
+) {
+    jit_emit_op_mem(jit, 0x8D, wide, dst, base, index, scale, 0);
+}
+
+/*
+** `bt dword [RBX + cpsr], 29`: copy the carry flag of the CPSR to the host's one.
+*/
+static inline
+void
+jit_emit_load_carry(
+    struct jit *jit
+) {
+    jit_emit_op_gba(jit, 0x0FBA, 4, JIT_OFFSET(core.cpsr));
+    jit_emit8(jit, 29);
+}
+
+/*
+** Create a new label, not bound to any location yet.
+*/
+static
+uint32_t
+jit_label(
+    struct jit *jit
+) {
+    hs_assert(jit->labels_len < CORE_JIT_MAX_LABELS);
+    jit->labels[jit->labels_len] = -1;
+    return (jit->labels_len++);
+}
+
+/*
+** Bind the given label to the current location.
+*/
+static inline
+void
+jit_bind(
+    struct jit *jit,
+    uint32_t label
+) {
+    jit->labels[label] = jit->len;
+}
+
+static
+void
+jit_emit_rel32(
+    struct jit *jit,
+    uint32_t label
+) {
+    hs_assert(jit->fixups_len < CORE_JIT_MAX_FIXUPS);
+    jit->fixups[jit->fixups_len].at = jit->len;
+    jit->fixups[jit->fixups_len].label = label;
+    ++jit->fixups_len;
+    jit_emit32(jit, 0);
+}
+
+/*
+** `jcc label`
+*/
+static inline
+void
+jit_emit_jcc(
+    struct jit *jit,
+    enum x64_conds cc,
+    uint32_t label
+) {
+    jit_emit8(jit, 0x0F);
+    jit_emit8(jit, 0x80 | cc);
+    jit_emit_rel32(jit, label);
+}
+
+/*
+** `jmp label`
+*/
+static inline
+void
+jit_emit_jmp(
+    struct jit *jit,
+    uint32_t label
+) {
+    jit_emit8(jit, 0xE9);
+    jit_emit_rel32(jit, label);
+}
+
+/*
+** Patch all the jumps to the labels they target.
+*/
+static
+void
+jit_link(
+    struct jit *jit
+) {
+    size_t i;
+
+    for (i = 0; i < jit->fixups_len; ++i) {
+        struct jit_fixup const *fixup;
+        int32_t rel;
+
+        fixup = jit->fixups + i;
+        hs_assert(jit->labels[fixup->label] >= 0);
+        rel = jit->labels[fixup->label] - (int32_t)(fixup->at + sizeof(int32_t));
+        memcpy(jit->code + fixup->at, &rel, sizeof(rel));
+    }
+}
+
+/*
+** Decoder
+*/
+
+static inline
+struct jit_operand
+jit_reg(
+    uint32_t reg,
+    uint32_t pc
+) {
+    // Reading the PC yields a value known at compile time.
+    if (reg == 15) {
+        return ((struct jit_operand){ .is_const = true, .value = pc });
+    }
+    return ((struct jit_operand){ .is_const = false, .value = reg });
+}
+
+static inline
+struct jit_operand
+jit_const(
+    uint32_t value
+) {
+    return ((struct jit_operand){ .is_const = true, .value = value });
+}
+
+/*
+** Fill `insn` with a Data Processing instruction whose second operand is a constant.
+*/
+static inline
+void
+jit_decode_alu_imm(
+    struct jit_insn *insn,
+    uint32_t opcode,
+    bool set_flags,
+    uint32_t rd,
+    struct jit_operand rn,
+    uint32_t imm
+) {
+    insn->kind = JIT_INSN_ALU;
+    insn->opcode = opcode;
+    insn->set_flags = set_flags;
+    insn->rd = rd;
+    insn->rn = rn;
+    insn->rm = jit_const(imm);
+    insn->shift_type = 0;
+    insn->shift = 0;
+    insn->imm_carry = -1;
+}
+
+/*
+** Fill `insn` with a Data Processing instruction whose second operand is a register shifted by an immediate.
+*/
+static inline
+void
+jit_decode_alu_reg(
+    struct jit_insn *insn,
+    uint32_t opcode,
+    bool set_flags,
+    uint32_t rd,
+    struct jit_operand rn,
+    struct jit_operand rm,
+    uint32_t shift_type,
+    uint32_t shift
+) {
+    insn->kind = JIT_INSN_ALU;
+    insn->opcode = opcode;
+    insn->set_flags = set_flags;
+    insn->rd = rd;
+    insn->rn = rn;
+    insn->rm = rm;
+    insn->shift_type = shift_type;
+    insn->shift = shift;
+    insn->imm_carry = -1;
+}
+
+/*
+** Fill `insn` with a pre-indexed transfer without write-back, the kind of all the Thumb ones.
+*/
+static inline
+void
+jit_decode_transfer(
+    struct jit_insn *insn,
+    bool load,
+    uint32_t size,
+    bool sign,
+    uint32_t rd,
+    struct jit_operand base,
+    struct jit_operand offset
+) {
+    insn->kind = load ? JIT_INSN_LOAD : JIT_INSN_STORE;
+    insn->value = jit_reg(rd, 0);
+    insn->size = size;
+    insn->sign = sign;
+    insn->rn = base;
+    insn->rm = offset;
+    insn->shift_type = 0;
+    insn->shift = 0;
+    insn->up = true;
+    insn->pre = true;
+    insn->writeback = false;
+}
+
+/*
+** Decode the ARM instruction held by `uop`, located at `addr`.
+**
+** Return false if it can't be compiled.
+*/
+static
+bool
+jit_decode_arm(
+    struct jit_insn *insn,
+    struct core_uop const *uop,
+    uint32_t addr
+) {
+    void (*handler)(struct gba *gba, uint32_t op);
+    uint32_t op;
+    uint32_t rd;
+    uint32_t rn;
+
+    handler = uop->handler.arm;
+    op = uop->op;
+    rd = bitfield_get_range(op, 12, 16);
+    rn = bitfield_get_range(op, 16, 20);
+    insn->cond = uop->cond;
+
+    if (handler == core_arm_sdt || handler == core_arm_hsdt) {
+        bool load;
+
+        load = bitfield_get(op, 20);
+        insn->kind = load ? JIT_INSN_LOAD : JIT_INSN_STORE;
+        insn->up = bitfield_get(op, 23);
+        insn->pre = bitfield_get(op, 24);
+        insn->writeback = !insn->pre || bitfield_get(op, 21);
+        insn->rn = jit_reg(rn, addr + 8);
+        insn->shift_type = 0;
+        insn->shift = 0;
+
+        // Stores of the PC store the address of the instruction plus 12.
+        insn->value = jit_reg(rd, addr + 12);
+
+        if ((load && rd == 15) || (insn->writeback && rn == 15)) {
+            return (false);
+        }
+
+        if (handler == core_arm_sdt) {
+            insn->size = bitfield_get(op, 22) ? sizeof(uint8_t) : sizeof(uint32_t);
+            insn->sign = false;
+
+            if (bitfield_get(op, 25)) {
+                // A register shifted by another one is undefined, but the interpreter handles it anyway.
+                if (bitfield_get(op, 4)) {
+                    return (false);
+                }
+                insn->rm = jit_reg(bitfield_get_range(op, 0, 4), addr + 8);
+                insn->shift_type = bitfield_get_range(op, 5, 7);
+                insn->shift = bitfield_get_range(op, 7, 12);
+            } else {
+                insn->rm = jit_const(bitfield_get_range(op, 0, 12));
+            }
+        } else {
+            switch ((load << 2) | bitfield_get_range(op, 5, 7)) {
+                case 0b001: // STRH
+                case 0b101: // LDRH
+                    insn->size = sizeof(uint16_t);
+                    insn->sign = false;
+                    break;
+                case 0b110: // LDRSB
+                    insn->size = sizeof(uint8_t);
+                    insn->sign = true;
+                    break;
+                default:
+                    return (false);
+            }
+
+            if (bitfield_get(op, 22)) {
+                insn->rm = jit_const((bitfield_get_range(op, 8, 12) << 4) | bitfield_get_range(op, 0, 4));
+            } else {
+                insn->rm = jit_reg(bitfield_get_range(op, 0, 4), addr + 8);
+            }
+        }
+        return (true);
+    }
+
+    if (
+           handler == NULL
+        || bitfield_get_range(op, 26, 28) != 0
+        || handler == core_arm_mrs
+        || handler == core_arm_msr
+        || handler == core_arm_mul
+        || handler == core_arm_mull
+        || handler == core_arm_branch_xchg
+        || handler == core_arm_swp
+    ) {
+        return (false);
+    }
+
+    // Data Processing, but the ones writing to the PC or shifting by a register.
+    // TST, TEQ, CMP and CMN without the S bit are PSR transfers.
+    if (
+           rd == 15
+        || (!bitfield_get(op, 25) && bitfield_get(op, 4))
+        || (bitfield_get_range(op, 23, 25) == 0b10 && !bitfield_get(op, 20))
+    ) {
+        return (false);
+    }
+
+    if (bitfield_get(op, 25)) {
+        uint32_t imm;
+        uint32_t rot;
+
+        imm = bitfield_get_range(op, 0, 8);
+        rot = bitfield_get_range(op, 8, 12) * 2;
+        jit_decode_alu_imm(insn, bitfield_get_range(op, 21, 25), bitfield_get(op, 20), rd, jit_reg(rn, addr + 8), ror32(imm, rot));
+        if (rot > 0 && insn->set_flags) {
+            insn->imm_carry = (imm >> (rot - 1)) & 0b1;
+        }
+    } else {
+        jit_decode_alu_reg(
+            insn,
+            bitfield_get_range(op, 21, 25),
+            bitfield_get(op, 20),
+            rd,
+            jit_reg(rn, addr + 8),
+            jit_reg(bitfield_get_range(op, 0, 4), addr + 8),
+            bitfield_get_range(op, 5, 7),
+            bitfield_get_range(op, 7, 12)
+        );
+    }
+    return (true);
+}
+
+/*
+** Decode the Thumb instruction held by `uop`, located at `addr`, into its ARM equivalent.
+**
+** Return false if it can't be compiled.
+*/
+static
+bool
+jit_decode_thumb(
+    struct jit_insn *insn,
+    struct core_uop const *uop,
+    uint32_t addr
+) {
+    void (*handler)(struct gba *gba, uint16_t op);
+    uint32_t pc;
+    uint16_t op;
+    uint32_t lo0;   // Bits 0-2
+    uint32_t lo3;   // Bits 3-5
+    uint32_t lo6;   // Bits 6-8
+    uint32_t hi8;   // Bits 8-10
+    uint32_t imm5;  // Bits 6-10
+    uint32_t imm8;  // Bits 0-7
+
+    handler = uop->handler.thumb;
+    op = uop->op;
+    pc = addr + 4;
+    lo0 = bitfield_get_range(op, 0, 3);
+    lo3 = bitfield_get_range(op, 3, 6);
+    lo6 = bitfield_get_range(op, 6, 9);
+    hi8 = bitfield_get_range(op, 8, 11);
+    imm5 = bitfield_get_range(op, 6, 11);
+    imm8 = bitfield_get_range(op, 0, 8);
+    insn->cond = COND_AL;
+
+    // Move shifted register
+    if (handler == core_thumb_lsl) {
+        jit_decode_alu_reg(insn, 13, true, lo0, jit_const(0), jit_reg(lo3, pc), 0, imm5);
+    } else if (handler == core_thumb_lsr) {
+        jit_decode_alu_reg(insn, 13, true, lo0, jit_const(0), jit_reg(lo3, pc), 1, imm5);
+    } else if (handler == core_thumb_asr) {
+        jit_decode_alu_reg(insn, 13, true, lo0, jit_const(0), jit_reg(lo3, pc), 2, imm5);
+
+    // Add/Subtract
+    } else if (handler == core_thumb_lo_add || handler == core_thumb_lo_sub) {
+        uint32_t opcode;
+
+        opcode = handler == core_thumb_lo_add ? 4 : 2;
+        if (bitfield_get(op, 10)) {
+            jit_decode_alu_imm(insn, opcode, true, lo0, jit_reg(lo3, pc), lo6);
+        } else {
+            jit_decode_alu_reg(insn, opcode, true, lo0, jit_reg(lo3, pc), jit_reg(lo6, pc), 0, 0);
+        }
+
+    // Move/Compare/Add/Subtract immediate
+    } else if (handler == core_thumb_mov_imm) {
+        jit_decode_alu_imm(insn, 13, true, hi8, jit_const(0), imm8);
+    } else if (handler == core_thumb_cmp_imm) {
+        jit_decode_alu_imm(insn, 10, true, hi8, jit_reg(hi8, pc), imm8);
+    } else if (handler == core_thumb_add_imm) {
+        jit_decode_alu_imm(insn, 4, true, hi8, jit_reg(hi8, pc), imm8);
+    } else if (handler == core_thumb_sub_imm) {
+        jit_decode_alu_imm(insn, 2, true, hi8, jit_reg(hi8, pc), imm8);
+
+    // ALU operations, but the shifts by a register and MUL
+    } else if (handler == core_thumb_alu_and) {
+        jit_decode_alu_reg(insn, 0, true, lo0, jit_reg(lo0, pc), jit_reg(lo3, pc), 0, 0);
+    } else if (handler == core_thumb_alu_eor) {
+        jit_decode_alu_reg(insn, 1, true, lo0, jit_reg(lo0, pc), jit_reg(lo3, pc), 0, 0);
+    } else if (handler == core_thumb_alu_adc) {
+        jit_decode_alu_reg(insn, 5, true, lo0, jit_reg(lo0, pc), jit_reg(lo3, pc), 0, 0);
+    } else if (handler == core_thumb_alu_sbc) {
+        jit_decode_alu_reg(insn, 6, true, lo0, jit_reg(lo0, pc), jit_reg(lo3, pc), 0, 0);
+    } else if (handler == core_thumb_alu_tst) {
+        jit_decode_alu_reg(insn, 8, true, lo0, jit_reg(lo0, pc), jit_reg(lo3, pc), 0, 0);
+    } else if (handler == core_thumb_alu_neg) {
+        jit_decode_alu_imm(insn, 3, true, lo0, jit_reg(lo3, pc), 0);
+    } else if (handler == core_thumb_alu_cmp) {
+        jit_decode_alu_reg(insn, 10, true, lo0, jit_reg(lo0, pc), jit_reg(lo3, pc), 0, 0);
+    } else if (handler == core_thumb_alu_cmn) {
+        jit_decode_alu_reg(insn, 11, true, lo0, jit_reg(lo0, pc), jit_reg(lo3, pc), 0, 0);
+    } else if (handler == core_thumb_alu_orr) {
+        jit_decode_alu_reg(insn, 12, true, lo0, jit_reg(lo0, pc), jit_reg(lo3, pc), 0, 0);
+    } else if (handler == core_thumb_alu_bic) {
+        jit_decode_alu_reg(insn, 14, true, lo0, jit_reg(lo0, pc), jit_reg(lo3, pc), 0, 0);
+    } else if (handler == core_thumb_alu_mvn) {
+        jit_decode_alu_reg(insn, 15, true, lo0, jit_const(0), jit_reg(lo3, pc), 0, 0);
+
+    // Hi register operations, but the ones writing to the PC
+    } else if (handler == core_thumb_hi_add || handler == core_thumb_hi_cmp || handler == core_thumb_hi_mov) {
+        uint32_t rd;
+        uint32_t rs;
+
+        rd = lo0 + bitfield_get(op, 7) * 8;
+        rs = lo3 + bitfield_get(op, 6) * 8;
+
+        // Undefined, the interpreter panics.
+        if (!bitfield_get(op, 7) && !bitfield_get(op, 6)) {
+            return (false);
+        }
+
+        if (handler == core_thumb_hi_cmp) {
+            jit_decode_alu_reg(insn, 10, true, rd, jit_reg(rd, pc), jit_reg(rs, pc), 0, 0);
+        } else if (rd == 15) {
+            return (false);
+        } else if (handler == core_thumb_hi_add) {
+            jit_decode_alu_reg(insn, 4, false, rd, jit_reg(rd, pc), jit_reg(rs, pc), 0, 0);
+        } else {
+            jit_decode_alu_reg(insn, 13, false, rd, jit_const(0), jit_reg(rs, pc), 0, 0);
+        }
+
+    // Load address and add offset to the stack pointer
+    } else if (handler == core_thumb_add_pc_imm) {
+        jit_decode_alu_imm(insn, 13, false, hi8, jit_const(0), (pc & 0xFFFFFFFC) + (imm8 << 2));
+    } else if (handler == core_thumb_add_sp_imm) {
+        jit_decode_alu_imm(insn, 4, false, hi8, jit_reg(13, pc), imm8 << 2);
+    } else if (handler == core_thumb_add_sp_s_imm) {
+        jit_decode_alu_imm(insn, bitfield_get(op, 7) ? 2 : 4, false, 13, jit_reg(13, pc), bitfield_get_range(op, 0, 7) << 2);
+
+    // Loads and stores
+    } else if (handler == core_thumb_ldr_pc) {
+        jit_decode_transfer(insn, true, sizeof(uint32_t), false, hi8, jit_const(pc & 0xFFFFFFFC), jit_const(imm8 << 2));
+    } else if (handler == core_thumb_str_imm || handler == core_thumb_ldr_imm) {
+        jit_decode_transfer(insn, handler == core_thumb_ldr_imm, sizeof(uint32_t), false, lo0, jit_reg(lo3, pc), jit_const(imm5 << 2));
+    } else if (handler == core_thumb_strb_imm || handler == core_thumb_ldrb_imm) {
+        jit_decode_transfer(insn, handler == core_thumb_ldrb_imm, sizeof(uint8_t), false, lo0, jit_reg(lo3, pc), jit_const(imm5));
+    } else if (handler == core_thumb_strh_imm || handler == core_thumb_ldrh_imm) {
+        jit_decode_transfer(insn, handler == core_thumb_ldrh_imm, sizeof(uint16_t), false, lo0, jit_reg(lo3, pc), jit_const(imm5 << 1));
+    } else if (handler == core_thumb_str_reg || handler == core_thumb_ldr_reg) {
+        jit_decode_transfer(insn, handler == core_thumb_ldr_reg, sizeof(uint32_t), false, lo0, jit_reg(lo3, pc), jit_reg(lo6, pc));
+    } else if (handler == core_thumb_strb_reg || handler == core_thumb_ldrb_reg) {
+        jit_decode_transfer(insn, handler == core_thumb_ldrb_reg, sizeof(uint8_t), false, lo0, jit_reg(lo3, pc), jit_reg(lo6, pc));
+    } else if (handler == core_thumb_strh_reg || handler == core_thumb_ldrh_reg) {
+        jit_decode_transfer(insn, handler == core_thumb_ldrh_reg, sizeof(uint16_t), false, lo0, jit_reg(lo3, pc), jit_reg(lo6, pc));
+    } else if (handler == core_thumb_ldsb_reg) {
+        jit_decode_transfer(insn, true, sizeof(uint8_t), true, lo0, jit_reg(lo3, pc), jit_reg(lo6, pc));
+    } else if (handler == core_thumb_str_sp || handler == core_thumb_ldr_sp) {
+        jit_decode_transfer(insn, handler == core_thumb_ldr_sp, sizeof(uint32_t), false, hi8, jit_reg(13, pc), jit_const(imm8 << 2));
+    } else {
+        return (false);
+    }
+    return (true);
+}
+
+/*
+** Code generation
+*/
+
+/*
+** Load the given operand in `reg`.
+*/
+static inline
+void
+jit_emit_load_operand(
+    struct jit *jit,
+    uint32_t reg,
+    struct jit_operand operand
+) {
+    if (operand.is_const) {
+        jit_emit_mov_imm(jit, reg, operand.value);
+    } else {
+        jit_emit_op_gba(jit, 0x8B, reg, JIT_REG(operand.value));
+    }
+}
+
+/*
+** Load the second operand (or the offset) of `insn` in `ECX`, shifted the same way `core_compute_shift()` does.
+**
+** If `carry` is set, the carry out of the shifter is put in `EDX`.
+** Return false if the carry flag must be left untouched instead.
+*/
+static
+bool
+jit_emit_shifter(
+    struct jit *jit,
+    struct jit_insn const *insn,
+    bool carry
+) {
+    jit_emit_load_operand(jit, X64_RCX, insn->rm);
+
+    if (carry && insn->imm_carry >= 0) {
+        jit_emit_mov_imm(jit, X64_RDX, insn->imm_carry);
+        return (true);
+    }
+
+    // LSL#0, and so the immediates, leave both the value and the carry untouched.
+    if (insn->shift_type == 0 && insn->shift == 0) {
+        return (false);
+    }
+
+    if (carry) {
+        jit_emit_alu(jit, X64_XOR, X64_RDX, X64_RDX);
+    }
+
+    switch (insn->shift_type) {
+        case 0: // LSL
+            jit_emit_shift(jit, X64_SHL, X64_RCX, insn->shift);
+            break;
+        case 1: // LSR, LSR#0 being LSR#32
+            if (insn->shift) {
+                jit_emit_shift(jit, X64_SHR, X64_RCX, insn->shift);
+            } else {
+                jit_emit_shift(jit, X64_SHL, X64_RCX, 1);
+                if (carry) {
+                    jit_emit_setcc(jit, X64_CC_C, X64_RDX);
+                }
+                jit_emit_mov_imm(jit, X64_RCX, 0);
+                return (carry);
+            }
+            break;
+        case 2: // ASR, ASR#0 being ASR#32
+            jit_emit_shift(jit, X64_SAR, X64_RCX, insn->shift ? insn->shift : 31);
+            if (!insn->shift) {
+                jit_emit_shift(jit, X64_SAR, X64_RCX, 1);
+            }
+            break;
+        case 3: // ROR, ROR#0 being RRX
+            if (insn->shift) {
+                jit_emit_shift(jit, X64_ROR, X64_RCX, insn->shift);
+            } else {
+                jit_emit_load_carry(jit);
+                jit_emit_op_reg(jit, 0xD1, false, X64_RCR, X64_RCX);
+            }
+            break;
+    }
+
+    if (carry) {
+        jit_emit_setcc(jit, X64_CC_C, X64_RDX);
+    }
+    return (carry);
+}
+
+/*
+** Merge the given flags, computed in `EDX` and shifted to their place in the CPSR, with the other bits of the CPSR.
+*/
+static
+void
+jit_emit_store_flags(
+    struct jit *jit,
+    uint32_t mask
+) {
+    jit_emit_op_gba(jit, 0x8B, X64_R9, JIT_OFFSET(core.cpsr));
+    jit_emit_alu_imm(jit, X64_AND, X64_R9, mask);
+    jit_emit_alu(jit, X64_OR, X64_R9, X64_RDX);
+    jit_emit_op_gba(jit, 0x89, X64_R9, JIT_OFFSET(core.cpsr));
+}
+
+/*
+** Emit the body of a Data Processing instruction.
+*/
+static
+void
+jit_emit_alu_insn(
+    struct jit *jit,
+    struct jit_insn const *insn
+) {
+    bool logical;
+    bool carry;
+
+    switch (insn->opcode) {
+        case 0: case 1: case 8: case 9: case 12: case 13: case 14: case 15:
+            logical = true;
+            break;
+        default:
+            logical = false;
+            break;
+    }
+
+    carry = jit_emit_shifter(jit, insn, logical && insn->set_flags);
+    jit_emit_load_operand(jit, X64_RAX, insn->rn);
+
+    if (logical) {
+        switch (insn->opcode) {
+            case 0: // AND
+            case 8: // TST
+                jit_emit_alu(jit, X64_AND, X64_RAX, X64_RCX);
+                break;
+            case 1: // EOR
+            case 9: // TEQ
+                jit_emit_alu(jit, X64_XOR, X64_RAX, X64_RCX);
+                break;
+            case 12: // ORR
+                jit_emit_alu(jit, X64_OR, X64_RAX, X64_RCX);
+                break;
+            case 13: // MOV
+                jit_emit_alu(jit, X64_MOV, X64_RAX, X64_RCX);
+                break;
+            case 14: // BIC
+                jit_emit_op_reg(jit, 0xF7, false, 2, X64_RCX);
+                jit_emit_alu(jit, X64_AND, X64_RAX, X64_RCX);
+                break;
+            case 15: // MVN
+                jit_emit_alu(jit, X64_MOV, X64_RAX, X64_RCX);
+                jit_emit_op_reg(jit, 0xF7, false, 2, X64_RAX);
+                break;
+        }
+
+        if (insn->set_flags) {
+            // N and Z, plus C if the shifter changed it.
+            jit_emit_alu(jit, X64_XOR, X64_R10, X64_R10);
+            jit_emit_alu(jit, X64_XOR, X64_R11, X64_R11);
+            jit_emit_alu(jit, X64_TEST, X64_RAX, X64_RAX);
+            jit_emit_setcc(jit, X64_CC_S, X64_R10);
+            jit_emit_setcc(jit, X64_CC_Z, X64_R11);
+            if (carry) {
+                jit_emit_lea(jit, false, X64_RDX, X64_RDX, X64_R11, 1);
+                jit_emit_lea(jit, false, X64_RDX, X64_RDX, X64_R10, 2);
+                jit_emit_shift(jit, X64_SHL, X64_RDX, 29);
+                jit_emit_store_flags(jit, 0x1FFFFFFF);
+            } else {
+                jit_emit_lea(jit, false, X64_RDX, X64_R11, X64_R10, 1);
+                jit_emit_shift(jit, X64_SHL, X64_RDX, 30);
+                jit_emit_store_flags(jit, 0x3FFFFFFF);
+            }
+        }
+    } else {
+        enum x64_conds c;
+
+        if (insn->set_flags) {
+            jit_emit_alu(jit, X64_XOR, X64_RDX, X64_RDX);
+            jit_emit_alu(jit, X64_XOR, X64_R9, X64_R9);
+            jit_emit_alu(jit, X64_XOR, X64_R10, X64_R10);
+            jit_emit_alu(jit, X64_XOR, X64_R11, X64_R11);
+        }
+
+        // The carry of the ARM is the opposite of the borrow of the x86 when subtracting.
+        c = X64_CC_NC;
+        switch (insn->opcode) {
+            case 2: // SUB
+            case 10: // CMP
+                jit_emit_alu(jit, X64_SUB, X64_RAX, X64_RCX);
+                break;
+            case 3: // RSB
+                jit_emit_alu(jit, X64_SUB, X64_RCX, X64_RAX);
+                jit_emit_alu(jit, X64_MOV, X64_RAX, X64_RCX);
+                break;
+            case 4: // ADD
+            case 11: // CMN
+                jit_emit_alu(jit, X64_ADD, X64_RAX, X64_RCX);
+                c = X64_CC_C;
+                break;
+            case 5: // ADC
+                jit_emit_load_carry(jit);
+                jit_emit_alu(jit, X64_ADC, X64_RAX, X64_RCX);
+                c = X64_CC_C;
+                break;
+            case 6: // SBC
+                jit_emit_load_carry(jit);
+                jit_emit8(jit, 0xF5); // CMC
+                jit_emit_alu(jit, X64_SBB, X64_RAX, X64_RCX);
+                break;
+            case 7: // RSC
+                jit_emit_load_carry(jit);
+                jit_emit8(jit, 0xF5); // CMC
+                jit_emit_alu(jit, X64_SBB, X64_RCX, X64_RAX);
+                jit_emit_alu(jit, X64_MOV, X64_RAX, X64_RCX);
+                break;
+        }
+
+        if (insn->set_flags) {
+            jit_emit_setcc(jit, c, X64_RDX);
+            jit_emit_setcc(jit, X64_CC_O, X64_R9);
+            jit_emit_setcc(jit, X64_CC_S, X64_R10);
+            jit_emit_setcc(jit, X64_CC_Z, X64_R11);
+            jit_emit_lea(jit, false, X64_RDX, X64_R9, X64_RDX, 1);
+            jit_emit_lea(jit, false, X64_RDX, X64_RDX, X64_R11, 2);
+            jit_emit_lea(jit, false, X64_RDX, X64_RDX, X64_R10, 3);
+            jit_emit_shift(jit, X64_SHL, X64_RDX, 28);
+            jit_emit_store_flags(jit, 0x0FFFFFFF);
+        }
+    }
+
+    // TST, TEQ, CMP and CMN only set the flags.
+    if (insn->opcode < 8 || insn->opcode > 11) {
+        jit_emit_op_gba(jit, 0x89, X64_RAX, JIT_REG(insn->rd));
+    }
+
+    jit_emit_mov_imm(jit, X64_R15, JIT_SEQUENTIAL);
+}
+
+/*
+** Add the cycles in `R8` to the cycle counter, or leave through `exit` if that would reach the next event.
+*/
+static
+void
+jit_emit_commit_cycles(
+    struct jit *jit,
+    uint32_t exit
+) {
+    jit_emit_lea(jit, true, X64_R11, X64_R12, X64_R8, 0);
+    jit_emit_op_reg(jit, X64_CMP, true, X64_R13, X64_R11);
+    jit_emit_jcc(jit, X64_CC_NC, exit);
+    jit_emit_op_reg(jit, X64_MOV, true, X64_R11, X64_R12);
+}
+
+/*
+** Emit the body of a load or a store.
+**
+** The address is checked first and the native code leaves through `exit` if it isn't within EWRAM or IWRAM.
+** Stores then leave through `next` if they invalidated any cached block, which may be this one.
+*/
+static
+void
+jit_emit_transfer_insn(
+    struct jit *jit,
+    struct jit_insn const *insn,
+    uint32_t exit,
+    uint32_t next
+) {
+    int32_t access_time;
+
+    // Base in R9D, base +/- offset in R10D and the address of the transfer in EDX.
+    jit_emit_load_operand(jit, X64_R9, insn->rn);
+    jit_emit_alu(jit, X64_MOV, X64_R10, X64_R9);
+    if (insn->rm.is_const) {
+        jit_emit_alu_imm(jit, insn->up ? X64_ADD : X64_SUB, X64_R10, insn->rm.value);
+    } else {
+        jit_emit_shifter(jit, insn, false);
+        jit_emit_alu(jit, insn->up ? X64_ADD : X64_SUB, X64_R10, X64_RCX);
+    }
+    jit_emit_alu(jit, X64_MOV, X64_RDX, insn->pre ? X64_R10 : X64_R9);
+
+    // Leave if the region, in EAX, isn't EWRAM or IWRAM.
+    jit_emit_alu(jit, X64_MOV, X64_RAX, X64_RDX);
+    jit_emit_shift(jit, X64_SHR, X64_RAX, 24);
+    jit_emit_op_mem(jit, 0x8D, false, X64_RCX, X64_RAX, X64_NO_INDEX, 0, -EWRAM_REGION);
+    jit_emit_alu_imm(jit, X64_CMP, X64_RCX, IWRAM_REGION - EWRAM_REGION);
+    jit_emit_jcc(jit, X64_CC_A, exit);
+
+    // The access is non-sequential and loads take an extra internal cycle.
+    access_time = JIT_ACCESS_TIME(insn->size, NON_SEQUENTIAL, 0);
+    jit_emit_op_mem(jit, 0x03, false, X64_R8, X64_RBX, X64_RAX, 2, access_time);
+    if (insn->kind == JIT_INSN_LOAD) {
+        jit_emit_alu_imm(jit, X64_ADD, X64_R8, 1);
+    }
+    jit_emit_commit_cycles(jit, exit);
+
+    if (insn->kind == JIT_INSN_LOAD) {
+        uint32_t align;
+        uint32_t base;
+
+        align = ~(insn->size - 1);
+
+        if (jit->mirror) {
+            // The view holds all the mirrors: the aligned address in RCX is the offset of the data.
+            jit_emit_alu(jit, X64_MOV, X64_RCX, X64_RDX);
+            jit_emit_alu_imm(jit, X64_AND, X64_RCX, align);
+            jit_emit_op_mem(jit, 0x8B, true, X64_R11, X64_RBX, X64_NO_INDEX, 0, JIT_OFFSET(memory_mirror.view));
+            base = X64_R11;
+        } else {
+            uint32_t iwram;
+            uint32_t done;
+
+            iwram = jit_label(jit);
+            done = jit_label(jit);
+
+            // Offset of the data within the GBA in RCX.
+            jit_emit_alu(jit, X64_MOV, X64_RCX, X64_RDX);
+            jit_emit_alu_imm(jit, X64_CMP, X64_RAX, EWRAM_REGION);
+            jit_emit_jcc(jit, X64_CC_NZ, iwram);
+            jit_emit_alu_imm(jit, X64_AND, X64_RCX, EWRAM_MASK & align);
+            jit_emit_op_reg(jit, 0x81, true, X64_ALU_DIGIT(X64_ADD), X64_RCX);
+            jit_emit32(jit, JIT_OFFSET(memory.ewram));
+            jit_emit_jmp(jit, done);
+            jit_bind(jit, iwram);
+            jit_emit_alu_imm(jit, X64_AND, X64_RCX, IWRAM_MASK & align);
+            jit_emit_op_reg(jit, 0x81, true, X64_ALU_DIGIT(X64_ADD), X64_RCX);
+            jit_emit32(jit, JIT_OFFSET(memory.iwram));
+            jit_bind(jit, done);
+            base = X64_RBX;
+        }
+
+        switch (insn->size) {
+            case sizeof(uint8_t):
+                jit_emit_op_mem(jit, insn->sign ? 0x0FBE : 0x0FB6, false, X64_RAX, base, X64_RCX, 0, 0);
+                break;
+            case sizeof(uint16_t):
+                jit_emit_op_mem(jit, 0x0FB7, false, X64_RAX, base, X64_RCX, 0, 0);
+                break;
+            case sizeof(uint32_t):
+                jit_emit_op_mem(jit, 0x8B, false, X64_RAX, base, X64_RCX, 0, 0);
+                break;
+        }
+
+        // Unaligned words and halfwords are rotated.
+        if (insn->size != sizeof(uint8_t)) {
+            jit_emit_alu(jit, X64_MOV, X64_RCX, X64_RDX);
+            jit_emit_alu_imm(jit, X64_AND, X64_RCX, insn->size - 1);
+            jit_emit_shift(jit, X64_SHL, X64_RCX, 3);
+            jit_emit_op_reg(jit, 0xD3, false, X64_ROR, X64_RAX);
+        }
+
+        // The loaded value wins over the write-back if both target the same register.
+        if (insn->writeback) {
+            jit_emit_op_gba(jit, 0x89, X64_R10, JIT_REG(insn->rn.value));
+        }
+        jit_emit_op_gba(jit, 0x89, X64_RAX, JIT_REG(insn->value.value));
+        jit_emit_alu(jit, X64_XOR, X64_R15, X64_R15);
+    } else {
+        void *write;
+
+        // Value in ECX, read before the write-back.
+        jit_emit_load_operand(jit, X64_RCX, insn->value);
+        switch (insn->size) {
+            case sizeof(uint8_t):
+                jit_emit_op_reg(jit, 0x0FB6, false, X64_RCX, X64_RCX);
+                write = (void *)mem_write8_raw;
+                break;
+            case sizeof(uint16_t):
+                jit_emit_op_reg(jit, 0x0FB7, false, X64_RCX, X64_RCX);
+                write = (void *)mem_write16_raw;
+                break;
+            default:
+                write = (void *)mem_write32_raw;
+                break;
+        }
+
+        if (insn->writeback) {
+            jit_emit_op_gba(jit, 0x89, X64_R10, JIT_REG(insn->rn.value));
+        }
+
+        // core_idle_loop_taint()
+        jit_emit_op_gba(jit, 0xC6, 0, JIT_OFFSET(core_idle_loop.tainted));
+        jit_emit8(jit, true);
+
+        // The write goes through `template_write()` so that the caches and the dirty blocks are notified.
+        jit_emit_op_gba(jit, 0x8B, X64_RBP, JIT_OFFSET(core_cache.epoch));
+#if defined(_WIN32) && !defined(__CYGWIN__)
+        jit_emit_alu(jit, X64_MOV, X64_ARG2, X64_RCX);
+        jit_emit_op_reg(jit, X64_MOV, true, X64_RBX, X64_ARG0);
+#else
+        jit_emit_alu(jit, X64_MOV, X64_ARG1, X64_RDX);
+        jit_emit_alu(jit, X64_MOV, X64_ARG2, X64_RCX);
+        jit_emit_op_reg(jit, X64_MOV, true, X64_RBX, X64_ARG0);
+#endif
+        jit_emit_mov_imm64(jit, X64_RAX, (uint64_t)(uintptr_t)write);
+        jit_emit_op_reg(jit, 0xFF, false, 2, X64_RAX);
+
+        jit_emit_alu(jit, X64_XOR, X64_R15, X64_R15);
+        jit_emit_op_gba(jit, 0x3B, X64_RBP, JIT_OFFSET(core_cache.epoch));
+        jit_emit_jcc(jit, X64_CC_NZ, next);
+    }
+}
+
+/*
+** Compile the given block.
+**
+** The native code is a function `uint32_t native(struct gba *gba, uint64_t target, uint8_t const *entry)`
+** that jumps to `entry`, one of `block->entries`, and returns the index of the first instruction it didn't run.
+*/
+static
+void
+jit_compile(
+    struct gba *gba,
+    struct core_block *block
+) {
+    struct core_cache *cache;
+    struct jit_insn insns[CORE_CACHE_BLOCK_LEN];
+    bool supported[CORE_CACHE_BLOCK_LEN];
+    uint32_t exits[CORE_CACHE_BLOCK_LEN + 1];
+    uint32_t labels[CORE_CACHE_BLOCK_LEN + 1];
+    uint32_t fails[CORE_CACHE_BLOCK_LEN];
+    uint32_t leave;
+    struct jit jit;
+    uint32_t addr;
+    uint32_t size;
+    bool thumb;
+    uint32_t i;
+
+    cache = &gba->core_cache;
+    thumb = block->key & 0b1;
+    addr = block->key & ~0b1;
+    size = thumb ? sizeof(uint16_t) : sizeof(uint32_t);
+
+    // Start over once the executable memory is full.
+    if (CORE_JIT_CODE_SIZE - cache->jit_code_len < CORE_JIT_BLOCK_MAX_SIZE) {
+        for (i = 0; i < CORE_CACHE_BLOCKS; ++i) {
+            cache->blocks[i].native = NULL;
+            cache->blocks[i].hits = 0;
+        }
+        cache->jit_code_len = 0;
+    }
+
+    memset(&jit, 0, sizeof(jit));
+    jit.code = cache->jit_code + cache->jit_code_len;
+    jit.size = CORE_JIT_BLOCK_MAX_SIZE;
+    jit.mirror = gba->memory_mirror.enabled;
+
+    for (i = 0; i < block->len; ++i) {
+        uint32_t fetch;
+
+        // The instruction fetched along this one must be in EWRAM or IWRAM too, for its timing.
+        fetch = (addr + (i + 2) * size) >> 24;
+        if (thumb) {
+            supported[i] = jit_decode_thumb(insns + i, block->uops + i, addr + i * size);
+        } else {
+            supported[i] = jit_decode_arm(insns + i, block->uops + i, addr + i * size);
+        }
+        supported[i] = supported[i] && (fetch == EWRAM_REGION || fetch == IWRAM_REGION);
+
+        exits[i] = jit_label(&jit);
+        labels[i] = supported[i] ? jit_label(&jit) : exits[i];
+        fails[i] = jit_label(&jit);
+    }
+    exits[block->len] = jit_label(&jit);
+    labels[block->len] = exits[block->len];
+    leave = jit_label(&jit);
+
+    // Prologue
+    jit_emit8(&jit, 0x53);                              // push rbx
+    jit_emit8(&jit, 0x55);                              // push rbp
+    jit_emit8(&jit, 0x41); jit_emit8(&jit, 0x54);       // push r12
+    jit_emit8(&jit, 0x41); jit_emit8(&jit, 0x55);       // push r13
+    jit_emit8(&jit, 0x41); jit_emit8(&jit, 0x56);       // push r14
+    jit_emit8(&jit, 0x41); jit_emit8(&jit, 0x57);       // push r15
+    jit_emit_op_reg(&jit, 0x83, true, 5, X64_RSP);      // sub rsp, 40 (shadow space and alignment)
+    jit_emit8(&jit, 40);
+    jit_emit_op_reg(&jit, X64_MOV, true, X64_ARG0, X64_RBX);
+    jit_emit_op_reg(&jit, X64_MOV, true, X64_ARG1, X64_R14);
+    jit_emit_op_mem(&jit, 0x8B, true, X64_R12, X64_RBX, X64_NO_INDEX, 0, JIT_OFFSET(scheduler.cycles));
+    jit_emit_op_mem(&jit, 0x8B, true, X64_R13, X64_RBX, X64_NO_INDEX, 0, JIT_OFFSET(scheduler.next_event));
+    jit_emit_op_gba(&jit, 0x8B, X64_R15, JIT_OFFSET(core.prefetch_access_type));
+    jit_emit_shift(&jit, X64_SHL, X64_R15, 6);
+    jit_emit_op_reg(&jit, 0xFF, false, 4, X64_ARG2);   // jmp entry
+
+    for (i = 0; i < block->len; ++i) {
+        struct jit_insn const *insn;
+
+        if (!supported[i]) {
+            // Leave the interpreter the instruction the previous one falls through to.
+            if (i > 0 && supported[i - 1]) {
+                jit_emit_jmp(&jit, exits[i]);
+            }
+            block->entries[i] = 0;
+            continue;
+        }
+
+        insn = insns + i;
+        hs_assert(jit.len <= UINT16_MAX);
+        block->entries[i] = jit.len;
+        jit_bind(&jit, labels[i]);
+
+        // Stop once the run is over.
+        jit_emit_op_reg(&jit, X64_CMP, true, X64_R14, X64_R12);
+        jit_emit_jcc(&jit, X64_CC_NC, exits[i]);
+
+        // Cycles of the fetch of the instruction after the next one in R8D.
+        jit_emit_op_mem(
+            &jit,
+            0x8B,
+            false,
+            X64_R8,
+            X64_RBX,
+            X64_R15,
+            0,
+            JIT_ACCESS_TIME(size, 0, (addr + (i + 2) * size) >> 24)
+        );
+
+        if (insn->cond != COND_AL) {
+            // cond_lut[(cpsr >> 28) << 4 | cond]
+            jit_emit_op_gba(&jit, 0x0FB6, X64_RCX, JIT_OFFSET(core.cpsr) + 3);
+            jit_emit_alu_imm(&jit, X64_AND, X64_RCX, 0xF0);
+            jit_emit_mov_imm64(&jit, X64_RDX, (uint64_t)(uintptr_t)(cond_lut + insn->cond));
+            jit_emit_op_mem(&jit, 0x80, false, 7, X64_RDX, X64_RCX, 0, 0);
+            jit_emit8(&jit, 0);
+            jit_emit_jcc(&jit, X64_CC_Z, fails[i]);
+        }
+
+        if (insn->kind == JIT_INSN_ALU) {
+            jit_emit_commit_cycles(&jit, exits[i]);
+            jit_emit_alu_insn(&jit, insn);
+        } else {
+            jit_emit_transfer_insn(&jit, insn, exits[i], exits[i + 1]);
+        }
+    }
+
+    // Reaching the end of the block
+    jit_emit_jmp(&jit, exits[block->len]);
+
+    // Instructions whose condition failed: only the fetch is paid.
+    for (i = 0; i < block->len; ++i) {
+        if (supported[i] && insns[i].cond != COND_AL) {
+            jit_bind(&jit, fails[i]);
+            jit_emit_commit_cycles(&jit, exits[i]);
+            jit_emit_mov_imm(&jit, X64_R15, JIT_SEQUENTIAL);
+            jit_emit_jmp(&jit, labels[i + 1]);
+        }
+    }
+
+    // Exits, returning the index of the next instruction.
+    for (i = 0; i <= block->len; ++i) {
+        jit_bind(&jit, exits[i]);
+        jit_emit_mov_imm(&jit, X64_RAX, i);
+        jit_emit_jmp(&jit, leave);
+    }
+
+    // Epilogue
+    jit_bind(&jit, leave);
+    jit_emit_op_mem(&jit, 0x89, true, X64_R12, X64_RBX, X64_NO_INDEX, 0, JIT_OFFSET(scheduler.cycles));
+    jit_emit_shift(&jit, X64_SHR, X64_R15, 6);
+    jit_emit_op_gba(&jit, 0x89, X64_R15, JIT_OFFSET(core.prefetch_access_type));
+    jit_emit_op_reg(&jit, 0x83, true, 0, X64_RSP);      // add rsp, 40
+    jit_emit8(&jit, 40);
+    jit_emit8(&jit, 0x41); jit_emit8(&jit, 0x5F);       // pop r15
+    jit_emit8(&jit, 0x41); jit_emit8(&jit, 0x5E);       // pop r14
+    jit_emit8(&jit, 0x41); jit_emit8(&jit, 0x5D);       // pop r13
+    jit_emit8(&jit, 0x41); jit_emit8(&jit, 0x5C);       // pop r12
+    jit_emit8(&jit, 0x5D);                              // pop rbp
+    jit_emit8(&jit, 0x5B);                              // pop rbx
+    jit_emit8(&jit, 0xC3);                              // ret
+
+    jit_link(&jit);
+
+    block->native = jit.code;
+    cache->jit_code_len += align_on(jit.len + 15, 16);
+}
+
+/*
+** Allocate the executable memory the blocks are compiled to.
+**
+** Return false if it couldn't be allocated, in which case the interpreter is used instead.
+*/
+static
+bool
+jit_alloc(
+    struct core_cache *cache
+) {
+    void *code;
+
+    if (cache->jit_code) {
+        return (true);
+    }
+
+    if (cache->jit_unavailable) {
+        return (false);
+    }
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+    code = VirtualAlloc(NULL, CORE_JIT_CODE_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+#else
+    code = mmap(NULL, CORE_JIT_CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED) {
+        code = NULL;
+    }
+#endif
+
+    if (!code) {
+        logln(HS_WARNING, "Failed to allocate the memory of the JIT, falling back to the cached interpreter.");
+        cache->jit_unavailable = true;
+        return (false);
+    }
+
+    cache->jit_code = code;
+    cache->jit_code_len = 0;
+    return (true);
+}
+
+void
+core_jit_cleanup(
+    struct core_cache *cache
+) {
+    if (cache->jit_code) {
+#if defined(_WIN32) && !defined(__CYGWIN__)
+        VirtualFree(cache->jit_code, 0, MEM_RELEASE);
+#else
+        munmap(cache->jit_code, CORE_JIT_CODE_SIZE);
+#endif
+    }
+    cache->jit_code = NULL;
+    cache->jit_code_len = 0;
+}
+
+/*
+** Run the instructions following the current one for as long as they are compiled, but not past `target`.
+**
+** Return false if the current instruction must be run by the interpreter, in which case nothing was done.
+*/
+bool
+core_jit_run(
+    struct gba *gba,
+    uint64_t target
+) {
+    uint32_t (*native)(struct gba *gba, uint64_t target, uint8_t const *entry);
+    struct core_cache *cache;
+    struct core_block *block;
+    struct core *core;
+    uint64_t cycles;
+    uint32_t epoch;
+    uint32_t addr;
+    uint32_t size;
+    uint32_t key;
+    uint32_t idx;
+    uint32_t end;
+
+    core = &gba->core;
+    cache = &gba->core_cache;
+
+    // Interrupts, DMAs and the other states of the core are left to the interpreter.
+    if (
+           core->state != CORE_RUN
+        || (core->irq_line && !core->cpsr.irq_disable)
+        || core->pending_dma
+        || core->is_dma_running
+    ) {
+        return (false);
+    }
+
+#ifdef WITH_DEBUGGER
+    // So are the breakpoints, the watchpoints and the modes running a single instruction at a time.
+    if (
+           (gba->debugger.run_mode != GBA_RUN_MODE_NORMAL && gba->debugger.run_mode != GBA_RUN_MODE_FRAME)
+        || gba->debugger.breakpoints.len
+        || gba->debugger.watchpoints.len
+    ) {
+        return (false);
+    }
+#endif
+
+    size = core->cpsr.thumb ? sizeof(uint16_t) : sizeof(uint32_t);
+    addr = core->pc - 2 * size;
+    if ((addr >> 24) != EWRAM_REGION && (addr >> 24) != IWRAM_REGION) {
+        return (false);
+    }
+    key = addr | core->cpsr.thumb;
+
+    if (cache->next && cache->next_key == key) {
+        block = cache->block;
+        idx = cache->next - block->uops;
+    } else {
+        if (!core_cache_lookup(gba, key)) {
+            return (false);
+        }
+
+        // Let the interpreter find the micro-op without looking it up again.
+        block = cache->block;
+        idx = 0;
+        cache->next = block->uops;
+        cache->next_key = key;
+
+        if (!block->native) {
+            if (++block->hits < CORE_JIT_THRESHOLD || !jit_alloc(cache)) {
+                return (false);
+            }
+            jit_compile(gba, block);
+        }
+    }
+
+    if (
+           !block->native
+        || !block->entries[idx]
+        || block->uops[idx].op != core->prefetch[0]
+        || block->uops[idx + 1].op != core->prefetch[1]
+    ) {
+        return (false);
+    }
+
+    cycles = gba->scheduler.cycles;
+    epoch = cache->epoch;
+    native = (uint32_t (*)(struct gba *, uint64_t, uint8_t const *))block->native;
+    end = native(gba, target, block->native + block->entries[idx]);
+
+    if (end == idx) {
+        return (false);
+    }
+
+    core->pc = addr + (end - idx + 2) * size;
+    core->prefetch[0] = block->uops[end].op;
+    core->prefetch[1] = block->uops[end + 1].op;
+    gba->memory.was_last_access_from_dma = false;
+    gba->memory.gamepak_bus_in_use = false;
+
+    // All the accesses were outside of the cartridge, so the prefetch buffer kept running.
+    if (gba->memory.pbuffer.enabled) {
+        mem_prefetch_buffer_step(gba, gba->scheduler.cycles - cycles);
+    }
+
+    // Resume the block where the native code stopped, unless a store invalidated it.
+    if (cache->epoch == epoch && end < block->len) {
+        cache->next = block->uops + end;
+        cache->next_key = (addr + (end - idx) * size) | core->cpsr.thumb;
+    } else {
+        cache->next = NULL;
+    }
+
+    return (true);
+}
+
+#else
+
+void
+core_jit_cleanup(
+    struct core_cache *cache
+) {
+    (void)cache;
+}
+
+/*
+** The JIT only targets x86-64: everywhere else, the cached interpreter runs all the instructions.
+*/
+bool
+core_jit_run(
+    struct gba *gba,
+    uint64_t target
+) {
+    (void)gba;
+    (void)target;
+    return (false);
+}
+
+#endif
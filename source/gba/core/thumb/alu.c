@@ -67,10 +67,7 @@ core_thumb_lo_add(
 
     res = core->registers[rs] + rhs;
 
-    core->cpsr.zero = !res;
-    core->cpsr.negative = bitfield_get(res, 31);
-    core->cpsr.carry = uadd32(core->registers[rs], rhs, 0);
-    core->cpsr.overflow = iadd32(core->registers[rs], rhs, 0);
+    core_flags_set_nzcv(core, res, uadd32(core->registers[rs], rhs, 0), iadd32(core->registers[rs], rhs, 0));
 
     core->registers[rd] = res;
     core->pc += 2;
@@ -106,10 +103,7 @@ core_thumb_lo_sub(
 
     res = core->registers[rs] - rhs;
 
-    core->cpsr.zero = !res;
-    core->cpsr.negative = bitfield_get(res, 31);
-    core->cpsr.carry = usub32(core->registers[rs], rhs, 0);
-    core->cpsr.overflow = isub32(core->registers[rs], rhs, 0);
+    core_flags_set_nzcv(core, res, usub32(core->registers[rs], rhs, 0), isub32(core->registers[rs], rhs, 0));
 
     core->registers[rd] = res;
     core->pc += 2;
@@ -134,8 +128,7 @@ core_thumb_mov_imm(
     imm = bitfield_get_range(op, 0, 8);
 
     core->registers[rd] = imm;
-    core->cpsr.zero = !(core->registers[rd]);
-    core->cpsr.negative = bitfield_get(core->registers[rd], 31); // Useless ?
+    core_flags_set_nz(core, core->registers[rd]);
     core->pc += 2;
     core->prefetch_access_type = SEQUENTIAL;
 }
@@ -159,10 +152,7 @@ core_thumb_cmp_imm(
     imm = bitfield_get_range(op, 0, 8);
     tmp = core->registers[rd] - imm;
 
-    core->cpsr.zero = !tmp;
-    core->cpsr.negative = bitfield_get(tmp, 31);
-    core->cpsr.carry = usub32(core->registers[rd], imm, 0);
-    core->cpsr.overflow = isub32(core->registers[rd], imm, 0);
+    core_flags_set_nzcv(core, tmp, usub32(core->registers[rd], imm, 0), isub32(core->registers[rd], imm, 0));
     core->pc += 2;
     core->prefetch_access_type = SEQUENTIAL;
 }
@@ -183,13 +173,8 @@ core_thumb_add_imm(
     rd = bitfield_get_range(op, 8, 11);
     imm = bitfield_get_range(op, 0, 8);
 
-    core->cpsr.carry = uadd32(core->registers[rd], imm, 0);
-    core->cpsr.overflow = iadd32(core->registers[rd], imm, 0);
-
+    core_flags_set_nzcv(core, core->registers[rd] + imm, uadd32(core->registers[rd], imm, 0), iadd32(core->registers[rd], imm, 0));
     core->registers[rd] += imm;
-
-    core->cpsr.zero = !(core->registers[rd]);
-    core->cpsr.negative = bitfield_get(core->registers[rd], 31);
     core->pc += 2;
     core->prefetch_access_type = SEQUENTIAL;
 }
@@ -211,13 +196,8 @@ core_thumb_sub_imm(
     rd = bitfield_get_range(op, 8, 11);
     imm = bitfield_get_range(op, 0, 8);
 
-    core->cpsr.carry = usub32(core->registers[rd], imm, 0);
-    core->cpsr.overflow = isub32(core->registers[rd], imm, 0);
-
+    core_flags_set_nzcv(core, core->registers[rd] - imm, usub32(core->registers[rd], imm, 0), isub32(core->registers[rd], imm, 0));
     core->registers[rd] -= imm;
-
-    core->cpsr.zero = !(core->registers[rd]);
-    core->cpsr.negative = bitfield_get(core->registers[rd], 31);
     core->pc += 2;
     core->prefetch_access_type = SEQUENTIAL;
 }
@@ -282,10 +262,7 @@ core_thumb_hi_cmp(
 
     hs_assert(h1 | h2); // Ensure h1 != 0 && h2 != 0, or op is undefined.
 
-    core->cpsr.zero = !(op1 - op2);
-    core->cpsr.negative = bitfield_get(op1 - op2, 31);
-    core->cpsr.carry = usub32(op1, op2, 0);
-    core->cpsr.overflow = isub32(op1, op2, 0);
+    core_flags_set_nzcv(core, op1 - op2, usub32(op1, op2, 0), isub32(op1, op2, 0));
     core->pc += 2;
     core->prefetch_access_type = SEQUENTIAL;
 }
@@ -392,11 +369,16 @@ core_thumb_add_sp_s_imm(
 
 /*
 ** Implement a bunch of ALU instructions.
+**
+** `alu_op` is bits 6 to 9 of the instruction, resolved at compile time by the
+** specialized handlers below.
 */
+static __always_inline
 void
-core_thumb_alu(
+core_thumb_alu_template(
     struct gba *gba,
-    uint16_t op
+    uint16_t op,
+    uint32_t alu_op
 ) {
     struct core *core;
     uint16_t rd;
@@ -413,18 +395,16 @@ core_thumb_alu(
     op1 = core->registers[rd];
     op2 = core->registers[rs];
 
-    switch (bitfield_get_range(op, 6, 13)) {
+    switch (alu_op) {
         case 0b0000:
             // AND
             core->registers[rd] = op1 & op2;
-            core->cpsr.zero = !(core->registers[rd]);
-            core->cpsr.negative = bitfield_get(core->registers[rd], 31);
+            core_flags_set_nz(core, core->registers[rd]);
             break;
         case 0b0001:
             // EOR (XOR)
             core->registers[rd] = op1 ^ op2;
-            core->cpsr.zero = !(core->registers[rd]);
-            core->cpsr.negative = bitfield_get(core->registers[rd], 31);
+            core_flags_set_nz(core, core->registers[rd]);
             break;
         case 0b0010:
             // LSL (Logical Shift Left)
@@ -446,9 +426,7 @@ core_thumb_alu(
                     break;
             }
 
-            core->cpsr.carry = carry_out;
-            core->cpsr.zero = !op1;
-            core->cpsr.negative = bitfield_get(op1, 31);
+            core_flags_set_nzc(core, op1, carry_out);
 
             core->registers[rd] = op1;
             core_idle(gba);
@@ -475,9 +453,7 @@ core_thumb_alu(
                     break;
             }
 
-            core->cpsr.carry = carry_out;
-            core->cpsr.zero = !op1;
-            core->cpsr.negative = bitfield_get(op1, 31);
+            core_flags_set_nzc(core, op1, carry_out);
 
             core->registers[rd] = op1;
 
@@ -504,9 +480,7 @@ core_thumb_alu(
                     break;
             }
 
-            core->cpsr.carry = carry_out;
-            core->cpsr.zero = !op1;
-            core->cpsr.negative = bitfield_get(op1, 31);
+            core_flags_set_nzc(core, op1, carry_out);
 
             core->registers[rd] = op1;
             core_idle(gba);
@@ -520,10 +494,7 @@ core_thumb_alu(
 
                 carry = core->cpsr.carry;
                 core->registers[rd] = op1 + op2 + core->cpsr.carry;
-                core->cpsr.zero = (core->registers[rd] == 0);
-                core->cpsr.negative = ((core->registers[rd] & 0x80000000) != 0);
-                core->cpsr.carry = uadd32(op1, op2, carry);
-                core->cpsr.overflow = iadd32(op1, op2, carry);
+                core_flags_set_nzcv(core, core->registers[rd], uadd32(op1, op2, carry), iadd32(op1, op2, carry));
             }
             break;
         case 0b0110:
@@ -533,10 +504,7 @@ core_thumb_alu(
 
                 carry = core->cpsr.carry;
                 core->registers[rd] = op1 - op2 + core->cpsr.carry - 1;
-                core->cpsr.zero = !(core->registers[rd]);
-                core->cpsr.negative = bitfield_get(core->registers[rd], 31);
-                core->cpsr.carry = usub32(op1, op2, !carry);
-                core->cpsr.overflow = isub32(op1, op2, !carry);
+                core_flags_set_nzcv(core, core->registers[rd], usub32(op1, op2, !carry), isub32(op1, op2, !carry));
             }
             break;
         case 0b0111:
@@ -553,9 +521,7 @@ core_thumb_alu(
                 op1 = ror32(op1, op2);
             }
 
-            core->cpsr.carry = carry_out;
-            core->cpsr.zero = !op1;
-            core->cpsr.negative = bitfield_get(op1, 31);
+            core_flags_set_nzc(core, op1, carry_out);
 
             core->registers[rd] = op1;
             core_idle(gba);
@@ -564,58 +530,69 @@ core_thumb_alu(
             break;
         case 0b1000:
             // TST (as AND, but result is not written)
-            core->cpsr.zero = !(op1 & op2);
-            core->cpsr.negative = bitfield_get(op1 & op2, 31);
+            core_flags_set_nz(core, op1 & op2);
             break;
         case 0b1001:
             // NEG (As 0 - op2, implemented as RSBS Rd, Rs, #0)
             core->registers[rd] = 0 - op2;
-            core->cpsr.zero = !(core->registers[rd]);
-            core->cpsr.negative = bitfield_get(core->registers[rd], 31);
-            core->cpsr.carry = usub32(0, op2, 0);
-            core->cpsr.overflow = isub32(0, op2, 0);
+            core_flags_set_nzcv(core, core->registers[rd], usub32(0, op2, 0), isub32(0, op2, 0));
             break;
         case 0b1010:
             // CMP (as SUB, but result is not written)
-            core->cpsr.zero = !(op1 - op2);
-            core->cpsr.negative = bitfield_get(op1 - op2, 31);
-            core->cpsr.carry = usub32(op1, op2, 0);
-            core->cpsr.overflow = isub32(op1, op2, 0);
+            core_flags_set_nzcv(core, op1 - op2, usub32(op1, op2, 0), isub32(op1, op2, 0));
             break;
         case 0b1011:
             // CMN (as ADD, but result is not written)
-            core->cpsr.zero = !(op1 + op2);
-            core->cpsr.negative = bitfield_get(op1 + op2, 31);
-            core->cpsr.carry = uadd32(op1, op2, 0);
-            core->cpsr.overflow = iadd32(op1, op2, 0);
+            core_flags_set_nzcv(core, op1 + op2, uadd32(op1, op2, 0), iadd32(op1, op2, 0));
             break;
         case 0b1100:
             // ORR (Logical OR)
             core->registers[rd] = op1 | op2;
-            core->cpsr.zero = !(core->registers[rd]);
-            core->cpsr.negative = bitfield_get(core->registers[rd], 31);
+            core_flags_set_nz(core, core->registers[rd]);
             break;
         case 0b1101:
             // MUL
             core_arm_mul_idle_signed(gba, op1);
             core->registers[rd] = op1 * op2;
-            core->cpsr.zero = !(core->registers[rd]);
-            core->cpsr.negative = bitfield_get(core->registers[rd], 31);
-            core->cpsr.carry = 0;
+            core_flags_set_nzc(core, core->registers[rd], 0);
             core->prefetch_access_type = NON_SEQUENTIAL;
             break;
         case 0b1110:
             // BIC (op1 AND NOT op2)
             core->registers[rd] = op1 & ~op2;
-            core->cpsr.zero = !(core->registers[rd]);
-            core->cpsr.negative = bitfield_get(core->registers[rd], 31);
+            core_flags_set_nz(core, core->registers[rd]);
             break;
         case 0b1111:
             // MVN (NOT op2, op1 is ignored)
             core->registers[rd] = ~op2;
-            core->cpsr.zero = !(core->registers[rd]);
-            core->cpsr.negative = bitfield_get(core->registers[rd], 31);
+            core_flags_set_nz(core, core->registers[rd]);
             break;
     }
     core->pc += 2;
 }
+
+#define CORE_THUMB_ALU_DEFINE(name, alu_op)                                     \
+    void                                                                        \
+    name(                                                                       \
+        struct gba *gba,                                                        \
+        uint16_t op                                                             \
+    ) {                                                                         \
+        core_thumb_alu_template(gba, op, (alu_op));                             \
+    }
+
+CORE_THUMB_ALU_DEFINE(core_thumb_alu_and, 0b0000)
+CORE_THUMB_ALU_DEFINE(core_thumb_alu_eor, 0b0001)
+CORE_THUMB_ALU_DEFINE(core_thumb_alu_lsl, 0b0010)
+CORE_THUMB_ALU_DEFINE(core_thumb_alu_lsr, 0b0011)
+CORE_THUMB_ALU_DEFINE(core_thumb_alu_asr, 0b0100)
+CORE_THUMB_ALU_DEFINE(core_thumb_alu_adc, 0b0101)
+CORE_THUMB_ALU_DEFINE(core_thumb_alu_sbc, 0b0110)
+CORE_THUMB_ALU_DEFINE(core_thumb_alu_ror, 0b0111)
+CORE_THUMB_ALU_DEFINE(core_thumb_alu_tst, 0b1000)
+CORE_THUMB_ALU_DEFINE(core_thumb_alu_neg, 0b1001)
+CORE_THUMB_ALU_DEFINE(core_thumb_alu_cmp, 0b1010)
+CORE_THUMB_ALU_DEFINE(core_thumb_alu_cmn, 0b1011)
+CORE_THUMB_ALU_DEFINE(core_thumb_alu_orr, 0b1100)
+CORE_THUMB_ALU_DEFINE(core_thumb_alu_mul, 0b1101)
+CORE_THUMB_ALU_DEFINE(core_thumb_alu_bic, 0b1110)
+CORE_THUMB_ALU_DEFINE(core_thumb_alu_mvn, 0b1111)
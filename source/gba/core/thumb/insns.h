@@ -0,0 +1,127 @@
+/******************************************************************************\
+**
+**  This file is part of the Hades GBA Emulator, and is made available under
+**  the terms of the GNU General Public License version 2.
+**
+**  Copyright (C) 2021-2024 - The Hades Authors
+**
+\******************************************************************************/
+
+/*
+** The Thumb instruction set, as a list of `THUMB_INSN(name, mask, handler)`.
+**
+** The mask is a string of 16 characters (`_` are ignored as separators) where `0` and `1` are the
+** bits that identify the instruction and any other character is a don't-care bit.
+**
+** This is the single source of truth used by `gen_tables.c` to build `thumb_lut` at compile time.
+** Include it after defining `THUMB_INSN`.
+*/
+
+// Move shifted register
+THUMB_INSN("lsl",             "00000yyyyysssddd",    core_thumb_lsl)
+THUMB_INSN("lsr",             "00001yyyyysssddd",    core_thumb_lsr)
+THUMB_INSN("asr",             "00010yyyyysssddd",    core_thumb_asr)
+
+// Add/Subtract from/to low registers
+THUMB_INSN("add_lo_reg",      "00011i0yyysssddd",    core_thumb_lo_add)
+THUMB_INSN("sub_lo_reg",      "00011i1yyysssddd",    core_thumb_lo_sub)
+
+// Move/Compare/Add/Subtract immediate
+THUMB_INSN("mov_imm",         "00100dddxxxxxxxx",    core_thumb_mov_imm)
+THUMB_INSN("cmp_imm",         "00101dddxxxxxxxx",    core_thumb_cmp_imm)
+THUMB_INSN("add_imm",         "00110dddxxxxxxxx",    core_thumb_add_imm)
+THUMB_INSN("sub_imm",         "00111dddxxxxxxxx",    core_thumb_sub_imm)
+
+// ALU operations
+THUMB_INSN("alu_and",         "0100000000sssddd",    core_thumb_alu_and)
+THUMB_INSN("alu_eor",         "0100000001sssddd",    core_thumb_alu_eor)
+THUMB_INSN("alu_lsl",         "0100000010sssddd",    core_thumb_alu_lsl)
+THUMB_INSN("alu_lsr",         "0100000011sssddd",    core_thumb_alu_lsr)
+THUMB_INSN("alu_asr",         "0100000100sssddd",    core_thumb_alu_asr)
+THUMB_INSN("alu_adc",         "0100000101sssddd",    core_thumb_alu_adc)
+THUMB_INSN("alu_sbc",         "0100000110sssddd",    core_thumb_alu_sbc)
+THUMB_INSN("alu_ror",         "0100000111sssddd",    core_thumb_alu_ror)
+THUMB_INSN("alu_tst",         "0100001000sssddd",    core_thumb_alu_tst)
+THUMB_INSN("alu_neg",         "0100001001sssddd",    core_thumb_alu_neg)
+THUMB_INSN("alu_cmp",         "0100001010sssddd",    core_thumb_alu_cmp)
+THUMB_INSN("alu_cmn",         "0100001011sssddd",    core_thumb_alu_cmn)
+THUMB_INSN("alu_orr",         "0100001100sssddd",    core_thumb_alu_orr)
+THUMB_INSN("alu_mul",         "0100001101sssddd",    core_thumb_alu_mul)
+THUMB_INSN("alu_bic",         "0100001110sssddd",    core_thumb_alu_bic)
+THUMB_INSN("alu_mvn",         "0100001111sssddd",    core_thumb_alu_mvn)
+
+// Hi register operations/Branch exchange
+THUMB_INSN("add_hi_reg",      "01000100hhsssddd",    core_thumb_hi_add)
+THUMB_INSN("cmp_hi_reg",      "01000101hhsssddd",    core_thumb_hi_cmp)
+THUMB_INSN("mov_hi_reg",      "01000110hhsssddd",    core_thumb_hi_mov)
+THUMB_INSN("bx",              "01000111hhsssddd",    core_thumb_branch_xchg)
+
+// PC-Relative loads
+THUMB_INSN("ldr_pc",          "01001dddxxxxxxxx",    core_thumb_ldr_pc)
+
+// Load/Store Word/Byte with register offset
+THUMB_INSN("str_reg",         "0101000ooobbbddd",    core_thumb_str_reg)
+THUMB_INSN("strb_reg",        "0101010ooobbbddd",    core_thumb_strb_reg)
+THUMB_INSN("ldr_reg",         "0101100ooobbbddd",    core_thumb_ldr_reg)
+THUMB_INSN("ldrb_reg",        "0101110ooobbbddd",    core_thumb_ldrb_reg)
+
+// Load/Store Sign-Extended Byte/Halfword
+THUMB_INSN("strh_reg",        "0101001ooobbbddd",    core_thumb_strh_reg)
+THUMB_INSN("ldrh_reg",        "0101101ooobbbddd",    core_thumb_ldrh_reg)
+THUMB_INSN("ldsb_reg",        "0101011ooobbbddd",    core_thumb_ldsb_reg)
+THUMB_INSN("ldsh_reg",        "0101111ooobbbddd",    core_thumb_ldsh_reg)
+
+// Load/Store with Immediate Offset
+THUMB_INSN("str_imm",         "01100ooooobbbddd",    core_thumb_str_imm)
+THUMB_INSN("ldr_imm",         "01101ooooobbbddd",    core_thumb_ldr_imm)
+THUMB_INSN("strb_imm",        "01110ooooobbbddd",    core_thumb_strb_imm)
+THUMB_INSN("ldrb_imm",        "01111ooooobbbddd",    core_thumb_ldrb_imm)
+
+// Load/Store Halfword with Immediate Offset
+THUMB_INSN("strh_imm",        "10000ooooobbbddd",    core_thumb_strh_imm)
+THUMB_INSN("ldrh_imm",        "10001ooooobbbddd",    core_thumb_ldrh_imm)
+
+// SP-Relative Load/Store
+THUMB_INSN("str_sp",          "10010dddiiiiiiii",    core_thumb_str_sp)
+THUMB_INSN("ldr_sp",          "10011dddiiiiiiii",    core_thumb_ldr_sp)
+
+// Load Address
+THUMB_INSN("add_pc_imm",      "10100dddiiiiiiii",    core_thumb_add_pc_imm)
+THUMB_INSN("add_sp_imm",      "10101dddiiiiiiii",    core_thumb_add_sp_imm)
+
+// Add Offset to Stack Pointer
+THUMB_INSN("add_sp_s_imm",    "10110000siiiiiii",    core_thumb_add_sp_s_imm)
+
+// Push/Pop lo registers
+THUMB_INSN("push",            "1011010xxxxxxxxx",    core_thumb_push)
+THUMB_INSN("pop",             "1011110xxxxxxxxx",    core_thumb_pop)
+
+// Multiple Load/Store
+THUMB_INSN("stmia",           "11000bbbxxxxxxxx",    core_thumb_stmia)
+THUMB_INSN("ldmia",           "11001bbbxxxxxxxx",    core_thumb_ldmia)
+
+// Conditional Branch
+THUMB_INSN("beq",             "11010000xxxxxxxx",    core_thumb_branch_cond)
+THUMB_INSN("bne",             "11010001xxxxxxxx",    core_thumb_branch_cond)
+THUMB_INSN("bcs",             "11010010xxxxxxxx",    core_thumb_branch_cond)
+THUMB_INSN("bcc",             "11010011xxxxxxxx",    core_thumb_branch_cond)
+THUMB_INSN("bmi",             "11010100xxxxxxxx",    core_thumb_branch_cond)
+THUMB_INSN("bpl",             "11010101xxxxxxxx",    core_thumb_branch_cond)
+THUMB_INSN("bvs",             "11010110xxxxxxxx",    core_thumb_branch_cond)
+THUMB_INSN("bvc",             "11010111xxxxxxxx",    core_thumb_branch_cond)
+THUMB_INSN("bhi",             "11011000xxxxxxxx",    core_thumb_branch_cond)
+THUMB_INSN("bls",             "11011001xxxxxxxx",    core_thumb_branch_cond)
+THUMB_INSN("bge",             "11011010xxxxxxxx",    core_thumb_branch_cond)
+THUMB_INSN("blt",             "11011011xxxxxxxx",    core_thumb_branch_cond)
+THUMB_INSN("bgt",             "11011100xxxxxxxx",    core_thumb_branch_cond)
+THUMB_INSN("ble",             "11011101xxxxxxxx",    core_thumb_branch_cond)
+
+// Software Interrupt
+THUMB_INSN("swi",             "11011111xxxxxxxx",    core_thumb_swi)
+
+// Unconditional Branch (B)
+THUMB_INSN("b",               "11100xxxxxxxxxxx",    core_thumb_branch)
+
+// Long Branch with Link (BL)
+THUMB_INSN("bl_1",            "11110xxxxxxxxxxx",    core_thumb_branch_link)
+THUMB_INSN("bl_2",            "11111xxxxxxxxxxx",    core_thumb_branch_link)
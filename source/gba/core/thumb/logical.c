@@ -9,6 +9,7 @@
 
 #include "hades.h"
 #include "gba/gba.h"
+#include "gba/core/helpers.h"
 
 /*
 ** Implement the Logical Shift Left instructions.
@@ -34,14 +35,16 @@ core_thumb_lsl(
     /* LSL (Logical Shift Left) */
 
     if (shift > 0) {
+        bool carry;
+
         value <<= shift - 1;
-        core->cpsr.carry = value >> 31;
+        carry = value >> 31;
         value <<= 1;
+        core_flags_set_nzc(core, value, carry);
+    } else {
+        core_flags_set_nz(core, value);
     }
 
-    core->cpsr.zero = !value;
-    core->cpsr.negative = bitfield_get(value, 31);
-
     core->registers[rd] = value;
 
     core->pc += 2;
@@ -61,6 +64,7 @@ core_thumb_lsr(
     uint32_t rs;
     uint32_t shift;
     uint32_t value;
+    bool carry;
 
     rd = bitfield_get_range(op, 0, 3);
     rs = bitfield_get_range(op, 3, 6);
@@ -76,11 +80,10 @@ core_thumb_lsr(
     }
 
     value >>= shift - 1;
-    core->cpsr.carry = value & 0b1;
+    carry = value & 0b1;
     value >>= 1;
 
-    core->cpsr.zero = !value;
-    core->cpsr.negative = bitfield_get(value, 31);
+    core_flags_set_nzc(core, value, carry);
 
     core->registers[rd] = value;
 
@@ -101,6 +104,7 @@ core_thumb_asr(
     uint32_t rs;
     uint32_t shift;
     uint32_t value;
+    bool carry;
 
     rd = bitfield_get_range(op, 0, 3);
     rs = bitfield_get_range(op, 3, 6);
@@ -116,11 +120,10 @@ core_thumb_asr(
     }
 
     value = (int32_t)value >> (shift - 1);
-    core->cpsr.carry = value & 0b1;
+    carry = value & 0b1;
     value = (int32_t)value >> 1;
 
-    core->cpsr.zero = !value;
-    core->cpsr.negative = bitfield_get(value, 31);
+    core_flags_set_nzc(core, value, carry);
 
     core->registers[rd] = value;
 
@@ -13,10 +13,13 @@
 /*
 ** Execute the Load/Store Word/Byte With Immediate Offset instruction.
 */
+static __always_inline
 void
-core_thumb_sdt_imm(
+core_thumb_sdt_imm_template(
     struct gba *gba,
-    uint16_t op
+    uint16_t op,
+    bool load,
+    bool byte
 ) {
     struct core *core;
     uint32_t rd;
@@ -28,7 +31,7 @@ core_thumb_sdt_imm(
     rb = bitfield_get_range(op, 3, 6);
     offset = bitfield_get_range(op, 6, 11);
 
-    switch ((bitfield_get(op, 11) << 1) | bitfield_get(op, 12)) {
+    switch ((load << 1) | byte) {
         case 0b00: // Store word
             mem_write32(gba, core->registers[rb] + (offset << 2), core->registers[rd], NON_SEQUENTIAL);
             break;
@@ -52,10 +55,13 @@ core_thumb_sdt_imm(
 /*
 ** Execute the Load/Store Word/Byte With Register Offset instruction.
 */
+static __always_inline
 void
-core_thumb_sdt_wb_reg(
+core_thumb_sdt_wb_reg_template(
     struct gba *gba,
-    uint16_t op
+    uint16_t op,
+    bool load,
+    bool byte
 ) {
     struct core *core;
     uint32_t rd;
@@ -67,7 +73,7 @@ core_thumb_sdt_wb_reg(
     rb = bitfield_get_range(op, 3, 6);
     ro = bitfield_get_range(op, 6, 9);
 
-    switch ((bitfield_get(op, 11) << 1) | bitfield_get(op, 10)) {
+    switch ((load << 1) | byte) {
         case 0b00: // Store word
             mem_write32(gba, core->registers[rb] + core->registers[ro], core->registers[rd], NON_SEQUENTIAL);
             break;
@@ -91,24 +97,24 @@ core_thumb_sdt_wb_reg(
 /*
 ** Execute the Load/Store Halfword with Immediate Offset instructions
 */
+static __always_inline
 void
-core_thumb_sdt_h_imm(
+core_thumb_sdt_h_imm_template(
     struct gba *gba,
-    uint16_t op
+    uint16_t op,
+    bool load
 ) {
     struct core *core;
     uint32_t offset;
     uint32_t rd;
     uint32_t rb;
-    bool l;
 
     core = &gba->core;
     rd = bitfield_get_range(op, 0, 3);
     rb = bitfield_get_range(op, 3, 6);
     offset = bitfield_get_range(op, 6, 11) << 1;
-    l = bitfield_get(op, 11);
 
-    if (l) {
+    if (load) {
         // LDRH
         core->registers[rd] = mem_read16_ror(gba, core->registers[rb] + offset, NON_SEQUENTIAL);
         core_idle(gba);
@@ -124,10 +130,13 @@ core_thumb_sdt_h_imm(
 /*
 ** Execute the Load/Store Sign-Extended Byte/Halfword with Register Offset instructions.
 */
+static __always_inline
 void
-core_thumb_sdt_sbh_reg(
+core_thumb_sdt_sbh_reg_template(
     struct gba *gba,
-    uint16_t op
+    uint16_t op,
+    bool sign,
+    bool half
 ) {
     struct core *core;
     uint32_t rd;
@@ -142,7 +151,7 @@ core_thumb_sdt_sbh_reg(
     core = &gba->core;
     addr = core->registers[rb] + core->registers[ro];
 
-    switch ((bitfield_get(op, 10) << 1) | bitfield_get(op, 11)) {
+    switch ((sign << 1) | half) {
         case 0b00:
             // Store halfword
             mem_write16(gba, addr, core->registers[rd], NON_SEQUENTIAL);
@@ -199,22 +208,22 @@ core_thumb_ldr_pc(
 /*
 ** Execute the Sp-Relative Load/Store instructions
 */
+static __always_inline
 void
-core_thumb_sdt_sp(
+core_thumb_sdt_sp_template(
     struct gba *gba,
-    uint16_t op
+    uint16_t op,
+    bool load
 ) {
     struct core *core;
     uint32_t rd;
     uint32_t offset;
-    bool l;
 
     rd = bitfield_get_range(op, 8, 11);
     offset = bitfield_get_range(op, 0, 8) << 2;
-    l = bitfield_get(op, 11);
     core = &gba->core;
 
-    if (l) { // LDR
+    if (load) { // LDR
         core->registers[rd] = mem_read32_ror(gba, core->sp + offset, NON_SEQUENTIAL);
         core_idle(gba);
     } else { // STR
@@ -224,3 +233,33 @@ core_thumb_sdt_sp(
     core->pc += 2;
     core->prefetch_access_type = NON_SEQUENTIAL;
 }
+
+#define CORE_THUMB_SDT_DEFINE(name, template, ...)                              \
+    void                                                                        \
+    name(                                                                       \
+        struct gba *gba,                                                        \
+        uint16_t op                                                             \
+    ) {                                                                         \
+        template(gba, op, __VA_ARGS__);                                         \
+    }
+
+/*
+** Specialized variants of the templates above, one for each value of the bits
+** they would otherwise decode at runtime.
+*/
+CORE_THUMB_SDT_DEFINE(core_thumb_str_imm, core_thumb_sdt_imm_template, false, false)
+CORE_THUMB_SDT_DEFINE(core_thumb_strb_imm, core_thumb_sdt_imm_template, false, true)
+CORE_THUMB_SDT_DEFINE(core_thumb_ldr_imm, core_thumb_sdt_imm_template, true, false)
+CORE_THUMB_SDT_DEFINE(core_thumb_ldrb_imm, core_thumb_sdt_imm_template, true, true)
+CORE_THUMB_SDT_DEFINE(core_thumb_str_reg, core_thumb_sdt_wb_reg_template, false, false)
+CORE_THUMB_SDT_DEFINE(core_thumb_strb_reg, core_thumb_sdt_wb_reg_template, false, true)
+CORE_THUMB_SDT_DEFINE(core_thumb_ldr_reg, core_thumb_sdt_wb_reg_template, true, false)
+CORE_THUMB_SDT_DEFINE(core_thumb_ldrb_reg, core_thumb_sdt_wb_reg_template, true, true)
+CORE_THUMB_SDT_DEFINE(core_thumb_strh_imm, core_thumb_sdt_h_imm_template, false)
+CORE_THUMB_SDT_DEFINE(core_thumb_ldrh_imm, core_thumb_sdt_h_imm_template, true)
+CORE_THUMB_SDT_DEFINE(core_thumb_strh_reg, core_thumb_sdt_sbh_reg_template, false, false)
+CORE_THUMB_SDT_DEFINE(core_thumb_ldrh_reg, core_thumb_sdt_sbh_reg_template, false, true)
+CORE_THUMB_SDT_DEFINE(core_thumb_ldsb_reg, core_thumb_sdt_sbh_reg_template, true, false)
+CORE_THUMB_SDT_DEFINE(core_thumb_ldsh_reg, core_thumb_sdt_sbh_reg_template, true, true)
+CORE_THUMB_SDT_DEFINE(core_thumb_str_sp, core_thumb_sdt_sp_template, false)
+CORE_THUMB_SDT_DEFINE(core_thumb_ldr_sp, core_thumb_sdt_sp_template, true)
@@ -9,11 +9,16 @@
 
 #include "hades.h"
 #include "gba/gba.h"
+#include "gba/bios.h"
 
 void
 core_thumb_swi(
     struct gba *gba,
     uint16_t op
 ) {
+    if (gba->memory.hle_bios && bios_hle_swi(gba, bitfield_get_range(op, 0, 8))) {
+        return;
+    }
+
     core_interrupt(gba, VEC_SVC, MODE_SVC, false);
 }
@@ -16,7 +16,7 @@
 **
 ** Thanks Zayd for sharing this list with me :)
 */
-static struct game_entry game_database[] = {
+static struct game_entry const game_database[] = {
     (struct game_entry){.code = "BJB", .storage = BACKUP_EEPROM_4K, .gpio = GPIO_NONE, .title = "007 - Everything or Nothing"},
     (struct game_entry){.code = "BFB", .storage = BACKUP_SRAM,      .gpio = GPIO_NONE, .title = "2 Disney Games - Disney Sports Skateboarding + Football"},
     (struct game_entry){.code = "BLQ", .storage = BACKUP_EEPROM_4K, .gpio = GPIO_NONE, .title = "2 Disney Games - Lilo & Stitch 2 + Peter Pan"},
@@ -7,13 +7,17 @@
 **
 \******************************************************************************/
 
+#include <stdalign.h>
 #include <string.h>
 #include "hades.h"
 #include "gba/gba.h"
+#include "gba/bios.h"
 #include "gba/core/arm.h"
 #include "gba/core/thumb.h"
 #include "gba/channel.h"
 #include "gba/event.h"
+#include "gba/sync.h"
+#include "compat.h"
 
 /*
 ** Create a new GBA emulator.
@@ -24,15 +28,22 @@ gba_create(
 ) {
     struct gba *gba;
 
-    gba = malloc(sizeof(struct gba));
+    // Aligned for the arrays of `struct memory` the mirror view maps in place (see `struct mem_mirror`)
+    gba = hs_aligned_alloc(alignof(struct gba), sizeof(struct gba));
     hs_assert(gba);
 
     memset(gba, 0, sizeof(*gba));
 
-    // Initialize the ARM and Thumb decoder
+    // Initialize the cache of decoded instructions, tiles and sprites
     {
-        core_arm_decode_insns();
-        core_thumb_decode_insns();
+        core_cache_init(&gba->core_cache);
+        ppu_tile_cache_init(&gba->tile_cache);
+        ppu_oam_cache_invalidate(gba);
+    }
+
+    // Pick the fastest kernels of the PPU the host's CPU supports
+    {
+        gba->compositor = ppu_compositor_select();
     }
 
     // Channels
@@ -58,6 +69,11 @@ gba_send_notification_raw(
     struct gba *gba,
     struct event_header const *notif_header
 ) {
+    // Nobody is listening to the channels when the GBA is driven synchronously
+    if (gba->synchronous) {
+        return;
+    }
+
     switch (notif_header->kind) {
         case NOTIFICATION_RESET:
         case NOTIFICATION_PAUSE:
@@ -113,12 +129,11 @@ gba_send_notification(
     gba_send_notification_raw(gba, &notif.header);
 }
 
-static void
+void
 gba_state_stop(
     struct gba *gba
 ) {
-    free(gba->scheduler.events);
-    gba->scheduler.events = NULL;
+    sched_cleanup(gba);
 
     free(gba->shared_data.backup_storage.data);
     gba->shared_data.backup_storage.data = NULL;
@@ -144,7 +159,7 @@ gba_state_run(
     gba_send_notification(gba, NOTIFICATION_RUN);
 }
 
-static void
+void
 gba_state_reset(
     struct gba *gba,
     struct launch_config const *config
@@ -152,16 +167,18 @@ gba_state_reset(
     // Settings
     memcpy(&gba->settings, &config->settings, sizeof(struct gba_settings));
 
+    // Idle loop detection
+    memset(&gba->core_idle_loop, 0, sizeof(gba->core_idle_loop));
+    gba->core_idle_loop.config = config->idle_loop;
+    core_idle_loop_reset(gba);
+
     // Scheduler
     {
         struct scheduler *scheduler;
 
         scheduler = &gba->scheduler;
         memset(scheduler, 0, sizeof(*scheduler));
-
-        scheduler->events_size = 64;
-        scheduler->events = calloc(scheduler->events_size, sizeof(struct scheduler_event));
-        hs_assert(scheduler->events);
+        scheduler->next_event = UINT64_MAX;
 
         sched_update_speed(gba);
 
@@ -183,10 +200,25 @@ gba_state_reset(
         memory = &gba->memory;
         memset(memory, 0, sizeof(*memory));
 
-        // Copy the BIOS and ROM to memory
-        memcpy(gba->memory.bios, config->bios.data, min(config->bios.size, BIOS_SIZE));
-        memcpy(gba->memory.rom, config->rom.data, min(config->rom.size, CART_SIZE));
-        gba->memory.rom_size = config->rom.size;
+        // Copy the BIOS to memory
+        if (config->bios.data) {
+            memcpy(gba->memory.bios, config->bios.data, min(config->bios.size, BIOS_SIZE));
+        } else {
+            bios_hle_load(gba);
+        }
+
+        gba->memory.hle_bios = config->hle_bios || !config->bios.data;
+
+        // The ROM is used in place
+        gba->rom.data = config->rom.data;
+        gba->rom.size = min(config->rom.size, CART_SIZE);
+        gba->rom.hashed = false;
+
+        // Build or release the mirror view according to the settings, and map the new ROM in it
+        mem_mirror_enable(gba, gba->settings.mmu_mirrors);
+        mem_mirror_map_rom(gba);
+
+        core_cache_flush(gba);
     }
 
     // IO
@@ -300,16 +332,16 @@ gba_state_reset(
         gba->memory.backup_storage.type = config->backup_storage.type;
         switch (gba->memory.backup_storage.type) {
             case BACKUP_EEPROM_4K: {
-                gba->memory.backup_storage.chip.eeprom.mask = (gba->memory.rom_size > 16 * 1024 * 1024) ? 0x01FFFF00 : 0xFF000000;
-                gba->memory.backup_storage.chip.eeprom.range = (gba->memory.rom_size > 16 * 1024 * 1024) ? 0x01FFFF00 : 0x0d000000;
+                gba->memory.backup_storage.chip.eeprom.mask = (gba->rom.size > 16 * 1024 * 1024) ? 0x01FFFF00 : 0xFF000000;
+                gba->memory.backup_storage.chip.eeprom.range = (gba->rom.size > 16 * 1024 * 1024) ? 0x01FFFF00 : 0x0d000000;
                 gba->memory.backup_storage.chip.eeprom.address_mask = EEPROM_4K_ADDR_MASK;
                 gba->memory.backup_storage.chip.eeprom.address_len = EEPROM_4K_ADDR_LEN;
                 gba->shared_data.backup_storage.size = EEPROM_4K_SIZE;
                 break;
             };
             case BACKUP_EEPROM_64K: {
-                gba->memory.backup_storage.chip.eeprom.mask = (gba->memory.rom_size > 16 * 1024 * 1024) ? 0x01FFFF00 : 0xFF000000;
-                gba->memory.backup_storage.chip.eeprom.range = (gba->memory.rom_size > 16 * 1024 * 1024) ? 0x01FFFF00 : 0x0d000000;
+                gba->memory.backup_storage.chip.eeprom.mask = (gba->rom.size > 16 * 1024 * 1024) ? 0x01FFFF00 : 0xFF000000;
+                gba->memory.backup_storage.chip.eeprom.range = (gba->rom.size > 16 * 1024 * 1024) ? 0x01FFFF00 : 0x0d000000;
                 gba->memory.backup_storage.chip.eeprom.address_mask = EEPROM_64K_ADDR_MASK;
                 gba->memory.backup_storage.chip.eeprom.address_len = EEPROM_64K_ADDR_LEN;
                 gba->shared_data.backup_storage.size = EEPROM_64K_SIZE;
@@ -334,6 +366,12 @@ gba_state_reset(
         }
     }
 
+    // Now that the backup storage and GPIO are known, build the fastmem page table
+    mem_update_page_table(gba);
+
+    // The whole memory was replaced
+    mem_dirty_mark_all(gba);
+
     // Core
     {
         struct core *core;
@@ -349,7 +387,8 @@ gba_state_reset(
         core->prefetch[1] = 0xF0000000;
         core->prefetch_access_type = NON_SEQUENTIAL;
 
-        if (config->skip_bios) {
+        // There's no boot sequence without a BIOS dump
+        if (config->skip_bios || !config->bios.data) {
             core->r13_irq = 0x03007FA0;
             core->r13_svc = 0x03007FE0;
             core->sp = 0x03007F00;
@@ -363,6 +402,10 @@ gba_state_reset(
         }
     }
 
+    // Start a new history from the initial state
+    rewind_reset(gba);
+    runahead_reset(gba);
+
     gba_send_notification(gba, NOTIFICATION_RESET);
 }
 
@@ -405,34 +448,49 @@ gba_process_message(
             struct message_key const *msg_key;
 
             msg_key = (struct message_key const *)message;
-            switch (msg_key->key) {
-                case KEY_A:         gba->io.keyinput.a = !msg_key->pressed; break;
-                case KEY_B:         gba->io.keyinput.b = !msg_key->pressed; break;
-                case KEY_L:         gba->io.keyinput.l = !msg_key->pressed; break;
-                case KEY_R:         gba->io.keyinput.r = !msg_key->pressed; break;
-                case KEY_UP:        gba->io.keyinput.up = !msg_key->pressed; break;
-                case KEY_DOWN:      gba->io.keyinput.down = !msg_key->pressed; break;
-                case KEY_RIGHT:     gba->io.keyinput.right = !msg_key->pressed; break;
-                case KEY_LEFT:      gba->io.keyinput.left = !msg_key->pressed; break;
-                case KEY_START:     gba->io.keyinput.start = !msg_key->pressed; break;
-                case KEY_SELECT:    gba->io.keyinput.select = !msg_key->pressed; break;
-                default:            break;
-            };
-
-            if (gba->core.state == CORE_STOP && io_evaluate_keypad_cond(gba)) {
-                gba->core.state = CORE_RUN;
-                sched_reset_frame_limiter(gba);
-            }
-
-            io_scan_keypad_irq(gba);
+            gba_set_key(gba, msg_key->key, msg_key->pressed);
             break;
         };
         case MESSAGE_SETTINGS: {
             struct message_settings const *msg_settings;
+            bool rewind_changed;
+            bool runahead_changed;
 
             msg_settings = (struct message_settings const *)message;
+
+            // Start from a clean cache when switching to another backend
+            if (msg_settings->settings.core_backend != gba->settings.core_backend) {
+                core_cache_flush(gba);
+            }
+
+            // The compiled code and the page table depend on the mirror view
+            if (msg_settings->settings.mmu_mirrors != gba->settings.mmu_mirrors) {
+                mem_mirror_enable(gba, msg_settings->settings.mmu_mirrors);
+                if (gba->state != GBA_STATE_STOP) {
+                    mem_mirror_map_rom(gba);
+                }
+                mem_update_page_table(gba);
+                core_cache_flush(gba);
+            }
+
+            rewind_changed = (
+                   msg_settings->settings.rewind.enabled != gba->settings.rewind.enabled
+                || msg_settings->settings.rewind.interval != gba->settings.rewind.interval
+                || msg_settings->settings.rewind.buffer_size != gba->settings.rewind.buffer_size
+            );
+            runahead_changed = (msg_settings->settings.run_ahead != gba->settings.run_ahead);
+
             memcpy(&gba->settings, &msg_settings->settings, sizeof(struct gba_settings));
 
+            // Without a game, the history is started by the next reset
+            if (rewind_changed && gba->state != GBA_STATE_STOP) {
+                rewind_reset(gba);
+            }
+
+            if (runahead_changed && gba->state != GBA_STATE_STOP) {
+                runahead_reset(gba);
+            }
+
             sched_update_speed(gba);
 
             // If necessary, disable the prefetch buffer
@@ -458,6 +516,13 @@ gba_process_message(
             gba_send_notification(gba, NOTIFICATION_QUICKLOAD);
             break;
         };
+        case MESSAGE_REWIND: {
+            struct message_rewind const *msg_rewind;
+
+            msg_rewind = (struct message_rewind const *)message;
+            gba_set_rewind(gba, msg_rewind->enabled);
+            break;
+        };
 #ifdef WITH_DEBUGGER
         case MESSAGE_FRAME: {
             struct message_frame const *msg_frame;
@@ -580,6 +645,8 @@ gba_run(
 #else
                 sched_run_for(gba, GBA_CYCLES_PER_PIXEL * GBA_SCREEN_REAL_WIDTH);
 #endif
+                rewind_update(gba);
+                runahead_update(gba);
                 break;
             };
         }
@@ -593,7 +660,12 @@ void
 gba_delete(
     struct gba *gba
 ) {
-    free(gba);
+    core_cache_cleanup(&gba->core_cache);
+    ppu_tile_cache_cleanup(&gba->tile_cache);
+    rewind_cleanup(gba);
+    runahead_cleanup(gba);
+    mem_mirror_enable(gba, false);
+    hs_aligned_free(gba);
 }
 
 /*
@@ -10,6 +10,7 @@
 #include <time.h>
 #include "gba/gba.h"
 #include "gba/gpio.h"
+#include "compat.h"
 
 static inline
 bool
@@ -59,12 +60,15 @@ gpio_rtc_get_date_time(
     struct gba const *gba
 ) {
     time_t t;
+    struct tm tm_buf;
     struct tm *tm;
     uint64_t res;
     bool use_24h;
 
+    // `localtime()` isn't reentrant and would be shared by all the emulation threads.
     t = time(NULL);
-    tm = localtime(&t);
+    tm = hs_localtime(&t, &tm_buf);
+    hs_assert(tm);
     use_24h = gba->gpio.rtc.control.mode_24h;
 
     res = 0;
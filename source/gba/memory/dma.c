@@ -7,14 +7,15 @@
 **
 \******************************************************************************/
 
+#include <string.h>
 #include "hades.h"
 #include "gba/gba.h"
 #include "gba/scheduler.h"
 #include "gba/core/helpers.h"
 
-static uint32_t src_mask[4]   = {0x07FFFFFF, 0x0FFFFFFF, 0x0FFFFFFF, 0x0FFFFFFF};
-static uint32_t dst_mask[4]   = {0x07FFFFFF, 0x07FFFFFF, 0x07FFFFFF, 0x0FFFFFFF};
-static uint32_t count_mask[4] = {0x3FFF,     0x3FFF,     0x3FFF,     0xFFFF};
+static uint32_t const src_mask[4]   = {0x07FFFFFF, 0x0FFFFFFF, 0x0FFFFFFF, 0x0FFFFFFF};
+static uint32_t const dst_mask[4]   = {0x07FFFFFF, 0x07FFFFFF, 0x07FFFFFF, 0x0FFFFFFF};
+static uint32_t const count_mask[4] = {0x3FFF,     0x3FFF,     0x3FFF,     0xFFFF};
 
 void
 mem_io_dma_ctl_write8(
@@ -76,6 +77,284 @@ mem_io_dma_ctl_write8(
     }
 }
 
+/*
+** Return true if the units of a transfer going from `first` to `last` are all in memory
+** mapped by `pages`, which means they can be accessed without any side effect.
+*/
+static
+bool
+dma_is_plain(
+    struct mem_page const *pages,
+    int64_t first,
+    int64_t last,
+    uint32_t unit_size
+) {
+    int64_t lo;
+    int64_t hi;
+    int64_t page;
+
+    lo = min(first, last);
+    hi = max(first, last) + unit_size - 1;
+
+    // The whole range must stay within a single region
+    if (lo < 0 || hi >= MEM_PAGE_TABLE_END || (lo >> 24) != (hi >> 24)) {
+        return (false);
+    }
+
+    for (page = lo >> MEM_PAGE_SHIFT; page <= (hi >> MEM_PAGE_SHIFT); ++page) {
+        if (!pages[page].data) {
+            return (false);
+        }
+    }
+    return (true);
+}
+
+/*
+** Return the amount of bytes, starting at `addr`, that are contiguous in the host memory
+** backing `page`.
+*/
+static
+uint32_t
+dma_contiguous_size(
+    struct mem_page const *page,
+    uint32_t addr
+) {
+    uint32_t mirror;
+
+    // The size of the region's mirrors, `mask` being the size of the region minus one.
+    // It wraps to 0 for the pages of the mirror view, whose mirrors are contiguous, leaving only the page's limit.
+    mirror = (page->mask + 1) & ~page->mask;
+    return (min(MEM_PAGE_SIZE - (addr & MEM_PAGE_MASK), mirror - (addr & (mirror - 1))));
+}
+
+/*
+** Invalidate the cached code and mark as dirty the `size` bytes written to `page` at `addr`.
+*/
+static
+void
+dma_notify_write(
+    struct gba *gba,
+    struct mem_page const *page,
+    uint32_t addr,
+    uint32_t size
+) {
+    uint32_t offset;
+
+    offset = addr & page->mask;
+
+    if (page->cache_base != CORE_CACHE_NO_PAGE) {
+        uint32_t cache_page;
+
+        for (cache_page = offset >> CORE_CACHE_PAGE_SHIFT; cache_page <= ((offset + size - 1) >> CORE_CACHE_PAGE_SHIFT); ++cache_page) {
+            core_cache_notify_write(gba, page->cache_base + cache_page);
+        }
+    }
+
+    if (page->dirty_base != MEM_DIRTY_NO_BLOCK) {
+        mem_dirty_mark_range(gba, page->dirty_base, offset, size);
+    }
+}
+
+/*
+** Return the cycles taken by the first `count` units of a transfer from `src`, whose cost
+** is `per_unit` cycles plus `nonseq` for those doing a non-sequential access to the ROM.
+**
+** Within the ROM, the first access is non-sequential, and so are all the accesses crossing
+** a 128KiB boundary (see `mem_access()`).
+*/
+static
+uint64_t
+dma_units_cycles(
+    uint32_t src,
+    int32_t src_step,
+    uint32_t count,
+    uint32_t per_unit,
+    uint32_t nonseq,
+    bool first_nonseq
+) {
+    int64_t last;
+    uint64_t boundaries;
+
+    if (!nonseq) {
+        return ((uint64_t)count * per_unit);
+    }
+
+    last = (int64_t)src + (int64_t)src_step * (count - 1);
+
+    if (src_step > 0) {
+        boundaries = (last >> 17) - (((int64_t)src - 1) >> 17);
+    } else if (src_step < 0) {
+        boundaries = (src >> 17) - ((last - 1) >> 17);
+    } else {
+        boundaries = !(src & 0x1FFFF) * count;
+    }
+
+    // The first access can't be non-sequential twice
+    boundaries += (first_nonseq && (src & 0x1FFFF));
+
+    return ((uint64_t)count * per_unit + boundaries * nonseq);
+}
+
+/*
+** Move, in one go, as many units of the transfer as possible before the next scheduler event,
+** if both their source and destination are plain memory (see `mem_update_page_table()`).
+**
+** The result is the same than going through the loop of `dma_run_channel()`, which is left
+** with the unit reaching the next event, or with the whole transfer if it touches anything else.
+**
+** Return true if any unit was moved.
+*/
+static
+bool
+dma_run_channel_fast(
+    struct gba *gba,
+    struct dma_channel *channel,
+    int32_t unit_size,
+    int32_t src_step,
+    int32_t dst_step,
+    bool *rom_accessed
+) {
+    uint32_t (*access_time)[16];
+    uint32_t src_region;
+    uint32_t dst_region;
+    uint32_t per_unit;
+    uint32_t nonseq;
+    uint64_t available;
+    uint64_t cycles;
+    bool first_nonseq;
+    int64_t src_last;
+    int64_t dst_last;
+    uint32_t count;
+    uint32_t src;
+    uint32_t dst;
+
+#ifdef WITH_DEBUGGER
+    if (gba->debugger.watchpoints.len) {
+        return (false);
+    }
+#endif
+
+    src = channel->internal_src;
+    dst = channel->internal_dst;
+
+    if (src < EWRAM_START || src >= MEM_PAGE_TABLE_END || dst >= MEM_PAGE_TABLE_END) {
+        return (false);
+    }
+
+    if (gba->scheduler.next_event <= gba->scheduler.cycles + 1) {
+        return (false);
+    }
+
+    // The last event must be processed by the slow path, so stop strictly before it.
+    available = gba->scheduler.next_event - gba->scheduler.cycles - 1;
+
+    access_time = (unit_size == 4) ? gba->memory.access_time32 : gba->memory.access_time16;
+    src_region = (src >> 24) & 0xF;
+    dst_region = (dst >> 24) & 0xF;
+
+    per_unit = access_time[SEQUENTIAL][src_region] + access_time[SEQUENTIAL][dst_region];
+    nonseq = 0;
+    first_nonseq = false;
+    if (src_region >= CART_REGION_START && src_region <= CART_REGION_END) {
+        nonseq = access_time[NON_SEQUENTIAL][src_region] - access_time[SEQUENTIAL][src_region];
+        first_nonseq = !*rom_accessed;
+    }
+
+    count = min(channel->internal_count, available / per_unit);
+    while (count) {
+        cycles = dma_units_cycles(src, src_step, count, per_unit, nonseq, first_nonseq);
+        if (cycles <= available) {
+            break;
+        }
+        count -= min(count, max((cycles - available) / per_unit, 1u));
+    }
+
+    if (!count) {
+        return (false);
+    }
+
+    src_last = (int64_t)src + (int64_t)src_step * (count - 1);
+    dst_last = (int64_t)dst + (int64_t)dst_step * (count - 1);
+
+    if (
+           !dma_is_plain(gba->memory_pages.read, src, src_last, unit_size)
+        || !dma_is_plain(gba->memory_pages.write, dst, dst_last, unit_size)
+    ) {
+        return (false);
+    }
+
+    if (src_step == unit_size && dst_step == unit_size && src_region != dst_region) {
+        struct mem_page const *page;
+        uint32_t size;
+
+        // Both sides are contiguous and can't overlap: copy them in chunks.
+        size = count * unit_size;
+        while (size) {
+            struct mem_page const *src_page;
+            struct mem_page const *dst_page;
+            uint32_t len;
+
+            src_page = &gba->memory_pages.read[src >> MEM_PAGE_SHIFT];
+            dst_page = &gba->memory_pages.write[dst >> MEM_PAGE_SHIFT];
+            len = min(size, min(dma_contiguous_size(src_page, src), dma_contiguous_size(dst_page, dst)));
+
+            memcpy(dst_page->data + (dst & dst_page->mask), src_page->data + (src & src_page->mask), len);
+            dma_notify_write(gba, dst_page, dst, len);
+
+            src += len;
+            dst += len;
+            size -= len;
+        }
+
+        page = &gba->memory_pages.read[src_last >> MEM_PAGE_SHIFT];
+        if (unit_size == 4) {
+            channel->latch = *(uint32_t *)(page->data + (src_last & page->mask));
+        } else {
+            channel->latch = *(uint16_t *)(page->data + (src_last & page->mask));
+            channel->latch |= channel->latch << 16;
+        }
+    } else {
+        uint32_t i;
+
+        // Strided or overlapping copy, unit by unit.
+        for (i = 0; i < count; ++i) {
+            struct mem_page const *src_page;
+            struct mem_page const *dst_page;
+
+            src_page = &gba->memory_pages.read[src >> MEM_PAGE_SHIFT];
+            dst_page = &gba->memory_pages.write[dst >> MEM_PAGE_SHIFT];
+
+            if (unit_size == 4) {
+                channel->latch = *(uint32_t *)(src_page->data + (src & src_page->mask));
+                *(uint32_t *)(dst_page->data + (dst & dst_page->mask)) = channel->latch;
+            } else {
+                channel->latch = *(uint16_t *)(src_page->data + (src & src_page->mask));
+                channel->latch |= channel->latch << 16;
+                *(uint16_t *)(dst_page->data + (dst & dst_page->mask)) = (uint16_t)channel->latch;
+            }
+            dma_notify_write(gba, dst_page, dst, unit_size);
+
+            src += src_step;
+            dst += dst_step;
+        }
+    }
+
+    channel->internal_src = src_last + src_step;
+    channel->internal_dst = dst_last + dst_step;
+    channel->internal_count -= count;
+
+    // The destination is never the ROM, so only the source can be the first access to it
+    *rom_accessed |= (src_region >= CART_REGION_START);
+
+    gba->memory.dma_bus = channel->latch;
+    gba->memory.was_last_access_from_dma = true;
+    gba->memory.gamepak_bus_in_use = false;
+
+    // Doesn't reach the next event, so it has no other effect than moving the clock forward.
+    core_idle_for(gba, cycles);
+    return (true);
+}
+
 /*
 ** Run a single DMA transfer.
 */
@@ -130,6 +409,11 @@ dma_run_channel(
 
     while (channel->internal_count > 0 && !gba->core.reenter_dma_transfer_loop) {
 
+        // Move the units that don't need to go through the slow path below in one go
+        if (dma_run_channel_fast(gba, channel, unit_size, src_step, dst_step, &rom_accessed)) {
+            continue;
+        }
+
         /*
         ** Trial and error have led me to believe that the only the first ROM access
         ** will be non-sequential, no matter if it is the source or destination address.
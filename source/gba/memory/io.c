@@ -7,6 +7,7 @@
 **
 \******************************************************************************/
 
+#include <stddef.h>
 #include <string.h>
 #include "memory.h"
 #include "gba/gba.h"
@@ -155,673 +156,819 @@ mem_io_reg_name(
 };
 
 /*
-** Read the value contained in the corresponding IO register.
+** A half-word of the IO memory.
+**
+** Most registers are plain storage: a read returns the bits of `read_mask` and a write replaces
+** the bits of `write_mask`, the other bits of a written byte being cleared. Bytes whose bits are
+** all out of `write_mask` are left untouched.
+**
+** Registers with side effects have a `write` handler, called after the plain write (if any).
+** Registers that aren't stored as-is in `struct io` have a `read` handler replacing the plain read.
+**
+** Half-words that aren't readable and have no `read` handler return the open bus.
 */
-uint8_t
-mem_io_read8(
-    struct gba const *gba,
-    uint32_t addr
+struct io_register {
+    uint16_t offset;            // Offset of the register within `struct io`
+    bool readable;
+    uint16_t read_mask;
+    uint16_t write_mask;
+    uint16_t (*read)(struct gba const *gba, uint32_t addr);
+    void (*write)(struct gba *gba, uint32_t addr, uint16_t val, uint16_t lanes);
+};
+
+static inline
+uint16_t
+io_load(
+    struct io const *io,
+    uint16_t offset
 ) {
-    struct io const *io;
+    uint16_t val;
 
-    logln(HS_IO, "IO read to register %s (%#08x)", mem_io_reg_name(addr), addr);
+    memcpy(&val, (uint8_t const *)io + offset, sizeof(val));
+    return (val);
+}
+
+/*
+** Replace the bits of `mask` of the half-word at `offset` by those of `val`.
+*/
+static inline
+void
+io_store(
+    struct io *io,
+    uint16_t offset,
+    uint16_t val,
+    uint16_t mask
+) {
+    uint16_t old;
+
+    old = io_load(io, offset);
+    val = (old & ~mask) | (val & mask);
+    memcpy((uint8_t *)io + offset, &val, sizeof(val));
+}
+
+/*
+** Return the mask of the bytes of a half-word that have at least one bit set in `mask`.
+*/
+static inline
+uint16_t
+io_lanes(
+    uint16_t mask
+) {
+    return ((mask & 0x00FF ? 0x00FF : 0x0000) | (mask & 0xFF00 ? 0xFF00 : 0x0000));
+}
+
+/* Video */
+
+static
+void
+io_write_bg_affine_ref(
+    struct gba *gba,
+    uint32_t addr __unused,
+    uint16_t val __unused,
+    uint16_t lanes __unused
+) {
+    gba->ppu.reload_internal_affine_regs = true;
+}
+
+/* Sound */
+
+static
+void
+io_write_sound1cnt_h(
+    struct gba *gba,
+    uint32_t addr __unused,
+    uint16_t val __unused,
+    uint16_t lanes
+) {
+    // Enveloppe set to decrease mode with a volume of 0 mutes the channel
+    if ((lanes & 0xFF00) && !gba->io.sound1cnt_h.envelope_direction && !gba->io.sound1cnt_h.envelope_initial_volume) {
+        apu_tone_and_sweep_stop(gba);
+    }
+}
+
+static
+void
+io_write_sound1cnt_x(
+    struct gba *gba,
+    uint32_t addr __unused,
+    uint16_t val __unused,
+    uint16_t lanes
+) {
+    struct io *io;
+
+    if (!(lanes & 0xFF00)) {
+        return ;
+    }
 
     io = &gba->io;
-    switch (addr) {
 
-        /* Display */
-        case IO_REG_DISPCNT:                return (io->dispcnt.bytes[0]);
-        case IO_REG_DISPCNT + 1:            return (io->dispcnt.bytes[1]);
-        case IO_REG_GREENSWP:               return (io->greenswp.bytes[0]);
-        case IO_REG_GREENSWP + 1:           return (io->greenswp.bytes[1]);
-        case IO_REG_DISPSTAT:               return (io->dispstat.bytes[0]);
-        case IO_REG_DISPSTAT + 1:           return (io->dispstat.bytes[1]);
-        case IO_REG_VCOUNT:                 return (io->vcount.bytes[0]);
-        case IO_REG_VCOUNT + 1:             return (io->vcount.bytes[1]);
-        case IO_REG_BG0CNT:                 return (io->bgcnt[0].bytes[0]);
-        case IO_REG_BG0CNT + 1:             return (io->bgcnt[0].bytes[1]);
-        case IO_REG_BG1CNT:                 return (io->bgcnt[1].bytes[0]);
-        case IO_REG_BG1CNT + 1:             return (io->bgcnt[1].bytes[1]);
-        case IO_REG_BG2CNT:                 return (io->bgcnt[2].bytes[0]);
-        case IO_REG_BG2CNT + 1:             return (io->bgcnt[2].bytes[1]);
-        case IO_REG_BG3CNT:                 return (io->bgcnt[3].bytes[0]);
-        case IO_REG_BG3CNT + 1:             return (io->bgcnt[3].bytes[1]);
-        case IO_REG_WININ:                  return (io->winin.bytes[0]);
-        case IO_REG_WININ + 1:              return (io->winin.bytes[1]);
-        case IO_REG_WINOUT:                 return (io->winout.bytes[0]);
-        case IO_REG_WINOUT + 1:             return (io->winout.bytes[1]);
-        case IO_REG_BLDCNT:                 return (io->bldcnt.bytes[0]);
-        case IO_REG_BLDCNT + 1:             return (io->bldcnt.bytes[1]);
-        case IO_REG_BLDALPHA:               return (io->bldalpha.bytes[0]);
-        case IO_REG_BLDALPHA + 1:           return (io->bldalpha.bytes[1]);
-
-        /* Sound */
-        case IO_REG_SOUND1CNT_L:            return (io->sound1cnt_l.bytes[0]);
-        case IO_REG_SOUND1CNT_L + 1:        return (io->sound1cnt_l.bytes[1]);
-        case IO_REG_SOUND1CNT_H:            return (io->sound1cnt_h.bytes[0] & 0xC0);
-        case IO_REG_SOUND1CNT_H + 1:        return (io->sound1cnt_h.bytes[1]);
-        case IO_REG_SOUND1CNT_X:            return (0);
-        case IO_REG_SOUND1CNT_X + 1:        return (io->sound1cnt_x.bytes[1] & 0x40);
-        case IO_REG_SOUND1CNT_X + 2:        return (0);
-        case IO_REG_SOUND1CNT_X + 3:        return (0);
-        case IO_REG_SOUND2CNT_L:            return (io->sound2cnt_l.bytes[0] & 0xC0);
-        case IO_REG_SOUND2CNT_L + 1:        return (io->sound2cnt_l.bytes[1]);
-        case IO_REG_SOUND2CNT_L + 2:        return (0);
-        case IO_REG_SOUND2CNT_L + 3:        return (0);
-        case IO_REG_SOUND2CNT_H:            return (0);
-        case IO_REG_SOUND2CNT_H + 1:        return (io->sound2cnt_h.bytes[1] & 0x40);
-        case IO_REG_SOUND2CNT_H + 2:        return (0);
-        case IO_REG_SOUND2CNT_H + 3:        return (0);
-        case IO_REG_SOUND3CNT_L:            return (io->sound3cnt_l.bytes[0] & 0xE0);
-        case IO_REG_SOUND3CNT_L + 1:        return (0);
-        case IO_REG_SOUND3CNT_H:            return (0);
-        case IO_REG_SOUND3CNT_H + 1:        return (io->sound3cnt_h.bytes[1] & 0xE0);
-        case IO_REG_SOUND3CNT_X:            return (0);
-        case IO_REG_SOUND3CNT_X + 1:        return (io->sound3cnt_x.bytes[1] & 0x40);
-        case IO_REG_SOUND3CNT_X + 2:
-        case IO_REG_SOUND3CNT_X + 3:        return (0);
-        case IO_REG_SOUND4CNT_L:            return (0);
-        case IO_REG_SOUND4CNT_L + 1:        return (io->sound4cnt_l.bytes[1]);
-        case IO_REG_SOUND4CNT_L + 2:        return (0);
-        case IO_REG_SOUND4CNT_L + 3:        return (0);
-        case IO_REG_SOUND4CNT_H:            return (io->sound4cnt_h.bytes[0]);
-        case IO_REG_SOUND4CNT_H + 1:        return (io->sound4cnt_h.bytes[1] & 0x40);
-        case IO_REG_SOUND4CNT_H + 2:        return (0);
-        case IO_REG_SOUND4CNT_H + 3:        return (0);
-        case IO_REG_SOUNDCNT_L:             return (io->soundcnt_l.bytes[0]);
-        case IO_REG_SOUNDCNT_L + 1:         return (io->soundcnt_l.bytes[1]);
-        case IO_REG_SOUNDCNT_H:             return (io->soundcnt_h.bytes[0]);
-        case IO_REG_SOUNDCNT_H + 1:         return (io->soundcnt_h.bytes[1]);
-        case IO_REG_SOUNDCNT_X:             return (io->soundcnt_x.bytes[0] & 0x8F);
-        case IO_REG_SOUNDCNT_X + 1:
-        case IO_REG_SOUNDCNT_X + 2:
-        case IO_REG_SOUNDCNT_X + 3:         return (0);
-        case IO_REG_SOUNDBIAS:              return (io->soundbias.bytes[0]);
-        case IO_REG_SOUNDBIAS + 1:          return (io->soundbias.bytes[1]);
-        case IO_REG_SOUNDBIAS + 2:
-        case IO_REG_SOUNDBIAS + 3:          return (0);
-        case IO_REG_WAVE_RAM0 + 0:
-        case IO_REG_WAVE_RAM0 + 1:
-        case IO_REG_WAVE_RAM0 + 2:
-        case IO_REG_WAVE_RAM0 + 3:
-        case IO_REG_WAVE_RAM1 + 0:
-        case IO_REG_WAVE_RAM1 + 1:
-        case IO_REG_WAVE_RAM1 + 2:
-        case IO_REG_WAVE_RAM1 + 3:
-        case IO_REG_WAVE_RAM2 + 0:
-        case IO_REG_WAVE_RAM2 + 1:
-        case IO_REG_WAVE_RAM2 + 2:
-        case IO_REG_WAVE_RAM2 + 3:
-        case IO_REG_WAVE_RAM3 + 0:
-        case IO_REG_WAVE_RAM3 + 1:
-        case IO_REG_WAVE_RAM3 + 2:
-        case IO_REG_WAVE_RAM3 + 3:          return (io->waveram[!io->sound3cnt_l.bank_select][addr - IO_REG_WAVE_RAM0]);
-
-        /* DMA */
-        case IO_REG_DMA0CNT:
-        case IO_REG_DMA0CNT + 1:            return (0);
-        case IO_REG_DMA0CTL:                return (io->dma[0].control.bytes[0]);
-        case IO_REG_DMA0CTL + 1:            return (io->dma[0].control.bytes[1]);
-        case IO_REG_DMA1CNT:
-        case IO_REG_DMA1CNT + 1:            return (0);
-        case IO_REG_DMA1CTL:                return (io->dma[1].control.bytes[0]);
-        case IO_REG_DMA1CTL + 1:            return (io->dma[1].control.bytes[1]);
-        case IO_REG_DMA2CNT:
-        case IO_REG_DMA2CNT + 1:            return (0);
-        case IO_REG_DMA2CTL:                return (io->dma[2].control.bytes[0]);
-        case IO_REG_DMA2CTL + 1:            return (io->dma[2].control.bytes[1]);
-        case IO_REG_DMA3CNT:
-        case IO_REG_DMA3CNT + 1:            return (0);
-        case IO_REG_DMA3CTL:                return (io->dma[3].control.bytes[0]);
-        case IO_REG_DMA3CTL + 1:            return (io->dma[3].control.bytes[1]);
-
-        /* Timer 0 */
-        case IO_REG_TM0CNT_LO:
-        case IO_REG_TM0CNT_LO + 1: {
-            uint16_t val;
+    /*
+    ** Only the frequency (and not the shadow frequency) is updated on register writes.
+    ** Reference:
+    **   - https://gbdev.gg8.se/wiki/articles/Gameboy_sound_hardware#Frequency_Sweep
+    */
+    gba->apu.tone_and_sweep.sweep.frequency = io->sound1cnt_x.sample_rate;
 
-            val = timer_read_value(gba, 0);
-            return (val >> (8 * (addr - IO_REG_TM0CNT_LO)));
-        };
-        case IO_REG_TM0CNT_HI:              return (io->timers[0].control.bytes[0]);
-        case IO_REG_TM0CNT_HI + 1:          return (0);
+    if (io->sound1cnt_x.reset) {
+        apu_tone_and_sweep_reset(gba);
+    }
+    io->sound1cnt_x.reset = false;
+}
 
-        /* Timer 1 */
-        case IO_REG_TM1CNT_LO:
-        case IO_REG_TM1CNT_LO + 1: {
-            uint16_t val;
+static
+void
+io_write_sound2cnt_l(
+    struct gba *gba,
+    uint32_t addr __unused,
+    uint16_t val __unused,
+    uint16_t lanes
+) {
+    // Enveloppe set to decrease mode with a volume of 0 mutes the channel
+    if ((lanes & 0xFF00) && !gba->io.sound2cnt_l.envelope_direction && !gba->io.sound2cnt_l.envelope_initial_volume) {
+        apu_tone_stop(gba);
+    }
+}
 
-            val = timer_read_value(gba, 1);
-            return (val >> (8 * (addr - IO_REG_TM1CNT_LO)));
-        };
-        case IO_REG_TM1CNT_HI:              return (io->timers[1].control.bytes[0]);
-        case IO_REG_TM1CNT_HI + 1:          return (0);
+static
+void
+io_write_sound2cnt_h(
+    struct gba *gba,
+    uint32_t addr __unused,
+    uint16_t val __unused,
+    uint16_t lanes
+) {
+    if (!(lanes & 0xFF00)) {
+        return ;
+    }
 
-        /* Timer 2 */
-        case IO_REG_TM2CNT_LO:
-        case IO_REG_TM2CNT_LO + 1: {
-            uint16_t val;
+    if (gba->io.sound2cnt_h.reset) {
+        apu_tone_reset(gba);
+    }
+    gba->io.sound2cnt_h.reset = false;
+}
 
-            val = timer_read_value(gba, 2);
-            return (val >> (8 * (addr - IO_REG_TM2CNT_LO)));
-        };
-        case IO_REG_TM2CNT_HI:              return (io->timers[2].control.bytes[0]);
-        case IO_REG_TM2CNT_HI + 1:          return (0);
+static
+void
+io_write_sound3cnt_l(
+    struct gba *gba,
+    uint32_t addr __unused,
+    uint16_t val __unused,
+    uint16_t lanes
+) {
+    if ((lanes & 0x00FF) && !gba->io.sound3cnt_l.enable) {
+        apu_wave_stop(gba);
+    }
+}
 
-        /* Timer 3 */
-        case IO_REG_TM3CNT_LO:
-        case IO_REG_TM3CNT_LO + 1: {
-            uint16_t val;
+static
+void
+io_write_sound3cnt_x(
+    struct gba *gba,
+    uint32_t addr __unused,
+    uint16_t val __unused,
+    uint16_t lanes
+) {
+    if (!(lanes & 0xFF00)) {
+        return ;
+    }
 
-            val = timer_read_value(gba, 3);
-            return (val >> (8 * (addr - IO_REG_TM3CNT_LO)));
-        };
-        case IO_REG_TM3CNT_HI:              return (io->timers[3].control.bytes[0]);
-        case IO_REG_TM3CNT_HI + 1:          return (0);
-
-        /* Key Input */
-        case IO_REG_KEYINPUT:               return (io->keyinput.bytes[0]);
-        case IO_REG_KEYINPUT + 1:           return (io->keyinput.bytes[1]);
-        case IO_REG_KEYCNT:                 return (io->keycnt.bytes[0]);
-        case IO_REG_KEYCNT + 1:             return (io->keycnt.bytes[1]);
-
-        /* Serial communication */
-        case IO_REG_SIOCNT:                 return (io->siocnt.bytes[0]);
-        case IO_REG_SIOCNT + 1:             return (io->siocnt.bytes[1]);
-        case IO_REG_RCNT:                   return (io->rcnt.bytes[0]);
-        case IO_REG_RCNT + 1:               return (io->rcnt.bytes[1]);
-        case IO_REG_IR:                     return (0);
-        case IO_REG_IR + 1:                 return (0);
-        case IO_REG_UNKNOWN_1:              return (0);
-        case IO_REG_UNKNOWN_1 + 1:          return (0);
-        case IO_REG_UNKNOWN_2:              return (0);
-        case IO_REG_UNKNOWN_2 + 1:          return (0);
-
-        /* Interrupts */
-        case IO_REG_IE:                     return (io->int_enabled.bytes[0]);
-        case IO_REG_IE + 1:                 return (io->int_enabled.bytes[1]);
-        case IO_REG_IF:                     return (io->int_flag.bytes[0]);
-        case IO_REG_IF + 1:                 return (io->int_flag.bytes[1]);
-        case IO_REG_WAITCNT:                return (io->waitcnt.bytes[0]);
-        case IO_REG_WAITCNT + 1:            return (io->waitcnt.bytes[1]);
-        case IO_REG_WAITCNT + 2:
-        case IO_REG_WAITCNT + 3:            return (0);
-        case IO_REG_IME:                    return (io->ime.bytes[0]);
-        case IO_REG_IME + 1:
-        case IO_REG_IME + 2:
-        case IO_REG_IME + 3:                return (0);
-        case IO_REG_UNKNOWN_3:              return (0);
-        case IO_REG_UNKNOWN_3 + 1:          return (0);
-
-        /* System */
-        case IO_REG_POSTFLG:                return (io->postflg);
-    }
-    return (mem_openbus_read(gba, addr));
+    if (gba->io.sound3cnt_l.enable && gba->io.sound3cnt_x.reset) {
+        apu_wave_reset(gba);
+    }
+    gba->io.sound3cnt_x.reset = false;
+}
+
+static
+void
+io_write_sound4cnt_l(
+    struct gba *gba,
+    uint32_t addr __unused,
+    uint16_t val __unused,
+    uint16_t lanes
+) {
+    // Enveloppe set to decrease mode with a volume of 0 mutes the channel
+    if ((lanes & 0xFF00) && !gba->io.sound4cnt_l.envelope_direction && !gba->io.sound4cnt_l.envelope_initial_volume) {
+        apu_tone_and_sweep_stop(gba);
+    }
+}
+
+static
+void
+io_write_sound4cnt_h(
+    struct gba *gba,
+    uint32_t addr __unused,
+    uint16_t val __unused,
+    uint16_t lanes
+) {
+    if (!(lanes & 0xFF00)) {
+        return ;
+    }
+
+    if (gba->io.sound4cnt_h.reset) {
+        apu_noise_reset(gba);
+    }
+    gba->io.sound4cnt_h.reset = false;
+}
+
+static
+void
+io_write_soundcnt_h(
+    struct gba *gba,
+    uint32_t addr __unused,
+    uint16_t val __unused,
+    uint16_t lanes
+) {
+    struct io *io;
+
+    if (!(lanes & 0xFF00)) {
+        return ;
+    }
+
+    io = &gba->io;
+
+    if (io->soundcnt_h.reset_fifo_a) {
+        apu_reset_fifo(gba, FIFO_A);
+        io->soundcnt_h.reset_fifo_a = false;
+    }
+
+    if (io->soundcnt_h.reset_fifo_b) {
+        apu_reset_fifo(gba, FIFO_B);
+        io->soundcnt_h.reset_fifo_b = false;
+    }
+}
+
+static
+void
+io_write_soundcnt_x(
+    struct gba *gba,
+    uint32_t addr __unused,
+    uint16_t val,
+    uint16_t lanes
+) {
+    struct io *io;
+    uint16_t old_master;
+
+    if (!(lanes & 0x00FF)) {
+        return ;
+    }
+
+    io = &gba->io;
+    old_master = io->soundcnt_x.bytes[0] & 0x80;
+    io->soundcnt_x.bytes[0] = val & 0x80;
+
+    if (old_master && !io->soundcnt_x.master_enable) {
+        apu_reset_fifo(gba, 0);
+        apu_reset_fifo(gba, 1);
+        apu_wave_stop(gba);
+
+        /*
+        ** Registers 0x4000060 to 0x4000081 are reset.
+        */
+
+        io->sound3cnt_l.raw = 0;
+        io->sound3cnt_h.raw = 0;
+        io->sound3cnt_x.raw = 0;
+    }
 }
 
 /*
-** Write the given value to the corresponding IO register.
+** The CPU accesses the bank of the wave RAM that isn't played.
 */
+static
+uint16_t
+io_read_waveram(
+    struct gba const *gba,
+    uint32_t addr
+) {
+    uint8_t const *bank;
+    uint16_t val;
+
+    bank = gba->io.waveram[!gba->io.sound3cnt_l.bank_select];
+    memcpy(&val, bank + (addr - IO_REG_WAVE_RAM0), sizeof(val));
+    return (val);
+}
+
+static
 void
-mem_io_write8(
+io_write_waveram(
     struct gba *gba,
     uint32_t addr,
-    uint8_t val
+    uint16_t val,
+    uint16_t lanes
+) {
+    uint8_t *bank;
+
+    bank = gba->io.waveram[!gba->io.sound3cnt_l.bank_select];
+    if (lanes & 0x00FF) {
+        bank[addr - IO_REG_WAVE_RAM0] = (uint8_t)val;
+    }
+    if (lanes & 0xFF00) {
+        bank[addr - IO_REG_WAVE_RAM0 + 1] = (uint8_t)(val >> 8);
+    }
+}
+
+static
+void
+io_write_fifo(
+    struct gba *gba,
+    uint32_t addr,
+    uint16_t val,
+    uint16_t lanes
+) {
+    enum fifo_idx fifo_idx;
+
+    fifo_idx = addr < IO_REG_FIFO_B_L ? FIFO_A : FIFO_B;
+    if (lanes & 0x00FF) {
+        apu_fifo_write8(gba, fifo_idx, (uint8_t)val);
+    }
+    if (lanes & 0xFF00) {
+        apu_fifo_write8(gba, fifo_idx, (uint8_t)(val >> 8));
+    }
+}
+
+/* DMA */
+
+static
+void
+io_write_dma_ctl(
+    struct gba *gba,
+    uint32_t addr,
+    uint16_t val,
+    uint16_t lanes
+) {
+    if (lanes & 0xFF00) {
+        mem_io_dma_ctl_write8(gba, &gba->io.dma[(addr - IO_REG_DMA0CTL) / 12], val >> 8);
+    }
+}
+
+/* Timers */
+
+static
+uint16_t
+io_read_timer_counter(
+    struct gba const *gba,
+    uint32_t addr
+) {
+    return (timer_read_value(gba, (addr - IO_REG_TM0CNT_LO) / 4));
+}
+
+static
+void
+io_write_timer_reload(
+    struct gba *gba,
+    uint32_t addr,
+    uint16_t val,
+    uint16_t lanes
+) {
+    uint16_t *reload;
+
+    reload = &gba->io.pending.timers[(addr - IO_REG_TM0CNT_LO) / 4].reload.raw;
+    *reload = (*reload & ~lanes) | (val & lanes);
+    io_schedule_register_delayed_write(gba, addr);
+}
+
+static
+void
+io_write_timer_control(
+    struct gba *gba,
+    uint32_t addr,
+    uint16_t val,
+    uint16_t lanes
+) {
+    if (lanes & 0x00FF) {
+        gba->io.pending.timers[(addr - IO_REG_TM0CNT_HI) / 4].control.bytes[0] = (uint8_t)val;
+        io_schedule_register_delayed_write(gba, addr);
+    }
+}
+
+/* Serial communication */
+
+static
+void
+io_write_siocnt(
+    struct gba *gba,
+    uint32_t addr __unused,
+    uint16_t val __unused,
+    uint16_t lanes __unused
+) {
+    /* Stub */
+    if (gba->io.siocnt.start && gba->io.siocnt.irq) {
+        core_schedule_irq(gba, IRQ_SERIAL);
+    }
+
+    gba->io.siocnt.start = false;
+}
+
+/* Keypad input */
+
+static
+void
+io_write_keycnt(
+    struct gba *gba,
+    uint32_t addr __unused,
+    uint16_t val,
+    uint16_t lanes
 ) {
     struct io *io;
+    bool old_cond;
+    uint32_t old_mask;
 
-    logln(HS_IO, "IO write to register %s (%#08x) (%#02x)", mem_io_reg_name(addr), addr, val);
+    io = &gba->io;
+    old_mask = io->keycnt.mask;
+    old_cond = io_evaluate_keypad_cond(gba);
+    io->keycnt.raw = (io->keycnt.raw & ~lanes) | (val & lanes);
+
+    if (   (!old_cond && io_evaluate_keypad_cond(gba))  // Trigger an IRQ if the keypad condition switches to true.
+        || (((old_mask ^ io->keycnt.mask) & io->keycnt.mask))  // Trigger an IRQ on a new mask that extends the current one
+    ) {
+        io_scan_keypad_irq(gba);
+    }
+}
+
+/* Interrupts */
+
+static
+void
+io_write_ie(
+    struct gba *gba,
+    uint32_t addr __unused,
+    uint16_t val,
+    uint16_t lanes
+) {
+    struct io *io;
 
     io = &gba->io;
-    switch (addr) {
+    io->pending.int_enabled.raw = (io->pending.int_enabled.raw & ~lanes) | (val & lanes);
+    io->pending.int_enabled.raw &= 0x3FFF;
+    io_schedule_register_delayed_write(gba, IO_REG_IE);
+}
 
-        /* Display */
-        case IO_REG_DISPCNT:                io->dispcnt.bytes[0] = val; break;
-        case IO_REG_DISPCNT + 1:            io->dispcnt.bytes[1] = val; break;
-        case IO_REG_GREENSWP:               io->greenswp.bytes[0] = val; break;
-        case IO_REG_GREENSWP + 1:           io->greenswp.bytes[1] = val; break;
-        case IO_REG_DISPSTAT:               io->dispstat.bytes[0] = val; break;
-        case IO_REG_DISPSTAT + 1:           io->dispstat.bytes[1] = val; break;
-        case IO_REG_BG0CNT:                 io->bgcnt[0].bytes[0] = val; break;
-        case IO_REG_BG0CNT + 1:             io->bgcnt[0].bytes[1] = val & 0xDF; break;
-        case IO_REG_BG1CNT:                 io->bgcnt[1].bytes[0] = val; break;
-        case IO_REG_BG1CNT + 1:             io->bgcnt[1].bytes[1] = val & 0xDF; break;
-        case IO_REG_BG2CNT:                 io->bgcnt[2].bytes[0] = val; break;
-        case IO_REG_BG2CNT + 1:             io->bgcnt[2].bytes[1] = val; break;
-        case IO_REG_BG3CNT:                 io->bgcnt[3].bytes[0] = val; break;
-        case IO_REG_BG3CNT + 1:             io->bgcnt[3].bytes[1] = val; break;
-        case IO_REG_BG0HOFS:                io->bg_hoffset[0].bytes[0] = val; break;
-        case IO_REG_BG0HOFS + 1:            io->bg_hoffset[0].bytes[1] = val & 0x1; break;
-        case IO_REG_BG0VOFS:                io->bg_voffset[0].bytes[0] = val; break;
-        case IO_REG_BG0VOFS + 1:            io->bg_voffset[0].bytes[1] = val & 0x1; break;
-        case IO_REG_BG1HOFS:                io->bg_hoffset[1].bytes[0] = val; break;
-        case IO_REG_BG1HOFS + 1:            io->bg_hoffset[1].bytes[1] = val & 0x1; break;
-        case IO_REG_BG1VOFS:                io->bg_voffset[1].bytes[0] = val; break;
-        case IO_REG_BG1VOFS + 1:            io->bg_voffset[1].bytes[1] = val & 0x1; break;
-        case IO_REG_BG2HOFS:                io->bg_hoffset[2].bytes[0] = val; break;
-        case IO_REG_BG2HOFS + 1:            io->bg_hoffset[2].bytes[1] = val & 0x1; break;
-        case IO_REG_BG2VOFS:                io->bg_voffset[2].bytes[0] = val; break;
-        case IO_REG_BG2VOFS + 1:            io->bg_voffset[2].bytes[1] = val & 0x1; break;
-        case IO_REG_BG3HOFS:                io->bg_hoffset[3].bytes[0] = val; break;
-        case IO_REG_BG3HOFS + 1:            io->bg_hoffset[3].bytes[1] = val & 0x1; break;
-        case IO_REG_BG3VOFS:                io->bg_voffset[3].bytes[0] = val; break;
-        case IO_REG_BG3VOFS + 1:            io->bg_voffset[3].bytes[1] = val & 0x1; break;
-
-        /* Video - Affine Background */
-        case IO_REG_BG2PA:                  io->bg_pa[0].bytes[0] = val; break;
-        case IO_REG_BG2PA + 1:              io->bg_pa[0].bytes[1] = val; break;
-        case IO_REG_BG2PB:                  io->bg_pb[0].bytes[0] = val; break;
-        case IO_REG_BG2PB + 1:              io->bg_pb[0].bytes[1] = val; break;
-        case IO_REG_BG2PC:                  io->bg_pc[0].bytes[0] = val; break;
-        case IO_REG_BG2PC + 1:              io->bg_pc[0].bytes[1] = val; break;
-        case IO_REG_BG2PD:                  io->bg_pd[0].bytes[0] = val; break;
-        case IO_REG_BG2PD + 1:              io->bg_pd[0].bytes[1] = val; break;
-        case IO_REG_BG2X:                   io->bg_x[0].bytes[0] = val; gba->ppu.reload_internal_affine_regs = true; break;
-        case IO_REG_BG2X + 1:               io->bg_x[0].bytes[1] = val; gba->ppu.reload_internal_affine_regs = true; break;
-        case IO_REG_BG2X + 2:               io->bg_x[0].bytes[2] = val; gba->ppu.reload_internal_affine_regs = true; break;
-        case IO_REG_BG2X + 3:               io->bg_x[0].bytes[3] = val; gba->ppu.reload_internal_affine_regs = true; break;
-        case IO_REG_BG2Y:                   io->bg_y[0].bytes[0] = val; gba->ppu.reload_internal_affine_regs = true; break;
-        case IO_REG_BG2Y + 1:               io->bg_y[0].bytes[1] = val; gba->ppu.reload_internal_affine_regs = true; break;
-        case IO_REG_BG2Y + 2:               io->bg_y[0].bytes[2] = val; gba->ppu.reload_internal_affine_regs = true; break;
-        case IO_REG_BG2Y + 3:               io->bg_y[0].bytes[3] = val; gba->ppu.reload_internal_affine_regs = true; break;
-        case IO_REG_BG3PA:                  io->bg_pa[1].bytes[0] = val; break;
-        case IO_REG_BG3PA + 1:              io->bg_pa[1].bytes[1] = val; break;
-        case IO_REG_BG3PB:                  io->bg_pb[1].bytes[0] = val; break;
-        case IO_REG_BG3PB + 1:              io->bg_pb[1].bytes[1] = val; break;
-        case IO_REG_BG3PC:                  io->bg_pc[1].bytes[0] = val; break;
-        case IO_REG_BG3PC + 1:              io->bg_pc[1].bytes[1] = val; break;
-        case IO_REG_BG3PD:                  io->bg_pd[1].bytes[0] = val; break;
-        case IO_REG_BG3PD + 1:              io->bg_pd[1].bytes[1] = val; break;
-        case IO_REG_BG3X:                   io->bg_x[1].bytes[0] = val; gba->ppu.reload_internal_affine_regs = true; break;
-        case IO_REG_BG3X + 1:               io->bg_x[1].bytes[1] = val; gba->ppu.reload_internal_affine_regs = true; break;
-        case IO_REG_BG3X + 2:               io->bg_x[1].bytes[2] = val; gba->ppu.reload_internal_affine_regs = true; break;
-        case IO_REG_BG3X + 3:               io->bg_x[1].bytes[3] = val; gba->ppu.reload_internal_affine_regs = true; break;
-        case IO_REG_BG3Y:                   io->bg_y[1].bytes[0] = val; gba->ppu.reload_internal_affine_regs = true; break;
-        case IO_REG_BG3Y + 1:               io->bg_y[1].bytes[1] = val; gba->ppu.reload_internal_affine_regs = true; break;
-        case IO_REG_BG3Y + 2:               io->bg_y[1].bytes[2] = val; gba->ppu.reload_internal_affine_regs = true; break;
-        case IO_REG_BG3Y + 3:               io->bg_y[1].bytes[3] = val; gba->ppu.reload_internal_affine_regs = true; break;
-
-        /* Video - Windows */
-        case IO_REG_WIN0H:                  io->winh[0].bytes[0] = val; break;
-        case IO_REG_WIN0H + 1:              io->winh[0].bytes[1] = val; break;
-        case IO_REG_WIN1H:                  io->winh[1].bytes[0] = val; break;
-        case IO_REG_WIN1H + 1:              io->winh[1].bytes[1] = val; break;
-        case IO_REG_WIN0V:                  io->winv[0].bytes[0] = val; break;
-        case IO_REG_WIN0V + 1:              io->winv[0].bytes[1] = val; break;
-        case IO_REG_WIN1V:                  io->winv[1].bytes[0] = val; break;
-        case IO_REG_WIN1V + 1:              io->winv[1].bytes[1] = val; break;
-        case IO_REG_WININ:                  io->winin.bytes[0] = val & 0x3F; break;
-        case IO_REG_WININ + 1:              io->winin.bytes[1] = val & 0x3F; break;
-        case IO_REG_WINOUT:                 io->winout.bytes[0] = val & 0x3F; break;
-        case IO_REG_WINOUT + 1:             io->winout.bytes[1] = val & 0x3F; break;
-
-        /* Video - Mosaic */
-        case IO_REG_MOSAIC:                 io->mosaic.bytes[0] = val; break;
-        case IO_REG_MOSAIC + 1:             io->mosaic.bytes[1] = val; break;
-
-        /* Video - Effects */
-        case IO_REG_BLDCNT:                 io->bldcnt.bytes[0] = val; break;
-        case IO_REG_BLDCNT + 1:             io->bldcnt.bytes[1] = val & 0x3F; break;
-        case IO_REG_BLDALPHA:               io->bldalpha.bytes[0] = val & 0x1F; break;
-        case IO_REG_BLDALPHA + 1:           io->bldalpha.bytes[1] = val & 0x1F; break;
-        case IO_REG_BLDY:                   io->bldy.bytes[0] = val; break;
-        case IO_REG_BLDY + 1:               io->bldy.bytes[1] = val; break;
-
-        /* Sound */
-        case IO_REG_SOUND1CNT_L:            io->sound1cnt_l.bytes[0] = val & 0x7F; break;
-        case IO_REG_SOUND1CNT_H:            io->sound1cnt_h.bytes[0] = val; break;
-        case IO_REG_SOUND1CNT_H + 1: {
-            io->sound1cnt_h.bytes[1] = val;
-
-            // Enveloppe set to decrease mode with a volume of 0 mutes the channel
-            if (!gba->io.sound1cnt_h.envelope_direction && !gba->io.sound1cnt_h.envelope_initial_volume) {
-                apu_tone_and_sweep_stop(gba);
-            }
+static
+void
+io_write_if(
+    struct gba *gba,
+    uint32_t addr __unused,
+    uint16_t val,
+    uint16_t lanes
+) {
+    gba->io.pending.int_flag.raw &= ~(val & lanes);
+    io_schedule_register_delayed_write(gba, IO_REG_IF);
+}
 
-            break;
-        };
-        case IO_REG_SOUND1CNT_X:            io->sound1cnt_x.bytes[0] = val; break;
-        case IO_REG_SOUND1CNT_X + 1: {
-            io->sound1cnt_x.bytes[1] = val;
-
-            /*
-            ** Only the frequency (and not the shadow frequency) is updated on register writes.
-            ** Reference:
-            **   - https://gbdev.gg8.se/wiki/articles/Gameboy_sound_hardware#Frequency_Sweep
-            */
-            gba->apu.tone_and_sweep.sweep.frequency = io->sound1cnt_x.sample_rate;
-
-            if (io->sound1cnt_x.reset) {
-                apu_tone_and_sweep_reset(gba);
-            }
-            io->sound1cnt_x.reset = false;
-            break;
-        };
-        case IO_REG_SOUND2CNT_L:            io->sound2cnt_l.bytes[0] = val; break;
-        case IO_REG_SOUND2CNT_L + 1: {
-            io->sound2cnt_l.bytes[1] = val;
+static
+void
+io_write_waitcnt(
+    struct gba *gba,
+    uint32_t addr __unused,
+    uint16_t val __unused,
+    uint16_t lanes __unused
+) {
+    bool old_pbuffer_enabled;
 
-            // Enveloppe set to decrease mode with a volume of 0 mutes the channel
-            if (!gba->io.sound2cnt_l.envelope_direction && !gba->io.sound2cnt_l.envelope_initial_volume) {
-                apu_tone_stop(gba);
-            }
+    old_pbuffer_enabled = gba->memory.pbuffer.enabled;
 
-            break;
-        };
-        case IO_REG_SOUND2CNT_H:            io->sound2cnt_h.bytes[0] = val; break;
-        case IO_REG_SOUND2CNT_H + 1: {
-            io->sound2cnt_h.bytes[1] = val;
-            if (io->sound2cnt_h.reset) {
-                apu_tone_reset(gba);
-            }
-            io->sound2cnt_h.reset = false;
-            break;
-        };
-        case IO_REG_SOUND3CNT_L: {
-            io->sound3cnt_l.bytes[0] = val;
-            if (!io->sound3cnt_l.enable) {
-                apu_wave_stop(gba);
-            }
-        };
-        case IO_REG_SOUND3CNT_L + 1:        io->sound3cnt_l.bytes[1] = val; break;
-        case IO_REG_SOUND3CNT_H:            io->sound3cnt_h.bytes[0] = val; break;
-        case IO_REG_SOUND3CNT_H + 1:        io->sound3cnt_h.bytes[1] = val; break;
-        case IO_REG_SOUND3CNT_X:            io->sound3cnt_x.bytes[0] = val; break;
-        case IO_REG_SOUND3CNT_X + 1: {
-            io->sound3cnt_x.bytes[1] = val;
-            if (io->sound3cnt_l.enable && io->sound3cnt_x.reset) {
-                apu_wave_reset(gba);
-            }
-            io->sound3cnt_x.reset = false;
-            break;
-        };
-        case IO_REG_SOUND4CNT_L:            io->sound4cnt_l.bytes[0] = val; break;
-        case IO_REG_SOUND4CNT_L + 1: {
-            io->sound4cnt_l.bytes[1] = val;
+    if (old_pbuffer_enabled ^ gba->io.waitcnt.gamepak_prefetch) {
+        memset(&gba->memory.pbuffer, 0, sizeof(struct prefetch_buffer));
+    }
 
-            // Enveloppe set to decrease mode with a volume of 0 mutes the channel
-            if (!gba->io.sound4cnt_l.envelope_direction && !gba->io.sound4cnt_l.envelope_initial_volume) {
-                apu_tone_and_sweep_stop(gba);
-            }
+    gba->memory.pbuffer.enabled = gba->settings.prefetch_buffer && gba->io.waitcnt.gamepak_prefetch;
 
-            break;
-        };
-        case IO_REG_SOUND4CNT_H:            io->sound4cnt_h.bytes[0] = val; break;
-        case IO_REG_SOUND4CNT_H + 1: {
-            io->sound4cnt_h.bytes[1] = val;
-            if (io->sound4cnt_h.reset) {
-                apu_noise_reset(gba);
-            }
-            io->sound4cnt_h.reset = false;
-            break;
-        };
-        case IO_REG_SOUNDCNT_L:             io->soundcnt_l.bytes[0] = val & 0x77; break;
-        case IO_REG_SOUNDCNT_L + 1:         io->soundcnt_l.bytes[1] = val; break;
-        case IO_REG_SOUNDCNT_H:             io->soundcnt_h.bytes[0] = val & 0x0F; break;
-        case IO_REG_SOUNDCNT_H + 1: {
-            io->soundcnt_h.bytes[1] = val;
-
-            if (io->soundcnt_h.reset_fifo_a) {
-                apu_reset_fifo(gba, FIFO_A);
-                io->soundcnt_h.reset_fifo_a = false;
-            }
+    mem_update_waitstates(gba);
+}
 
-            if (io->soundcnt_h.reset_fifo_b) {
-                apu_reset_fifo(gba, FIFO_B);
-                io->soundcnt_h.reset_fifo_b = false;
-            }
+static
+void
+io_write_ime(
+    struct gba *gba,
+    uint32_t addr __unused,
+    uint16_t val,
+    uint16_t lanes
+) {
+    struct io *io;
 
-            break;
-        };
-        case IO_REG_SOUNDCNT_X: {
-            uint16_t old_master;
+    io = &gba->io;
+    io->pending.ime.raw = (io->pending.ime.raw & ~lanes) | (val & lanes);
+    io_schedule_register_delayed_write(gba, IO_REG_IME);
+}
 
-            old_master = io->soundcnt_x.bytes[0] & 0x80;
-            io->soundcnt_x.bytes[0] = val & 0x80;
+/* System */
 
-            if (old_master && !io->soundcnt_x.master_enable) {
-                apu_reset_fifo(gba, 0);
-                apu_reset_fifo(gba, 1);
-                apu_wave_stop(gba);
+/*
+** POSTFLG and HALTCNT share the same half-word, but HALTCNT is write-only.
+*/
+static
+uint16_t
+io_read_postflg(
+    struct gba const *gba,
+    uint32_t addr
+) {
+    return ((mem_openbus_read(gba, addr) & 0xFF00) | gba->io.postflg);
+}
 
-                /*
-                ** Registers 0x4000060 to 0x4000081 are reset.
-                */
+static
+void
+io_write_postflg(
+    struct gba *gba,
+    uint32_t addr __unused,
+    uint16_t val,
+    uint16_t lanes
+) {
+    if (lanes & 0x00FF) {
+        gba->io.postflg = (uint8_t)val;
+    }
 
-                io->sound3cnt_l.raw = 0;
-                io->sound3cnt_h.raw = 0;
-                io->sound3cnt_x.raw = 0;
-            }
-            break;
-        };
-        case IO_REG_SOUNDBIAS:              io->soundbias.bytes[0] = val; break;
-        case IO_REG_SOUNDBIAS + 1:          io->soundbias.bytes[1] = val; break;
-        case IO_REG_SOUNDBIAS + 2:          io->soundbias.bytes[2] = val; break;
-        case IO_REG_SOUNDBIAS + 3:          io->soundbias.bytes[3] = val; break;
-        case IO_REG_WAVE_RAM0 + 0:
-        case IO_REG_WAVE_RAM0 + 1:
-        case IO_REG_WAVE_RAM0 + 2:
-        case IO_REG_WAVE_RAM0 + 3:
-        case IO_REG_WAVE_RAM1 + 0:
-        case IO_REG_WAVE_RAM1 + 1:
-        case IO_REG_WAVE_RAM1 + 2:
-        case IO_REG_WAVE_RAM1 + 3:
-        case IO_REG_WAVE_RAM2 + 0:
-        case IO_REG_WAVE_RAM2 + 1:
-        case IO_REG_WAVE_RAM2 + 2:
-        case IO_REG_WAVE_RAM2 + 3:
-        case IO_REG_WAVE_RAM3 + 0:
-        case IO_REG_WAVE_RAM3 + 1:
-        case IO_REG_WAVE_RAM3 + 2:
-        case IO_REG_WAVE_RAM3 + 3: {
-            io->waveram[!io->sound3cnt_l.bank_select][addr - IO_REG_WAVE_RAM0] = val;
-            break;
-        };
-        case IO_REG_FIFO_A_L + 0:
-        case IO_REG_FIFO_A_L + 1:
-        case IO_REG_FIFO_A_H + 0:
-        case IO_REG_FIFO_A_H + 1: {
-            apu_fifo_write8(gba, FIFO_A, val);
-            break;
-        };
-        case IO_REG_FIFO_B_L + 0:
-        case IO_REG_FIFO_B_L + 1:
-        case IO_REG_FIFO_B_H + 0:
-        case IO_REG_FIFO_B_H + 1: {
-            apu_fifo_write8(gba, FIFO_B, val);
-            break;
-        };
+    if (lanes & 0xFF00) {
+        gba->core.state = (val >> 15) + 1;
+        if (gba->core.state == CORE_STOP) {
+            ppu_render_black_screen(gba);
+        }
+    }
+}
 
-        /* DMA - Channel 0 */
-        case IO_REG_DMA0SAD:                io->dma[0].src.bytes[0] = val; break;
-        case IO_REG_DMA0SAD + 1:            io->dma[0].src.bytes[1] = val; break;
-        case IO_REG_DMA0SAD + 2:            io->dma[0].src.bytes[2] = val; break;
-        case IO_REG_DMA0SAD + 3:            io->dma[0].src.bytes[3] = val; break;
-        case IO_REG_DMA0DAD:                io->dma[0].dst.bytes[0] = val; break;
-        case IO_REG_DMA0DAD + 1:            io->dma[0].dst.bytes[1] = val; break;
-        case IO_REG_DMA0DAD + 2:            io->dma[0].dst.bytes[2] = val; break;
-        case IO_REG_DMA0DAD + 3:            io->dma[0].dst.bytes[3] = val; break;
-        case IO_REG_DMA0CNT:                io->dma[0].count.bytes[0] = val; break;
-        case IO_REG_DMA0CNT + 1:            io->dma[0].count.bytes[1] = val; break;
-        case IO_REG_DMA0CTL:                io->dma[0].control.bytes[0] = val & 0xE0; break;
-        case IO_REG_DMA0CTL + 1:            mem_io_dma_ctl_write8(gba, &io->dma[0], val); break;
-
-        /* DMA - Channel 1 */
-        case IO_REG_DMA1SAD:                io->dma[1].src.bytes[0] = val; break;
-        case IO_REG_DMA1SAD + 1:            io->dma[1].src.bytes[1] = val; break;
-        case IO_REG_DMA1SAD + 2:            io->dma[1].src.bytes[2] = val; break;
-        case IO_REG_DMA1SAD + 3:            io->dma[1].src.bytes[3] = val; break;
-        case IO_REG_DMA1DAD:                io->dma[1].dst.bytes[0] = val; break;
-        case IO_REG_DMA1DAD + 1:            io->dma[1].dst.bytes[1] = val; break;
-        case IO_REG_DMA1DAD + 2:            io->dma[1].dst.bytes[2] = val; break;
-        case IO_REG_DMA1DAD + 3:            io->dma[1].dst.bytes[3] = val; break;
-        case IO_REG_DMA1CNT:                io->dma[1].count.bytes[0] = val; break;
-        case IO_REG_DMA1CNT + 1:            io->dma[1].count.bytes[1] = val; break;
-        case IO_REG_DMA1CTL:                io->dma[1].control.bytes[0] = val & 0xE0; break;
-        case IO_REG_DMA1CTL + 1:            mem_io_dma_ctl_write8(gba, &io->dma[1], val); break;
-
-        /* DMA - Channel 2 */
-        case IO_REG_DMA2SAD:                io->dma[2].src.bytes[0] = val; break;
-        case IO_REG_DMA2SAD + 1:            io->dma[2].src.bytes[1] = val; break;
-        case IO_REG_DMA2SAD + 2:            io->dma[2].src.bytes[2] = val; break;
-        case IO_REG_DMA2SAD + 3:            io->dma[2].src.bytes[3] = val; break;
-        case IO_REG_DMA2DAD:                io->dma[2].dst.bytes[0] = val; break;
-        case IO_REG_DMA2DAD + 1:            io->dma[2].dst.bytes[1] = val; break;
-        case IO_REG_DMA2DAD + 2:            io->dma[2].dst.bytes[2] = val; break;
-        case IO_REG_DMA2DAD + 3:            io->dma[2].dst.bytes[3] = val; break;
-        case IO_REG_DMA2CNT:                io->dma[2].count.bytes[0] = val; break;
-        case IO_REG_DMA2CNT + 1:            io->dma[2].count.bytes[1] = val; break;
-        case IO_REG_DMA2CTL:                io->dma[2].control.bytes[0] = val & 0xE0; break;
-        case IO_REG_DMA2CTL + 1:            mem_io_dma_ctl_write8(gba, &io->dma[2], val); break;
-
-        /* DMA - Channel 3 */
-        case IO_REG_DMA3SAD:                io->dma[3].src.bytes[0] = val; break;
-        case IO_REG_DMA3SAD + 1:            io->dma[3].src.bytes[1] = val; break;
-        case IO_REG_DMA3SAD + 2:            io->dma[3].src.bytes[2] = val; break;
-        case IO_REG_DMA3SAD + 3:            io->dma[3].src.bytes[3] = val; break;
-        case IO_REG_DMA3DAD:                io->dma[3].dst.bytes[0] = val; break;
-        case IO_REG_DMA3DAD + 1:            io->dma[3].dst.bytes[1] = val; break;
-        case IO_REG_DMA3DAD + 2:            io->dma[3].dst.bytes[2] = val; break;
-        case IO_REG_DMA3DAD + 3:            io->dma[3].dst.bytes[3] = val; break;
-        case IO_REG_DMA3CNT:                io->dma[3].count.bytes[0] = val; break;
-        case IO_REG_DMA3CNT + 1:            io->dma[3].count.bytes[1] = val; break;
-        case IO_REG_DMA3CTL:                io->dma[3].control.bytes[0] = val & 0xE0; break;
-        case IO_REG_DMA3CTL + 1:            mem_io_dma_ctl_write8(gba, &io->dma[3], val); break;
-
-        /* Timer 0 */
-        case IO_REG_TM0CNT_LO:
-        case IO_REG_TM0CNT_LO + 1: {
-            io->pending.timers[0].reload.bytes[addr - IO_REG_TM0CNT_LO] = val;
-            io_schedule_register_delayed_write(gba, IO_REG_TM0CNT_LO);
-            break;
-        };
-        case IO_REG_TM0CNT_HI: {
-            io->pending.timers[0].control.bytes[0] = val;
-            io_schedule_register_delayed_write(gba, IO_REG_TM0CNT_HI);
-            break;
-        };
+#define IO_REG(addr)        [((addr) - IO_REG_START) >> 1]
+#define IO_OFFSET(field)    offsetof(struct io, field)
 
-        /* Timer 1 */
-        case IO_REG_TM1CNT_LO:
-        case IO_REG_TM1CNT_LO + 1: {
-            io->pending.timers[1].reload.bytes[addr - IO_REG_TM1CNT_LO] = val;
-            io_schedule_register_delayed_write(gba, IO_REG_TM1CNT_LO);
-            break;
-        };
-        case IO_REG_TM1CNT_HI: {
-            io->pending.timers[1].control.bytes[0] = val;
-            io_schedule_register_delayed_write(gba, IO_REG_TM1CNT_HI);
-            break;
-        };
+/*
+** The IO registers, indexed by half-word.
+**
+** Columns: offset in `struct io`, readable, read mask, write mask, read handler, write handler.
+*/
+static struct io_register const io_registers[IO_SIZE >> 1] = {
+
+    /* Display */
+    IO_REG(IO_REG_DISPCNT)      = { IO_OFFSET(dispcnt),             true,  0xFFFF, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_GREENSWP)     = { IO_OFFSET(greenswp),            true,  0xFFFF, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_DISPSTAT)     = { IO_OFFSET(dispstat),            true,  0xFFFF, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_VCOUNT)       = { IO_OFFSET(vcount),              true,  0xFFFF, 0x0000, NULL, NULL },
+    IO_REG(IO_REG_BG0CNT)       = { IO_OFFSET(bgcnt[0]),            true,  0xFFFF, 0xDFFF, NULL, NULL },
+    IO_REG(IO_REG_BG1CNT)       = { IO_OFFSET(bgcnt[1]),            true,  0xFFFF, 0xDFFF, NULL, NULL },
+    IO_REG(IO_REG_BG2CNT)       = { IO_OFFSET(bgcnt[2]),            true,  0xFFFF, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_BG3CNT)       = { IO_OFFSET(bgcnt[3]),            true,  0xFFFF, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_BG0HOFS)      = { IO_OFFSET(bg_hoffset[0]),       false, 0x0000, 0x01FF, NULL, NULL },
+    IO_REG(IO_REG_BG0VOFS)      = { IO_OFFSET(bg_voffset[0]),       false, 0x0000, 0x01FF, NULL, NULL },
+    IO_REG(IO_REG_BG1HOFS)      = { IO_OFFSET(bg_hoffset[1]),       false, 0x0000, 0x01FF, NULL, NULL },
+    IO_REG(IO_REG_BG1VOFS)      = { IO_OFFSET(bg_voffset[1]),       false, 0x0000, 0x01FF, NULL, NULL },
+    IO_REG(IO_REG_BG2HOFS)      = { IO_OFFSET(bg_hoffset[2]),       false, 0x0000, 0x01FF, NULL, NULL },
+    IO_REG(IO_REG_BG2VOFS)      = { IO_OFFSET(bg_voffset[2]),       false, 0x0000, 0x01FF, NULL, NULL },
+    IO_REG(IO_REG_BG3HOFS)      = { IO_OFFSET(bg_hoffset[3]),       false, 0x0000, 0x01FF, NULL, NULL },
+    IO_REG(IO_REG_BG3VOFS)      = { IO_OFFSET(bg_voffset[3]),       false, 0x0000, 0x01FF, NULL, NULL },
+
+    /* Display - Affine Background */
+    IO_REG(IO_REG_BG2PA)        = { IO_OFFSET(bg_pa[0]),            false, 0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_BG2PB)        = { IO_OFFSET(bg_pb[0]),            false, 0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_BG2PC)        = { IO_OFFSET(bg_pc[0]),            false, 0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_BG2PD)        = { IO_OFFSET(bg_pd[0]),            false, 0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_BG2X_L)       = { IO_OFFSET(bg_x[0]),             false, 0x0000, 0xFFFF, NULL, io_write_bg_affine_ref },
+    IO_REG(IO_REG_BG2X_H)       = { IO_OFFSET(bg_x[0]) + 2,         false, 0x0000, 0xFFFF, NULL, io_write_bg_affine_ref },
+    IO_REG(IO_REG_BG2Y_L)       = { IO_OFFSET(bg_y[0]),             false, 0x0000, 0xFFFF, NULL, io_write_bg_affine_ref },
+    IO_REG(IO_REG_BG2Y_H)       = { IO_OFFSET(bg_y[0]) + 2,         false, 0x0000, 0xFFFF, NULL, io_write_bg_affine_ref },
+    IO_REG(IO_REG_BG3PA)        = { IO_OFFSET(bg_pa[1]),            false, 0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_BG3PB)        = { IO_OFFSET(bg_pb[1]),            false, 0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_BG3PC)        = { IO_OFFSET(bg_pc[1]),            false, 0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_BG3PD)        = { IO_OFFSET(bg_pd[1]),            false, 0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_BG3X_L)       = { IO_OFFSET(bg_x[1]),             false, 0x0000, 0xFFFF, NULL, io_write_bg_affine_ref },
+    IO_REG(IO_REG_BG3X_H)       = { IO_OFFSET(bg_x[1]) + 2,         false, 0x0000, 0xFFFF, NULL, io_write_bg_affine_ref },
+    IO_REG(IO_REG_BG3Y_L)       = { IO_OFFSET(bg_y[1]),             false, 0x0000, 0xFFFF, NULL, io_write_bg_affine_ref },
+    IO_REG(IO_REG_BG3Y_H)       = { IO_OFFSET(bg_y[1]) + 2,         false, 0x0000, 0xFFFF, NULL, io_write_bg_affine_ref },
+
+    /* Display - Windows, Mosaic & Effects */
+    IO_REG(IO_REG_WIN0H)        = { IO_OFFSET(winh[0]),             false, 0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_WIN1H)        = { IO_OFFSET(winh[1]),             false, 0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_WIN0V)        = { IO_OFFSET(winv[0]),             false, 0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_WIN1V)        = { IO_OFFSET(winv[1]),             false, 0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_WININ)        = { IO_OFFSET(winin),               true,  0xFFFF, 0x3F3F, NULL, NULL },
+    IO_REG(IO_REG_WINOUT)       = { IO_OFFSET(winout),              true,  0xFFFF, 0x3F3F, NULL, NULL },
+    IO_REG(IO_REG_MOSAIC)       = { IO_OFFSET(mosaic),              false, 0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_BLDCNT)       = { IO_OFFSET(bldcnt),              true,  0xFFFF, 0x3FFF, NULL, NULL },
+    IO_REG(IO_REG_BLDALPHA)     = { IO_OFFSET(bldalpha),            true,  0xFFFF, 0x1F1F, NULL, NULL },
+    IO_REG(IO_REG_BLDY)         = { IO_OFFSET(bldy),                false, 0x0000, 0xFFFF, NULL, NULL },
+
+    /* Sound */
+    IO_REG(IO_REG_SOUND1CNT_L)      = { IO_OFFSET(sound1cnt_l),     true,  0xFFFF, 0x007F, NULL, NULL },
+    IO_REG(IO_REG_SOUND1CNT_H)      = { IO_OFFSET(sound1cnt_h),     true,  0xFFC0, 0xFFFF, NULL, io_write_sound1cnt_h },
+    IO_REG(IO_REG_SOUND1CNT_X)      = { IO_OFFSET(sound1cnt_x),     true,  0x4000, 0xFFFF, NULL, io_write_sound1cnt_x },
+    IO_REG(IO_REG_SOUND1CNT_X + 2)  = { 0,                          true,  0x0000, 0x0000, NULL, NULL },
+    IO_REG(IO_REG_SOUND2CNT_L)      = { IO_OFFSET(sound2cnt_l),     true,  0xFFC0, 0xFFFF, NULL, io_write_sound2cnt_l },
+    IO_REG(IO_REG_SOUND2CNT_L + 2)  = { 0,                          true,  0x0000, 0x0000, NULL, NULL },
+    IO_REG(IO_REG_SOUND2CNT_H)      = { IO_OFFSET(sound2cnt_h),     true,  0x4000, 0xFFFF, NULL, io_write_sound2cnt_h },
+    IO_REG(IO_REG_SOUND2CNT_H + 2)  = { 0,                          true,  0x0000, 0x0000, NULL, NULL },
+    IO_REG(IO_REG_SOUND3CNT_L)      = { IO_OFFSET(sound3cnt_l),     true,  0x00E0, 0xFFFF, NULL, io_write_sound3cnt_l },
+    IO_REG(IO_REG_SOUND3CNT_H)      = { IO_OFFSET(sound3cnt_h),     true,  0xE000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_SOUND3CNT_X)      = { IO_OFFSET(sound3cnt_x),     true,  0x4000, 0xFFFF, NULL, io_write_sound3cnt_x },
+    IO_REG(IO_REG_SOUND3CNT_X + 2)  = { 0,                          true,  0x0000, 0x0000, NULL, NULL },
+    IO_REG(IO_REG_SOUND4CNT_L)      = { IO_OFFSET(sound4cnt_l),     true,  0xFF00, 0xFFFF, NULL, io_write_sound4cnt_l },
+    IO_REG(IO_REG_SOUND4CNT_L + 2)  = { 0,                          true,  0x0000, 0x0000, NULL, NULL },
+    IO_REG(IO_REG_SOUND4CNT_H)      = { IO_OFFSET(sound4cnt_h),     true,  0x40FF, 0xFFFF, NULL, io_write_sound4cnt_h },
+    IO_REG(IO_REG_SOUND4CNT_H + 2)  = { 0,                          true,  0x0000, 0x0000, NULL, NULL },
+    IO_REG(IO_REG_SOUNDCNT_L)       = { IO_OFFSET(soundcnt_l),      true,  0xFFFF, 0xFF77, NULL, NULL },
+    IO_REG(IO_REG_SOUNDCNT_H)       = { IO_OFFSET(soundcnt_h),      true,  0xFFFF, 0xFF0F, NULL, io_write_soundcnt_h },
+    IO_REG(IO_REG_SOUNDCNT_X)       = { IO_OFFSET(soundcnt_x),      true,  0x008F, 0x0000, NULL, io_write_soundcnt_x },
+    IO_REG(IO_REG_SOUNDCNT_X + 2)   = { 0,                          true,  0x0000, 0x0000, NULL, NULL },
+    IO_REG(IO_REG_SOUNDBIAS)        = { IO_OFFSET(soundbias),       true,  0xFFFF, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_SOUNDBIAS + 2)    = { IO_OFFSET(soundbias) + 2,   true,  0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_WAVE_RAM0)        = { 0,                          true,  0x0000, 0x0000, io_read_waveram, io_write_waveram },
+    IO_REG(IO_REG_WAVE_RAM0 + 2)    = { 0,                          true,  0x0000, 0x0000, io_read_waveram, io_write_waveram },
+    IO_REG(IO_REG_WAVE_RAM1)        = { 0,                          true,  0x0000, 0x0000, io_read_waveram, io_write_waveram },
+    IO_REG(IO_REG_WAVE_RAM1 + 2)    = { 0,                          true,  0x0000, 0x0000, io_read_waveram, io_write_waveram },
+    IO_REG(IO_REG_WAVE_RAM2)        = { 0,                          true,  0x0000, 0x0000, io_read_waveram, io_write_waveram },
+    IO_REG(IO_REG_WAVE_RAM2 + 2)    = { 0,                          true,  0x0000, 0x0000, io_read_waveram, io_write_waveram },
+    IO_REG(IO_REG_WAVE_RAM3)        = { 0,                          true,  0x0000, 0x0000, io_read_waveram, io_write_waveram },
+    IO_REG(IO_REG_WAVE_RAM3 + 2)    = { 0,                          true,  0x0000, 0x0000, io_read_waveram, io_write_waveram },
+    IO_REG(IO_REG_FIFO_A_L)         = { 0,                          false, 0x0000, 0x0000, NULL, io_write_fifo },
+    IO_REG(IO_REG_FIFO_A_H)         = { 0,                          false, 0x0000, 0x0000, NULL, io_write_fifo },
+    IO_REG(IO_REG_FIFO_B_L)         = { 0,                          false, 0x0000, 0x0000, NULL, io_write_fifo },
+    IO_REG(IO_REG_FIFO_B_H)         = { 0,                          false, 0x0000, 0x0000, NULL, io_write_fifo },
+
+    /* DMA - Channel 0 */
+    IO_REG(IO_REG_DMA0SAD_LO)   = { IO_OFFSET(dma[0].src),          false, 0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_DMA0SAD_HI)   = { IO_OFFSET(dma[0].src) + 2,      false, 0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_DMA0DAD_LO)   = { IO_OFFSET(dma[0].dst),          false, 0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_DMA0DAD_HI)   = { IO_OFFSET(dma[0].dst) + 2,      false, 0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_DMA0CNT)      = { IO_OFFSET(dma[0].count),        true,  0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_DMA0CTL)      = { IO_OFFSET(dma[0].control),      true,  0xFFFF, 0x00E0, NULL, io_write_dma_ctl },
+
+    /* DMA - Channel 1 */
+    IO_REG(IO_REG_DMA1SAD_LO)   = { IO_OFFSET(dma[1].src),          false, 0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_DMA1SAD_HI)   = { IO_OFFSET(dma[1].src) + 2,      false, 0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_DMA1DAD_LO)   = { IO_OFFSET(dma[1].dst),          false, 0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_DMA1DAD_HI)   = { IO_OFFSET(dma[1].dst) + 2,      false, 0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_DMA1CNT)      = { IO_OFFSET(dma[1].count),        true,  0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_DMA1CTL)      = { IO_OFFSET(dma[1].control),      true,  0xFFFF, 0x00E0, NULL, io_write_dma_ctl },
+
+    /* DMA - Channel 2 */
+    IO_REG(IO_REG_DMA2SAD_LO)   = { IO_OFFSET(dma[2].src),          false, 0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_DMA2SAD_HI)   = { IO_OFFSET(dma[2].src) + 2,      false, 0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_DMA2DAD_LO)   = { IO_OFFSET(dma[2].dst),          false, 0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_DMA2DAD_HI)   = { IO_OFFSET(dma[2].dst) + 2,      false, 0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_DMA2CNT)      = { IO_OFFSET(dma[2].count),        true,  0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_DMA2CTL)      = { IO_OFFSET(dma[2].control),      true,  0xFFFF, 0x00E0, NULL, io_write_dma_ctl },
+
+    /* DMA - Channel 3 */
+    IO_REG(IO_REG_DMA3SAD_LO)   = { IO_OFFSET(dma[3].src),          false, 0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_DMA3SAD_HI)   = { IO_OFFSET(dma[3].src) + 2,      false, 0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_DMA3DAD_LO)   = { IO_OFFSET(dma[3].dst),          false, 0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_DMA3DAD_HI)   = { IO_OFFSET(dma[3].dst) + 2,      false, 0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_DMA3CNT)      = { IO_OFFSET(dma[3].count),        true,  0x0000, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_DMA3CTL)      = { IO_OFFSET(dma[3].control),      true,  0xFFFF, 0x00E0, NULL, io_write_dma_ctl },
+
+    /* Timers */
+    IO_REG(IO_REG_TM0CNT_LO)    = { 0,                              true,  0x0000, 0x0000, io_read_timer_counter, io_write_timer_reload },
+    IO_REG(IO_REG_TM0CNT_HI)    = { IO_OFFSET(timers[0].control),   true,  0x00FF, 0x0000, NULL, io_write_timer_control },
+    IO_REG(IO_REG_TM1CNT_LO)    = { 0,                              true,  0x0000, 0x0000, io_read_timer_counter, io_write_timer_reload },
+    IO_REG(IO_REG_TM1CNT_HI)    = { IO_OFFSET(timers[1].control),   true,  0x00FF, 0x0000, NULL, io_write_timer_control },
+    IO_REG(IO_REG_TM2CNT_LO)    = { 0,                              true,  0x0000, 0x0000, io_read_timer_counter, io_write_timer_reload },
+    IO_REG(IO_REG_TM2CNT_HI)    = { IO_OFFSET(timers[2].control),   true,  0x00FF, 0x0000, NULL, io_write_timer_control },
+    IO_REG(IO_REG_TM3CNT_LO)    = { 0,                              true,  0x0000, 0x0000, io_read_timer_counter, io_write_timer_reload },
+    IO_REG(IO_REG_TM3CNT_HI)    = { IO_OFFSET(timers[3].control),   true,  0x00FF, 0x0000, NULL, io_write_timer_control },
+
+    /* Serial communication */
+    IO_REG(IO_REG_SIOCNT)       = { IO_OFFSET(siocnt),              true,  0xFFFF, 0xFFFF, NULL, io_write_siocnt },
+    IO_REG(IO_REG_RCNT)         = { IO_OFFSET(rcnt),                true,  0xFFFF, 0xFFFF, NULL, NULL },
+    IO_REG(IO_REG_IR)           = { 0,                              true,  0x0000, 0x0000, NULL, NULL },
+    IO_REG(IO_REG_UNKNOWN_1)    = { 0,                              true,  0x0000, 0x0000, NULL, NULL },
+    IO_REG(IO_REG_UNKNOWN_2)    = { 0,                              true,  0x0000, 0x0000, NULL, NULL },
+
+    /* Keypad input */
+    IO_REG(IO_REG_KEYINPUT)     = { IO_OFFSET(keyinput),            true,  0xFFFF, 0x0000, NULL, NULL },
+    IO_REG(IO_REG_KEYCNT)       = { IO_OFFSET(keycnt),              true,  0xFFFF, 0x0000, NULL, io_write_keycnt },
+
+    /* Interrupts */
+    IO_REG(IO_REG_IE)           = { IO_OFFSET(int_enabled),         true,  0xFFFF, 0x0000, NULL, io_write_ie },
+    IO_REG(IO_REG_IF)           = { IO_OFFSET(int_flag),            true,  0xFFFF, 0x0000, NULL, io_write_if },
+    IO_REG(IO_REG_WAITCNT)      = { IO_OFFSET(waitcnt),             true,  0xFFFF, 0xFFFF, NULL, io_write_waitcnt },
+    IO_REG(IO_REG_WAITCNT + 2)  = { 0,                              true,  0x0000, 0x0000, NULL, NULL },
+    IO_REG(IO_REG_IME)          = { IO_OFFSET(ime),                 true,  0x00FF, 0x0000, NULL, io_write_ime },
+    IO_REG(IO_REG_IME + 2)      = { 0,                              true,  0x0000, 0x0000, NULL, NULL },
+
+    /* System */
+    IO_REG(IO_REG_POSTFLG)      = { 0,                              true,  0x0000, 0x0000, io_read_postflg, io_write_postflg },
+    IO_REG(IO_REG_UNKNOWN_3)    = { 0,                              true,  0x0000, 0x0000, NULL, NULL },
+};
 
-        /* Timer 2 */
-        case IO_REG_TM2CNT_LO:
-        case IO_REG_TM2CNT_LO + 1: {
-            io->pending.timers[2].reload.bytes[addr - IO_REG_TM2CNT_LO] = val;
-            io_schedule_register_delayed_write(gba, IO_REG_TM2CNT_LO);
-            break;
-        };
-        case IO_REG_TM2CNT_HI: {
-            io->pending.timers[2].control.bytes[0] = val;
-            io_schedule_register_delayed_write(gba, IO_REG_TM2CNT_HI);
-            break;
-        };
+#undef IO_REG
+#undef IO_OFFSET
 
-        /* Timer 3 */
-        case IO_REG_TM3CNT_LO:
-        case IO_REG_TM3CNT_LO + 1: {
-            io->pending.timers[3].reload.bytes[addr - IO_REG_TM3CNT_LO] = val;
-            io_schedule_register_delayed_write(gba, IO_REG_TM3CNT_LO);
-            break;
-        };
-        case IO_REG_TM3CNT_HI: {
-            io->pending.timers[3].control.bytes[0] = val;
-            io_schedule_register_delayed_write(gba, IO_REG_TM3CNT_HI);
-            break;
-        };
+/*
+** Read the half-word at the given address of the IO memory.
+** `addr` must be aligned on a half-word.
+*/
+uint16_t
+mem_io_read16(
+    struct gba const *gba,
+    uint32_t addr
+) {
+    struct io_register const *reg;
 
-        /* Serial communication */
-        case IO_REG_SIOCNT:
-        case IO_REG_SIOCNT + 1: {
-            io->siocnt.bytes[addr - IO_REG_SIOCNT] = val;
+    logln(HS_IO, "IO read to register %s (%#08x)", mem_io_reg_name(addr), addr);
 
-            /* Stub */
-            if (io->siocnt.start && io->siocnt.irq) {
-                core_schedule_irq(gba, IRQ_SERIAL);
-            }
+    if (addr - IO_START >= IO_SIZE) {
+        return ((uint16_t)mem_openbus_read(gba, addr));
+    }
 
-            io->siocnt.start = false;
-            break;
-        };
+    reg = &io_registers[(addr - IO_START) >> 1];
 
-        case IO_REG_RCNT:
-        case IO_REG_RCNT + 1:               io->rcnt.bytes[addr - IO_REG_RCNT] = val; break;
+    if (reg->read) {
+        return (reg->read(gba, addr));
+    } else if (reg->readable) {
+        return (io_load(&gba->io, reg->offset) & reg->read_mask);
+    }
+    return ((uint16_t)mem_openbus_read(gba, addr));
+}
 
-        /* Keypad input */
-        case IO_REG_KEYCNT:
-        case IO_REG_KEYCNT + 1: {
-            bool old_cond;
-            uint32_t old_mask;
+/*
+** Write the bytes of `val` selected by `lanes` (`0x00FF`, `0xFF00` or `0xFFFF`) to the half-word
+** at the given address of the IO memory.
+** `addr` must be aligned on a half-word.
+*/
+static
+void
+io_write(
+    struct gba *gba,
+    uint32_t addr,
+    uint16_t val,
+    uint16_t lanes
+) {
+    struct io_register const *reg;
 
-            old_mask = io->keycnt.mask;
-            old_cond = io_evaluate_keypad_cond(gba);
-            io->keycnt.bytes[addr - IO_REG_KEYCNT] = val;
+    if (addr - IO_START >= IO_SIZE) {
+        return ;
+    }
 
-            if (   (!old_cond && io_evaluate_keypad_cond(gba))  // Trigger an IRQ if the keypad condition switches to true.
-                || (((old_mask ^ io->keycnt.mask) & io->keycnt.mask))  // Trigger an IRQ on a new mask that extends the current one
-            ) {
-                io_scan_keypad_irq(gba);
-            }
-            break;
-        };
+    reg = &io_registers[(addr - IO_START) >> 1];
 
-        /* Interrupt */
-        case IO_REG_IE:
-        case IO_REG_IE + 1: {
-            io->pending.int_enabled.bytes[addr - IO_REG_IE] = val;
-            io->pending.int_enabled.raw &= 0x3FFF;
-            io_schedule_register_delayed_write(gba, IO_REG_IE);
-            break;
-        };
-        case IO_REG_IF:
-        case IO_REG_IF + 1: {
-            io->pending.int_flag.bytes[addr - IO_REG_IF] &= ~val;
-            io_schedule_register_delayed_write(gba, IO_REG_IF);
-            break;
-        };
-        case IO_REG_WAITCNT:
-        case IO_REG_WAITCNT + 1: {
-            bool old_pbuffer_enabled;
+    if (reg->write_mask) {
+        io_store(&gba->io, reg->offset, val & reg->write_mask, lanes & io_lanes(reg->write_mask));
+    }
 
-            io->waitcnt.bytes[addr - IO_REG_WAITCNT] = val;
-            old_pbuffer_enabled = gba->memory.pbuffer.enabled;
+    if (reg->write) {
+        reg->write(gba, addr, val, lanes);
+    }
+}
 
-            if (old_pbuffer_enabled ^ io->waitcnt.gamepak_prefetch) {
-                memset(&gba->memory.pbuffer, 0, sizeof(struct prefetch_buffer));
-            }
+/*
+** Read the word at the given address of the IO memory.
+** `addr` must be aligned on a word.
+*/
+uint32_t
+mem_io_read32(
+    struct gba const *gba,
+    uint32_t addr
+) {
+    return (mem_io_read16(gba, addr) | ((uint32_t)mem_io_read16(gba, addr + 2) << 16));
+}
 
-            gba->memory.pbuffer.enabled = gba->settings.prefetch_buffer && io->waitcnt.gamepak_prefetch;
+/*
+** Read the byte at the given address of the IO memory.
+*/
+uint8_t
+mem_io_read8(
+    struct gba const *gba,
+    uint32_t addr
+) {
+    return (mem_io_read16(gba, addr & ~1) >> (8 * (addr & 1)));
+}
 
-            mem_update_waitstates(gba);
-            break;
-        };
-        case IO_REG_IME:
-        case IO_REG_IME + 1: {
-            io->pending.ime.bytes[addr - IO_REG_IME] = val;
-            io_schedule_register_delayed_write(gba, IO_REG_IME);
-            break;
-        };
+/*
+** Write the given value to the word at the given address of the IO memory.
+** `addr` must be aligned on a word.
+*/
+void
+mem_io_write32(
+    struct gba *gba,
+    uint32_t addr,
+    uint32_t val
+) {
+    mem_io_write16(gba, addr, (uint16_t)val);
+    mem_io_write16(gba, addr + 2, (uint16_t)(val >> 16));
+}
 
-        /* System */
-        case IO_REG_POSTFLG:                io->postflg = val; break;
-        case IO_REG_HALTCNT: {
-            gba->core.state = (val >> 7) + 1;
-            if (gba->core.state == CORE_STOP) {
-                ppu_render_black_screen(gba);
-            }
-            break;
-        };
-    }
+/*
+** Write the given value to the half-word at the given address of the IO memory.
+** `addr` must be aligned on a half-word.
+*/
+void
+mem_io_write16(
+    struct gba *gba,
+    uint32_t addr,
+    uint16_t val
+) {
+    logln(HS_IO, "IO write to register %s (%#08x) (%#04x)", mem_io_reg_name(addr), addr, val);
+
+    io_write(gba, addr, val, 0xFFFF);
+}
+
+/*
+** Write the given value to the byte at the given address of the IO memory.
+*/
+void
+mem_io_write8(
+    struct gba *gba,
+    uint32_t addr,
+    uint8_t val
+) {
+    logln(HS_IO, "IO write to register %s (%#08x) (%#02x)", mem_io_reg_name(addr), addr, val);
+
+    io_write(gba, addr & ~1, (uint16_t)val << (8 * (addr & 1)), 0x00FF << (8 * (addr & 1)));
 }
 
 bool
@@ -37,29 +37,36 @@
 **
 ** Source: GBATek
 */
-static uint32_t access_time16[2][16] = {
+static uint32_t const default_access_time16[2][16] = {
     [NON_SEQUENTIAL]    = { 1, 1, 3, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 1 },
     [SEQUENTIAL]        = { 1, 1, 3, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 1 },
 };
 
-static uint32_t access_time32[2][16] = {
+static uint32_t const default_access_time32[2][16] = {
     [NON_SEQUENTIAL]    = { 1, 1, 6, 1, 1, 2, 2, 1, 0, 0, 0, 0, 0, 0, 0, 1 },
     [SEQUENTIAL]        = { 1, 1, 6, 1, 1, 2, 2, 1, 0, 0, 0, 0, 0, 0, 0, 1 },
 };
 
-static uint32_t gamepak_nonseq_waitstates[4] = { 4, 3, 2, 8 };
+static uint32_t const gamepak_nonseq_waitstates[4] = { 4, 3, 2, 8 };
 
 /*
 ** Set the waitstates for ROM/SRAM memory according to the content of REG_WAITCNT.
 */
 void
 mem_update_waitstates(
-    struct gba const *gba
+    struct gba *gba
 ) {
+    uint32_t (*access_time16)[16];
+    uint32_t (*access_time32)[16];
     struct io const *io;
     uint32_t x;
 
     io = &gba->io;
+    access_time16 = gba->memory.access_time16;
+    access_time32 = gba->memory.access_time32;
+
+    memcpy(access_time16, default_access_time16, sizeof(default_access_time16));
+    memcpy(access_time32, default_access_time32, sizeof(default_access_time32));
 
     // 16 bit, non seq
     access_time16[NON_SEQUENTIAL][CART_0_REGION_1] = 1 + gamepak_nonseq_waitstates[io->waitcnt.ws0_nonseq];
@@ -86,6 +93,221 @@ mem_update_waitstates(
     }
 }
 
+static_assert(CORE_CACHE_PAGES <= UINT16_MAX);
+
+static void
+mem_map_page(
+    struct mem_page *page,
+    uint8_t *data,
+    uint32_t mask,
+    uint16_t cache_base,
+    uint16_t dirty_base
+) {
+    page->data = data;
+    page->mask = mask;
+    page->cache_base = cache_base;
+    page->dirty_base = dirty_base;
+}
+
+/*
+** Rebuild the fastmem page table according to the current memory layout.
+**
+** Only regions that can be accessed without any side effect are mapped.
+** The ROM is only mapped for reads, and only where it isn't shadowed by the
+** EEPROM window, the GPIO registers or the open bus past the end of the ROM.
+** 8-bit writes to video memory have special behaviours and aren't mapped either (see `template_write()`).
+**
+** With the mirror view, the read pages of EWRAM, IWRAM, VRAM and of the ROM it holds point to the view
+** with a mask of all ones instead.
+*/
+void
+mem_update_page_table(
+    struct gba *gba
+) {
+    struct mem_page_table *table;
+    struct memory *memory;
+    uint8_t *view;
+    bool eeprom;
+    bool dirty;
+    uint32_t i;
+
+    table = &gba->memory_pages;
+    memory = &gba->memory;
+    view = gba->memory_mirror.enabled ? gba->memory_mirror.view : NULL;
+    eeprom = (memory->backup_storage.type == BACKUP_EEPROM_4K || memory->backup_storage.type == BACKUP_EEPROM_64K);
+    dirty = gba->memory_dirty.enabled;
+
+    memset(table, 0, sizeof(*table));
+
+    for (i = 0; i < MEM_PAGE_COUNT; ++i) {
+        struct mem_page *read;
+        struct mem_page *write;
+        uint32_t addr;
+
+        read = &table->read[i];
+        write = &table->write[i];
+        addr = i << MEM_PAGE_SHIFT;
+
+        switch (addr >> 24) {
+            case EWRAM_REGION: {
+                if (view) {
+                    mem_map_page(read, view, UINT32_MAX, CORE_CACHE_NO_PAGE, MEM_DIRTY_NO_BLOCK);
+                } else {
+                    mem_map_page(read, memory->ewram, EWRAM_MASK, 0, MEM_DIRTY_NO_BLOCK);
+                }
+                mem_map_page(write, memory->ewram, EWRAM_MASK, 0, dirty ? MEM_DIRTY_EWRAM_BLOCK : MEM_DIRTY_NO_BLOCK);
+                break;
+            };
+            case IWRAM_REGION: {
+                if (view) {
+                    mem_map_page(read, view, UINT32_MAX, CORE_CACHE_NO_PAGE, MEM_DIRTY_NO_BLOCK);
+                } else {
+                    mem_map_page(read, memory->iwram, IWRAM_MASK, CORE_CACHE_EWRAM_PAGES, MEM_DIRTY_NO_BLOCK);
+                }
+                mem_map_page(write, memory->iwram, IWRAM_MASK, CORE_CACHE_EWRAM_PAGES, dirty ? MEM_DIRTY_IWRAM_BLOCK : MEM_DIRTY_NO_BLOCK);
+                break;
+            };
+            case PALRAM_REGION: {
+                mem_map_page(read, memory->palram, PALRAM_MASK, CORE_CACHE_NO_PAGE, MEM_DIRTY_NO_BLOCK);
+                mem_map_page(write, memory->palram, PALRAM_MASK, CORE_CACHE_NO_PAGE, dirty ? MEM_DIRTY_PALRAM_BLOCK : MEM_DIRTY_NO_BLOCK);
+                break;
+            };
+            case VRAM_REGION: {
+                uint32_t mask;
+
+                mask = (addr & 0x10000) ? VRAM_MASK_1 : VRAM_MASK_2;
+                if (view) {
+                    mem_map_page(read, view, UINT32_MAX, CORE_CACHE_NO_PAGE, MEM_DIRTY_NO_BLOCK);
+                } else {
+                    mem_map_page(read, memory->vram, mask, CORE_CACHE_NO_PAGE, MEM_DIRTY_NO_BLOCK);
+                }
+                // Always tracked: the PPU's tile cache must see all the writes
+                mem_map_page(write, memory->vram, mask, CORE_CACHE_NO_PAGE, MEM_DIRTY_VRAM_BLOCK);
+                break;
+            };
+            case OAM_REGION: {
+                mem_map_page(read, memory->oam, OAM_MASK, CORE_CACHE_NO_PAGE, MEM_DIRTY_NO_BLOCK);
+                // Always tracked: the PPU's decoded sprites must see all the writes
+                mem_map_page(write, memory->oam, OAM_MASK, CORE_CACHE_NO_PAGE, MEM_DIRTY_OAM_BLOCK);
+                break;
+            };
+            case CART_REGION_START ... CART_REGION_END: {
+                uint32_t eeprom_mask;
+                uint32_t eeprom_range;
+
+                // Past the end of the ROM, reads return the open bus.
+                if ((addr & CART_MASK) + MEM_PAGE_SIZE > gba->rom.size) {
+                    break;
+                }
+
+                // Pages that may contain an address of the EEPROM window.
+                eeprom_mask = memory->backup_storage.chip.eeprom.mask & ~MEM_PAGE_MASK;
+                eeprom_range = memory->backup_storage.chip.eeprom.range & ~MEM_PAGE_MASK;
+                if (eeprom && (addr & eeprom_mask) == eeprom_range) {
+                    break;
+                }
+
+                // The GPIO registers can be made readable at any time.
+                if (gba->gpio.device != GPIO_NONE && addr <= GPIO_REG_END && addr + MEM_PAGE_SIZE > GPIO_REG_START) {
+                    break;
+                }
+
+                // Only mapped for reads, so dropping the `const` is fine.
+                if (view && (addr & CART_MASK) < gba->memory_mirror.rom_size) {
+                    mem_map_page(read, view, UINT32_MAX, CORE_CACHE_NO_PAGE, MEM_DIRTY_NO_BLOCK);
+                } else {
+                    mem_map_page(read, (uint8_t *)gba->rom.data, CART_MASK, CORE_CACHE_NO_PAGE, MEM_DIRTY_NO_BLOCK);
+                }
+                break;
+            };
+            default: break;
+        }
+    }
+}
+
+/*
+** Enable or disable the dirty-block tracking.
+** The bitmap starts cleared.
+*/
+void
+mem_dirty_enable(
+    struct gba *gba,
+    bool enable
+) {
+    gba->memory_dirty.enabled = enable;
+    mem_dirty_clear(gba);
+    mem_update_page_table(gba);
+}
+
+/*
+** Clear the dirty bit of all blocks.
+*/
+void
+mem_dirty_clear(
+    struct gba *gba
+) {
+    memset(gba->memory_dirty.bits, 0, sizeof(gba->memory_dirty.bits));
+}
+
+/*
+** Mark as dirty the blocks covering `size` bytes starting at `offset` of the region
+** whose first block is `base` (one of the `MEM_DIRTY_*_BLOCK`), and invalidate the tiles
+** and sprites the PPU decoded from them.
+**
+** Used when the memory is written to without going through `mem_write*()`.
+*/
+void
+mem_dirty_mark_range(
+    struct gba *gba,
+    uint32_t base,
+    uint32_t offset,
+    uint32_t size
+) {
+    uint32_t block;
+    uint32_t end;
+    uint32_t start;
+
+    if (!size) {
+        return ;
+    }
+
+    // The part of the range that lands in VRAM, if any
+    start = (base << MEM_DIRTY_SHIFT) + offset;
+    end = start + size;
+    if (start < (MEM_DIRTY_OAM_BLOCK << MEM_DIRTY_SHIFT) && end > (MEM_DIRTY_VRAM_BLOCK << MEM_DIRTY_SHIFT)) {
+        start = max(start, MEM_DIRTY_VRAM_BLOCK << MEM_DIRTY_SHIFT);
+        end = min(end, MEM_DIRTY_OAM_BLOCK << MEM_DIRTY_SHIFT);
+        ppu_tile_cache_invalidate(gba, start - (MEM_DIRTY_VRAM_BLOCK << MEM_DIRTY_SHIFT), end - start);
+    }
+
+    // Same for OAM
+    if ((base << MEM_DIRTY_SHIFT) + offset + size > (MEM_DIRTY_OAM_BLOCK << MEM_DIRTY_SHIFT)) {
+        ppu_oam_cache_invalidate(gba);
+    }
+
+    if (!gba->memory_dirty.enabled) {
+        return ;
+    }
+
+    block = base + (offset >> MEM_DIRTY_SHIFT);
+    end = base + ((offset + size - 1) >> MEM_DIRTY_SHIFT);
+    hs_assert(end < MEM_DIRTY_BLOCKS);
+
+    for (; block <= end; ++block) {
+        mem_dirty_mark(gba, block);
+    }
+}
+
+/*
+** Mark all blocks as dirty, typically after the whole memory was replaced (reset, quickload).
+*/
+void
+mem_dirty_mark_all(
+    struct gba *gba
+) {
+    mem_dirty_mark_range(gba, 0, 0, MEM_DIRTY_BLOCKS << MEM_DIRTY_SHIFT);
+}
+
 /*
 ** Calculate and add to the current cycle counter the amount of cycles needed for as many bus accesses
 ** are needed to transfer a data of the given size and access type.
@@ -108,9 +330,9 @@ mem_access(
     }
 
     if (size <= sizeof(uint16_t)) {
-        cycles = access_time16[access_type][page];
+        cycles = gba->memory.access_time16[access_type][page];
     } else {
-        cycles = access_time32[access_type][page];
+        cycles = gba->memory.access_time32[access_type][page];
     }
 
     gba->memory.gamepak_bus_in_use = (page >= CART_REGION_START && page <= CART_REGION_END);
@@ -152,11 +374,11 @@ mem_prefetch_buffer_access(
         if (gba->core.cpsr.thumb) {
             pbuffer->insn_len = sizeof(uint16_t);
             pbuffer->capacity = 8;
-            pbuffer->reload = access_time16[SEQUENTIAL][(addr >> 24) & 0xF];
+            pbuffer->reload = gba->memory.access_time16[SEQUENTIAL][(addr >> 24) & 0xF];
         } else {
             pbuffer->insn_len = sizeof(uint32_t);
             pbuffer->capacity = 4;
-            pbuffer->reload = access_time32[SEQUENTIAL][(addr >> 24) & 0xF];
+            pbuffer->reload = gba->memory.access_time32[SEQUENTIAL][(addr >> 24) & 0xF];
         }
 
         pbuffer->countdown = pbuffer->reload;
@@ -264,8 +486,13 @@ mem_openbus_read(
         T _ret = 0;                                                                         \
         uint32_t _addr;                                                                     \
                                                                                             \
+        struct mem_page const *_page;                                                       \
+                                                                                            \
         _addr = align(T, (unaligned_addr));                                                 \
-        switch (_addr >> 24) {                                                              \
+        _page = &(gba)->memory_pages.read[(_addr & (MEM_PAGE_TABLE_END - 1)) >> MEM_PAGE_SHIFT]; \
+        if (likely(_addr < MEM_PAGE_TABLE_END && _page->data)) {                            \
+            _ret = *(T *)(_page->data + (_addr & _page->mask));                             \
+        } else switch (_addr >> 24) {                                                       \
             case BIOS_REGION: {                                                             \
                 if (_addr <= BIOS_END) {                                                    \
                     uint32_t _shift;                                                        \
@@ -289,17 +516,12 @@ mem_openbus_read(
                 _ret = *(T *)((uint8_t *)((gba)->memory.iwram) + (_addr & IWRAM_MASK));     \
                 break;                                                                      \
             case IO_REGION:                                                                 \
+                if (unlikely((_addr & 0xFFFFFFF0) == IO_REG_TM0CNT_LO)) {                   \
+                    core_idle_loop_taint(gba);                                              \
+                }                                                                           \
                 _ret = _Generic(_ret,                                                       \
-                    uint32_t: (                                                             \
-                        ((T)mem_io_read8((gba), _addr + 0) <<  0) |                         \
-                        ((T)mem_io_read8((gba), _addr + 1) <<  8) |                         \
-                        ((T)mem_io_read8((gba), _addr + 2) << 16) |                         \
-                        ((T)mem_io_read8((gba), _addr + 3) << 24)                           \
-                    ),                                                                      \
-                    uint16_t: (                                                             \
-                        ((T)mem_io_read8((gba), _addr + 0) <<  0) |                         \
-                        ((T)mem_io_read8((gba), _addr + 1) <<  8)                           \
-                    ),                                                                      \
+                    uint32_t: mem_io_read32((gba), _addr),                                  \
+                    uint16_t: mem_io_read16((gba), _addr),                                  \
                     default: mem_io_read8((gba), _addr)                                     \
                 );                                                                          \
                 break;                                                                      \
@@ -317,10 +539,11 @@ mem_openbus_read(
                     ((gba)->memory.backup_storage.type == BACKUP_EEPROM_4K || (gba)->memory.backup_storage.type == BACKUP_EEPROM_64K) \
                     && (_addr & (gba)->memory.backup_storage.chip.eeprom.mask) == (gba)->memory.backup_storage.chip.eeprom.range \
                 )) {                                                                        \
+                    core_idle_loop_taint(gba);                                              \
                     _ret = mem_eeprom_read8(gba);                                           \
                 } else if (unlikely(_addr >= GPIO_REG_START && _addr <= GPIO_REG_END && (gba)->gpio.readable)) { \
                     _ret = gpio_read_u8((gba), _addr);                                      \
-                } else if (unlikely((_addr & 0x00FFFFFF) >= (gba)->memory.rom_size)) {      \
+                } else if (unlikely((_addr & CART_MASK) + sizeof(T) > (gba)->rom.size)) {   \
                     _ret = _Generic(_ret,                                                   \
                         uint32_t: (                                                         \
                             ((_addr >> 1) & 0xFFFF) |                                       \
@@ -332,7 +555,7 @@ mem_openbus_read(
                         default: ((_addr >> (1 + 8 * (_addr & 0b1))) & 0xFF)                \
                     );                                                                      \
                 } else {                                                                    \
-                    _ret = *(T *)((uint8_t *)((gba)->memory.rom) + (_addr & CART_MASK));    \
+                    _ret = *(T const *)((gba)->rom.data + (_addr & CART_MASK));             \
                 }                                                                           \
                 break;                                                                      \
             };                                                                              \
@@ -358,6 +581,16 @@ mem_openbus_read(
         _ret;                                                                               \
     })
 
+/*
+** Mark the block containing `offset`, in the region starting at `base`, as dirty if tracking is enabled.
+*/
+#define mem_dirty_notify_write(gba, base, offset)                                               \
+    ({                                                                                          \
+        if (unlikely((gba)->memory_dirty.enabled)) {                                            \
+            mem_dirty_mark((gba), (base) + ((offset) >> MEM_DIRTY_SHIFT));                      \
+        }                                                                                       \
+    })
+
 /*
 ** Write a data of type T to memory at the given address.
 **
@@ -367,28 +600,48 @@ mem_openbus_read(
     ({                                                                                          \
         uint32_t _addr;                                                                         \
                                                                                                 \
+        struct mem_page const *_page;                                                           \
+                                                                                                \
         _addr = align(T, (unaligned_addr));                                                     \
-        switch (_addr >> 24) {                                                                  \
+        _page = &(gba)->memory_pages.write[(_addr & (MEM_PAGE_TABLE_END - 1)) >> MEM_PAGE_SHIFT]; \
+        if (                                                                                    \
+            likely(_addr < MEM_PAGE_TABLE_END && _page->data)                                   \
+            && (sizeof(T) != sizeof(uint8_t) || _page->cache_base != CORE_CACHE_NO_PAGE)        \
+        ) {                                                                                     \
+            /* u8 writes to video memory are special and must take the slow path. */           \
+            *(T *)(_page->data + (_addr & _page->mask)) = (T)(val);                             \
+            if (_page->cache_base != CORE_CACHE_NO_PAGE) {                                      \
+                core_cache_notify_write((gba), _page->cache_base + ((_addr & _page->mask) >> CORE_CACHE_PAGE_SHIFT)); \
+            }                                                                                   \
+            if (unlikely(_page->dirty_base != MEM_DIRTY_NO_BLOCK)) {                            \
+                if (_page->dirty_base == MEM_DIRTY_VRAM_BLOCK) {                                \
+                    ppu_tile_cache_invalidate((gba), _addr & _page->mask, sizeof(T));           \
+                } else if (_page->dirty_base == MEM_DIRTY_OAM_BLOCK) {                          \
+                    ppu_oam_cache_invalidate(gba);                                              \
+                }                                                                               \
+                mem_dirty_notify_write((gba), _page->dirty_base, _addr & _page->mask);          \
+            }                                                                                   \
+        } else switch (_addr >> 24) {                                                           \
             case BIOS_REGION:                                                                   \
                 /* Ignore writes attempts to the bios memory. */                                \
                 break;                                                                          \
             case EWRAM_REGION:                                                                  \
                 *(T *)((uint8_t *)((gba)->memory.ewram) + (_addr & EWRAM_MASK)) = (T)(val);     \
+                core_cache_notify_write((gba), CORE_CACHE_EWRAM_PAGE(_addr));                   \
+                mem_dirty_notify_write((gba), MEM_DIRTY_EWRAM_BLOCK, _addr & EWRAM_MASK);       \
                 break;                                                                          \
             case IWRAM_REGION:                                                                  \
                 *(T *)((uint8_t *)((gba)->memory.iwram) + (_addr & IWRAM_MASK)) = (T)(val);     \
+                core_cache_notify_write((gba), CORE_CACHE_IWRAM_PAGE(_addr));                   \
+                mem_dirty_notify_write((gba), MEM_DIRTY_IWRAM_BLOCK, _addr & IWRAM_MASK);       \
                 break;                                                                          \
             case IO_REGION:                                                                     \
                 _Generic(val,                                                                   \
                     uint32_t: ({                                                                \
-                        mem_io_write8((gba), _addr + 0, (uint8_t)((val) >>  0));                \
-                        mem_io_write8((gba), _addr + 1, (uint8_t)((val) >>  8));                \
-                        mem_io_write8((gba), _addr + 2, (uint8_t)((val) >> 16));                \
-                        mem_io_write8((gba), _addr + 3, (uint8_t)((val) >> 24));                \
+                        mem_io_write32((gba), _addr, (val));                                    \
                     }),                                                                         \
                     uint16_t: ({                                                                \
-                        mem_io_write8((gba), _addr + 0, (uint8_t)((val) >>  0));                \
-                        mem_io_write8((gba), _addr + 1, (uint8_t)((val) >>  8));                \
+                        mem_io_write16((gba), _addr, (val));                                    \
                     }),                                                                         \
                     default: ({                                                                 \
                         mem_io_write8((gba), _addr, (val));                                     \
@@ -410,15 +663,20 @@ mem_openbus_read(
                         *(T *)((uint8_t *)((gba)->memory.palram) + ((_addr + 1) & PALRAM_MASK)) = (T)(val); \
                     })                                                                          \
                 );                                                                              \
+                mem_dirty_notify_write((gba), MEM_DIRTY_PALRAM_BLOCK, _addr & PALRAM_MASK);     \
                 break;                                                                          \
             };                                                                                  \
             case VRAM_REGION: {                                                                 \
                 _Generic(val,                                                                   \
                     uint32_t: ({                                                                \
                         *(T *)((uint8_t *)((gba)->memory.vram) + (_addr & ((_addr & 0x10000) ? VRAM_MASK_1 : VRAM_MASK_2))) = (T)(val); \
+                        ppu_tile_cache_invalidate((gba), _addr & ((_addr & 0x10000) ? VRAM_MASK_1 : VRAM_MASK_2), sizeof(T)); \
+                        mem_dirty_notify_write((gba), MEM_DIRTY_VRAM_BLOCK, _addr & ((_addr & 0x10000) ? VRAM_MASK_1 : VRAM_MASK_2)); \
                     }),                                                                         \
                     uint16_t: ({                                                                \
                         *(T *)((uint8_t *)((gba)->memory.vram) + (_addr & ((_addr & 0x10000) ? VRAM_MASK_1 : VRAM_MASK_2))) = (T)(val); \
+                        ppu_tile_cache_invalidate((gba), _addr & ((_addr & 0x10000) ? VRAM_MASK_1 : VRAM_MASK_2), sizeof(T)); \
+                        mem_dirty_notify_write((gba), MEM_DIRTY_VRAM_BLOCK, _addr & ((_addr & 0x10000) ? VRAM_MASK_1 : VRAM_MASK_2)); \
                     }),                                                                         \
                     default: ({                                                                 \
                         uint32_t new_addr;                                                      \
@@ -435,6 +693,8 @@ mem_openbus_read(
                             addr &= ~(sizeof(uint16_t) - 1);                                    \
                             *(T *)((uint8_t *)((gba)->memory.vram) + (_addr & ((_addr & 0x10000) ? VRAM_MASK_1 : VRAM_MASK_2))) = (T)(val); \
                             *(T *)((uint8_t *)((gba)->memory.vram) + ((_addr + 1) & (((_addr + 1) & 0x10000) ? VRAM_MASK_1 : VRAM_MASK_2))) = (T)(val); \
+                            ppu_tile_cache_invalidate((gba), _addr & ((_addr & 0x10000) ? VRAM_MASK_1 : VRAM_MASK_2), 2); \
+                            mem_dirty_notify_write((gba), MEM_DIRTY_VRAM_BLOCK, _addr & ((_addr & 0x10000) ? VRAM_MASK_1 : VRAM_MASK_2)); \
                         }                                                                       \
                     })                                                                          \
                 );                                                                              \
@@ -444,9 +704,13 @@ mem_openbus_read(
                 _Generic(val,                                                                   \
                     uint32_t: ({                                                                \
                         *(T *)((uint8_t *)((gba)->memory.oam) + (_addr & OAM_MASK)) = (T)(val); \
+                        ppu_oam_cache_invalidate(gba);                                          \
+                        mem_dirty_notify_write((gba), MEM_DIRTY_OAM_BLOCK, _addr & OAM_MASK);   \
                     }),                                                                         \
                     uint16_t: ({                                                                \
                         *(T *)((uint8_t *)((gba)->memory.oam) + (_addr & OAM_MASK)) = (T)(val); \
+                        ppu_oam_cache_invalidate(gba);                                          \
+                        mem_dirty_notify_write((gba), MEM_DIRTY_OAM_BLOCK, _addr & OAM_MASK);   \
                     }),                                                                         \
                     default: ({                                                                 \
                         /* Ignore u8 write attemps to OAM memory */                             \
@@ -633,6 +897,7 @@ mem_write8(
     debugger_eval_write_watchpoints(gba, addr, sizeof(uint8_t), val);
 #endif
 
+    core_idle_loop_taint(gba);
     mem_access(gba, addr, sizeof(uint8_t), access_type);
     template_write(uint8_t, gba, addr, val);
 }
@@ -661,6 +926,7 @@ mem_write16(
     debugger_eval_write_watchpoints(gba, addr, sizeof(uint16_t), val);
 #endif
 
+    core_idle_loop_taint(gba);
     mem_access(gba, addr, sizeof(uint16_t), access_type);
     template_write(uint16_t, gba, addr, val);
 }
@@ -688,6 +954,7 @@ mem_write32(
     debugger_eval_write_watchpoints(gba, addr, sizeof(uint32_t), val);
 #endif
 
+    core_idle_loop_taint(gba);
     mem_access(gba, addr, sizeof(uint32_t), access_type);
     template_write(uint32_t, gba, addr, val);
 }
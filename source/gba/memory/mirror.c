@@ -0,0 +1,313 @@
+/******************************************************************************\
+**
+**  This file is part of the Hades GBA Emulator, and is made available under
+**  the terms of the GNU General Public License version 2.
+**
+**  Copyright (C) 2021-2024 - The Hades Authors
+**
+\******************************************************************************/
+
+#define _GNU_SOURCE
+
+#include <string.h>
+#include "hades.h"
+#include "gba/gba.h"
+
+#ifdef __linux__
+
+#include <errno.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/*
+** Offsets of the regions within the memfd.
+*/
+#define MEM_MIRROR_EWRAM_OFFSET     (0)
+#define MEM_MIRROR_IWRAM_OFFSET     (MEM_MIRROR_EWRAM_OFFSET + EWRAM_SIZE)
+#define MEM_MIRROR_VRAM_OFFSET      (MEM_MIRROR_IWRAM_OFFSET + IWRAM_SIZE)
+#define MEM_MIRROR_FD_SIZE          (MEM_MIRROR_VRAM_OFFSET + VRAM_SIZE)
+
+static_assert(MEM_PAGE_SIZE % MEM_MIRROR_ALIGN == 0);
+static_assert(VRAM_SIZE % MEM_MIRROR_ALIGN == 0);
+
+/*
+** The cartridge regions the ROM is mapped at, one per wait state.
+*/
+static uint32_t const mem_mirror_rom_bases[] = {
+    CART_0_START,
+    CART_1_START,
+    CART_2_START,
+};
+
+/*
+** Map `size` bytes of the memfd, starting at `offset`, at `addr`.
+*/
+static
+bool
+mem_mirror_map(
+    struct mem_mirror *mirror,
+    void *addr,
+    size_t size,
+    off_t offset
+) {
+    return (mmap(addr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, mirror->fd, offset) != MAP_FAILED);
+}
+
+/*
+** Put back the `size` bytes of the view at `addr` into the PROT_NONE reservation.
+*/
+static
+void
+mem_mirror_reserve(
+    struct mem_mirror *mirror,
+    uint32_t addr,
+    size_t size
+) {
+    void *ptr;
+
+    ptr = mmap(mirror->view + addr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+    hs_assert(ptr != MAP_FAILED);
+}
+
+/*
+** Back `array` with private memory again, keeping the content it had in the memfd.
+*/
+static
+void
+mem_mirror_unmap_array(
+    struct mem_mirror *mirror,
+    uint8_t *array,
+    size_t size,
+    off_t offset
+) {
+    void *ptr;
+
+    ptr = mmap(array, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+    hs_assert(ptr != MAP_FAILED);
+    hs_assert(pread(mirror->fd, array, size, offset) == (ssize_t)size);
+}
+
+/*
+** Release the view and the memfd.
+**
+** If `in_place` is true, the arrays of EWRAM, IWRAM and VRAM may be backed by the memfd and are moved
+** back to private memory with their content.
+** Safe to call on a half-built view.
+*/
+static
+void
+mem_mirror_release(
+    struct gba *gba,
+    bool in_place
+) {
+    struct mem_mirror *mirror;
+    struct memory *memory;
+
+    mirror = &gba->memory_mirror;
+    memory = &gba->memory;
+
+    if (in_place) {
+        mem_mirror_unmap_array(mirror, memory->ewram, EWRAM_SIZE, MEM_MIRROR_EWRAM_OFFSET);
+        mem_mirror_unmap_array(mirror, memory->iwram, IWRAM_SIZE, MEM_MIRROR_IWRAM_OFFSET);
+        mem_mirror_unmap_array(mirror, memory->vram, VRAM_SIZE, MEM_MIRROR_VRAM_OFFSET);
+    }
+
+    if (mirror->fd >= 0) {
+        close(mirror->fd);
+    }
+
+    if (mirror->view) {
+        munmap(mirror->view, MEM_MIRROR_VIEW_SIZE);
+    }
+
+    mirror->enabled = false;
+    mirror->fd = -1;
+    mirror->view = NULL;
+    mirror->rom_size = 0;
+}
+
+/*
+** Build the view and back the arrays of EWRAM, IWRAM and VRAM with the memfd.
+*/
+static
+bool
+mem_mirror_create(
+    struct gba *gba
+) {
+    struct mem_mirror *mirror;
+    struct memory *memory;
+    uint32_t addr;
+    long page_size;
+
+    mirror = &gba->memory_mirror;
+    memory = &gba->memory;
+
+    mirror->fd = -1;
+    mirror->view = NULL;
+    mirror->rom_size = 0;
+
+    // The arrays are only aligned on `MEM_MIRROR_ALIGN` and the ROM is mapped by pages of `MEM_PAGE_SIZE`.
+    page_size = sysconf(_SC_PAGESIZE);
+    if (page_size <= 0 || MEM_MIRROR_ALIGN % page_size) {
+        logln(HS_WARNING, "The host's pages (%li bytes) are too large to mirror the memory.", page_size);
+        return (false);
+    }
+
+    mirror->fd = memfd_create("hades-memory", MFD_CLOEXEC);
+    if (mirror->fd < 0) {
+        goto err;
+    }
+
+    if (ftruncate(mirror->fd, MEM_MIRROR_FD_SIZE)) {
+        goto err;
+    }
+
+    // Copy the current content before the arrays are replaced by the memfd.
+    if (
+           pwrite(mirror->fd, memory->ewram, EWRAM_SIZE, MEM_MIRROR_EWRAM_OFFSET) != EWRAM_SIZE
+        || pwrite(mirror->fd, memory->iwram, IWRAM_SIZE, MEM_MIRROR_IWRAM_OFFSET) != IWRAM_SIZE
+        || pwrite(mirror->fd, memory->vram, VRAM_SIZE, MEM_MIRROR_VRAM_OFFSET) != VRAM_SIZE
+    ) {
+        goto err;
+    }
+
+    mirror->view = mmap(NULL, MEM_MIRROR_VIEW_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mirror->view == MAP_FAILED) {
+        mirror->view = NULL;
+        goto err;
+    }
+
+    // EWRAM mirrors every 256KiB and IWRAM every 32KiB.
+    for (addr = EWRAM_START; addr < EWRAM_START + 0x01000000; addr += EWRAM_SIZE) {
+        if (!mem_mirror_map(mirror, mirror->view + addr, EWRAM_SIZE, MEM_MIRROR_EWRAM_OFFSET)) {
+            goto err;
+        }
+    }
+
+    for (addr = IWRAM_START; addr < IWRAM_START + 0x01000000; addr += IWRAM_SIZE) {
+        if (!mem_mirror_map(mirror, mirror->view + addr, IWRAM_SIZE, MEM_MIRROR_IWRAM_OFFSET)) {
+            goto err;
+        }
+    }
+
+    // VRAM mirrors every 128KiB, the last 32KiB being mirrored once more in the upper 32KiB.
+    for (addr = VRAM_START; addr < VRAM_START + 0x01000000; addr += VRAM_MASK_2 + 1) {
+        if (
+               !mem_mirror_map(mirror, mirror->view + addr, VRAM_SIZE, MEM_MIRROR_VRAM_OFFSET)
+            || !mem_mirror_map(mirror, mirror->view + addr + VRAM_SIZE, VRAM_MASK_2 + 1 - VRAM_SIZE, MEM_MIRROR_VRAM_OFFSET + 0x10000)
+        ) {
+            goto err;
+        }
+    }
+
+    // Everything the emulator reads or writes in these regions now goes through the memfd.
+    if (
+           !mem_mirror_map(mirror, memory->ewram, EWRAM_SIZE, MEM_MIRROR_EWRAM_OFFSET)
+        || !mem_mirror_map(mirror, memory->iwram, IWRAM_SIZE, MEM_MIRROR_IWRAM_OFFSET)
+        || !mem_mirror_map(mirror, memory->vram, VRAM_SIZE, MEM_MIRROR_VRAM_OFFSET)
+    ) {
+        logln(HS_WARNING, "Failed to mirror the memory: %s.", strerror(errno));
+        mem_mirror_release(gba, true);
+        return (false);
+    }
+
+    mirror->enabled = true;
+    return (true);
+
+err:
+    logln(HS_WARNING, "Failed to mirror the memory: %s.", strerror(errno));
+    mem_mirror_release(gba, false);
+    return (false);
+}
+
+/*
+** Enable or disable the mirror view.
+** Return true if it's enabled afterwards.
+**
+** The page table must be rebuilt and the compiled code flushed after any change.
+*/
+bool
+mem_mirror_enable(
+    struct gba *gba,
+    bool enable
+) {
+    struct mem_mirror *mirror;
+
+    mirror = &gba->memory_mirror;
+
+    if (enable && !mirror->enabled) {
+        mem_mirror_create(gba);
+    } else if (!enable && mirror->enabled) {
+        mem_mirror_release(gba, true);
+    }
+
+    return (mirror->enabled);
+}
+
+/*
+** Map the current ROM at its three mirrors in the view, replacing the previous one.
+**
+** The ROM isn't copied: its mapping is duplicated with `mremap()`, which only works for
+** shared mappings like the one of `hs_map_file()`. Other ROMs, like the ones extracted from
+** an archive, are left out of the view and keep being read through their masked page.
+**
+** Only the pages of `MEM_PAGE_SIZE` bytes entirely within the ROM are mapped, like in the page table.
+** Must be called each time the ROM changes (reset).
+*/
+void
+mem_mirror_map_rom(
+    struct gba *gba
+) {
+    struct mem_mirror *mirror;
+    size_t size;
+    size_t i;
+
+    mirror = &gba->memory_mirror;
+
+    if (!mirror->enabled) {
+        return ;
+    }
+
+    if (mirror->rom_size) {
+        for (i = 0; i < array_length(mem_mirror_rom_bases); ++i) {
+            mem_mirror_reserve(mirror, mem_mirror_rom_bases[i], mirror->rom_size);
+        }
+        mirror->rom_size = 0;
+    }
+
+    size = gba->rom.size & ~MEM_PAGE_MASK;
+    if (!gba->rom.data || !size) {
+        return ;
+    }
+
+    for (i = 0; i < array_length(mem_mirror_rom_bases); ++i) {
+        void *ptr;
+
+        ptr = mremap((void *)gba->rom.data, 0, size, MREMAP_MAYMOVE | MREMAP_FIXED, mirror->view + mem_mirror_rom_bases[i]);
+        if (ptr == MAP_FAILED) {
+            while (i--) {
+                mem_mirror_reserve(mirror, mem_mirror_rom_bases[i], size);
+            }
+            return ;
+        }
+    }
+
+    mirror->rom_size = size;
+}
+
+#else
+
+bool
+mem_mirror_enable(
+    struct gba *gba,
+    bool enable __unused
+) {
+    return (gba->memory_mirror.enabled);
+}
+
+void
+mem_mirror_map_rom(
+    struct gba *gba __unused
+) {}
+
+#endif /* __linux__ */
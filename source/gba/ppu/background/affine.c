@@ -98,13 +98,8 @@ ppu_render_background_affine(
         palette_idx = mem_vram_read8(gba, chrs_addr + tile_idx * 64 + chr_y * 8 + chr_x);
 
         if (palette_idx) {
-            struct rich_color c;
-
-            c.raw = mem_palram_read16(gba, palette_idx * sizeof(union color));
-            c.visible = true;
-            c.idx = bg_idx;
-            c.force_blend = false;
-            scanline->bg[x] = c;
+            scanline->bg[x] = mem_palram_read16(gba, palette_idx * sizeof(union color));
+            scanline->bg_flags[x] = PPU_LAYER_VISIBLE;
         }
     }
 }
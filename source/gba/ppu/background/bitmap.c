@@ -22,7 +22,6 @@ ppu_render_background_bitmap(
     int32_t px;
     int32_t py;
     uint32_t x;
-    struct rich_color c;
     struct io const *io;
 
     io = &gba->io;
@@ -54,18 +53,12 @@ ppu_render_background_bitmap(
 
             palette_idx = mem_vram_read8(gba, (GBA_SCREEN_WIDTH * rel_y + rel_x) + 0xA000 * gba->io.dispcnt.frame);
             if (palette_idx) {
-                c.raw = mem_palram_read16(gba, palette_idx * sizeof(union color));
-                c.visible = true;
-                c.idx = 2;
-                c.force_blend = false;
-                scanline->bg[x] = c;
+                scanline->bg[x] = mem_palram_read16(gba, palette_idx * sizeof(union color));
+                scanline->bg_flags[x] = PPU_LAYER_VISIBLE;
             }
         } else {
-            c.raw = mem_vram_read16(gba, (GBA_SCREEN_WIDTH * rel_y + rel_x) * sizeof(union color));
-            c.visible = true;
-            c.idx = 2;
-            c.force_blend = false;
-            scanline->bg[x] = c;
+            scanline->bg[x] = mem_vram_read16(gba, (GBA_SCREEN_WIDTH * rel_y + rel_x) * sizeof(union color));
+            scanline->bg_flags[x] = PPU_LAYER_VISIBLE;
         }
     }
 }
@@ -80,7 +73,6 @@ ppu_render_background_bitmap_small(
     int32_t px;
     int32_t py;
     uint32_t x;
-    struct rich_color c;
     struct io const *io;
 
     io = &gba->io;
@@ -107,10 +99,7 @@ ppu_render_background_bitmap_small(
             continue;
         }
 
-        c.raw = mem_vram_read16(gba, 0xA000 * gba->io.dispcnt.frame + (160 * rel_y + rel_x) * sizeof(union color) );
-        c.visible = true;
-        c.idx = 2;
-        c.force_blend = false;
-        scanline->bg[x] = c;
+        scanline->bg[x] = mem_vram_read16(gba, 0xA000 * gba->io.dispcnt.frame + (160 * rel_y + rel_x) * sizeof(union color) );
+        scanline->bg_flags[x] = PPU_LAYER_VISIBLE;
     }
 }
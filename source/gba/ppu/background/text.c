@@ -11,36 +11,99 @@
 #include "gba/ppu.h"
 
 /*
-** Render the bitmap background of given index.
+** Return the entry of the tilemap at the given coordinates, in tiles (0-63).
 */
-void
-ppu_render_background_text(
+static inline
+union tile
+ppu_text_fetch_tile(
     struct gba const *gba,
+    uint32_t screen_addr,
+    uint32_t bg_size,
+    uint32_t tile_x,
+    uint32_t tile_y
+) {
+    uint32_t screen_idx;
+    union tile tile;
+    bool up_x;
+    bool up_y;
+
+    up_x = tile_x & 0b100000;
+    up_y = tile_y & 0b100000;
+    screen_idx = (tile_y % 32) * 32 + (tile_x % 32);
+
+    switch (bg_size) {
+        case 0b00: // 256x256 (32x32)
+            break;
+        case 0b01: // 512x256 (64x32)
+            screen_idx += up_x * 1024;
+            break;
+        case 0b10: // 256x512 (32x64)
+            screen_idx += up_y * 1024;
+            break;
+        case 0b11: // 512x512 (64x64)
+            screen_idx += up_x * 1024 + up_y * 2048;
+            break;
+    }
+
+    tile.raw = mem_vram_read16(gba, screen_addr + screen_idx * sizeof(union tile));
+    return (tile);
+}
+
+/*
+** Return the row `chr_y` of the given tile, flipped if needed, the leftmost pixel being the lowest byte.
+*/
+static __always_inline
+uint64_t
+ppu_text_fetch_row(
+    struct gba *gba,
+    uint32_t chrs_addr,
+    union tile tile,
+    uint32_t chr_y,
+    bool color_256
+) {
+    uint64_t const *rows;
+    uint64_t row;
+
+    rows = ppu_tile_cache_get(gba, chrs_addr + tile.number * (color_256 ? 64 : 32), color_256);
+    row = rows[chr_y ^ tile.vflip * 0b111];
+    return (tile.hflip ? __builtin_bswap64(row) : row);
+}
+
+/*
+** Render the text background of given index.
+**
+** The scanline is walked one entry of the tilemap at a time (at most 31 per line, the first and last
+** ones being partially visible), each entry yielding up to 8 pixels read from a single row of its tile.
+**
+** Instantiated for each combination of `color_256` and `mosaic` so that none of them is tested per pixel.
+*/
+static __always_inline
+void
+ppu_render_background_text_template(
+    struct gba *gba,
     struct scanline *scanline,
     uint32_t line,
-    uint32_t bg_idx
+    uint32_t bg_idx,
+    bool color_256,
+    bool mosaic
 ) {
     struct io const *io;
-    bool mosaic;
-    bool palette_type;
     uint32_t bg_size;
     uint32_t screen_addr;
     uint32_t chrs_addr;
-    uint32_t x;
-    int32_t rel_y;          // Y coord of the pixel within the bg
+    uint32_t rel_y;         // Y coord of the pixel within the bg
     uint32_t tile_y;        // Y coord of the tile in the tilemap
     uint32_t chr_y;         // Y coord of the pixel we want to render within the tile
-    bool up_y;
+    uint32_t hoffset;
+    uint32_t x;
 
     io = &gba->io;
-    scanline->top_idx = bg_idx;
 
-    /* Retrieve all those before so that we don't have to read them for each pixel. */
-    mosaic = io->bgcnt[bg_idx].mosaic;
+    /* Retrieve all those before so that we don't have to read them for each tile. */
     bg_size = io->bgcnt[bg_idx].size;
-    palette_type = io->bgcnt[bg_idx].palette_type;
     screen_addr = (uint32_t)io->bgcnt[bg_idx].screen_base * 0x800;
     chrs_addr = (uint32_t)io->bgcnt[bg_idx].character_base * 0x4000;
+    hoffset = io->bg_hoffset[bg_idx].raw;
 
     /*
     ** Do all the maths for the Y coordinate first, since those do not change until the next scanline.
@@ -52,83 +115,105 @@ ppu_render_background_text(
         rel_y = line;
     }
     rel_y += io->bg_voffset[bg_idx].raw;
-    tile_y = (rel_y / 8);
-    up_y = tile_y & 0b100000;
-    tile_y %= 32;
+    tile_y = (rel_y / 8) % 64;
     chr_y = rel_y % 8;
 
-    /* Now iterate for each pixels of this scanline. */
-    for (x = 0; x < GBA_SCREEN_WIDTH; ++x) {
-        int32_t rel_x;          // X coord of the pixel within the bg
-        uint32_t tile_x;        // X coord of the tile in the tilemap
-        uint32_t chr_x;         // X coord of the pixel we want to render within the tile
-        uint32_t chr_vy;        // Y coord of the pixel we want to render within the tile
-        uint32_t screen_idx;
-        uint8_t palette_idx;
-        union tile tile;
-        bool up_x;
-
-        if (mosaic) {
-            rel_x = x / (io->mosaic.bg_hsize + 1) * (io->mosaic.bg_hsize + 1);
-        } else {
-            rel_x = x;
+    if (!mosaic) {
+        uint32_t rel_x;     // X coord of the pixel within the bg
+
+        rel_x = hoffset;
+        x = 0;
+        while (x < GBA_SCREEN_WIDTH) {
+            uint32_t palette_base;
+            uint32_t chr_x;
+            uint32_t end;
+            union tile tile;
+            uint64_t row;
+
+            tile = ppu_text_fetch_tile(gba, screen_addr, bg_size, (rel_x / 8) % 64, tile_y);
+            row = ppu_text_fetch_row(gba, chrs_addr, tile, chr_y, color_256);
+            palette_base = color_256 ? 0 : tile.palette * 16;
+
+            // Only the first tile of the scanline may start in the middle, and only the last may end early.
+            chr_x = rel_x % 8;
+            row >>= chr_x * 8;
+            end = min(x + 8 - chr_x, GBA_SCREEN_WIDTH);
+            rel_x += 8 - chr_x;
+
+            for (; x < end; ++x, row >>= 8) {
+                uint8_t palette_idx;
+
+                palette_idx = row & 0xFF;
+                if (palette_idx) {
+                    scanline->bg[x] = mem_palram_read16(gba, (palette_base + palette_idx) * sizeof(union color));
+                    scanline->bg_flags[x] = PPU_LAYER_VISIBLE;
+                } else {
+                    scanline->bg_flags[x] = 0;
+                }
+            }
         }
-
-        rel_x += io->bg_hoffset[bg_idx].raw;
-
-        tile_x = (rel_x / 8);
-        up_x = tile_x & 0b100000;
-        tile_x %= 32;
-        chr_x = rel_x % 8;
-
-        switch (bg_size) {
-            case 0b00: // 256x256 (32x32)
-                screen_idx = tile_y * 32 + tile_x;
-                break;
-            case 0b01: // 512x256 (64x32)
-                screen_idx = tile_y * 32 + tile_x + up_x * 1024;
-                break;
-            case 0b10: // 256x512 (32x64)
-                screen_idx = tile_y * 32 + tile_x + up_y * 1024;
-                break;
-            case 0b11: // 512x512 (64x64)
-                screen_idx = tile_y * 32 + tile_x + up_x * 1024 + up_y * 2048;
-                break;
-        }
-
-        tile.raw = mem_vram_read16(gba, screen_addr + screen_idx * sizeof(union tile));
-        chr_vy = chr_y ^ tile.vflip * 0b111;
-        chr_x ^= tile.hflip * 0b111;
-
-        if (palette_type) { // 256 colors, 1 palette
-            palette_idx = mem_vram_read8(gba, chrs_addr + tile.number * 64 + chr_vy * 8 + chr_x);
-        } else { // 16 colors, 16 palettes
-
-            /*
-            ** In this mode, each byte represents two pixels:
-            **   * The lower 4 bits define the color of the left pixel
-            **   * The upper 4 bits define the color of the right pixel
-            */
-
-            palette_idx = mem_vram_read8(gba, chrs_addr + tile.number * 32 + chr_vy * 4 + (chr_x >> 1));
-            palette_idx >>= (chr_x % 2) * 4;
-            palette_idx &= 0xF;
+    } else {
+        uint32_t mosaic_size;
+
+        /*
+        ** Each block of `mosaic_size` pixels takes the color of its leftmost pixel, so only one
+        ** pixel is read per block.
+        */
+
+        mosaic_size = io->mosaic.bg_hsize + 1;
+        for (x = 0; x < GBA_SCREEN_WIDTH; x += mosaic_size) {
+            uint32_t rel_x;     // X coord of the pixel within the bg
+            uint32_t end;
+            uint32_t i;
+            union tile tile;
+            uint64_t row;
+            uint8_t palette_idx;
+            uint16_t color;
+
+            rel_x = x + hoffset;
+            tile = ppu_text_fetch_tile(gba, screen_addr, bg_size, (rel_x / 8) % 64, tile_y);
+            row = ppu_text_fetch_row(gba, chrs_addr, tile, chr_y, color_256);
+            palette_idx = (row >> ((rel_x % 8) * 8)) & 0xFF;
+            end = min(x + mosaic_size, GBA_SCREEN_WIDTH);
+
+            if (palette_idx) {
+                color = mem_palram_read16(
+                    gba,
+                    ((color_256 ? 0 : tile.palette * 16) + palette_idx) * sizeof(union color)
+                );
+
+                for (i = x; i < end; ++i) {
+                    scanline->bg[i] = color;
+                    scanline->bg_flags[i] = PPU_LAYER_VISIBLE;
+                }
+            } else {
+                for (i = x; i < end; ++i) {
+                    scanline->bg_flags[i] = 0;
+                }
+            }
         }
+    }
+}
 
-        if (palette_idx) {
-            struct rich_color c;
+/*
+** Render the text background of given index.
+*/
+void
+ppu_render_background_text(
+    struct gba *gba,
+    struct scanline *scanline,
+    uint32_t line,
+    uint32_t bg_idx
+) {
+    struct io const *io;
 
-            c.raw = mem_palram_read16(
-                gba,
-                (tile.palette * 16 * !palette_type + palette_idx) * sizeof(union color)
-            );
+    io = &gba->io;
+    scanline->top_idx = bg_idx;
 
-            c.visible = true;
-            c.idx = bg_idx;
-            c.force_blend = false;
-            scanline->bg[x] = c;
-        } else {
-            scanline->bg[x].visible = false;
-        }
+    switch ((io->bgcnt[bg_idx].palette_type << 1) | io->bgcnt[bg_idx].mosaic) {
+        case 0b00: ppu_render_background_text_template(gba, scanline, line, bg_idx, false, false); break;
+        case 0b01: ppu_render_background_text_template(gba, scanline, line, bg_idx, false, true); break;
+        case 0b10: ppu_render_background_text_template(gba, scanline, line, bg_idx, true, false); break;
+        case 0b11: ppu_render_background_text_template(gba, scanline, line, bg_idx, true, true); break;
     }
 }
@@ -0,0 +1,142 @@
+/******************************************************************************\
+**
+**  This file is part of the Hades GBA Emulator, and is made available under
+**  the terms of the GNU General Public License version 2.
+**
+**  Copyright (C) 2021-2024 - The Hades Authors
+**
+\******************************************************************************/
+
+#include <string.h>
+#include "gba/gba.h"
+#include "gba/ppu.h"
+
+/*
+** The 8bpp tile starting at the last 32 bytes of VRAM is made of those bytes and of the
+** first 32 bytes of the OBJ VRAM mirror (0x06018000-0x0601FFFF mirrors 0x06010000-0x06017FFF).
+*/
+#define PPU_TILE_CACHE_OBJ_TILE     (0x10000 >> PPU_TILE_CACHE_SHIFT)
+
+void
+ppu_tile_cache_init(
+    struct ppu_tile_cache *cache
+) {
+    memset(cache, 0, sizeof(*cache));
+    cache->tiles_4bpp = calloc(PPU_TILE_CACHE_TILES, sizeof(*cache->tiles_4bpp));
+    cache->tiles_8bpp = calloc(PPU_TILE_CACHE_TILES, sizeof(*cache->tiles_8bpp));
+    hs_assert(cache->tiles_4bpp && cache->tiles_8bpp);
+}
+
+void
+ppu_tile_cache_cleanup(
+    struct ppu_tile_cache *cache
+) {
+    free(cache->tiles_4bpp);
+    free(cache->tiles_8bpp);
+    cache->tiles_4bpp = NULL;
+    cache->tiles_8bpp = NULL;
+}
+
+/*
+** Drop all the decoded tiles.
+** Must be called when the content of VRAM is replaced without going through `mem_dirty_mark_range()`.
+*/
+void
+ppu_tile_cache_flush(
+    struct gba *gba
+) {
+    memset(gba->tile_cache.valid_4bpp, 0, sizeof(gba->tile_cache.valid_4bpp));
+    memset(gba->tile_cache.valid_8bpp, 0, sizeof(gba->tile_cache.valid_8bpp));
+}
+
+/*
+** Invalidate the tiles made of any of the `size` bytes starting at `offset` in VRAM.
+** Must be called each time VRAM is written to.
+*/
+void
+ppu_tile_cache_invalidate(
+    struct gba *gba,
+    uint32_t offset,
+    uint32_t size
+) {
+    struct ppu_tile_cache *cache;
+    uint32_t first;
+    uint32_t last;
+    uint32_t tile;
+
+    if (!size) {
+        return ;
+    }
+
+    cache = &gba->tile_cache;
+    first = offset >> PPU_TILE_CACHE_SHIFT;
+    last = min((offset + size - 1) >> PPU_TILE_CACHE_SHIFT, PPU_TILE_CACHE_TILES - 1);
+
+    for (tile = first; tile <= last; ++tile) {
+        cache->valid_4bpp[tile / 64] &= ~(1ull << (tile % 64));
+        cache->valid_8bpp[tile / 64] &= ~(1ull << (tile % 64));
+    }
+
+    // 8bpp tiles span two units of 32 bytes: the one before `first` ends in the written range.
+    if (first) {
+        tile = first - 1;
+        cache->valid_8bpp[tile / 64] &= ~(1ull << (tile % 64));
+    }
+
+    if (first <= PPU_TILE_CACHE_OBJ_TILE && last >= PPU_TILE_CACHE_OBJ_TILE) {
+        tile = PPU_TILE_CACHE_TILES - 1;
+        cache->valid_8bpp[tile / 64] &= ~(1ull << (tile % 64));
+    }
+}
+
+/*
+** Decode the given tile and mark it as valid.
+*/
+void
+ppu_tile_cache_decode(
+    struct gba *gba,
+    uint32_t tile,
+    bool color_256
+) {
+    struct ppu_tile_cache *cache;
+    uint32_t addr;
+    uint32_t y;
+
+    cache = &gba->tile_cache;
+    addr = tile << PPU_TILE_CACHE_SHIFT;
+
+    for (y = 0; y < 8; ++y) {
+        uint64_t row;
+        uint32_t x;
+
+        row = 0;
+        if (color_256) { // 256 colors, 1 palette
+            for (x = 0; x < 8; ++x) {
+                row |= (uint64_t)mem_vram_read8(gba, addr + y * 8 + x) << (x * 8);
+            }
+            cache->tiles_8bpp[tile][y] = row;
+        } else { // 16 colors, 16 palettes
+
+            /*
+            ** In this mode, each byte represents two pixels:
+            **   * The lower 4 bits define the color of the left pixel
+            **   * The upper 4 bits define the color of the right pixel
+            */
+
+            for (x = 0; x < 4; ++x) {
+                uint8_t pixels;
+
+                pixels = mem_vram_read8(gba, addr + y * 4 + x);
+                row |= (uint64_t)(pixels & 0xF) << (x * 16);
+                row |= (uint64_t)(pixels >> 4) << (x * 16 + 8);
+            }
+            cache->tiles_4bpp[tile][y] = row;
+        }
+    }
+
+    if (color_256) {
+        cache->valid_8bpp[tile / 64] |= 1ull << (tile % 64);
+    } else {
+        cache->valid_4bpp[tile / 64] |= 1ull << (tile % 64);
+    }
+}
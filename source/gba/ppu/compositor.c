@@ -0,0 +1,680 @@
+/******************************************************************************\
+**
+**  This file is part of the Hades GBA Emulator, and is made available under
+**  the terms of the GNU General Public License version 2.
+**
+**  Copyright (C) 2021-2024 - The Hades Authors
+**
+\******************************************************************************/
+
+/*
+** The compositor of the PPU.
+**
+** Every kernel comes in three flavors: a portable one and two processing 8 (SSE2) or 16 (AVX2)
+** pixels at once. They all produce the exact same result: the vectorized ones only replace the
+** branches of the portable one with masks.
+**
+** `ppu_compositor_select()` picks the fastest one at runtime, so the emulator can be built
+** for any x86 CPU and still use AVX2 when it's available.
+*/
+
+#include "gba/gba.h"
+#include "gba/ppu.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+# define COMPOSITOR_X86
+# include <immintrin.h>
+#endif
+
+static_assert(GBA_SCREEN_WIDTH % 16 == 0);
+
+/*
+** Portable kernels
+*/
+
+static inline
+uint16_t
+compositor_alpha(
+    uint16_t top,
+    uint16_t bot,
+    uint32_t eva,
+    uint32_t evb
+) {
+    uint32_t red;
+    uint32_t green;
+    uint32_t blue;
+
+    red = min(31, ((uint32_t)(top & 0x1F) * eva + (uint32_t)(bot & 0x1F) * evb) >> 4);
+    green = min(31, ((uint32_t)((top >> 5) & 0x1F) * eva + (uint32_t)((bot >> 5) & 0x1F) * evb) >> 4);
+    blue = min(31, ((uint32_t)((top >> 10) & 0x1F) * eva + (uint32_t)((bot >> 10) & 0x1F) * evb) >> 4);
+    return (red | (green << 5) | (blue << 10));
+}
+
+static inline
+uint16_t
+compositor_light(
+    uint16_t top,
+    uint32_t evy
+) {
+    uint32_t red;
+    uint32_t green;
+    uint32_t blue;
+
+    red = top & 0x1F;
+    green = (top >> 5) & 0x1F;
+    blue = (top >> 10) & 0x1F;
+    red += ((31 - red) * evy) >> 4;
+    green += ((31 - green) * evy) >> 4;
+    blue += ((31 - blue) * evy) >> 4;
+    return (red | (green << 5) | (blue << 10));
+}
+
+static inline
+uint16_t
+compositor_dark(
+    uint16_t top,
+    uint32_t evy
+) {
+    uint32_t red;
+    uint32_t green;
+    uint32_t blue;
+
+    red = top & 0x1F;
+    green = (top >> 5) & 0x1F;
+    blue = (top >> 10) & 0x1F;
+    red -= (red * evy) >> 4;
+    green -= (green * evy) >> 4;
+    blue -= (blue * evy) >> 4;
+    return (red | (green << 5) | (blue << 10));
+}
+
+static
+void
+compositor_build_win_opts_scalar(
+    struct scanline *scanline,
+    bool const *win0,
+    bool const *win1,
+    uint8_t const opts[WIN_MAX + 1]
+) {
+    uint32_t x;
+
+    for (x = 0; x < GBA_SCREEN_WIDTH; ++x) {
+        if (win0[x]) {
+            scanline->win_opts[x] = opts[WIN0];
+        } else if (win1[x]) {
+            scanline->win_opts[x] = opts[WIN1];
+        } else if (scanline->win_obj_mask[x]) {
+            scanline->win_opts[x] = opts[WINOBJ];
+        } else {
+            scanline->win_opts[x] = opts[WIN_MAX];
+        }
+    }
+}
+
+static
+void
+compositor_merge_scalar(
+    struct scanline *scanline,
+    uint16_t const *colors,
+    uint8_t const *flags,
+    uint8_t const *prios,
+    struct ppu_blend const *blend
+) {
+    uint32_t x;
+
+    for (x = 0; x < GBA_SCREEN_WIDTH; ++x) {
+        uint16_t top;
+        uint8_t pixel_flags;
+        uint8_t win;
+        bool effects;
+        bool bot_target;
+
+        pixel_flags = flags[x];
+        win = blend->windowed ? scanline->win_opts[x] : 0xFF;
+
+        /* Skip transparent pixels, those of another priority and those hidden by the windows */
+        if (!(pixel_flags & PPU_LAYER_VISIBLE) || (prios && prios[x] != blend->prio) || !(win & blend->win_bit)) {
+            continue;
+        }
+
+        top = colors[x];
+        effects = (win & PPU_WIN_BLEND);
+        bot_target = scanline->bot_target[x];
+
+        /* Sprites can force blending no matter what BLDCNT and the windows say */
+        if (bot_target && ((pixel_flags & PPU_LAYER_FORCE_BLEND) || (effects && blend->mode == BLEND_ALPHA))) {
+            scanline->result[x] = compositor_alpha(top, scanline->bot[x], blend->eva, blend->evb);
+        } else if (effects && blend->mode == BLEND_LIGHT) {
+            scanline->result[x] = compositor_light(top, blend->evy);
+        } else if (effects && blend->mode == BLEND_DARK) {
+            scanline->result[x] = compositor_dark(top, blend->evy);
+        } else {
+            scanline->result[x] = top;
+        }
+
+        scanline->bot[x] = top;
+        scanline->bot_target[x] = blend->bot_target;
+    }
+}
+
+static
+void
+compositor_draw_scalar(
+    uint32_t *pixels,
+    struct scanline const *scanline
+) {
+    uint32_t x;
+
+    for (x = 0; x < GBA_SCREEN_WIDTH; ++x) {
+        uint32_t red;
+        uint32_t green;
+        uint32_t blue;
+        uint16_t c;
+
+        c = scanline->result[x];
+        red = c & 0x1F;
+        green = (c >> 5) & 0x1F;
+        blue = (c >> 10) & 0x1F;
+        pixels[x] = 0xFF000000
+            | ((red   << 3) | (red   >> 2)) << 0
+            | ((green << 3) | (green >> 2)) << 8
+            | ((blue  << 3) | (blue  >> 2)) << 16
+        ;
+    }
+}
+
+static struct ppu_compositor const compositor_scalar = {
+    .build_win_opts = compositor_build_win_opts_scalar,
+    .merge = compositor_merge_scalar,
+    .draw = compositor_draw_scalar,
+};
+
+#ifdef COMPOSITOR_X86
+
+/*
+** SSE2 kernels, 8 pixels at once (16 for the window flags).
+**
+** The masks are made of 16-bit lanes that are either all set or all cleared.
+*/
+
+#define SSE2 __attribute__((target("sse2")))
+
+SSE2
+static inline
+__m128i
+sse2_select(
+    __m128i mask,
+    __m128i a,
+    __m128i b
+) {
+    return (_mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)));
+}
+
+SSE2
+static inline
+__m128i
+sse2_test16(
+    __m128i v,
+    uint16_t bits
+) {
+    return (_mm_xor_si128(_mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16(bits)), _mm_setzero_si128()), _mm_set1_epi16(-1)));
+}
+
+SSE2
+static inline
+__m128i
+sse2_load8(
+    uint8_t const *p
+) {
+    return (_mm_unpacklo_epi8(_mm_loadl_epi64((__m128i const *)p), _mm_setzero_si128()));
+}
+
+SSE2
+static inline
+__m128i
+sse2_alpha(
+    __m128i top,
+    __m128i bot,
+    __m128i eva,
+    __m128i evb
+) {
+    __m128i const mask = _mm_set1_epi16(0x1F);
+    __m128i red;
+    __m128i green;
+    __m128i blue;
+
+    red = _mm_add_epi16(_mm_mullo_epi16(_mm_and_si128(top, mask), eva), _mm_mullo_epi16(_mm_and_si128(bot, mask), evb));
+    green = _mm_add_epi16(
+        _mm_mullo_epi16(_mm_and_si128(_mm_srli_epi16(top, 5), mask), eva),
+        _mm_mullo_epi16(_mm_and_si128(_mm_srli_epi16(bot, 5), mask), evb)
+    );
+    blue = _mm_add_epi16(
+        _mm_mullo_epi16(_mm_and_si128(_mm_srli_epi16(top, 10), mask), eva),
+        _mm_mullo_epi16(_mm_and_si128(_mm_srli_epi16(bot, 10), mask), evb)
+    );
+    red = _mm_min_epi16(_mm_srli_epi16(red, 4), mask);
+    green = _mm_min_epi16(_mm_srli_epi16(green, 4), mask);
+    blue = _mm_min_epi16(_mm_srli_epi16(blue, 4), mask);
+    return (_mm_or_si128(red, _mm_or_si128(_mm_slli_epi16(green, 5), _mm_slli_epi16(blue, 10))));
+}
+
+SSE2
+static inline
+__m128i
+sse2_light_or_dark(
+    __m128i top,
+    __m128i evy,
+    bool light
+) {
+    __m128i const mask = _mm_set1_epi16(0x1F);
+    __m128i red;
+    __m128i green;
+    __m128i blue;
+
+    red = _mm_and_si128(top, mask);
+    green = _mm_and_si128(_mm_srli_epi16(top, 5), mask);
+    blue = _mm_and_si128(_mm_srli_epi16(top, 10), mask);
+    if (light) {
+        red = _mm_add_epi16(red, _mm_srli_epi16(_mm_mullo_epi16(_mm_sub_epi16(mask, red), evy), 4));
+        green = _mm_add_epi16(green, _mm_srli_epi16(_mm_mullo_epi16(_mm_sub_epi16(mask, green), evy), 4));
+        blue = _mm_add_epi16(blue, _mm_srli_epi16(_mm_mullo_epi16(_mm_sub_epi16(mask, blue), evy), 4));
+    } else {
+        red = _mm_sub_epi16(red, _mm_srli_epi16(_mm_mullo_epi16(red, evy), 4));
+        green = _mm_sub_epi16(green, _mm_srli_epi16(_mm_mullo_epi16(green, evy), 4));
+        blue = _mm_sub_epi16(blue, _mm_srli_epi16(_mm_mullo_epi16(blue, evy), 4));
+    }
+    return (_mm_or_si128(red, _mm_or_si128(_mm_slli_epi16(green, 5), _mm_slli_epi16(blue, 10))));
+}
+
+SSE2
+static
+void
+compositor_build_win_opts_sse2(
+    struct scanline *scanline,
+    bool const *win0,
+    bool const *win1,
+    uint8_t const opts[WIN_MAX + 1]
+) {
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const opts_win0 = _mm_set1_epi8(opts[WIN0]);
+    __m128i const opts_win1 = _mm_set1_epi8(opts[WIN1]);
+    __m128i const opts_winobj = _mm_set1_epi8(opts[WINOBJ]);
+    __m128i const opts_winout = _mm_set1_epi8(opts[WIN_MAX]);
+    uint32_t x;
+
+    for (x = 0; x < GBA_SCREEN_WIDTH; x += 16) {
+        __m128i out_win0;
+        __m128i out_win1;
+        __m128i out_winobj;
+        __m128i win;
+
+        // Those masks are set where the pixel is *outside* the window
+        out_win0 = _mm_cmpeq_epi8(_mm_loadu_si128((__m128i const *)(win0 + x)), zero);
+        out_win1 = _mm_cmpeq_epi8(_mm_loadu_si128((__m128i const *)(win1 + x)), zero);
+        out_winobj = _mm_cmpeq_epi8(_mm_loadu_si128((__m128i const *)(scanline->win_obj_mask + x)), zero);
+
+        win = sse2_select(out_winobj, opts_winout, opts_winobj);
+        win = sse2_select(out_win1, win, opts_win1);
+        win = sse2_select(out_win0, win, opts_win0);
+        _mm_store_si128((__m128i *)(scanline->win_opts + x), win);
+    }
+}
+
+SSE2
+static
+void
+compositor_merge_sse2(
+    struct scanline *scanline,
+    uint16_t const *colors,
+    uint8_t const *flags,
+    uint8_t const *prios,
+    struct ppu_blend const *blend
+) {
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const eva = _mm_set1_epi16(blend->eva);
+    __m128i const evb = _mm_set1_epi16(blend->evb);
+    __m128i const evy = _mm_set1_epi16(blend->evy);
+    __m128i const is_alpha = _mm_set1_epi16(blend->mode == BLEND_ALPHA ? -1 : 0);
+    __m128i const is_effect = _mm_set1_epi16(blend->mode == BLEND_LIGHT || blend->mode == BLEND_DARK ? -1 : 0);
+    __m128i const new_bot_target = _mm_set1_epi16(blend->bot_target);
+    __m128i const prio = _mm_set1_epi16(blend->prio);
+    bool const light_or_dark = (blend->mode == BLEND_LIGHT || blend->mode == BLEND_DARK);
+    uint32_t x;
+
+    for (x = 0; x < GBA_SCREEN_WIDTH; x += 8) {
+        __m128i pixel_flags;
+        __m128i win;
+        __m128i active;
+        __m128i effects;
+        __m128i bot_target;
+        __m128i do_alpha;
+        __m128i do_effect;
+        __m128i top;
+        __m128i bot;
+        __m128i out;
+
+        pixel_flags = sse2_load8(flags + x);
+        win = blend->windowed ? sse2_load8(scanline->win_opts + x) : _mm_set1_epi16(0xFF);
+
+        active = _mm_and_si128(sse2_test16(pixel_flags, PPU_LAYER_VISIBLE), sse2_test16(win, blend->win_bit));
+        if (prios) {
+            active = _mm_and_si128(active, _mm_cmpeq_epi16(sse2_load8(prios + x), prio));
+        }
+        if (!_mm_movemask_epi8(active)) {
+            continue;
+        }
+
+        top = _mm_load_si128((__m128i const *)(colors + x));
+        bot = _mm_load_si128((__m128i const *)(scanline->bot + x));
+        bot_target = sse2_load8(scanline->bot_target + x);
+        effects = sse2_test16(win, PPU_WIN_BLEND);
+
+        do_alpha = _mm_andnot_si128(
+            _mm_cmpeq_epi16(bot_target, zero),
+            _mm_or_si128(sse2_test16(pixel_flags, PPU_LAYER_FORCE_BLEND), _mm_and_si128(effects, is_alpha))
+        );
+        do_effect = _mm_andnot_si128(do_alpha, _mm_and_si128(effects, is_effect));
+
+        out = top;
+        if (light_or_dark && _mm_movemask_epi8(do_effect)) {
+            out = sse2_select(do_effect, sse2_light_or_dark(top, evy, blend->mode == BLEND_LIGHT), out);
+        }
+        if (_mm_movemask_epi8(do_alpha)) {
+            out = sse2_select(do_alpha, sse2_alpha(top, bot, eva, evb), out);
+        }
+
+        out = sse2_select(active, out, _mm_load_si128((__m128i const *)(scanline->result + x)));
+        bot = sse2_select(active, top, bot);
+        bot_target = sse2_select(active, new_bot_target, bot_target);
+
+        _mm_store_si128((__m128i *)(scanline->result + x), out);
+        _mm_store_si128((__m128i *)(scanline->bot + x), bot);
+        _mm_storel_epi64((__m128i *)(scanline->bot_target + x), _mm_packus_epi16(bot_target, bot_target));
+    }
+}
+
+SSE2
+static
+void
+compositor_draw_sse2(
+    uint32_t *pixels,
+    struct scanline const *scanline
+) {
+    __m128i const mask = _mm_set1_epi16(0x1F);
+    __m128i const alpha = _mm_set1_epi16((int16_t)0xFF00);
+    uint32_t x;
+
+    for (x = 0; x < GBA_SCREEN_WIDTH; x += 8) {
+        __m128i c;
+        __m128i red;
+        __m128i green;
+        __m128i blue;
+        __m128i red_green;
+        __m128i blue_alpha;
+
+        c = _mm_load_si128((__m128i const *)(scanline->result + x));
+        red = _mm_and_si128(c, mask);
+        green = _mm_and_si128(_mm_srli_epi16(c, 5), mask);
+        blue = _mm_and_si128(_mm_srli_epi16(c, 10), mask);
+
+        // Expand each channel from 5 to 8 bits
+        red = _mm_or_si128(_mm_slli_epi16(red, 3), _mm_srli_epi16(red, 2));
+        green = _mm_or_si128(_mm_slli_epi16(green, 3), _mm_srli_epi16(green, 2));
+        blue = _mm_or_si128(_mm_slli_epi16(blue, 3), _mm_srli_epi16(blue, 2));
+
+        red_green = _mm_or_si128(red, _mm_slli_epi16(green, 8));
+        blue_alpha = _mm_or_si128(blue, alpha);
+        _mm_storeu_si128((__m128i *)(pixels + x), _mm_unpacklo_epi16(red_green, blue_alpha));
+        _mm_storeu_si128((__m128i *)(pixels + x + 4), _mm_unpackhi_epi16(red_green, blue_alpha));
+    }
+}
+
+static struct ppu_compositor const compositor_sse2 = {
+    .build_win_opts = compositor_build_win_opts_sse2,
+    .merge = compositor_merge_sse2,
+    .draw = compositor_draw_sse2,
+};
+
+/*
+** AVX2 kernels, 16 pixels at once.
+**
+** The window flags are built with the SSE2 kernel: they are only 240 bytes long.
+*/
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2
+static inline
+__m256i
+avx2_select(
+    __m256i mask,
+    __m256i a,
+    __m256i b
+) {
+    return (_mm256_blendv_epi8(b, a, mask));
+}
+
+AVX2
+static inline
+__m256i
+avx2_test16(
+    __m256i v,
+    uint16_t bits
+) {
+    return (_mm256_xor_si256(_mm256_cmpeq_epi16(_mm256_and_si256(v, _mm256_set1_epi16(bits)), _mm256_setzero_si256()), _mm256_set1_epi16(-1)));
+}
+
+AVX2
+static inline
+__m256i
+avx2_load8(
+    uint8_t const *p
+) {
+    return (_mm256_cvtepu8_epi16(_mm_load_si128((__m128i const *)p)));
+}
+
+AVX2
+static inline
+__m256i
+avx2_alpha(
+    __m256i top,
+    __m256i bot,
+    __m256i eva,
+    __m256i evb
+) {
+    __m256i const mask = _mm256_set1_epi16(0x1F);
+    __m256i red;
+    __m256i green;
+    __m256i blue;
+
+    red = _mm256_add_epi16(
+        _mm256_mullo_epi16(_mm256_and_si256(top, mask), eva),
+        _mm256_mullo_epi16(_mm256_and_si256(bot, mask), evb)
+    );
+    green = _mm256_add_epi16(
+        _mm256_mullo_epi16(_mm256_and_si256(_mm256_srli_epi16(top, 5), mask), eva),
+        _mm256_mullo_epi16(_mm256_and_si256(_mm256_srli_epi16(bot, 5), mask), evb)
+    );
+    blue = _mm256_add_epi16(
+        _mm256_mullo_epi16(_mm256_and_si256(_mm256_srli_epi16(top, 10), mask), eva),
+        _mm256_mullo_epi16(_mm256_and_si256(_mm256_srli_epi16(bot, 10), mask), evb)
+    );
+    red = _mm256_min_epi16(_mm256_srli_epi16(red, 4), mask);
+    green = _mm256_min_epi16(_mm256_srli_epi16(green, 4), mask);
+    blue = _mm256_min_epi16(_mm256_srli_epi16(blue, 4), mask);
+    return (_mm256_or_si256(red, _mm256_or_si256(_mm256_slli_epi16(green, 5), _mm256_slli_epi16(blue, 10))));
+}
+
+AVX2
+static inline
+__m256i
+avx2_light_or_dark(
+    __m256i top,
+    __m256i evy,
+    bool light
+) {
+    __m256i const mask = _mm256_set1_epi16(0x1F);
+    __m256i red;
+    __m256i green;
+    __m256i blue;
+
+    red = _mm256_and_si256(top, mask);
+    green = _mm256_and_si256(_mm256_srli_epi16(top, 5), mask);
+    blue = _mm256_and_si256(_mm256_srli_epi16(top, 10), mask);
+    if (light) {
+        red = _mm256_add_epi16(red, _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(mask, red), evy), 4));
+        green = _mm256_add_epi16(green, _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(mask, green), evy), 4));
+        blue = _mm256_add_epi16(blue, _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(mask, blue), evy), 4));
+    } else {
+        red = _mm256_sub_epi16(red, _mm256_srli_epi16(_mm256_mullo_epi16(red, evy), 4));
+        green = _mm256_sub_epi16(green, _mm256_srli_epi16(_mm256_mullo_epi16(green, evy), 4));
+        blue = _mm256_sub_epi16(blue, _mm256_srli_epi16(_mm256_mullo_epi16(blue, evy), 4));
+    }
+    return (_mm256_or_si256(red, _mm256_or_si256(_mm256_slli_epi16(green, 5), _mm256_slli_epi16(blue, 10))));
+}
+
+AVX2
+static
+void
+compositor_merge_avx2(
+    struct scanline *scanline,
+    uint16_t const *colors,
+    uint8_t const *flags,
+    uint8_t const *prios,
+    struct ppu_blend const *blend
+) {
+    __m256i const zero = _mm256_setzero_si256();
+    __m256i const eva = _mm256_set1_epi16(blend->eva);
+    __m256i const evb = _mm256_set1_epi16(blend->evb);
+    __m256i const evy = _mm256_set1_epi16(blend->evy);
+    __m256i const is_alpha = _mm256_set1_epi16(blend->mode == BLEND_ALPHA ? -1 : 0);
+    __m256i const is_effect = _mm256_set1_epi16(blend->mode == BLEND_LIGHT || blend->mode == BLEND_DARK ? -1 : 0);
+    __m256i const new_bot_target = _mm256_set1_epi16(blend->bot_target);
+    __m256i const prio = _mm256_set1_epi16(blend->prio);
+    bool const light_or_dark = (blend->mode == BLEND_LIGHT || blend->mode == BLEND_DARK);
+    uint32_t x;
+
+    for (x = 0; x < GBA_SCREEN_WIDTH; x += 16) {
+        __m256i pixel_flags;
+        __m256i win;
+        __m256i active;
+        __m256i effects;
+        __m256i bot_target;
+        __m256i do_alpha;
+        __m256i do_effect;
+        __m256i top;
+        __m256i bot;
+        __m256i out;
+
+        pixel_flags = avx2_load8(flags + x);
+        win = blend->windowed ? avx2_load8(scanline->win_opts + x) : _mm256_set1_epi16(0xFF);
+
+        active = _mm256_and_si256(avx2_test16(pixel_flags, PPU_LAYER_VISIBLE), avx2_test16(win, blend->win_bit));
+        if (prios) {
+            active = _mm256_and_si256(active, _mm256_cmpeq_epi16(avx2_load8(prios + x), prio));
+        }
+        if (_mm256_testz_si256(active, active)) {
+            continue;
+        }
+
+        top = _mm256_load_si256((__m256i const *)(colors + x));
+        bot = _mm256_load_si256((__m256i const *)(scanline->bot + x));
+        bot_target = avx2_load8(scanline->bot_target + x);
+        effects = avx2_test16(win, PPU_WIN_BLEND);
+
+        do_alpha = _mm256_andnot_si256(
+            _mm256_cmpeq_epi16(bot_target, zero),
+            _mm256_or_si256(avx2_test16(pixel_flags, PPU_LAYER_FORCE_BLEND), _mm256_and_si256(effects, is_alpha))
+        );
+        do_effect = _mm256_andnot_si256(do_alpha, _mm256_and_si256(effects, is_effect));
+
+        out = top;
+        if (light_or_dark && !_mm256_testz_si256(do_effect, do_effect)) {
+            out = avx2_select(do_effect, avx2_light_or_dark(top, evy, blend->mode == BLEND_LIGHT), out);
+        }
+        if (!_mm256_testz_si256(do_alpha, do_alpha)) {
+            out = avx2_select(do_alpha, avx2_alpha(top, bot, eva, evb), out);
+        }
+
+        out = avx2_select(active, out, _mm256_load_si256((__m256i const *)(scanline->result + x)));
+        bot = avx2_select(active, top, bot);
+        bot_target = avx2_select(active, new_bot_target, bot_target);
+
+        _mm256_store_si256((__m256i *)(scanline->result + x), out);
+        _mm256_store_si256((__m256i *)(scanline->bot + x), bot);
+
+        // `packus` works within each 128-bit lane: gather the two halves in the low one.
+        bot_target = _mm256_permute4x64_epi64(_mm256_packus_epi16(bot_target, bot_target), 0x08);
+        _mm_store_si128((__m128i *)(scanline->bot_target + x), _mm256_castsi256_si128(bot_target));
+    }
+}
+
+AVX2
+static
+void
+compositor_draw_avx2(
+    uint32_t *pixels,
+    struct scanline const *scanline
+) {
+    __m256i const mask = _mm256_set1_epi16(0x1F);
+    __m256i const alpha = _mm256_set1_epi16((int16_t)0xFF00);
+    uint32_t x;
+
+    for (x = 0; x < GBA_SCREEN_WIDTH; x += 16) {
+        __m256i c;
+        __m256i red;
+        __m256i green;
+        __m256i blue;
+        __m256i red_green;
+        __m256i blue_alpha;
+        __m256i lo;
+        __m256i hi;
+
+        c = _mm256_load_si256((__m256i const *)(scanline->result + x));
+        red = _mm256_and_si256(c, mask);
+        green = _mm256_and_si256(_mm256_srli_epi16(c, 5), mask);
+        blue = _mm256_and_si256(_mm256_srli_epi16(c, 10), mask);
+
+        // Expand each channel from 5 to 8 bits
+        red = _mm256_or_si256(_mm256_slli_epi16(red, 3), _mm256_srli_epi16(red, 2));
+        green = _mm256_or_si256(_mm256_slli_epi16(green, 3), _mm256_srli_epi16(green, 2));
+        blue = _mm256_or_si256(_mm256_slli_epi16(blue, 3), _mm256_srli_epi16(blue, 2));
+
+        red_green = _mm256_or_si256(red, _mm256_slli_epi16(green, 8));
+        blue_alpha = _mm256_or_si256(blue, alpha);
+
+        // The unpacks work within each 128-bit lane: `lo` holds pixels 0-3 and 8-11, `hi` 4-7 and 12-15.
+        lo = _mm256_unpacklo_epi16(red_green, blue_alpha);
+        hi = _mm256_unpackhi_epi16(red_green, blue_alpha);
+        _mm256_storeu_si256((__m256i *)(pixels + x), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i *)(pixels + x + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+}
+
+static struct ppu_compositor const compositor_avx2 = {
+    .build_win_opts = compositor_build_win_opts_sse2,
+    .merge = compositor_merge_avx2,
+    .draw = compositor_draw_avx2,
+};
+
+#endif /* COMPOSITOR_X86 */
+
+/*
+** Return the fastest compositor supported by the host's CPU.
+*/
+struct ppu_compositor const *
+ppu_compositor_select(
+    void
+) {
+#ifdef COMPOSITOR_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        return (&compositor_avx2);
+    } else if (__builtin_cpu_supports("sse2")) {
+        return (&compositor_sse2);
+    }
+#endif
+
+    return (&compositor_scalar);
+}
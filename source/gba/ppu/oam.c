@@ -22,40 +22,93 @@
 **  0110: 32 x 16        1110: Not used
 **  0111: 64 x 32        1111: Not used
 */
-int32_t sprite_size_x[16] = { 8, 16, 32, 64, 16, 32, 32, 64, 8, 8, 16, 32, 0, 0, 0, 0};
-int32_t sprite_size_y[16] = { 8, 16, 32, 64, 8, 8, 16, 32, 16, 32, 32, 64, 0, 0, 0, 0};
+static int32_t const sprite_size_x[16] = { 8, 16, 32, 64, 16, 32, 32, 64, 8, 8, 16, 32, 0, 0, 0, 0};
+static int32_t const sprite_size_y[16] = { 8, 16, 32, 64, 8, 8, 16, 32, 16, 32, 32, 64, 0, 0, 0, 0};
 
 /*
-** Pre-render all visible sprites.
+** Return the offset within VRAM of the tile at the given coordinates within the sprite.
+*/
+static inline
+uint32_t
+ppu_oam_tile_offset(
+    struct io const *io,
+    union oam_entry const *oam,
+    int32_t sprite_sx,
+    uint32_t tile_x,
+    uint32_t tile_y
+) {
+    uint32_t tile_offset;   // Within VRAM
+    uint32_t tile_size;     // In bytes
+
+    tile_size = oam->color_256 ? 64 : 32;
+    tile_offset = 0x10000 + oam->tile_idx * 32;
+
+    if (io->dispcnt.obj_dim) { // 1 Dimension
+        tile_offset += tile_y * (sprite_sx / 8) * tile_size + tile_x * tile_size;
+    } else { // 2 Dimension
+        tile_offset += tile_y * 32 * 32 + tile_x * tile_size;
+    }
+    return (tile_offset);
+}
+
+/*
+** Draw the pixel of the given sprite at the given X coordinate, if its palette index isn't 0.
 */
+static inline
 void
-ppu_prerender_oam(
-    struct gba *gba,
+ppu_oam_draw_pixel(
+    struct gba const *gba,
     struct scanline *scanline,
-    int32_t line
+    union oam_entry const *oam,
+    int32_t x,
+    uint32_t palette_idx
 ) {
-    uint32_t bg_mode;
-    struct io const *io;
-    int32_t oam_idx;
+    if (!palette_idx) {
+        return ;
+    }
 
-    io = &gba->io;
-    bg_mode = io->dispcnt.bg_mode;
+    if (oam->mode == OAM_MODE_WINDOW) {
+        scanline->win_obj_mask[x] = true;
+    } else if (!scanline->obj_flags[x] || oam->priority <= scanline->obj_prio[x]) {
 
-    if (!io->dispcnt.obj) {
-        return;
+        /*
+        ** The sprites are rendered from the last to the first, so the first sprite
+        ** of the highest priority ends up in front.
+        */
+
+        // 16-bits palette mode
+        if (!oam->color_256) {
+            palette_idx += oam->palette_num * 16;
+        }
+
+        scanline->obj[x] = mem_palram_read16(gba, 0x200 + palette_idx * sizeof(union color));
+        scanline->obj_flags[x] = PPU_LAYER_VISIBLE | (oam->mode == OAM_MODE_BLEND ? PPU_LAYER_FORCE_BLEND : 0);
+        scanline->obj_prio[x] = oam->priority;
+        scanline->obj_prios |= 1 << oam->priority;
     }
+}
+
+/*
+** Decode all the entries of OAM and list, for each visible line, the sprites crossing it.
+*/
+static
+void
+ppu_oam_cache_rebuild(
+    struct gba *gba
+) {
+    struct ppu_oam_cache *cache;
+    int32_t oam_idx;
+
+    cache = &gba->oam_cache;
+    memset(cache->lines_len, 0, sizeof(cache->lines_len));
 
     for (oam_idx = 127; oam_idx >= 0; --oam_idx) {
+        struct ppu_sprite *sprite;
         union oam_entry oam;
-        int32_t x;
-
-        int32_t win_oy;
-        int32_t win_ox;
-        int32_t win_sx;
-        int32_t win_sy;
-        int32_t sprite_sx;
-        int32_t sprite_sy;
+        int32_t line;
+        int32_t line_end;
 
+        sprite = &cache->sprites[oam_idx];
         oam.raw[0] = mem_oam_read16(gba, (oam_idx * 4 + 0) * 2);
         oam.raw[1] = mem_oam_read16(gba, (oam_idx * 4 + 1) * 2);
         oam.raw[2] = mem_oam_read16(gba, (oam_idx * 4 + 2) * 2);
@@ -65,145 +118,224 @@ ppu_prerender_oam(
             continue;
         }
 
-        // Skip OAM entries of index < 512 for BG mode 3-5
-        if (bg_mode >= 3 && bg_mode <= 5 && oam.tile_idx < 512) {
+        sprite->oam = oam;
+        sprite->win_oy = oam.coord_y;
+        sprite->win_ox = sign_extend9(oam.coord_x);
+        sprite->sprite_sx = sprite_size_x[(oam.size_high << 2) | oam.size_low];
+        sprite->sprite_sy = sprite_size_y[(oam.size_high << 2) | oam.size_low];
+        sprite->win_sx = sprite->sprite_sx;
+        sprite->win_sy = sprite->sprite_sy;
+
+        if (oam.affine && oam.virt_dsize) {
+            sprite->win_sx *= 2;
+            sprite->win_sy *= 2;
+        }
+
+        if (sprite->win_oy + sprite->win_sy >= 255) { // TODO Improve this for super large sprite
+            sprite->win_oy -= 256;
+        }
+
+        // Clip the sprite to the screen, skipping it entirely if it's outside of it.
+        sprite->x_start = max(0, -sprite->win_ox);
+        sprite->x_end = min(sprite->win_sx, GBA_SCREEN_WIDTH - sprite->win_ox);
+        if (sprite->x_start >= sprite->x_end) {
             continue;
         }
 
-        win_oy = oam.coord_y;
-        win_ox = sign_extend9(oam.coord_x);
-        sprite_sx = sprite_size_x[(oam.size_high << 2) | oam.size_low];
-        sprite_sy = sprite_size_y[(oam.size_high << 2) | oam.size_low];
-        win_sx = sprite_sx;
-        win_sy = sprite_sy;
+        if (oam.affine) {
+            sprite->pa = (int16_t)mem_oam_read16(gba, oam.affine_data_idx * 32 + 0x6);
+            sprite->pb = (int16_t)mem_oam_read16(gba, oam.affine_data_idx * 32 + 0xe);
+            sprite->pc = (int16_t)mem_oam_read16(gba, oam.affine_data_idx * 32 + 0x16);
+            sprite->pd = (int16_t)mem_oam_read16(gba, oam.affine_data_idx * 32 + 0x1e);
+        } else { // Identity matrix
+            sprite->pa = 0x100;
+            sprite->pb = 0;
+            sprite->pc = 0;
+            sprite->pd = 0x100;
+        }
 
-        if (oam.affine && oam.virt_dsize) {
-            win_sx *= 2;
-            win_sy *= 2;
+        line_end = min(sprite->win_oy + sprite->win_sy, GBA_SCREEN_HEIGHT);
+        for (line = max(sprite->win_oy, 0); line < line_end; ++line) {
+            cache->lines[line][cache->lines_len[line]++] = oam_idx;
+        }
+    }
+
+    cache->dirty = false;
+}
+
+/*
+** Render the given line of a sprite that is neither affine nor mosaic, one tile row at a time.
+*/
+static
+void
+ppu_render_regular_sprite(
+    struct gba *gba,
+    struct scanline *scanline,
+    struct ppu_sprite const *sprite,
+    int32_t rel_y
+) {
+    union oam_entry const *oam;
+    struct io const *io;
+    uint32_t tile_y;
+    uint32_t chr_y;
+    int32_t tiles;
+    int32_t i;
+
+    io = &gba->io;
+    oam = &sprite->oam;
+    tiles = sprite->sprite_sx / 8;
+    tile_y = rel_y / 8;
+    chr_y = rel_y % 8;
+
+    // Flip vertically
+    if (oam->vflip) {
+        tile_y = (sprite->sprite_sy / 8) - 1 - tile_y;
+        chr_y ^= 0b111;
+    }
+
+    // Only walk the tiles that are, at least partially, on screen
+    for (i = sprite->x_start / 8; i * 8 < sprite->x_end; ++i) {
+        uint64_t const *rows;
+        uint32_t tile_x;
+        uint64_t row;
+        int32_t first;
+        int32_t last;
+        int32_t x;
+
+        // Flip horizontally: the row is read from the other tile, with its pixels reversed
+        tile_x = oam->hflip ? tiles - 1 - i : i;
+        rows = ppu_tile_cache_get(gba, ppu_oam_tile_offset(io, oam, sprite->sprite_sx, tile_x, tile_y), oam->color_256);
+        row = oam->hflip ? __builtin_bswap64(rows[chr_y]) : rows[chr_y];
+
+        first = max(sprite->x_start - i * 8, 0);
+        last = min(sprite->x_end - i * 8, 8);
+        row >>= first * 8;
+
+        for (x = first; x < last && row; ++x, row >>= 8) {
+            ppu_oam_draw_pixel(gba, scanline, oam, sprite->win_ox + i * 8 + x, row & 0xFF);
+        }
+    }
+}
+
+/*
+** Render the given line of an affine or mosaic sprite, one pixel at a time.
+*/
+static
+void
+ppu_render_affine_sprite(
+    struct gba *gba,
+    struct scanline *scanline,
+    struct ppu_sprite const *sprite,
+    int32_t line
+) {
+    union oam_entry const *oam;
+    struct io const *io;
+    int32_t px;
+    int32_t py;
+    int32_t x;
+
+    io = &gba->io;
+    oam = &sprite->oam;
+
+    /*
+    ** We pre-compute PX and PY for the first visible pixel and simply add the difference when X is increased.
+    */
+    px = sprite->pa * (sprite->x_start - sprite->win_sx / 2)
+        + sprite->pb * ((line - sprite->win_oy) - (sprite->win_sy / 2))
+        + ((sprite->sprite_sx / 2) << 8)
+    ;
+    py = sprite->pc * (sprite->x_start - sprite->win_sx / 2)
+        + sprite->pd * ((line - sprite->win_oy) - (sprite->win_sy / 2))
+        + ((sprite->sprite_sy / 2) << 8)
+    ;
+
+    for (x = sprite->x_start; x < sprite->x_end; ++x, px += sprite->pa, py += sprite->pc) {
+        uint64_t const *rows;
+        int32_t rel_x;          // X coordinate of the pixel within the sprite
+        int32_t rel_y;          // Y coordinate of the pixel within the sprite
+        uint32_t chr_x;         // X coordinate of the pixel within the tile (0-7)
+        uint32_t chr_y;         // Y coordinate of the pixel within the tile (0-7)
+        uint32_t tile_x;        // X coordinate of the tile within the sprite
+        uint32_t tile_y;        // Y coordinate of the tile within the sprite
+
+        rel_x = (px >> 8);
+        rel_y = (py >> 8);
+
+        if (oam->mosaic) {
+            rel_x = (sprite->win_ox + rel_x) / (io->mosaic.obj_hsize + 1) * (io->mosaic.obj_hsize + 1) - sprite->win_ox;
+            rel_y = (sprite->win_oy + rel_y) / (io->mosaic.obj_vsize + 1) * (io->mosaic.obj_vsize + 1) - sprite->win_oy;
+        }
+
+        tile_x = rel_x / 8;
+        tile_y = rel_y / 8;
+        chr_x = rel_x % 8;
+        chr_y = rel_y % 8;
+
+        // Filter out pixels that are rotated/shred/scaled outside of their sprite.
+        if (
+               rel_x < 0 || tile_x >= sprite->sprite_sx / 8
+            || rel_y < 0 || tile_y >= sprite->sprite_sy / 8
+        ) {
+            continue;
+        }
+
+        // Flip horizontally
+        if (!oam->affine && oam->hflip) {
+            tile_x = (sprite->sprite_sx / 8) - 1 - tile_x;
+            chr_x ^= 0b111;
+        }
+
+        // Flip vertically
+        if (!oam->affine && oam->vflip) {
+            tile_y = (sprite->sprite_sy / 8) - 1 - tile_y;
+            chr_y ^= 0b111;
         }
 
-        if (win_oy + win_sy >= 255) { // TODO Improve this for super large sprite
-            win_oy -= 256;
+        rows = ppu_tile_cache_get(gba, ppu_oam_tile_offset(io, oam, sprite->sprite_sx, tile_x, tile_y), oam->color_256);
+        ppu_oam_draw_pixel(gba, scanline, oam, sprite->win_ox + x, (rows[chr_y] >> (chr_x * 8)) & 0xFF);
+    }
+}
+
+/*
+** Pre-render all visible sprites.
+*/
+void
+ppu_prerender_oam(
+    struct gba *gba,
+    struct scanline *scanline,
+    int32_t line
+) {
+    struct ppu_oam_cache const *cache;
+    struct io const *io;
+    uint32_t bg_mode;
+    uint32_t i;
+
+    io = &gba->io;
+    cache = &gba->oam_cache;
+    bg_mode = io->dispcnt.bg_mode;
+
+    if (!io->dispcnt.obj) {
+        return;
+    }
+
+    if (cache->dirty) {
+        ppu_oam_cache_rebuild(gba);
+    }
+
+    for (i = 0; i < cache->lines_len[line]; ++i) {
+        struct ppu_sprite const *sprite;
+
+        sprite = &cache->sprites[cache->lines[line][i]];
+
+        // Skip OAM entries of index < 512 for BG mode 3-5
+        if (bg_mode >= 3 && bg_mode <= 5 && sprite->oam.tile_idx < 512) {
+            continue;
         }
 
-        if (line >= win_oy && line < win_oy + win_sy) {
-            int32_t px;
-            int32_t py;
-            int16_t pa;
-            int16_t pb;
-            int16_t pc;
-            int16_t pd;
-
-            if (oam.affine) {
-                pa = (int16_t)mem_oam_read16(gba, oam.affine_data_idx * 32 + 0x6);
-                pb = (int16_t)mem_oam_read16(gba, oam.affine_data_idx * 32 + 0xe);
-                pc = (int16_t)mem_oam_read16(gba, oam.affine_data_idx * 32 + 0x16);
-                pd = (int16_t)mem_oam_read16(gba, oam.affine_data_idx * 32 + 0x1e);
-            } else { // Identity matrix
-                pa = 0x100;
-                pb = 0;
-                pc = 0;
-                pd = 0x100;
-            }
-
-            /*
-            ** We pre-compute PX and PY for x=0 and simply add the difference when X is increased.
-            */
-            px = pa * -(win_sx / 2) + pb * ((line - win_oy) - (win_sy / 2)) + ((sprite_sx / 2) << 8);
-            py = pc * -(win_sx / 2) + pd * ((line - win_oy) - (win_sy / 2)) + ((sprite_sy / 2) << 8);
-
-            for (x = 0; x < win_sx; ++x, px += pa, py += pc) {
-                uint32_t palette_idx;
-                int32_t rel_x;          // X coordinate of the pixel within the sprite
-                int32_t rel_y;          // Y coordinate of the pixel within the sprite
-                uint32_t chr_x;         // X coordinate of the pixel within the tile (0-7)
-                uint32_t chr_y;         // Y coordinate of the pixel within the tile (0-7)
-                uint32_t tile_x;        // X coordinate of the tile within the sprite
-                uint32_t tile_y;        // Y coordinate of the tile within the sprite
-                uint32_t tile_offset;   // Within VRAM
-                uint32_t tile_size;     // In bytes
-
-                // Filter-out pixels that are outside of the screen
-                if (win_ox + x < 0 || win_ox + x >= GBA_SCREEN_WIDTH) {
-                    continue;
-                }
-
-                rel_x = (px >> 8);
-                rel_y = (py >> 8);
-
-                if (oam.mosaic) {
-                    rel_x = (win_ox + rel_x) / (io->mosaic.obj_hsize + 1) * (io->mosaic.obj_hsize + 1) - win_ox;
-                    rel_y = (win_oy + rel_y) / (io->mosaic.obj_vsize + 1) * (io->mosaic.obj_vsize + 1) - win_oy;
-                }
-
-                tile_x = rel_x / 8;
-                tile_y = rel_y / 8;
-                chr_x = rel_x % 8;
-                chr_y = rel_y % 8;
-
-                // Filter out pixels that are rotated/shred/scaled outside of their sprite.
-                if (
-                       rel_x < 0 || tile_x >= sprite_sx / 8
-                    || rel_y < 0 || tile_y >= sprite_sy / 8
-                ) {
-                    continue;
-                }
-
-                // Flip horizontally
-                if (!oam.affine && oam.hflip) {
-                    tile_x = (sprite_sx / 8) - 1 - tile_x;
-                    chr_x ^= 0b111;
-                }
-
-                // Flip vertically
-                if (!oam.affine && oam.vflip) {
-                    tile_y = (sprite_sy / 8) - 1 - tile_y;
-                    chr_y ^= 0b111;
-                }
-
-                tile_size = oam.color_256 ? 64 : 32;
-                tile_offset = 0x10000 + oam.tile_idx * 32;
-
-                if (io->dispcnt.obj_dim) { // 1 Dimension
-                    tile_offset += tile_y * (sprite_sx / 8) * tile_size + tile_x * tile_size;
-                } else { // 2 Dimension
-                    tile_offset += tile_y * 32 * 32 + tile_x * tile_size;
-                }
-
-                if (oam.color_256) { // 256 colors, 1 palette
-                    palette_idx = mem_vram_read8(gba, tile_offset + chr_y * 8 + chr_x);
-                } else { // 16 colors, 16 palettes
-
-                    /*
-                    ** In this mode, each byte represents two pixels:
-                    **   * The lower 4 bits define the color for the left pixel
-                    **   * The upper 4 bits define the color for the right pixel
-                    */
-
-                    palette_idx = mem_vram_read8(gba, tile_offset + chr_y * 4 + (chr_x >> 1));
-                    palette_idx >>= (chr_x % 2) * 4;
-                    palette_idx &= 0xF;
-                }
-
-                if (palette_idx) {
-                    if (oam.mode == OAM_MODE_WINDOW) {
-                        scanline->win_obj_mask[win_ox + x] = true;
-                    } else {
-                        struct rich_color c;
-
-                        // 16-bits palette mode
-                        if (!oam.color_256) {
-                            palette_idx += oam.palette_num * 16;
-                        }
-
-                        c.raw = mem_palram_read16(gba, 0x200 + palette_idx * sizeof(union color));
-                        c.visible = true;
-                        c.idx = 4;
-                        c.force_blend = (oam.mode == OAM_MODE_BLEND);
-                        scanline->oam[oam.priority][win_ox + x] = c;
-                    }
-                }
-            }
+        if (!sprite->oam.affine && !sprite->oam.mosaic) {
+            ppu_render_regular_sprite(gba, scanline, sprite, line - sprite->win_oy);
+        } else {
+            ppu_render_affine_sprite(gba, scanline, sprite, line);
         }
     }
 }
@@ -11,7 +11,7 @@
 #include "gba/gba.h"
 #include "gba/ppu.h"
 
-static void ppu_merge_layer(struct gba const *gba, struct scanline *scanline, struct rich_color *layer);
+static void ppu_merge_bg(struct gba const *gba, struct scanline *scanline);
 
 /*
 ** Initialize the content of the given `scanline` to a default, sane and working value.
@@ -22,146 +22,95 @@ ppu_initialize_scanline(
     struct gba const *gba,
     struct scanline *scanline
 ) {
-    struct rich_color backdrop;
+    uint16_t backdrop;
     uint32_t x;
 
-    memset(scanline, 0x00, sizeof(*scanline));
-
-    backdrop.visible = true;
-    backdrop.idx = 5;
-    backdrop.raw = (gba->io.dispcnt.blank ? 0x7fff : mem_palram_read16(gba, PALRAM_START));
+    backdrop = (gba->io.dispcnt.blank ? 0x7fff : mem_palram_read16(gba, PALRAM_START));
 
     for (x = 0; x < GBA_SCREEN_WIDTH; ++x) {
         scanline->result[x] = backdrop;
+        scanline->bot[x] = backdrop;
     }
 
+    memset(scanline->bot_target, 0x00, sizeof(scanline->bot_target));
+    memset(scanline->obj_flags, 0x00, sizeof(scanline->obj_flags));
+    memset(scanline->win_obj_mask, 0x00, sizeof(scanline->win_obj_mask));
+    scanline->obj_prios = 0;
+    scanline->top_idx = 0;
+
     /*
-    ** The only layer that `ppu_merge_layer` will never merge is the backdrop layer so we force
+    ** The only layer that `ppu_merge_bg` will never merge is the backdrop layer so we force
     ** it here instead (if that's useful).
     */
 
     if (gba->io.bldcnt.mode == BLEND_LIGHT || gba->io.bldcnt.mode == BLEND_DARK) {
         scanline->top_idx = 5;
-        memcpy(scanline->bg, scanline->result, sizeof(scanline->bg));
-        memcpy(scanline->bot, scanline->result, sizeof(scanline->bot));
-        ppu_merge_layer(gba, scanline, scanline->bg);
+        for (x = 0; x < GBA_SCREEN_WIDTH; ++x) {
+            scanline->bg[x] = backdrop;
+        }
+        memset(scanline->bg_flags, PPU_LAYER_VISIBLE, sizeof(scanline->bg_flags));
+        ppu_merge_bg(gba, scanline);
         scanline->top_idx = 0;
     }
 }
 
 /*
-** Merge the current layer with any previous ones (using alpha blending) as stated in REG_BLDCNT.
+** Fill `blend` with the parameters of REG_BLDCNT and the windows for the layer of the given index.
 */
 static
 void
-ppu_merge_layer(
+ppu_build_blend(
     struct gba const *gba,
-    struct scanline *scanline,
-    struct rich_color *layer
+    struct ppu_blend *blend,
+    uint32_t layer_idx
 ) {
-    uint32_t eva;
-    uint32_t evb;
-    uint32_t evy;
     struct io const *io;
-    uint32_t x;
 
     io = &gba->io;
-    eva = min(16, io->bldalpha.top_coef);
-    evb = min(16, io->bldalpha.bot_coef);
-    evy = min(16, io->bldy.coef);
-
-    for (x = 0; x < GBA_SCREEN_WIDTH; ++x) {
-        bool bot_enabled;
-        struct rich_color topc;
-        struct rich_color botc;
-        uint32_t mode;
-
-        topc = layer[x];
-        botc = scanline->bot[x];
-
-        /* Skip transparent pixels */
-        if (!topc.visible) {
-            continue;
-        }
-
-        mode = gba->io.bldcnt.mode;
-        bot_enabled = bitfield_get(io->bldcnt.raw, botc.idx + 8);
-
-        /* Apply windowing, if any */
-        if (scanline->top_idx <= 4 && (io->dispcnt.win0 || io->dispcnt.win1 || io->dispcnt.winobj)) {
-            uint8_t win_opts;
-
-            win_opts = ppu_find_top_window(gba, scanline, x);
+    blend->mode = bitfield_get(io->bldcnt.raw, layer_idx) ? io->bldcnt.mode : BLEND_OFF;
+    blend->bot_target = bitfield_get(io->bldcnt.raw, layer_idx + 8);
+    blend->windowed = layer_idx <= 4 && (io->dispcnt.win0 || io->dispcnt.win1 || io->dispcnt.winobj);
+    blend->win_bit = blend->windowed ? 1 << layer_idx : 0xFF;
+    blend->prio = 0;
+    blend->eva = min(16, io->bldalpha.top_coef);
+    blend->evb = min(16, io->bldalpha.bot_coef);
+    blend->evy = min(16, io->bldy.coef);
+}
 
-            /* Hide pixels that belong to a layer that this window doesn't show. */
-            if (!bitfield_get(win_opts, scanline->top_idx)) {
-                continue;
-            }
+/*
+** Merge the BG that was just rendered with any previous layers (using alpha blending) as stated in REG_BLDCNT.
+*/
+static
+void
+ppu_merge_bg(
+    struct gba const *gba,
+    struct scanline *scanline
+) {
+    struct ppu_blend blend;
 
-            /* Windows can disable blending */
-            if (!bitfield_get(win_opts, 5)) {
-                mode = BLEND_OFF;
-            }
-        }
+    ppu_build_blend(gba, &blend, scanline->top_idx);
+    gba->compositor->merge(scanline, scanline->bg, scanline->bg_flags, NULL, &blend);
+}
 
-        /* Sprite can force blending no matter what BLDCNT says */
-        if (topc.force_blend && bot_enabled) {
-            mode = BLEND_ALPHA;
-        }
+/*
+** Merge the sprites of the given priority with any previous layers (using alpha blending) as stated in REG_BLDCNT.
+*/
+static
+void
+ppu_merge_obj(
+    struct gba const *gba,
+    struct scanline *scanline,
+    uint32_t prio
+) {
+    struct ppu_blend blend;
 
-        scanline->bot[x] = layer[x];
-
-        switch (mode) {
-            case BLEND_OFF: {
-                scanline->result[x] = topc;
-                break;
-            };
-            case BLEND_ALPHA: {
-                bool top_enabled;
-
-                /*
-                ** If both the top and bot layers are enabled, blend the colors.
-                ** Otherwise, the top layer takes priority.
-                */
-
-                top_enabled = bitfield_get(io->bldcnt.raw, scanline->top_idx) || topc.force_blend;
-                if (top_enabled && bot_enabled && botc.visible) {
-                    scanline->result[x].red = min(31, ((uint32_t)topc.red * eva + (uint32_t)botc.red * evb) >> 4);
-                    scanline->result[x].green = min(31, ((uint32_t)topc.green * eva + (uint32_t)botc.green * evb) >> 4);
-                    scanline->result[x].blue = min(31, ((uint32_t)topc.blue * eva + (uint32_t)botc.blue * evb) >> 4);
-                    scanline->result[x].visible = true;
-                    scanline->result[x].idx = scanline->top_idx;
-                } else {
-                    scanline->result[x] = topc;
-                }
-                break;
-            };
-            case BLEND_LIGHT: {
-                if (bitfield_get(io->bldcnt.raw, scanline->top_idx)) {
-                    scanline->result[x].red = topc.red + (((31 - topc.red) * evy) >> 4);
-                    scanline->result[x].green = topc.green + (((31 - topc.green) * evy) >> 4);
-                    scanline->result[x].blue = topc.blue + (((31 - topc.blue) * evy) >> 4);
-                    scanline->result[x].idx = topc.idx;
-                    scanline->result[x].visible = true;
-                } else {
-                    scanline->result[x] = topc;
-                }
-                break;
-            };
-            case BLEND_DARK: {
-                if (bitfield_get(io->bldcnt.raw, scanline->top_idx)) {
-                    scanline->result[x].red = topc.red - ((topc.red * evy) >> 4);
-                    scanline->result[x].green = topc.green - ((topc.green * evy) >> 4);
-                    scanline->result[x].blue = topc.blue - ((topc.blue * evy) >> 4);
-                    scanline->result[x].idx = topc.idx;
-                    scanline->result[x].visible = true;
-                } else {
-                    scanline->result[x] = topc;
-                }
-                break;
-            };
-        }
+    if (!bitfield_get(scanline->obj_prios, prio)) {
+        return ;
     }
+
+    ppu_build_blend(gba, &blend, 4);
+    blend.prio = prio;
+    gba->compositor->merge(scanline, scanline->obj, scanline->obj_flags, scanline->obj_prio, &blend);
 }
 
 /*
@@ -188,13 +137,12 @@ ppu_render_scanline(
                 for (bg_idx = 3; bg_idx >= 0; --bg_idx) {
                     if (bitfield_get((uint8_t)io->dispcnt.bg, bg_idx) && io->bgcnt[bg_idx].priority == prio && likely(gba->settings.ppu.enable_bg_layers[bg_idx])) {
                         ppu_render_background_text(gba, scanline, y, bg_idx);
-                        ppu_merge_layer(gba, scanline, scanline->bg);
+                        ppu_merge_bg(gba, scanline);
                     }
                 }
 
                 if (likely(gba->settings.ppu.enable_oam)) {
-                    scanline->top_idx = 4;
-                    ppu_merge_layer(gba, scanline, scanline->oam[prio]);
+                    ppu_merge_obj(gba, scanline, prio);
                 }
             }
             break;
@@ -206,18 +154,17 @@ ppu_render_scanline(
                 for (bg_idx = 2; bg_idx >= 0; --bg_idx) {
                     if (bitfield_get((uint8_t)io->dispcnt.bg, bg_idx) && io->bgcnt[bg_idx].priority == prio && likely(gba->settings.ppu.enable_bg_layers[bg_idx])) {
                         if (bg_idx == 2) {
-                            memset(scanline->bg, 0x00, sizeof(scanline->bg));
+                            memset(scanline->bg_flags, 0x00, sizeof(scanline->bg_flags));
                             ppu_render_background_affine(gba, scanline, y, bg_idx);
                         } else {
                             ppu_render_background_text(gba, scanline, y, bg_idx);
                         }
-                        ppu_merge_layer(gba, scanline, scanline->bg);
+                        ppu_merge_bg(gba, scanline);
                     }
                 }
 
                 if (likely(gba->settings.ppu.enable_oam)) {
-                    scanline->top_idx = 4;
-                    ppu_merge_layer(gba, scanline, scanline->oam[prio]);
+                    ppu_merge_obj(gba, scanline, prio);
                 }
             }
             break;
@@ -228,15 +175,14 @@ ppu_render_scanline(
 
                 for (bg_idx = 3; bg_idx >= 2; --bg_idx) {
                     if (bitfield_get((uint8_t)io->dispcnt.bg, bg_idx) && io->bgcnt[bg_idx].priority == prio && likely(gba->settings.ppu.enable_bg_layers[bg_idx])) {
-                        memset(scanline->bg, 0x00, sizeof(scanline->bg));
+                        memset(scanline->bg_flags, 0x00, sizeof(scanline->bg_flags));
                         ppu_render_background_affine(gba, scanline, y, bg_idx);
-                        ppu_merge_layer(gba, scanline, scanline->bg);
+                        ppu_merge_bg(gba, scanline);
                     }
                 }
 
                 if (likely(gba->settings.ppu.enable_oam)) {
-                    scanline->top_idx = 4;
-                    ppu_merge_layer(gba, scanline, scanline->oam[prio]);
+                    ppu_merge_obj(gba, scanline, prio);
                 }
             }
             break;
@@ -244,14 +190,13 @@ ppu_render_scanline(
         case 3: {
             for (prio = 3; prio >= 0; --prio) {
                 if (bitfield_get((uint8_t)io->dispcnt.bg, 2) && io->bgcnt[2].priority == prio && likely(gba->settings.ppu.enable_bg_layers[2])) {
-                    memset(scanline->bg, 0x00, sizeof(scanline->bg));
+                    memset(scanline->bg_flags, 0x00, sizeof(scanline->bg_flags));
                     ppu_render_background_bitmap(gba, scanline, false);
-                    ppu_merge_layer(gba, scanline, scanline->bg);
+                    ppu_merge_bg(gba, scanline);
                 }
 
                 if (likely(gba->settings.ppu.enable_oam)) {
-                    scanline->top_idx = 4;
-                    ppu_merge_layer(gba, scanline, scanline->oam[prio]);
+                    ppu_merge_obj(gba, scanline, prio);
                 }
             }
             break;
@@ -259,14 +204,13 @@ ppu_render_scanline(
         case 4: {
             for (prio = 3; prio >= 0; --prio) {
                 if (bitfield_get((uint8_t)io->dispcnt.bg, 2) && io->bgcnt[2].priority == prio && likely(gba->settings.ppu.enable_bg_layers[2])) {
-                    memset(scanline->bg, 0x00, sizeof(scanline->bg));
+                    memset(scanline->bg_flags, 0x00, sizeof(scanline->bg_flags));
                     ppu_render_background_bitmap(gba, scanline, true);
-                    ppu_merge_layer(gba, scanline, scanline->bg);
+                    ppu_merge_bg(gba, scanline);
                 }
 
                 if (likely(gba->settings.ppu.enable_oam)) {
-                    scanline->top_idx = 4;
-                    ppu_merge_layer(gba, scanline, scanline->oam[prio]);
+                    ppu_merge_obj(gba, scanline, prio);
                 }
             }
             break;
@@ -274,14 +218,13 @@ ppu_render_scanline(
         case 5: {
             for (prio = 3; prio >= 0; --prio) {
                 if (bitfield_get((uint8_t)io->dispcnt.bg, 2) && io->bgcnt[2].priority == prio && y < 128 && likely(gba->settings.ppu.enable_bg_layers[2])) {
-                    memset(scanline->bg, 0x00, sizeof(scanline->bg));
+                    memset(scanline->bg_flags, 0x00, sizeof(scanline->bg_flags));
                     ppu_render_background_bitmap_small(gba, scanline);
-                    ppu_merge_layer(gba, scanline, scanline->bg);
+                    ppu_merge_bg(gba, scanline);
                 }
 
                 if (likely(gba->settings.ppu.enable_oam)) {
-                    scanline->top_idx = 4;
-                    ppu_merge_layer(gba, scanline, scanline->oam[prio]);
+                    ppu_merge_obj(gba, scanline, prio);
                 }
             }
             break;
@@ -298,20 +241,10 @@ ppu_draw_scanline(
     struct gba *gba,
     struct scanline const *scanline
 ) {
-    uint32_t x;
     uint32_t y;
 
     y = gba->io.vcount.raw;
-    for (x = 0; x < GBA_SCREEN_WIDTH; ++x) {
-        struct rich_color c;
-
-        c = scanline->result[x];
-        gba->ppu.framebuffer[GBA_SCREEN_WIDTH * y + x] = 0xFF000000
-            | (((uint32_t)c.red   << 3 ) | (((uint32_t)c.red   >> 2) & 0b111)) << 0
-            | (((uint32_t)c.green << 3 ) | (((uint32_t)c.green >> 2) & 0b111)) << 8
-            | (((uint32_t)c.blue  << 3 ) | (((uint32_t)c.blue  >> 2) & 0b111)) << 16
-        ;
-    }
+    gba->compositor->draw(gba->ppu.framebuffer + GBA_SCREEN_WIDTH * y, scanline);
 }
 
 /*
@@ -332,17 +265,25 @@ ppu_hdraw(
 
     if (io->vcount.raw >= GBA_SCREEN_REAL_HEIGHT) {
         io->vcount.raw = 0;
-        atomic_fetch_add(&gba->shared_data.frame_counter, 1);
-    } else if (io->vcount.raw == GBA_SCREEN_HEIGHT) {
+
+        // Each real frame is shown once, either itself or the one run ahead of it
+        if (!gba->runahead.speculating) {
+            atomic_fetch_add(&gba->shared_data.frame_counter, 1);
+        }
+    } else if (io->vcount.raw == GBA_SCREEN_HEIGHT && !gba->runahead.hide_frame) {
         /*
         ** Now that the frame is finished, we can copy the current framebuffer to
         ** the one the frontend uses.
         **
         ** Doing it now will avoid tearing.
         */
-        pthread_mutex_lock(&gba->shared_data.framebuffer.lock);
-        memcpy(gba->shared_data.framebuffer.data, gba->ppu.framebuffer, sizeof(gba->ppu.framebuffer));
-        pthread_mutex_unlock(&gba->shared_data.framebuffer.lock);
+        if (gba->synchronous) {
+            memcpy(gba->shared_data.framebuffer.data, gba->ppu.framebuffer, sizeof(gba->ppu.framebuffer));
+        } else {
+            pthread_mutex_lock(&gba->shared_data.framebuffer.lock);
+            memcpy(gba->shared_data.framebuffer.data, gba->ppu.framebuffer, sizeof(gba->ppu.framebuffer));
+            pthread_mutex_unlock(&gba->shared_data.framebuffer.lock);
+        }
     }
 
     io->dispstat.vcount_eq = (io->vcount.raw == io->dispstat.vcount_val);
@@ -392,6 +333,11 @@ ppu_hblank(
         if (!gba->io.dispcnt.blank) {
             ppu_window_build_masks(gba, io->vcount.raw);
             ppu_prerender_oam(gba, &scanline, io->vcount.raw);
+
+            if (io->dispcnt.win0 || io->dispcnt.win1 || io->dispcnt.winobj) {
+                ppu_window_build_opts(gba, &scanline);
+            }
+
             ppu_render_scanline(gba, &scanline);
         }
 
@@ -437,7 +383,11 @@ void
 ppu_render_black_screen(
     struct gba *gba
 ) {
-    pthread_mutex_lock(&gba->shared_data.framebuffer.lock);
-    memset(gba->shared_data.framebuffer.data, 0x00, sizeof(gba->ppu.framebuffer));
-    pthread_mutex_unlock(&gba->shared_data.framebuffer.lock);
+    if (gba->synchronous) {
+        memset(gba->shared_data.framebuffer.data, 0x00, sizeof(gba->ppu.framebuffer));
+    } else {
+        pthread_mutex_lock(&gba->shared_data.framebuffer.lock);
+        memset(gba->shared_data.framebuffer.data, 0x00, sizeof(gba->ppu.framebuffer));
+        pthread_mutex_unlock(&gba->shared_data.framebuffer.lock);
+    }
 }
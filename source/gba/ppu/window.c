@@ -59,19 +59,21 @@ ppu_window_build_masks(
     }
 }
 
-uint8_t
-ppu_find_top_window(
+/*
+** Fill `scanline->win_opts` with the WININ/WINOUT flags of the top window covering each pixel.
+** Must be called after the masks of all windows have been built, including the OBJ window's one.
+*/
+void
+ppu_window_build_opts(
     struct gba const *gba,
-    struct scanline const *scanline,
-    uint32_t x
+    struct scanline *scanline
 ) {
-    if (gba->ppu.win_masks[WIN0][x]) {
-        return (gba->io.winin.win0);
-    } else if (gba->ppu.win_masks[WIN1][x]) {
-        return (gba->io.winin.win1);
-    } else if (scanline->win_obj_mask[x]) {
-        return (gba->io.winout.winobj);
-    } else {
-        return (gba->io.winout.winout);
-    }
+    uint8_t opts[WIN_MAX + 1];
+
+    opts[WIN0] = gba->io.winin.win0;
+    opts[WIN1] = gba->io.winin.win1;
+    opts[WINOBJ] = gba->io.winout.winobj;
+    opts[WIN_MAX] = gba->io.winout.winout;
+
+    gba->compositor->build_win_opts(scanline, gba->ppu.win_masks[WIN0], gba->ppu.win_masks[WIN1], opts);
 }
@@ -7,8 +7,44 @@
 **
 \******************************************************************************/
 
+#include <stdalign.h>
 #include <string.h>
 #include "gba/gba.h"
+#include "compat.h"
+
+/*
+** Layout of a save state:
+**
+**     Header:
+**         u32  QUICKSAVE_MAGIC
+**         u32  QUICKSAVE_VERSION
+**         u64  Hash of the ROM (see `quicksave_rom_hash()`)
+**         u32  Size of the ROM
+**
+**     Followed by as many sections as needed:
+**         u32  Section kind (see `enum quicksave_sections`)
+**         u32  Size of the section's payload
+**         ...  Payload
+**
+** All integers are little-endian.
+**
+** Only the mutable state is saved: neither the ROM nor the BIOS are, and anything that can be derived
+** from the saved state (the waitstates, the fastmem page table, the scheduler's heaps, etc.) is rebuilt
+** when the state is loaded.
+**
+** Each section is written field by field with an explicit width, independently of the layout of the
+** structures it comes from: booleans are written as u8, enums, indexes and event handles as u32
+** (`QUICKSAVE_NONE` standing for `INVALID_EVENT_HANDLE` and `NO_CURRENT_DMA`). Any change to the
+** content of a section must bump `QUICKSAVE_VERSION`.
+**
+** Unknown sections are skipped so a newer version can add new ones without breaking older states.
+*/
+
+#define QUICKSAVE_MAGIC         0x53534448  // "HDSS"
+#define QUICKSAVE_VERSION       2
+
+// Written in place of an invalid handle or index
+#define QUICKSAVE_NONE          UINT32_MAX
 
 // Not always true, but it's for optimization purposes so it's not a big deal
 // if the page size isn't 4k.
@@ -16,21 +52,65 @@
 #define PAGE_MASK           (PAGE_SIZE - 1)
 #define PAGE_ALIGN(size)    ((size + PAGE_SIZE) & ~PAGE_MASK)
 
+enum quicksave_sections {
+    QUICKSAVE_SECTION_CORE          = 1,
+    QUICKSAVE_SECTION_EWRAM         = 2,
+    QUICKSAVE_SECTION_IWRAM         = 3,
+    QUICKSAVE_SECTION_PALRAM        = 4,
+    QUICKSAVE_SECTION_VRAM          = 5,
+    QUICKSAVE_SECTION_OAM           = 6,
+    QUICKSAVE_SECTION_MEMORY        = 7,
+    QUICKSAVE_SECTION_BACKUP_CHIP   = 8,
+    QUICKSAVE_SECTION_IO            = 9,
+    QUICKSAVE_SECTION_PPU           = 10,
+    QUICKSAVE_SECTION_APU           = 11,
+    QUICKSAVE_SECTION_GPIO          = 12,
+    QUICKSAVE_SECTION_SCHEDULER     = 13,
+
+    QUICKSAVE_SECTION_LEN,
+};
+
+// Size of the header of the `QUICKSAVE_SECTION_SCHEDULER` section
+#define QUICKSAVE_SCHEDULER_SIZE        (sizeof(uint64_t) + sizeof(uint32_t))
+
+// Size of each event of the `QUICKSAVE_SECTION_SCHEDULER` section
+#define QUICKSAVE_EVENT_SIZE            (sizeof(uint32_t) + 2 * sizeof(uint8_t) + 2 * sizeof(uint64_t) + 4 * sizeof(uint32_t))
+
 struct quicksave_buffer {
     uint8_t *data;
     size_t size;    // Allocated size
     size_t index;   // Read/Write index
 };
 
+/*
+** The state read from a save state, applied to the emulator only once all of it is known to be valid.
+*/
+struct quickload_state {
+    uint32_t sections;      // A mask of the sections read
+
+    struct core core;
+    struct memory memory;
+    struct io io;
+    struct ppu ppu;
+    struct apu apu;
+    struct gpio gpio;
+
+    struct {
+        uint64_t cycles;
+        struct scheduler_event *events;
+        size_t events_size;
+    } scheduler;
+};
+
 static
 void
 quicksave_write(
     struct quicksave_buffer *buffer,
-    uint8_t const *data,
+    void const *data,
     size_t length
 ) {
     if (buffer->index + length > buffer->size) {
-        buffer->size = PAGE_ALIGN(buffer->size + length);
+        buffer->size = PAGE_ALIGN(buffer->index + length);
         buffer->data = realloc(buffer->data, buffer->size);
         hs_assert(buffer->data);
     }
@@ -41,11 +121,110 @@ quicksave_write(
     buffer->index += length;
 }
 
+static
+void
+quicksave_write_u8(
+    struct quicksave_buffer *buffer,
+    uint8_t val
+) {
+    quicksave_write(buffer, &val, sizeof(val));
+}
+
+static
+void
+quicksave_write_u16(
+    struct quicksave_buffer *buffer,
+    uint16_t val
+) {
+    uint8_t raw[2];
+
+    raw[0] = val;
+    raw[1] = val >> 8;
+    quicksave_write(buffer, raw, sizeof(raw));
+}
+
+static
+void
+quicksave_write_u32(
+    struct quicksave_buffer *buffer,
+    uint32_t val
+) {
+    uint8_t raw[4];
+
+    raw[0] = val;
+    raw[1] = val >> 8;
+    raw[2] = val >> 16;
+    raw[3] = val >> 24;
+    quicksave_write(buffer, raw, sizeof(raw));
+}
+
+static
+void
+quicksave_write_u64(
+    struct quicksave_buffer *buffer,
+    uint64_t val
+) {
+    quicksave_write_u32(buffer, val);
+    quicksave_write_u32(buffer, val >> 32);
+}
+
+static
+void
+quicksave_write_handle(
+    struct quicksave_buffer *buffer,
+    event_handler_t handle
+) {
+    quicksave_write_u32(buffer, handle == INVALID_EVENT_HANDLE ? QUICKSAVE_NONE : handle);
+}
+
+static
+void
+quicksave_write_section(
+    struct quicksave_buffer *buffer,
+    enum quicksave_sections section,
+    void const *data,
+    size_t length
+) {
+    quicksave_write_u32(buffer, section);
+    quicksave_write_u32(buffer, length);
+    quicksave_write(buffer, data, length);
+}
+
+/*
+** Write the header of a section whose size isn't known yet.
+** Return the offset of its payload, to give to `quicksave_end_section()` once it is written.
+*/
+static
+size_t
+quicksave_begin_section(
+    struct quicksave_buffer *buffer,
+    enum quicksave_sections section
+) {
+    quicksave_write_u32(buffer, section);
+    quicksave_write_u32(buffer, 0);
+    return (buffer->index);
+}
+
+static
+void
+quicksave_end_section(
+    struct quicksave_buffer *buffer,
+    size_t start
+) {
+    uint32_t size;
+
+    size = buffer->index - start;
+    buffer->data[start - 4] = size;
+    buffer->data[start - 3] = size >> 8;
+    buffer->data[start - 2] = size >> 16;
+    buffer->data[start - 1] = size >> 24;
+}
+
 static
 bool
 quicksave_read(
     struct quicksave_buffer *buffer,
-    uint8_t *data,
+    void *data,
     size_t length
 ) {
     if (buffer->size < buffer->index + length) {
@@ -57,102 +236,1267 @@ quicksave_read(
     return (false);
 }
 
+static
+bool
+quicksave_read_u8(
+    struct quicksave_buffer *buffer,
+    uint8_t *val
+) {
+    return (quicksave_read(buffer, val, sizeof(*val)));
+}
+
+static
+bool
+quicksave_read_bool(
+    struct quicksave_buffer *buffer,
+    bool *val
+) {
+    uint8_t raw;
+
+    if (quicksave_read_u8(buffer, &raw)) {
+        return (true);
+    }
+
+    *val = raw;
+    return (false);
+}
+
+static
+bool
+quicksave_read_u16(
+    struct quicksave_buffer *buffer,
+    uint16_t *val
+) {
+    uint8_t raw[2];
+
+    if (quicksave_read(buffer, raw, sizeof(raw))) {
+        return (true);
+    }
+
+    *val = raw[0] | (raw[1] << 8);
+    return (false);
+}
+
+static
+bool
+quicksave_read_u32(
+    struct quicksave_buffer *buffer,
+    uint32_t *val
+) {
+    uint8_t raw[4];
+
+    if (quicksave_read(buffer, raw, sizeof(raw))) {
+        return (true);
+    }
+
+    *val = raw[0] | (raw[1] << 8) | (raw[2] << 16) | ((uint32_t)raw[3] << 24);
+    return (false);
+}
+
+static
+bool
+quicksave_read_u64(
+    struct quicksave_buffer *buffer,
+    uint64_t *val
+) {
+    uint32_t lo;
+    uint32_t hi;
+
+    if (quicksave_read_u32(buffer, &lo) || quicksave_read_u32(buffer, &hi)) {
+        return (true);
+    }
+
+    *val = ((uint64_t)hi << 32) | lo;
+    return (false);
+}
+
+static
+bool
+quicksave_read_handle(
+    struct quicksave_buffer *buffer,
+    event_handler_t *handle
+) {
+    uint32_t raw;
+
+    if (quicksave_read_u32(buffer, &raw)) {
+        return (true);
+    }
+
+    *handle = (raw == QUICKSAVE_NONE) ? INVALID_EVENT_HANDLE : raw;
+    return (false);
+}
+
 /*
-** Save the current state of the emulator in the given buffer.
+** Read an enum (or an index) and ensure it isn't greater than `max`.
 */
-void
-quicksave(
-    struct gba const *gba,
-    uint8_t **data,
-    size_t *size
+static
+bool
+quicksave_read_enum(
+    struct quicksave_buffer *buffer,
+    uint32_t *val,
+    uint32_t max
 ) {
-    struct quicksave_buffer buffer;
+    return (quicksave_read_u32(buffer, val) || *val > max);
+}
+
+/*
+** Return a hash of the given ROM, used to ensure a save state is loaded on the game that created it.
+*/
+uint64_t
+quicksave_rom_hash(
+    uint8_t const *rom,
+    size_t size
+) {
+    uint64_t hash;
     size_t i;
 
-    buffer.data = NULL;
-    buffer.size = 0;
-    buffer.index = 0;
+    hash = 0xcbf29ce484222325ull;
+    for (i = 0; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
 
-    quicksave_write(&buffer, (uint8_t *)&gba->core, sizeof(gba->core));
-    quicksave_write(&buffer, (uint8_t *)&gba->memory, sizeof(gba->memory));
-    quicksave_write(&buffer, (uint8_t *)&gba->io, sizeof(gba->io));
-    quicksave_write(&buffer, (uint8_t *)&gba->ppu, sizeof(gba->ppu));
-    quicksave_write(&buffer, (uint8_t *)&gba->gpio, sizeof(gba->gpio));
-    quicksave_write(&buffer, (uint8_t *)&gba->apu, sizeof(gba->apu));
-    quicksave_write(&buffer, (uint8_t *)&gba->scheduler.cycles, sizeof(uint64_t));
-    quicksave_write(&buffer, (uint8_t *)&gba->scheduler.next_event, sizeof(uint64_t));
-    quicksave_write(&buffer, (uint8_t *)&gba->scheduler.events_size, sizeof(size_t));
-
-    // Serialize the scheduler's event list
-    for (i = 0; i < gba->scheduler.events_size; ++i) {
-        struct scheduler_event *event;
+        memcpy(&word, rom + i, sizeof(word));
+        hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+        hash ^= hash >> 32;
+    }
 
-        event = gba->scheduler.events + i;
-        quicksave_write(&buffer, (uint8_t *)&event->kind, sizeof(enum sched_event_kind));
-        quicksave_write(&buffer, (uint8_t *)&event->active, sizeof(bool));
-        quicksave_write(&buffer, (uint8_t *)&event->repeat, sizeof(bool));
-        quicksave_write(&buffer, (uint8_t *)&event->at, sizeof(uint64_t));
-        quicksave_write(&buffer, (uint8_t *)&event->period, sizeof(uint64_t));
-        quicksave_write(&buffer, (uint8_t *)&event->args, sizeof(struct event_args));
+    for (; i < size; ++i) {
+        hash = (hash ^ rom[i]) * 0x100000001B3ull;
     }
 
-    *data = buffer.data;
-    *size = buffer.size;
+    return (hash ^ size);
 }
 
 /*
-** Load a new state for the emulator from the given save state.
+** Return the hash of the game's ROM, computing it the first time it's needed so that resetting
+** the emulator doesn't read the whole ROM.
+*/
+static
+uint64_t
+quicksave_game_hash(
+    struct gba *gba
+) {
+    if (!gba->rom.hashed) {
+        gba->rom.hash = quicksave_rom_hash(gba->rom.data, gba->rom.size);
+        gba->rom.hashed = true;
+    }
+    return (gba->rom.hash);
+}
+
+/*
+** Core
 */
+
+static
+void
+quicksave_core(
+    struct quicksave_buffer *buffer,
+    struct core const *core
+) {
+    size_t i;
+
+    for (i = 0; i < array_length(core->registers); ++i) {
+        quicksave_write_u32(buffer, core->registers[i]);
+    }
+
+    for (i = 0; i < array_length(core->bank_registers); ++i) {
+        quicksave_write_u32(buffer, core->bank_registers[i]);
+    }
+
+    quicksave_write_u32(buffer, core->prefetch[0]);
+    quicksave_write_u32(buffer, core->prefetch[1]);
+    quicksave_write_u32(buffer, core->prefetch_access_type);
+    quicksave_write_u32(buffer, core->cpsr.raw);
+    quicksave_write_u32(buffer, core->state);
+    quicksave_write_u8(buffer, core->is_dma_running);
+    quicksave_write_u32(buffer, core->current_dma_idx == NO_CURRENT_DMA ? QUICKSAVE_NONE : (uint32_t)core->current_dma_idx);
+    quicksave_write_u32(buffer, core->pending_dma);
+    quicksave_write_u8(buffer, core->reenter_dma_transfer_loop);
+    quicksave_write_u8(buffer, core->irq_line);
+    quicksave_write_u8(buffer, core->bios_intr_wait);
+}
+
+static
 bool
-quickload(
-    struct gba *gba,
-    uint8_t *data,
-    size_t size
+quickload_core(
+    struct quicksave_buffer *buffer,
+    struct core *core
 ) {
-    struct quicksave_buffer buffer;
+    uint32_t prefetch_access_type;
+    uint32_t current_dma_idx;
+    uint32_t state;
+    uint32_t cpsr;
     size_t i;
 
-    buffer.data = data;
-    buffer.size = size;
-    buffer.index = 0;
+    for (i = 0; i < array_length(core->registers); ++i) {
+        if (quicksave_read_u32(buffer, &core->registers[i])) {
+            return (true);
+        }
+    }
+
+    for (i = 0; i < array_length(core->bank_registers); ++i) {
+        if (quicksave_read_u32(buffer, &core->bank_registers[i])) {
+            return (true);
+        }
+    }
+
+    if (
+           quicksave_read_u32(buffer, &core->prefetch[0])
+        || quicksave_read_u32(buffer, &core->prefetch[1])
+        || quicksave_read_enum(buffer, &prefetch_access_type, SEQUENTIAL)
+        || quicksave_read_u32(buffer, &cpsr)
+        || quicksave_read_enum(buffer, &state, CORE_STOP)
+        || quicksave_read_bool(buffer, &core->is_dma_running)
+        || quicksave_read_u32(buffer, &current_dma_idx)
+        || quicksave_read_u32(buffer, &core->pending_dma)
+        || quicksave_read_bool(buffer, &core->reenter_dma_transfer_loop)
+        || quicksave_read_bool(buffer, &core->irq_line)
+        || quicksave_read_bool(buffer, &core->bios_intr_wait)
+    ) {
+        return (true);
+    }
+
+    if (current_dma_idx != QUICKSAVE_NONE && current_dma_idx >= 4) {
+        return (true);
+    }
+
+    core->prefetch_access_type = prefetch_access_type;
+    core->cpsr.raw = cpsr;
+    core->state = state;
+    core->current_dma_idx = (current_dma_idx == QUICKSAVE_NONE) ? NO_CURRENT_DMA : (ssize_t)current_dma_idx;
+    return (false);
+}
+
+/*
+** Memory
+*/
+
+static
+void
+quicksave_memory(
+    struct quicksave_buffer *buffer,
+    struct memory const *memory
+) {
+    quicksave_write_u32(buffer, memory->bios_bus);
+    quicksave_write_u32(buffer, memory->dma_bus);
+    quicksave_write_u8(buffer, memory->hle_bios);
+    quicksave_write_u8(buffer, memory->was_last_access_from_dma);
+    quicksave_write_u8(buffer, memory->gamepak_bus_in_use);
+    quicksave_write_u32(buffer, memory->pbuffer.head);
+    quicksave_write_u32(buffer, memory->pbuffer.tail);
+    quicksave_write_u32(buffer, memory->pbuffer.countdown);
+    quicksave_write_u32(buffer, memory->pbuffer.size);
+    quicksave_write_u32(buffer, memory->pbuffer.capacity);
+    quicksave_write_u32(buffer, memory->pbuffer.insn_len);
+    quicksave_write_u32(buffer, memory->pbuffer.reload);
+    quicksave_write_u8(buffer, memory->pbuffer.enabled);
+}
+
+static
+bool
+quickload_memory(
+    struct quicksave_buffer *buffer,
+    struct memory *memory
+) {
+    return (
+           quicksave_read_u32(buffer, &memory->bios_bus)
+        || quicksave_read_u32(buffer, &memory->dma_bus)
+        || quicksave_read_bool(buffer, &memory->hle_bios)
+        || quicksave_read_bool(buffer, &memory->was_last_access_from_dma)
+        || quicksave_read_bool(buffer, &memory->gamepak_bus_in_use)
+        || quicksave_read_u32(buffer, &memory->pbuffer.head)
+        || quicksave_read_u32(buffer, &memory->pbuffer.tail)
+        || quicksave_read_u32(buffer, &memory->pbuffer.countdown)
+        || quicksave_read_u32(buffer, &memory->pbuffer.size)
+        || quicksave_read_u32(buffer, &memory->pbuffer.capacity)
+        || quicksave_read_u32(buffer, &memory->pbuffer.insn_len)
+        || quicksave_read_u32(buffer, &memory->pbuffer.reload)
+        || quicksave_read_bool(buffer, &memory->pbuffer.enabled)
+    );
+}
+
+/*
+** Backup storage's chip
+*/
+
+static
+void
+quicksave_backup_chip(
+    struct quicksave_buffer *buffer,
+    struct memory const *memory
+) {
+    struct flash const *flash;
+    struct eeprom const *eeprom;
+
+    flash = &memory->backup_storage.chip.flash;
+    eeprom = &memory->backup_storage.chip.eeprom;
+
+    quicksave_write_u32(buffer, memory->backup_storage.type);
+
+    quicksave_write_u32(buffer, flash->state);
+    quicksave_write_u8(buffer, flash->identity_mode);
+    quicksave_write_u8(buffer, flash->bank);
+
+    quicksave_write_u32(buffer, eeprom->mask);
+    quicksave_write_u32(buffer, eeprom->range);
+    quicksave_write_u32(buffer, eeprom->state);
+    quicksave_write_u32(buffer, eeprom->cmd);
+    quicksave_write_u32(buffer, eeprom->address_mask);
+    quicksave_write_u32(buffer, eeprom->address_len);
+    quicksave_write_u32(buffer, eeprom->transfer_address);
+    quicksave_write_u64(buffer, eeprom->transfer_data);
+    quicksave_write_u32(buffer, eeprom->transfer_len);
+}
+
+static
+bool
+quickload_backup_chip(
+    struct quicksave_buffer *buffer,
+    struct memory *memory
+) {
+    struct flash *flash;
+    struct eeprom *eeprom;
+    uint32_t type;
+    uint32_t flash_state;
+    uint32_t eeprom_state;
+    uint32_t eeprom_cmd;
 
-    free(gba->scheduler.events);
-    gba->scheduler.events = NULL;
-    gba->scheduler.events_size = 0;
+    flash = &memory->backup_storage.chip.flash;
+    eeprom = &memory->backup_storage.chip.eeprom;
 
     if (
-           quicksave_read(&buffer, (uint8_t *)&gba->core, sizeof(gba->core))
-        || quicksave_read(&buffer, (uint8_t *)&gba->memory, sizeof(gba->memory))
-        || quicksave_read(&buffer, (uint8_t *)&gba->io, sizeof(gba->io))
-        || quicksave_read(&buffer, (uint8_t *)&gba->ppu, sizeof(gba->ppu))
-        || quicksave_read(&buffer, (uint8_t *)&gba->gpio, sizeof(gba->gpio))
-        || quicksave_read(&buffer, (uint8_t *)&gba->apu, sizeof(gba->apu))
-        || quicksave_read(&buffer, (uint8_t *)&gba->scheduler.cycles, sizeof(uint64_t))
-        || quicksave_read(&buffer, (uint8_t *)&gba->scheduler.next_event, sizeof(uint64_t))
-        || quicksave_read(&buffer, (uint8_t *)&gba->scheduler.events_size, sizeof(size_t))
+           quicksave_read_enum(buffer, &type, BACKUP_MAX)
+        || quicksave_read_enum(buffer, &flash_state, FLASH_STATE_BANK)
+        || quicksave_read_bool(buffer, &flash->identity_mode)
+        || quicksave_read_bool(buffer, &flash->bank)
+        || quicksave_read_u32(buffer, &eeprom->mask)
+        || quicksave_read_u32(buffer, &eeprom->range)
+        || quicksave_read_enum(buffer, &eeprom_state, EEPROM_STATE_END)
+        || quicksave_read_enum(buffer, &eeprom_cmd, EEPROM_CMD_WRITE)
+        || quicksave_read_u32(buffer, &eeprom->address_mask)
+        || quicksave_read_u32(buffer, &eeprom->address_len)
+        || quicksave_read_u32(buffer, &eeprom->transfer_address)
+        || quicksave_read_u64(buffer, &eeprom->transfer_data)
+        || quicksave_read_u32(buffer, &eeprom->transfer_len)
     ) {
         return (true);
     }
 
-    gba->scheduler.events = calloc(gba->scheduler.events_size, sizeof(struct scheduler_event));
-    hs_assert(gba->scheduler.events);
+    memory->backup_storage.type = type;
+    flash->state = flash_state;
+    eeprom->state = eeprom_state;
+    eeprom->cmd = eeprom_cmd;
+    return (false);
+}
+
+/*
+** IO
+*/
 
-    // Serialize the scheduler's event list
-    for (i = 0; i < gba->scheduler.events_size; ++i) {
-        struct scheduler_event *event;
+static
+void
+quicksave_io(
+    struct quicksave_buffer *buffer,
+    struct io const *io
+) {
+    size_t i;
 
-        event = &gba->scheduler.events[i];
-        if (
-               quicksave_read(&buffer, (uint8_t *)&event->kind, sizeof(enum sched_event_kind))
-            || quicksave_read(&buffer, (uint8_t *)&event->active, sizeof(bool))
-            || quicksave_read(&buffer, (uint8_t *)&event->repeat, sizeof(bool))
-            || quicksave_read(&buffer, (uint8_t *)&event->at, sizeof(uint64_t))
-            || quicksave_read(&buffer, (uint8_t *)&event->period, sizeof(uint64_t))
-            || quicksave_read(&buffer, (uint8_t *)&event->args, sizeof(struct event_args))
-        ) {
-            return (true);
-        }
+    quicksave_write_u16(buffer, io->dispcnt.raw);
+    quicksave_write_u16(buffer, io->greenswp.raw);
+    quicksave_write_u16(buffer, io->dispstat.raw);
+    quicksave_write_u16(buffer, io->vcount.raw);
+
+    for (i = 0; i < 4; ++i) {
+        quicksave_write_u16(buffer, io->bgcnt[i].raw);
+        quicksave_write_u16(buffer, io->bg_hoffset[i].raw);
+        quicksave_write_u16(buffer, io->bg_voffset[i].raw);
+    }
+
+    for (i = 0; i < 2; ++i) {
+        quicksave_write_u16(buffer, io->bg_pa[i].raw);
+        quicksave_write_u16(buffer, io->bg_pb[i].raw);
+        quicksave_write_u16(buffer, io->bg_pc[i].raw);
+        quicksave_write_u16(buffer, io->bg_pd[i].raw);
+        quicksave_write_u32(buffer, io->bg_x[i].raw);
+        quicksave_write_u32(buffer, io->bg_y[i].raw);
+        quicksave_write_u16(buffer, io->winh[i].raw);
+        quicksave_write_u16(buffer, io->winv[i].raw);
     }
 
+    quicksave_write_u16(buffer, io->winin.raw);
+    quicksave_write_u16(buffer, io->winout.raw);
+    quicksave_write_u32(buffer, io->mosaic.raw);
+    quicksave_write_u16(buffer, io->bldcnt.raw);
+    quicksave_write_u16(buffer, io->bldalpha.raw);
+    quicksave_write_u16(buffer, io->bldy.raw);
+
+    quicksave_write_u16(buffer, io->sound1cnt_l.raw);
+    quicksave_write_u16(buffer, io->sound1cnt_h.raw);
+    quicksave_write_u16(buffer, io->sound1cnt_x.raw);
+    quicksave_write_u16(buffer, io->sound2cnt_l.raw);
+    quicksave_write_u16(buffer, io->sound2cnt_h.raw);
+    quicksave_write_u16(buffer, io->sound3cnt_l.raw);
+    quicksave_write_u16(buffer, io->sound3cnt_h.raw);
+    quicksave_write_u16(buffer, io->sound3cnt_x.raw);
+    quicksave_write_u16(buffer, io->sound4cnt_l.raw);
+    quicksave_write_u16(buffer, io->sound4cnt_h.raw);
+    quicksave_write_u16(buffer, io->soundcnt_l.raw);
+    quicksave_write_u16(buffer, io->soundcnt_h.raw);
+    quicksave_write_u16(buffer, io->soundcnt_x.raw);
+    quicksave_write_u32(buffer, io->soundbias.raw);
+    quicksave_write(buffer, io->waveram, sizeof(io->waveram));
+
+    for (i = 0; i < 4; ++i) {
+        struct dma_channel const *channel;
+
+        channel = &io->dma[i];
+        quicksave_write_u32(buffer, channel->src.raw);
+        quicksave_write_u32(buffer, channel->dst.raw);
+        quicksave_write_u16(buffer, channel->count.raw);
+        quicksave_write_u16(buffer, channel->control.raw);
+        quicksave_write_u32(buffer, channel->internal_src);
+        quicksave_write_u32(buffer, channel->internal_dst);
+        quicksave_write_u32(buffer, channel->internal_count);
+        quicksave_write_u32(buffer, channel->latch);
+        quicksave_write_u8(buffer, channel->is_fifo);
+        quicksave_write_u8(buffer, channel->is_video);
+        quicksave_write_handle(buffer, channel->enable_event_handle);
+    }
+
+    for (i = 0; i < 4; ++i) {
+        struct timer const *timer;
+
+        timer = &io->timers[i];
+        quicksave_write_u16(buffer, timer->counter.raw);
+        quicksave_write_u16(buffer, timer->reload.raw);
+        quicksave_write_u16(buffer, timer->control.raw);
+        quicksave_write_handle(buffer, timer->handler);
+        quicksave_write_u16(buffer, io->pending.timers[i].reload.raw);
+        quicksave_write_u16(buffer, io->pending.timers[i].control.raw);
+    }
+
+    quicksave_write_u16(buffer, io->keyinput.raw);
+    quicksave_write_u16(buffer, io->keycnt.raw);
+    quicksave_write_u16(buffer, io->siocnt.raw);
+    quicksave_write_u16(buffer, io->rcnt.raw);
+    quicksave_write_u16(buffer, io->int_enabled.raw);
+    quicksave_write_u16(buffer, io->int_flag.raw);
+    quicksave_write_u16(buffer, io->waitcnt.raw);
+    quicksave_write_u16(buffer, io->ime.raw);
+    quicksave_write_u8(buffer, io->postflg);
+    quicksave_write_u16(buffer, io->pending.int_enabled.raw);
+    quicksave_write_u16(buffer, io->pending.int_flag.raw);
+    quicksave_write_u16(buffer, io->pending.ime.raw);
+}
+
+static
+bool
+quickload_io(
+    struct quicksave_buffer *buffer,
+    struct io *io
+) {
+    size_t i;
+
+    if (
+           quicksave_read_u16(buffer, &io->dispcnt.raw)
+        || quicksave_read_u16(buffer, &io->greenswp.raw)
+        || quicksave_read_u16(buffer, &io->dispstat.raw)
+        || quicksave_read_u16(buffer, &io->vcount.raw)
+    ) {
+        return (true);
+    }
+
+    for (i = 0; i < 4; ++i) {
+        if (
+               quicksave_read_u16(buffer, &io->bgcnt[i].raw)
+            || quicksave_read_u16(buffer, &io->bg_hoffset[i].raw)
+            || quicksave_read_u16(buffer, &io->bg_voffset[i].raw)
+        ) {
+            return (true);
+        }
+    }
+
+    for (i = 0; i < 2; ++i) {
+        if (
+               quicksave_read_u16(buffer, &io->bg_pa[i].raw)
+            || quicksave_read_u16(buffer, &io->bg_pb[i].raw)
+            || quicksave_read_u16(buffer, &io->bg_pc[i].raw)
+            || quicksave_read_u16(buffer, &io->bg_pd[i].raw)
+            || quicksave_read_u32(buffer, &io->bg_x[i].raw)
+            || quicksave_read_u32(buffer, &io->bg_y[i].raw)
+            || quicksave_read_u16(buffer, &io->winh[i].raw)
+            || quicksave_read_u16(buffer, &io->winv[i].raw)
+        ) {
+            return (true);
+        }
+    }
+
+    if (
+           quicksave_read_u16(buffer, &io->winin.raw)
+        || quicksave_read_u16(buffer, &io->winout.raw)
+        || quicksave_read_u32(buffer, &io->mosaic.raw)
+        || quicksave_read_u16(buffer, &io->bldcnt.raw)
+        || quicksave_read_u16(buffer, &io->bldalpha.raw)
+        || quicksave_read_u16(buffer, &io->bldy.raw)
+        || quicksave_read_u16(buffer, &io->sound1cnt_l.raw)
+        || quicksave_read_u16(buffer, &io->sound1cnt_h.raw)
+        || quicksave_read_u16(buffer, &io->sound1cnt_x.raw)
+        || quicksave_read_u16(buffer, &io->sound2cnt_l.raw)
+        || quicksave_read_u16(buffer, &io->sound2cnt_h.raw)
+        || quicksave_read_u16(buffer, &io->sound3cnt_l.raw)
+        || quicksave_read_u16(buffer, &io->sound3cnt_h.raw)
+        || quicksave_read_u16(buffer, &io->sound3cnt_x.raw)
+        || quicksave_read_u16(buffer, &io->sound4cnt_l.raw)
+        || quicksave_read_u16(buffer, &io->sound4cnt_h.raw)
+        || quicksave_read_u16(buffer, &io->soundcnt_l.raw)
+        || quicksave_read_u16(buffer, &io->soundcnt_h.raw)
+        || quicksave_read_u16(buffer, &io->soundcnt_x.raw)
+        || quicksave_read_u32(buffer, &io->soundbias.raw)
+        || quicksave_read(buffer, io->waveram, sizeof(io->waveram))
+    ) {
+        return (true);
+    }
+
+    for (i = 0; i < 4; ++i) {
+        struct dma_channel *channel;
+
+        channel = &io->dma[i];
+        channel->index = i;
+        if (
+               quicksave_read_u32(buffer, &channel->src.raw)
+            || quicksave_read_u32(buffer, &channel->dst.raw)
+            || quicksave_read_u16(buffer, &channel->count.raw)
+            || quicksave_read_u16(buffer, &channel->control.raw)
+            || quicksave_read_u32(buffer, &channel->internal_src)
+            || quicksave_read_u32(buffer, &channel->internal_dst)
+            || quicksave_read_u32(buffer, &channel->internal_count)
+            || quicksave_read_u32(buffer, &channel->latch)
+            || quicksave_read_bool(buffer, &channel->is_fifo)
+            || quicksave_read_bool(buffer, &channel->is_video)
+            || quicksave_read_handle(buffer, &channel->enable_event_handle)
+        ) {
+            return (true);
+        }
+    }
+
+    for (i = 0; i < 4; ++i) {
+        struct timer *timer;
+
+        timer = &io->timers[i];
+        if (
+               quicksave_read_u16(buffer, &timer->counter.raw)
+            || quicksave_read_u16(buffer, &timer->reload.raw)
+            || quicksave_read_u16(buffer, &timer->control.raw)
+            || quicksave_read_handle(buffer, &timer->handler)
+            || quicksave_read_u16(buffer, &io->pending.timers[i].reload.raw)
+            || quicksave_read_u16(buffer, &io->pending.timers[i].control.raw)
+        ) {
+            return (true);
+        }
+    }
+
+    return (
+           quicksave_read_u16(buffer, &io->keyinput.raw)
+        || quicksave_read_u16(buffer, &io->keycnt.raw)
+        || quicksave_read_u16(buffer, &io->siocnt.raw)
+        || quicksave_read_u16(buffer, &io->rcnt.raw)
+        || quicksave_read_u16(buffer, &io->int_enabled.raw)
+        || quicksave_read_u16(buffer, &io->int_flag.raw)
+        || quicksave_read_u16(buffer, &io->waitcnt.raw)
+        || quicksave_read_u16(buffer, &io->ime.raw)
+        || quicksave_read_u8(buffer, &io->postflg)
+        || quicksave_read_u16(buffer, &io->pending.int_enabled.raw)
+        || quicksave_read_u16(buffer, &io->pending.int_flag.raw)
+        || quicksave_read_u16(buffer, &io->pending.ime.raw)
+    );
+}
+
+/*
+** PPU
+*/
+
+static
+void
+quicksave_ppu(
+    struct quicksave_buffer *buffer,
+    struct ppu const *ppu
+) {
+    size_t i;
+
+    for (i = 0; i < array_length(ppu->framebuffer); ++i) {
+        quicksave_write_u32(buffer, ppu->framebuffer[i]);
+    }
+
+    for (i = 0; i < 2; ++i) {
+        size_t x;
+
+        quicksave_write_u32(buffer, ppu->internal_px[i]);
+        quicksave_write_u32(buffer, ppu->internal_py[i]);
+        quicksave_write_u32(buffer, ppu->win_masks_hash[i]);
+        for (x = 0; x < array_length(ppu->win_masks[i]); ++x) {
+            quicksave_write_u8(buffer, ppu->win_masks[i][x]);
+        }
+    }
+
+    quicksave_write_u8(buffer, ppu->reload_internal_affine_regs);
+    quicksave_write_u8(buffer, ppu->video_capture_enabled);
+}
+
+static
+bool
+quickload_ppu(
+    struct quicksave_buffer *buffer,
+    struct ppu *ppu
+) {
+    size_t i;
+
+    for (i = 0; i < array_length(ppu->framebuffer); ++i) {
+        if (quicksave_read_u32(buffer, &ppu->framebuffer[i])) {
+            return (true);
+        }
+    }
+
+    for (i = 0; i < 2; ++i) {
+        size_t x;
+
+        if (
+               quicksave_read_u32(buffer, (uint32_t *)&ppu->internal_px[i])
+            || quicksave_read_u32(buffer, (uint32_t *)&ppu->internal_py[i])
+            || quicksave_read_u32(buffer, &ppu->win_masks_hash[i])
+        ) {
+            return (true);
+        }
+
+        for (x = 0; x < array_length(ppu->win_masks[i]); ++x) {
+            if (quicksave_read_bool(buffer, &ppu->win_masks[i][x])) {
+                return (true);
+            }
+        }
+    }
+
+    return (
+           quicksave_read_bool(buffer, &ppu->reload_internal_affine_regs)
+        || quicksave_read_bool(buffer, &ppu->video_capture_enabled)
+    );
+}
+
+/*
+** APU
+*/
+
+static
+void
+quicksave_apu_counter(
+    struct quicksave_buffer *buffer,
+    struct apu_counter const *counter
+) {
+    quicksave_write_u8(buffer, counter->enabled);
+    quicksave_write_u32(buffer, counter->value);
+}
+
+static
+bool
+quickload_apu_counter(
+    struct quicksave_buffer *buffer,
+    struct apu_counter *counter
+) {
+    return (
+           quicksave_read_bool(buffer, &counter->enabled)
+        || quicksave_read_u32(buffer, &counter->value)
+    );
+}
+
+static
+void
+quicksave_apu_envelope(
+    struct quicksave_buffer *buffer,
+    struct apu_envelope const *envelope
+) {
+    quicksave_write_u32(buffer, envelope->step_time);
+    quicksave_write_u8(buffer, envelope->direction);
+    quicksave_write_u32(buffer, envelope->initial_volume);
+    quicksave_write_u8(buffer, envelope->enabled);
+    quicksave_write_u32(buffer, envelope->step);
+    quicksave_write_u32(buffer, envelope->volume);
+}
+
+static
+bool
+quickload_apu_envelope(
+    struct quicksave_buffer *buffer,
+    struct apu_envelope *envelope
+) {
+    return (
+           quicksave_read_u32(buffer, &envelope->step_time)
+        || quicksave_read_bool(buffer, &envelope->direction)
+        || quicksave_read_u32(buffer, (uint32_t *)&envelope->initial_volume)
+        || quicksave_read_bool(buffer, &envelope->enabled)
+        || quicksave_read_u32(buffer, &envelope->step)
+        || quicksave_read_u32(buffer, (uint32_t *)&envelope->volume)
+    );
+}
+
+static
+void
+quicksave_apu(
+    struct quicksave_buffer *buffer,
+    struct apu const *apu
+) {
+    struct apu_sweep const *sweep;
+    size_t i;
+
+    for (i = 0; i < 2; ++i) {
+        quicksave_write(buffer, apu->fifos[i].data, sizeof(apu->fifos[i].data));
+        quicksave_write_u32(buffer, apu->fifos[i].read_idx);
+        quicksave_write_u32(buffer, apu->fifos[i].write_idx);
+        quicksave_write_u32(buffer, apu->fifos[i].size);
+    }
+
+    sweep = &apu->tone_and_sweep.sweep;
+    quicksave_write_u8(buffer, apu->tone_and_sweep.enabled);
+    quicksave_write_u32(buffer, sweep->shifts);
+    quicksave_write_u8(buffer, sweep->direction);
+    quicksave_write_u32(buffer, sweep->time);
+    quicksave_write_u32(buffer, sweep->step);
+    quicksave_write_u32(buffer, sweep->frequency);
+    quicksave_write_u32(buffer, sweep->shadow_frequency);
+    quicksave_apu_counter(buffer, &apu->tone_and_sweep.counter);
+    quicksave_apu_envelope(buffer, &apu->tone_and_sweep.envelope);
+    quicksave_write_u32(buffer, apu->tone_and_sweep.step);
+    quicksave_write_handle(buffer, apu->tone_and_sweep.step_handler);
+
+    quicksave_write_u8(buffer, apu->tone.enabled);
+    quicksave_apu_counter(buffer, &apu->tone.counter);
+    quicksave_apu_envelope(buffer, &apu->tone.envelope);
+    quicksave_write_u32(buffer, apu->tone.step);
+    quicksave_write_handle(buffer, apu->tone.step_handler);
+
+    quicksave_write_u8(buffer, apu->wave.enabled);
+    quicksave_write_u32(buffer, apu->wave.step);
+    quicksave_write_handle(buffer, apu->wave.step_handler);
+    quicksave_apu_counter(buffer, &apu->wave.counter);
+
+    quicksave_write_u8(buffer, apu->noise.enabled);
+    quicksave_apu_counter(buffer, &apu->noise.counter);
+    quicksave_apu_envelope(buffer, &apu->noise.envelope);
+    quicksave_write_u32(buffer, apu->noise.lfsr);
+    quicksave_write_handle(buffer, apu->noise.step_handler);
+
+    quicksave_write_u32(buffer, apu->modules_step);
+
+    quicksave_write_u16(buffer, apu->latch.fifo[0]);
+    quicksave_write_u16(buffer, apu->latch.fifo[1]);
+    quicksave_write_u16(buffer, apu->latch.channel_1);
+    quicksave_write_u16(buffer, apu->latch.channel_2);
+    quicksave_write_u16(buffer, apu->latch.channel_3);
+    quicksave_write_u16(buffer, apu->latch.channel_4);
+}
+
+static
+bool
+quickload_apu(
+    struct quicksave_buffer *buffer,
+    struct apu *apu
+) {
+    struct apu_sweep *sweep;
+    size_t i;
+
+    for (i = 0; i < 2; ++i) {
+        uint32_t read_idx;
+        uint32_t write_idx;
+        uint32_t size;
+
+        if (
+               quicksave_read(buffer, apu->fifos[i].data, sizeof(apu->fifos[i].data))
+            || quicksave_read_enum(buffer, &read_idx, FIFO_CAPACITY - 1)
+            || quicksave_read_enum(buffer, &write_idx, FIFO_CAPACITY - 1)
+            || quicksave_read_enum(buffer, &size, FIFO_CAPACITY)
+        ) {
+            return (true);
+        }
+
+        apu->fifos[i].read_idx = read_idx;
+        apu->fifos[i].write_idx = write_idx;
+        apu->fifos[i].size = size;
+    }
+
+    sweep = &apu->tone_and_sweep.sweep;
+    return (
+           quicksave_read_bool(buffer, &apu->tone_and_sweep.enabled)
+        || quicksave_read_u32(buffer, &sweep->shifts)
+        || quicksave_read_bool(buffer, &sweep->direction)
+        || quicksave_read_u32(buffer, &sweep->time)
+        || quicksave_read_u32(buffer, &sweep->step)
+        || quicksave_read_u32(buffer, &sweep->frequency)
+        || quicksave_read_u32(buffer, &sweep->shadow_frequency)
+        || quickload_apu_counter(buffer, &apu->tone_and_sweep.counter)
+        || quickload_apu_envelope(buffer, &apu->tone_and_sweep.envelope)
+        || quicksave_read_u32(buffer, &apu->tone_and_sweep.step)
+        || quicksave_read_handle(buffer, &apu->tone_and_sweep.step_handler)
+
+        || quicksave_read_bool(buffer, &apu->tone.enabled)
+        || quickload_apu_counter(buffer, &apu->tone.counter)
+        || quickload_apu_envelope(buffer, &apu->tone.envelope)
+        || quicksave_read_u32(buffer, &apu->tone.step)
+        || quicksave_read_handle(buffer, &apu->tone.step_handler)
+
+        || quicksave_read_bool(buffer, &apu->wave.enabled)
+        || quicksave_read_u32(buffer, &apu->wave.step)
+        || quicksave_read_handle(buffer, &apu->wave.step_handler)
+        || quickload_apu_counter(buffer, &apu->wave.counter)
+
+        || quicksave_read_bool(buffer, &apu->noise.enabled)
+        || quickload_apu_counter(buffer, &apu->noise.counter)
+        || quickload_apu_envelope(buffer, &apu->noise.envelope)
+        || quicksave_read_u32(buffer, &apu->noise.lfsr)
+        || quicksave_read_handle(buffer, &apu->noise.step_handler)
+
+        || quicksave_read_u32(buffer, &apu->modules_step)
+
+        || quicksave_read_u16(buffer, (uint16_t *)&apu->latch.fifo[0])
+        || quicksave_read_u16(buffer, (uint16_t *)&apu->latch.fifo[1])
+        || quicksave_read_u16(buffer, (uint16_t *)&apu->latch.channel_1)
+        || quicksave_read_u16(buffer, (uint16_t *)&apu->latch.channel_2)
+        || quicksave_read_u16(buffer, (uint16_t *)&apu->latch.channel_3)
+        || quicksave_read_u16(buffer, (uint16_t *)&apu->latch.channel_4)
+    );
+}
+
+/*
+** GPIO
+*/
+
+static
+void
+quicksave_gpio(
+    struct quicksave_buffer *buffer,
+    struct gpio const *gpio
+) {
+    quicksave_write_u32(buffer, gpio->device);
+    quicksave_write_u8(buffer, gpio->readable);
+
+    quicksave_write_u32(buffer, gpio->rtc.state);
+    quicksave_write_u64(buffer, gpio->rtc.data);
+    quicksave_write_u8(buffer, gpio->rtc.data_count);
+    quicksave_write_u8(buffer, gpio->rtc.data_len);
+    quicksave_write_u8(buffer, gpio->rtc.sck);
+    quicksave_write_u8(buffer, gpio->rtc.sio);
+    quicksave_write_u8(buffer, gpio->rtc.cs);
+    quicksave_write_u32(buffer, gpio->rtc.active_register);
+    quicksave_write_u8(buffer, gpio->rtc.control.raw);
+
+    quicksave_write_u8(buffer, gpio->rumble.enabled);
+}
+
+static
+bool
+quickload_gpio(
+    struct quicksave_buffer *buffer,
+    struct gpio *gpio
+) {
+    uint32_t device;
+    uint32_t rtc_state;
+    uint32_t rtc_active_register;
+
+    if (
+           quicksave_read_enum(buffer, &device, GPIO_MAX)
+        || quicksave_read_bool(buffer, &gpio->readable)
+        || quicksave_read_enum(buffer, &rtc_state, RTC_REG_SEND)
+        || quicksave_read_u64(buffer, &gpio->rtc.data)
+        || quicksave_read_u8(buffer, &gpio->rtc.data_count)
+        || quicksave_read_u8(buffer, &gpio->rtc.data_len)
+        || quicksave_read_bool(buffer, &gpio->rtc.sck)
+        || quicksave_read_bool(buffer, &gpio->rtc.sio)
+        || quicksave_read_bool(buffer, &gpio->rtc.cs)
+        || quicksave_read_enum(buffer, &rtc_active_register, RTC_REG_IRQ)
+        || quicksave_read_u8(buffer, &gpio->rtc.control.raw)
+        || quicksave_read_bool(buffer, &gpio->rumble.enabled)
+    ) {
+        return (true);
+    }
+
+    gpio->device = device;
+    gpio->rtc.state = rtc_state;
+    gpio->rtc.active_register = rtc_active_register;
+    return (false);
+}
+
+/*
+** Scheduler
+*/
+
+static
+void
+quicksave_scheduler(
+    struct quicksave_buffer *buffer,
+    struct scheduler const *scheduler
+) {
+    size_t i;
+
+    quicksave_write_u64(buffer, scheduler->cycles);
+    quicksave_write_u32(buffer, scheduler->events_size);
+    for (i = 0; i < scheduler->events_size; ++i) {
+        struct scheduler_event const *event;
+
+        event = scheduler->events + i;
+        quicksave_write_u32(buffer, event->kind);
+        quicksave_write_u8(buffer, event->active);
+        quicksave_write_u8(buffer, event->repeat);
+        quicksave_write_u64(buffer, event->at);
+        quicksave_write_u64(buffer, event->period);
+        quicksave_write_u32(buffer, event->args.a1.u32);
+        quicksave_write_u32(buffer, event->args.a2.u32);
+        quicksave_write_u32(buffer, event->args.a3.u32);
+        quicksave_write_u32(buffer, event->args.a4.u32);
+    }
+}
+
+/*
+** Read the scheduler's events into `state`, which owns them until they are handed to the scheduler.
+*/
+static
+bool
+quickload_scheduler(
+    struct quicksave_buffer *buffer,
+    struct quickload_state *state
+) {
+    uint32_t events_size;
+    size_t i;
+
+    if (
+           quicksave_read_u64(buffer, &state->scheduler.cycles)
+        || quicksave_read_u32(buffer, &events_size)
+        || buffer->size != QUICKSAVE_SCHEDULER_SIZE + (size_t)events_size * QUICKSAVE_EVENT_SIZE
+    ) {
+        return (true);
+    }
+
+    free(state->scheduler.events);
+    state->scheduler.events_size = events_size;
+    state->scheduler.events = calloc(events_size, sizeof(struct scheduler_event));
+    hs_assert(!events_size || state->scheduler.events);
+
+    for (i = 0; i < events_size; ++i) {
+        struct scheduler_event *event;
+        uint32_t kind;
+
+        event = &state->scheduler.events[i];
+        if (
+               quicksave_read_enum(buffer, &kind, SCHED_EVENT_MAX)
+            || quicksave_read_bool(buffer, &event->active)
+            || quicksave_read_bool(buffer, &event->repeat)
+            || quicksave_read_u64(buffer, &event->at)
+            || quicksave_read_u64(buffer, &event->period)
+            || quicksave_read_u32(buffer, &event->args.a1.u32)
+            || quicksave_read_u32(buffer, &event->args.a2.u32)
+            || quicksave_read_u32(buffer, &event->args.a3.u32)
+            || quicksave_read_u32(buffer, &event->args.a4.u32)
+        ) {
+            return (true);
+        }
+
+        event->kind = kind;
+    }
+
+    return (false);
+}
+
+/*
+** Save the current state of the emulator in the given buffer.
+*/
+void
+quicksave(
+    struct gba *gba,
+    uint8_t **data,
+    size_t *size
+) {
+    struct quicksave_buffer buffer;
+    struct memory const *memory;
+    size_t start;
+
+    memory = &gba->memory;
+
+    // Allocate enough space for the biggest sections upfront
+    buffer.size = PAGE_ALIGN(EWRAM_SIZE + IWRAM_SIZE + PALRAM_SIZE + VRAM_SIZE + OAM_SIZE + sizeof(gba->ppu));
+    buffer.data = malloc(buffer.size);
+    buffer.index = 0;
+    hs_assert(buffer.data);
+
+    quicksave_write_u32(&buffer, QUICKSAVE_MAGIC);
+    quicksave_write_u32(&buffer, QUICKSAVE_VERSION);
+    quicksave_write_u64(&buffer, quicksave_game_hash(gba));
+    quicksave_write_u32(&buffer, gba->rom.size);
+
+    start = quicksave_begin_section(&buffer, QUICKSAVE_SECTION_CORE);
+    quicksave_core(&buffer, &gba->core);
+    quicksave_end_section(&buffer, start);
+
+    quicksave_write_section(&buffer, QUICKSAVE_SECTION_EWRAM, memory->ewram, sizeof(memory->ewram));
+    quicksave_write_section(&buffer, QUICKSAVE_SECTION_IWRAM, memory->iwram, sizeof(memory->iwram));
+    quicksave_write_section(&buffer, QUICKSAVE_SECTION_PALRAM, memory->palram, sizeof(memory->palram));
+    quicksave_write_section(&buffer, QUICKSAVE_SECTION_VRAM, memory->vram, sizeof(memory->vram));
+    quicksave_write_section(&buffer, QUICKSAVE_SECTION_OAM, memory->oam, sizeof(memory->oam));
+
+    // The buses and the prefetch buffer
+    start = quicksave_begin_section(&buffer, QUICKSAVE_SECTION_MEMORY);
+    quicksave_memory(&buffer, memory);
+    quicksave_end_section(&buffer, start);
+
+    start = quicksave_begin_section(&buffer, QUICKSAVE_SECTION_BACKUP_CHIP);
+    quicksave_backup_chip(&buffer, memory);
+    quicksave_end_section(&buffer, start);
+
+    start = quicksave_begin_section(&buffer, QUICKSAVE_SECTION_IO);
+    quicksave_io(&buffer, &gba->io);
+    quicksave_end_section(&buffer, start);
+
+    start = quicksave_begin_section(&buffer, QUICKSAVE_SECTION_PPU);
+    quicksave_ppu(&buffer, &gba->ppu);
+    quicksave_end_section(&buffer, start);
+
+    start = quicksave_begin_section(&buffer, QUICKSAVE_SECTION_APU);
+    quicksave_apu(&buffer, &gba->apu);
+    quicksave_end_section(&buffer, start);
+
+    start = quicksave_begin_section(&buffer, QUICKSAVE_SECTION_GPIO);
+    quicksave_gpio(&buffer, &gba->gpio);
+    quicksave_end_section(&buffer, start);
+
+    start = quicksave_begin_section(&buffer, QUICKSAVE_SECTION_SCHEDULER);
+    quicksave_scheduler(&buffer, &gba->scheduler);
+    quicksave_end_section(&buffer, start);
+
+    *data = buffer.data;
+    *size = buffer.index;
+}
+
+/*
+** Read the content of the given section into `state`.
+** `section` holds the section's payload and nothing else: it must be consumed entirely.
+*/
+static
+bool
+quickload_section(
+    struct quickload_state *state,
+    struct quicksave_buffer *section,
+    uint32_t kind
+) {
+    struct memory *memory;
+    bool err;
+
+    memory = &state->memory;
+
+    switch (kind) {
+        case QUICKSAVE_SECTION_CORE:        err = quickload_core(section, &state->core); break;
+        case QUICKSAVE_SECTION_EWRAM:       err = quicksave_read(section, memory->ewram, sizeof(memory->ewram)); break;
+        case QUICKSAVE_SECTION_IWRAM:       err = quicksave_read(section, memory->iwram, sizeof(memory->iwram)); break;
+        case QUICKSAVE_SECTION_PALRAM:      err = quicksave_read(section, memory->palram, sizeof(memory->palram)); break;
+        case QUICKSAVE_SECTION_VRAM:        err = quicksave_read(section, memory->vram, sizeof(memory->vram)); break;
+        case QUICKSAVE_SECTION_OAM:         err = quicksave_read(section, memory->oam, sizeof(memory->oam)); break;
+        case QUICKSAVE_SECTION_MEMORY:      err = quickload_memory(section, memory); break;
+        case QUICKSAVE_SECTION_BACKUP_CHIP: err = quickload_backup_chip(section, memory); break;
+        case QUICKSAVE_SECTION_IO:          err = quickload_io(section, &state->io); break;
+        case QUICKSAVE_SECTION_PPU:         err = quickload_ppu(section, &state->ppu); break;
+        case QUICKSAVE_SECTION_APU:         err = quickload_apu(section, &state->apu); break;
+        case QUICKSAVE_SECTION_GPIO:        err = quickload_gpio(section, &state->gpio); break;
+        case QUICKSAVE_SECTION_SCHEDULER:   err = quickload_scheduler(section, state); break;
+        default:                            return (false); // Unknown sections are skipped
+    }
+
+    if (err || section->index != section->size) {
+        logln(HS_ERROR, "The save state's section %u is invalid.", kind);
+        return (true);
+    }
+
+    state->sections |= (1 << kind);
+    return (false);
+}
+
+/*
+** Ensure all the event handles held by `state` refer to one of its events.
+*/
+static
+bool
+quickload_check_handles(
+    struct quickload_state const *state
+) {
+    event_handler_t handles[4 + 4 + 4];
+    size_t i;
+
+    for (i = 0; i < 4; ++i) {
+        handles[i] = state->io.dma[i].enable_event_handle;
+        handles[4 + i] = state->io.timers[i].handler;
+    }
+
+    handles[8] = state->apu.tone_and_sweep.step_handler;
+    handles[9] = state->apu.tone.step_handler;
+    handles[10] = state->apu.wave.step_handler;
+    handles[11] = state->apu.noise.step_handler;
+
+    for (i = 0; i < array_length(handles); ++i) {
+        if (handles[i] != INVALID_EVENT_HANDLE && handles[i] >= state->scheduler.events_size) {
+            return (true);
+        }
+    }
+    return (false);
+}
+
+/*
+** Read and validate the given save state into `state`, without modifying the emulator.
+*/
+static
+bool
+quickload_read(
+    struct gba *gba,
+    struct quicksave_buffer *buffer,
+    struct quickload_state *state
+) {
+    uint32_t version;
+    uint32_t rom_size;
+    uint64_t rom_hash;
+    uint32_t magic;
+
+    if (
+           quicksave_read_u32(buffer, &magic)
+        || quicksave_read_u32(buffer, &version)
+        || quicksave_read_u64(buffer, &rom_hash)
+        || quicksave_read_u32(buffer, &rom_size)
+    ) {
+        return (true);
+    }
+
+    if (magic != QUICKSAVE_MAGIC || version != QUICKSAVE_VERSION) {
+        logln(HS_ERROR, "The save state's format isn't supported.");
+        return (true);
+    }
+
+    if (rom_hash != quicksave_game_hash(gba) || rom_size != gba->rom.size) {
+        logln(HS_ERROR, "The save state was made for another game.");
+        return (true);
+    }
+
+    while (buffer->index < buffer->size) {
+        struct quicksave_buffer section;
+        uint32_t kind;
+        uint32_t size;
+
+        if (quicksave_read_u32(buffer, &kind) || quicksave_read_u32(buffer, &size)) {
+            return (true);
+        }
+
+        if (buffer->size - buffer->index < size) {
+            return (true);
+        }
+
+        section.data = buffer->data + buffer->index;
+        section.size = size;
+        section.index = 0;
+
+        if (quickload_section(state, &section, kind)) {
+            return (true);
+        }
+
+        buffer->index += size;
+    }
+
+    // All the sections are mandatory
+    if (state->sections != ((1 << QUICKSAVE_SECTION_LEN) - 2)) {
+        logln(HS_ERROR, "The save state is incomplete.");
+        return (true);
+    }
+
+    if (quickload_check_handles(state)) {
+        logln(HS_ERROR, "The save state refers to events that don't exist.");
+        return (true);
+    }
+
+    return (false);
+}
+
+/*
+** Load a new state for the emulator from the given save state.
+**
+** The save state is entirely read and validated first: if it can't be loaded, true is returned and
+** the emulator is left untouched.
+*/
+bool
+quickload(
+    struct gba *gba,
+    uint8_t *data,
+    size_t size
+) {
+    struct quicksave_buffer buffer;
+    struct quickload_state *state;
+    struct memory *memory;
+
+    buffer.data = data;
+    buffer.size = size;
+    buffer.index = 0;
+
+    // Start from the current state so the fields that aren't saved keep their value
+    state = hs_aligned_alloc(alignof(struct quickload_state), sizeof(*state));
+    hs_assert(state);
+    state->sections = 0;
+    state->core = gba->core;
+    state->memory = gba->memory;
+    state->io = gba->io;
+    state->ppu = gba->ppu;
+    state->apu = gba->apu;
+    state->gpio = gba->gpio;
+    state->scheduler.cycles = 0;
+    state->scheduler.events = NULL;
+    state->scheduler.events_size = 0;
+
+    if (quickload_read(gba, &buffer, state)) {
+        free(state->scheduler.events);
+        hs_aligned_free(state);
+        return (true);
+    }
+
+    memory = &gba->memory;
+
+    gba->core = state->core;
+    memcpy(memory->ewram, state->memory.ewram, sizeof(memory->ewram));
+    memcpy(memory->iwram, state->memory.iwram, sizeof(memory->iwram));
+    memcpy(memory->palram, state->memory.palram, sizeof(memory->palram));
+    memcpy(memory->vram, state->memory.vram, sizeof(memory->vram));
+    memcpy(memory->oam, state->memory.oam, sizeof(memory->oam));
+    memory->backup_storage = state->memory.backup_storage;
+    memory->pbuffer = state->memory.pbuffer;
+    memory->bios_bus = state->memory.bios_bus;
+    memory->dma_bus = state->memory.dma_bus;
+    memory->hle_bios = state->memory.hle_bios;
+    memory->was_last_access_from_dma = state->memory.was_last_access_from_dma;
+    memory->gamepak_bus_in_use = state->memory.gamepak_bus_in_use;
+    gba->io = state->io;
+    gba->ppu = state->ppu;
+    gba->apu = state->apu;
+    gba->gpio = state->gpio;
+
+    // Hand the events over to the scheduler and rebuild its internal ordering
+    sched_cleanup(gba);
+    gba->scheduler.cycles = state->scheduler.cycles;
+    gba->scheduler.events = state->scheduler.events;
+    gba->scheduler.events_size = state->scheduler.events_size;
+    sched_rebuild(gba);
+
+    hs_aligned_free(state);
+
+    // The memory layout (backup storage, GPIO) may have changed
+    mem_update_page_table(gba);
+
+    // So may have any byte of the memory
+    mem_dirty_mark_all(gba);
+
+    // Derive the access times from the restored REG_WAITCNT
+    mem_update_waitstates(gba);
+
+    // The cached blocks may not match the new content of the memory
+    core_cache_flush(gba);
+    core_idle_loop_reset(gba);
+
+    // The history leads to another state
+    rewind_reset(gba);
+    runahead_reset(gba);
+
     return (false);
 }
@@ -0,0 +1,597 @@
+/******************************************************************************\
+**
+**  This file is part of the Hades GBA Emulator, and is made available under
+**  the terms of the GNU General Public License version 2.
+**
+**  Copyright (C) 2021-2024 - The Hades Authors
+**
+\******************************************************************************/
+
+#include <stddef.h>
+#include <string.h>
+#include "hades.h"
+#include "gba/gba.h"
+#include "gba/core.h"
+#include "gba/rewind.h"
+
+/*
+** The state captured by the rewind is made of the following segments, laid out back to back in `image`.
+**
+** The BIOS never changes and the PPU's framebuffer is rendered again by the next frame, so neither
+** are part of it. The scheduler's events come last as they are the only segment that can grow.
+*/
+enum rewind_segments {
+    REWIND_SEGMENT_SCHEDULER,
+    REWIND_SEGMENT_CORE,
+    REWIND_SEGMENT_EWRAM,
+    REWIND_SEGMENT_IWRAM,
+    REWIND_SEGMENT_PALRAM,
+    REWIND_SEGMENT_VRAM,
+    REWIND_SEGMENT_OAM,
+    REWIND_SEGMENT_MEMORY,
+    REWIND_SEGMENT_IO,
+    REWIND_SEGMENT_PPU,
+    REWIND_SEGMENT_APU,
+    REWIND_SEGMENT_GPIO,
+    REWIND_SEGMENT_EVENTS,
+
+    REWIND_SEGMENT_MIN = REWIND_SEGMENT_SCHEDULER,
+    REWIND_SEGMENT_MAX = REWIND_SEGMENT_EVENTS,
+    REWIND_SEGMENT_LEN = REWIND_SEGMENT_MAX + 1,
+};
+
+struct rewind_segment {
+    uint8_t *data;
+    size_t size;
+    uint32_t dirty_base;    // The first dirty block of `data`, or `MEM_DIRTY_NO_BLOCK` if it must always be compared
+};
+
+struct rewind_scheduler {
+    uint64_t cycles;
+    uint64_t events_size;
+};
+
+#define REWIND_RUN_HEADER_SIZE  (2 * sizeof(uint32_t))
+#define REWIND_WORD_SIZE        (sizeof(uint64_t))
+
+#define REWIND_MIN_EVENTS       (16u)
+
+/*
+** Fill `segments` with the location of the live state of the GBA.
+**
+** The scheduler's cycles and events aren't contiguous in memory: the segments point to `scheduler`
+** and `rewind->events` instead (see `rewind_copy_scheduler()`).
+*/
+static
+void
+rewind_build_segments(
+    struct gba *gba,
+    struct rewind_segment *segments,
+    struct rewind_scheduler *scheduler
+) {
+    struct rewind *rewind;
+    struct memory *memory;
+
+    rewind = &gba->rewind;
+    memory = &gba->memory;
+
+    segments[REWIND_SEGMENT_SCHEDULER] = (struct rewind_segment){ (uint8_t *)scheduler, sizeof(*scheduler), MEM_DIRTY_NO_BLOCK };
+    segments[REWIND_SEGMENT_CORE] = (struct rewind_segment){ (uint8_t *)&gba->core, sizeof(gba->core), MEM_DIRTY_NO_BLOCK };
+    segments[REWIND_SEGMENT_EWRAM] = (struct rewind_segment){ memory->ewram, sizeof(memory->ewram), MEM_DIRTY_EWRAM_BLOCK };
+    segments[REWIND_SEGMENT_IWRAM] = (struct rewind_segment){ memory->iwram, sizeof(memory->iwram), MEM_DIRTY_IWRAM_BLOCK };
+    segments[REWIND_SEGMENT_PALRAM] = (struct rewind_segment){ memory->palram, sizeof(memory->palram), MEM_DIRTY_PALRAM_BLOCK };
+    segments[REWIND_SEGMENT_VRAM] = (struct rewind_segment){ memory->vram, sizeof(memory->vram), MEM_DIRTY_VRAM_BLOCK };
+    segments[REWIND_SEGMENT_OAM] = (struct rewind_segment){ memory->oam, sizeof(memory->oam), MEM_DIRTY_OAM_BLOCK };
+
+    // Everything in `struct memory` past the RAMs (backup storage's chip, prefetch buffer, buses, etc.)
+    segments[REWIND_SEGMENT_MEMORY] = (struct rewind_segment){
+        (uint8_t *)&memory->backup_storage,
+        sizeof(*memory) - offsetof(struct memory, backup_storage),
+        MEM_DIRTY_NO_BLOCK,
+    };
+
+    segments[REWIND_SEGMENT_IO] = (struct rewind_segment){ (uint8_t *)&gba->io, sizeof(gba->io), MEM_DIRTY_NO_BLOCK };
+
+    // Everything in `struct ppu` but the framebuffer
+    segments[REWIND_SEGMENT_PPU] = (struct rewind_segment){
+        (uint8_t *)&gba->ppu.internal_px,
+        sizeof(gba->ppu) - offsetof(struct ppu, internal_px),
+        MEM_DIRTY_NO_BLOCK,
+    };
+
+    segments[REWIND_SEGMENT_APU] = (struct rewind_segment){ (uint8_t *)&gba->apu, sizeof(gba->apu), MEM_DIRTY_NO_BLOCK };
+    segments[REWIND_SEGMENT_GPIO] = (struct rewind_segment){ (uint8_t *)&gba->gpio, sizeof(gba->gpio), MEM_DIRTY_NO_BLOCK };
+    segments[REWIND_SEGMENT_EVENTS] = (struct rewind_segment){ rewind->events, rewind->image_events * sizeof(struct scheduler_event), MEM_DIRTY_NO_BLOCK };
+}
+
+/*
+** Copy the scheduler's cycles and events to `scheduler` and `rewind->events`, the unused events being zero.
+*/
+static
+void
+rewind_copy_scheduler(
+    struct gba *gba,
+    struct rewind_scheduler *scheduler
+) {
+    struct rewind *rewind;
+    size_t events_size;
+
+    rewind = &gba->rewind;
+
+    scheduler->cycles = gba->scheduler.cycles;
+    scheduler->events_size = gba->scheduler.events_size;
+
+    events_size = gba->scheduler.events_size * sizeof(struct scheduler_event);
+    memcpy(rewind->events, gba->scheduler.events, events_size);
+    memset(rewind->events + events_size, 0, rewind->image_events * sizeof(struct scheduler_event) - events_size);
+}
+
+/*
+** Make sure `image` can hold all the events of the scheduler.
+**
+** `image` only ever grows, so the new events are zero in all the previous states and the deltas
+** already in the ring buffer stay valid.
+*/
+static
+void
+rewind_fit_events(
+    struct gba *gba
+) {
+    struct rewind *rewind;
+    size_t old_size;
+    size_t events;
+
+    rewind = &gba->rewind;
+
+    if (rewind->image && gba->scheduler.events_size <= rewind->image_events) {
+        return ;
+    }
+
+    events = max(gba->scheduler.events_size, max(rewind->image_events * 2, REWIND_MIN_EVENTS));
+    old_size = rewind->image_size;
+
+    rewind->image_size += (events - rewind->image_events) * sizeof(struct scheduler_event);
+    rewind->image_events = events;
+
+    rewind->image = realloc(rewind->image, rewind->image_size);
+    rewind->events = realloc(rewind->events, rewind->image_events * sizeof(struct scheduler_event));
+
+    // Worst case: every other word differs, each of them needing its own run.
+    rewind->delta = realloc(rewind->delta, 2 * rewind->image_size + REWIND_RUN_HEADER_SIZE * REWIND_SEGMENT_LEN);
+
+    hs_assert(rewind->image && rewind->events && rewind->delta);
+
+    memset(rewind->image + old_size, 0, rewind->image_size - old_size);
+}
+
+static inline
+bool
+rewind_word_eq(
+    uint8_t const *a,
+    uint8_t const *b,
+    size_t size
+) {
+    uint64_t x;
+    uint64_t y;
+
+    if (likely(size == REWIND_WORD_SIZE)) {
+        memcpy(&x, a, sizeof(x));
+        memcpy(&y, b, sizeof(y));
+        return (x == y);
+    }
+    return (!memcmp(a, b, size));
+}
+
+/*
+** Append to `delta` the runs of words that differ between `image` and `live`, and copy them to `image`.
+** `offset` is the position of `image` within `rewind->image`.
+**
+** Return the amount of bytes written to `delta`.
+*/
+static
+size_t
+rewind_diff(
+    uint8_t *image,
+    uint8_t const *live,
+    size_t size,
+    size_t offset,
+    uint8_t *delta
+) {
+    size_t len;
+    size_t i;
+
+    len = 0;
+    i = 0;
+    while (i < size) {
+        uint32_t run_offset;
+        uint32_t run_len;
+        size_t start;
+
+        if (rewind_word_eq(image + i, live + i, min(size - i, REWIND_WORD_SIZE))) {
+            i += REWIND_WORD_SIZE;
+            continue;
+        }
+
+        start = i;
+        do {
+            i += REWIND_WORD_SIZE;
+        } while (i < size && !rewind_word_eq(image + i, live + i, min(size - i, REWIND_WORD_SIZE)));
+        i = min(i, size);
+
+        run_offset = offset + start;
+        run_len = i - start;
+        memcpy(delta + len, &run_offset, sizeof(run_offset));
+        memcpy(delta + len + sizeof(run_offset), &run_len, sizeof(run_len));
+        len += REWIND_RUN_HEADER_SIZE;
+
+        for (; start < i; ++start) {
+            delta[len++] = image[start] ^ live[start];
+            image[start] = live[start];
+        }
+    }
+
+    return (len);
+}
+
+static
+void
+rewind_ring_clear(
+    struct rewind *rewind
+) {
+    rewind->head = 0;
+    rewind->tail = 0;
+    rewind->wrap = 0;
+    rewind->wrapped = false;
+    rewind->count = 0;
+}
+
+/*
+** Drop the oldest delta of the ring buffer.
+*/
+static
+void
+rewind_ring_drop_oldest(
+    struct rewind *rewind
+) {
+    uint32_t size;
+
+    memcpy(&size, rewind->ring + rewind->tail, sizeof(size));
+    rewind->tail += size + 2 * sizeof(size);
+
+    if (rewind->wrapped && rewind->tail == rewind->wrap) {
+        rewind->tail = 0;
+        rewind->wrapped = false;
+    }
+
+    if (!--rewind->count) {
+        rewind_ring_clear(rewind);
+    }
+}
+
+/*
+** Push the first `size` bytes of `rewind->delta` to the ring buffer, dropping the oldest deltas
+** to make room for it.
+*/
+static
+void
+rewind_ring_push(
+    struct rewind *rewind,
+    uint32_t size
+) {
+    size_t total;
+
+    total = size + 2 * sizeof(size);
+
+    // The delta is larger than the whole history: the previous deltas no longer lead anywhere.
+    if (total > rewind->ring_size) {
+        rewind_ring_clear(rewind);
+        return ;
+    }
+
+    while (true) {
+        if (!rewind->wrapped) {
+            if (rewind->head + total <= rewind->ring_size) {
+                break;
+            }
+
+            rewind->wrap = rewind->head;
+            rewind->wrapped = true;
+            rewind->head = 0;
+        }
+
+        // The free space is between `head` and `tail`
+        if (!rewind->count || rewind->head + total <= rewind->tail) {
+            break;
+        }
+
+        rewind_ring_drop_oldest(rewind);
+    }
+
+    memcpy(rewind->ring + rewind->head, &size, sizeof(size));
+    memcpy(rewind->ring + rewind->head + sizeof(size), rewind->delta, size);
+    memcpy(rewind->ring + rewind->head + sizeof(size) + size, &size, sizeof(size));
+    rewind->head += total;
+    ++rewind->count;
+}
+
+/*
+** Pop the newest delta of the ring buffer and apply it to `image`.
+*/
+static
+void
+rewind_ring_pop(
+    struct rewind *rewind
+) {
+    uint8_t const *delta;
+    uint32_t size;
+    size_t i;
+
+    if (rewind->wrapped && !rewind->head) {
+        rewind->head = rewind->wrap;
+        rewind->wrapped = false;
+    }
+
+    memcpy(&size, rewind->ring + rewind->head - sizeof(size), sizeof(size));
+    rewind->head -= size + 2 * sizeof(size);
+    delta = rewind->ring + rewind->head + sizeof(size);
+
+    i = 0;
+    while (i < size) {
+        uint32_t run_offset;
+        uint32_t run_len;
+        uint32_t j;
+
+        memcpy(&run_offset, delta + i, sizeof(run_offset));
+        memcpy(&run_len, delta + i + sizeof(run_offset), sizeof(run_len));
+        i += REWIND_RUN_HEADER_SIZE;
+
+        for (j = 0; j < run_len; ++j) {
+            rewind->image[run_offset + j] ^= delta[i + j];
+        }
+        i += run_len;
+    }
+
+    if (!--rewind->count) {
+        rewind_ring_clear(rewind);
+    }
+}
+
+/*
+** Drop the history and start a new one from the current state of the GBA, according to `gba->settings.rewind`.
+** Must be called each time the state of the GBA is replaced (reset, quickload).
+*/
+void
+rewind_reset(
+    struct gba *gba
+) {
+    struct rewind_segment segments[REWIND_SEGMENT_LEN];
+    struct rewind_scheduler scheduler;
+    struct rewind *rewind;
+    size_t offset;
+    size_t i;
+
+    rewind = &gba->rewind;
+
+    if (!gba->settings.rewind.enabled || !gba->settings.rewind.buffer_size) {
+        rewind_cleanup(gba);
+        if (gba->memory_dirty.enabled) {
+            mem_dirty_enable(gba, false);
+        }
+        return ;
+    }
+
+    if (rewind->ring_size != gba->settings.rewind.buffer_size) {
+        free(rewind->ring);
+        rewind->ring_size = gba->settings.rewind.buffer_size;
+        rewind->ring = malloc(rewind->ring_size);
+        hs_assert(rewind->ring);
+    }
+
+    rewind_ring_clear(rewind);
+
+    // Size `image` for the current segments, the events being added by `rewind_fit_events()`
+    free(rewind->image);
+    rewind->image = NULL;
+    rewind->image_events = 0;
+    rewind->image_size = 0;
+    rewind_build_segments(gba, segments, &scheduler);
+    for (i = REWIND_SEGMENT_MIN; i <= REWIND_SEGMENT_MAX; ++i) {
+        rewind->image_size += segments[i].size;
+    }
+    rewind_fit_events(gba);
+
+    // Take the first capture in full
+    rewind_build_segments(gba, segments, &scheduler);
+    rewind_copy_scheduler(gba, &scheduler);
+    offset = 0;
+    for (i = REWIND_SEGMENT_MIN; i <= REWIND_SEGMENT_MAX; ++i) {
+        memcpy(rewind->image + offset, segments[i].data, segments[i].size);
+        offset += segments[i].size;
+    }
+
+    rewind->frames = 0;
+    rewind->frame = gba->scheduler.cycles / GBA_CYCLES_PER_FRAME;
+
+    // Also clears the dirty bitmap, now that `image` matches the GBA.
+    mem_dirty_enable(gba, true);
+}
+
+/*
+** Release all the resources held by the rewind.
+*/
+void
+rewind_cleanup(
+    struct gba *gba
+) {
+    struct rewind *rewind;
+
+    rewind = &gba->rewind;
+    free(rewind->image);
+    free(rewind->delta);
+    free(rewind->events);
+    free(rewind->ring);
+    rewind->image = NULL;
+    rewind->image_size = 0;
+    rewind->image_events = 0;
+    rewind->delta = NULL;
+    rewind->events = NULL;
+    rewind->ring = NULL;
+    rewind->ring_size = 0;
+    rewind_ring_clear(rewind);
+}
+
+/*
+** Called by the emulator after running for a while.
+**
+** On each new frame, either capture the state of the GBA every `settings.rewind.interval` frames or,
+** if the frontend is walking back in time, restore the previous capture.
+*/
+void
+rewind_update(
+    struct gba *gba
+) {
+    struct rewind *rewind;
+    uint64_t frame;
+
+    rewind = &gba->rewind;
+
+    if (!rewind->image) {
+        return ;
+    }
+
+    frame = gba->scheduler.cycles / GBA_CYCLES_PER_FRAME;
+    if (frame == rewind->frame) {
+        return ;
+    }
+
+    rewind->frame = frame;
+
+    if (rewind->rewinding) {
+        rewind_restore(gba);
+    } else if (++rewind->frames >= max(gba->settings.rewind.interval, 1u)) {
+        rewind->frames = 0;
+        rewind_capture(gba);
+    }
+}
+
+/*
+** Push to the history the difference between the current state of the GBA and the previous capture.
+*/
+void
+rewind_capture(
+    struct gba *gba
+) {
+    struct rewind_segment segments[REWIND_SEGMENT_LEN];
+    struct rewind_scheduler scheduler;
+    struct rewind *rewind;
+    size_t offset;
+    size_t len;
+    size_t i;
+
+    rewind = &gba->rewind;
+
+    if (!rewind->image) {
+        return ;
+    }
+
+    rewind_fit_events(gba);
+    rewind_build_segments(gba, segments, &scheduler);
+    rewind_copy_scheduler(gba, &scheduler);
+
+    offset = 0;
+    len = 0;
+    for (i = REWIND_SEGMENT_MIN; i <= REWIND_SEGMENT_MAX; ++i) {
+        struct rewind_segment const *segment;
+
+        segment = &segments[i];
+
+        if (segment->dirty_base != MEM_DIRTY_NO_BLOCK) {
+            size_t block;
+
+            for (block = 0; block < (segment->size >> MEM_DIRTY_SHIFT); ++block) {
+                size_t block_offset;
+
+                if (gba->memory_dirty.enabled && !mem_dirty_test(gba, segment->dirty_base + block)) {
+                    continue;
+                }
+
+                block_offset = block << MEM_DIRTY_SHIFT;
+                if (!memcmp(rewind->image + offset + block_offset, segment->data + block_offset, MEM_DIRTY_BLOCK_SIZE)) {
+                    continue;
+                }
+
+                len += rewind_diff(
+                    rewind->image + offset + block_offset,
+                    segment->data + block_offset,
+                    MEM_DIRTY_BLOCK_SIZE,
+                    offset + block_offset,
+                    rewind->delta + len
+                );
+            }
+        } else {
+            len += rewind_diff(rewind->image + offset, segment->data, segment->size, offset, rewind->delta + len);
+        }
+
+        offset += segment->size;
+    }
+
+    mem_dirty_clear(gba);
+    rewind_ring_push(rewind, len);
+}
+
+/*
+** Restore the previous capture, dropping it from the history.
+**
+** Return true if the history is empty, in which case the GBA is brought back to the oldest capture.
+*/
+bool
+rewind_restore(
+    struct gba *gba
+) {
+    struct rewind_segment segments[REWIND_SEGMENT_LEN];
+    struct rewind_scheduler scheduler;
+    struct rewind *rewind;
+    size_t offset;
+    bool empty;
+    size_t i;
+
+    rewind = &gba->rewind;
+
+    if (!rewind->image) {
+        return (true);
+    }
+
+    empty = !rewind->count;
+    if (!empty) {
+        rewind_ring_pop(rewind);
+    }
+
+    rewind_build_segments(gba, segments, &scheduler);
+    offset = 0;
+    for (i = REWIND_SEGMENT_MIN; i <= REWIND_SEGMENT_MAX; ++i) {
+        memcpy(segments[i].data, rewind->image + offset, segments[i].size);
+        offset += segments[i].size;
+    }
+
+    // Rebuild the scheduler from the restored events
+    sched_cleanup(gba);
+    gba->scheduler.cycles = scheduler.cycles;
+    gba->scheduler.events_size = scheduler.events_size;
+    gba->scheduler.events = calloc(scheduler.events_size, sizeof(struct scheduler_event));
+    hs_assert(!scheduler.events_size || gba->scheduler.events);
+    memcpy(gba->scheduler.events, rewind->events, scheduler.events_size * sizeof(struct scheduler_event));
+    sched_rebuild(gba);
+
+    // The cached blocks, tiles and sprites may not match the new content of the memory
+    core_cache_flush(gba);
+    ppu_tile_cache_flush(gba);
+    ppu_oam_cache_invalidate(gba);
+    core_idle_loop_reset(gba);
+
+    // The GBA matches `image` again
+    mem_dirty_clear(gba);
+    rewind->frames = 0;
+    rewind->frame = gba->scheduler.cycles / GBA_CYCLES_PER_FRAME;
+
+    return (empty);
+}
@@ -0,0 +1,385 @@
+/******************************************************************************\
+**
+**  This file is part of the Hades GBA Emulator, and is made available under
+**  the terms of the GNU General Public License version 2.
+**
+**  Copyright (C) 2021-2024 - The Hades Authors
+**
+\******************************************************************************/
+
+#include <stdalign.h>
+#include <stddef.h>
+#include <string.h>
+#include "hades.h"
+#include "gba/gba.h"
+#include "gba/core.h"
+#include "gba/runahead.h"
+#include "compat.h"
+
+/*
+** The state saved by the run-ahead.
+**
+** Like for the rewind, the BIOS and the PPU's framebuffer aren't part of it: the former never
+** changes and the latter is rendered again by the next frame.
+*/
+struct runahead_state {
+    struct core core;
+    struct memory memory;
+    struct io io;
+    struct ppu ppu;
+    struct apu apu;
+    struct gpio gpio;
+
+    struct {
+        uint64_t cycles;
+        uint64_t next_event;
+
+        // `events`, `active` and `free` can hold `capacity` entries
+        struct scheduler_event *events;
+        event_handler_t *active;
+        event_handler_t *free;
+        size_t capacity;
+
+        size_t events_size;
+        size_t active_len;
+        size_t free_len;
+    } scheduler;
+
+    // A copy of the game's backup storage, the speculative frames being able to write to it
+    uint8_t *backup_storage;
+    size_t backup_storage_size;
+};
+
+#define RUNAHEAD_MEMORY_START   (offsetof(struct memory, ewram))
+#define RUNAHEAD_PPU_START      (offsetof(struct ppu, internal_px))
+
+/*
+** Make sure the saved state can hold all the events of the scheduler.
+** This is the only allocation that can happen once run-ahead is enabled, and only if the scheduler grew.
+*/
+static
+void
+runahead_fit_events(
+    struct gba *gba
+) {
+    struct runahead_state *state;
+    size_t capacity;
+
+    state = gba->runahead.state;
+
+    if (gba->scheduler.events_size <= state->scheduler.capacity) {
+        return ;
+    }
+
+    capacity = gba->scheduler.events_size;
+    state->scheduler.events = realloc(state->scheduler.events, capacity * sizeof(struct scheduler_event));
+    state->scheduler.active = realloc(state->scheduler.active, capacity * sizeof(event_handler_t));
+    state->scheduler.free = realloc(state->scheduler.free, capacity * sizeof(event_handler_t));
+    hs_assert(state->scheduler.events && state->scheduler.active && state->scheduler.free);
+    state->scheduler.capacity = capacity;
+}
+
+/*
+** Save the state of the GBA.
+*/
+static
+void
+runahead_save(
+    struct gba *gba
+) {
+    struct runahead_state *state;
+    struct scheduler *scheduler;
+
+    state = gba->runahead.state;
+    scheduler = &gba->scheduler;
+
+    runahead_fit_events(gba);
+
+    state->scheduler.cycles = scheduler->cycles;
+    state->scheduler.next_event = scheduler->next_event;
+    state->scheduler.events_size = scheduler->events_size;
+    state->scheduler.active_len = scheduler->active.len;
+    state->scheduler.free_len = scheduler->free.len;
+    memcpy(state->scheduler.events, scheduler->events, scheduler->events_size * sizeof(struct scheduler_event));
+    memcpy(state->scheduler.active, scheduler->active.handles, scheduler->active.len * sizeof(event_handler_t));
+    memcpy(state->scheduler.free, scheduler->free.handles, scheduler->free.len * sizeof(event_handler_t));
+
+    memcpy(&state->core, &gba->core, sizeof(gba->core));
+    memcpy(
+        (uint8_t *)&state->memory + RUNAHEAD_MEMORY_START,
+        (uint8_t *)&gba->memory + RUNAHEAD_MEMORY_START,
+        sizeof(gba->memory) - RUNAHEAD_MEMORY_START
+    );
+    memcpy(&state->io, &gba->io, sizeof(gba->io));
+    memcpy(
+        (uint8_t *)&state->ppu + RUNAHEAD_PPU_START,
+        (uint8_t *)&gba->ppu + RUNAHEAD_PPU_START,
+        sizeof(gba->ppu) - RUNAHEAD_PPU_START
+    );
+    memcpy(&state->apu, &gba->apu, sizeof(gba->apu));
+    memcpy(&state->gpio, &gba->gpio, sizeof(gba->gpio));
+
+    if (state->backup_storage) {
+        memcpy(state->backup_storage, gba->shared_data.backup_storage.data, state->backup_storage_size);
+    }
+}
+
+/*
+** Invalidate the cached blocks built from the pages of `live` that differ from `saved`.
+** `first_page` is the `core_cache` page of `live`.
+*/
+static
+void
+runahead_invalidate_code(
+    struct gba *gba,
+    uint8_t const *live,
+    uint8_t const *saved,
+    size_t size,
+    uint32_t first_page
+) {
+    size_t i;
+
+    for (i = 0; i < (size >> CORE_CACHE_PAGE_SHIFT); ++i) {
+        size_t offset;
+
+        if (!gba->core_cache.code[first_page + i]) {
+            continue;
+        }
+
+        offset = i << CORE_CACHE_PAGE_SHIFT;
+        if (memcmp(live + offset, saved + offset, CORE_CACHE_PAGE_SIZE)) {
+            core_cache_invalidate_page(gba, first_page + i);
+        }
+    }
+}
+
+/*
+** Invalidate the decoded tiles made of any byte of VRAM that differs from `saved`.
+**
+** VRAM is compared one group of 64 tiles at a time first, since most of it doesn't change from one
+** frame to the next.
+*/
+static
+void
+runahead_invalidate_tiles(
+    struct gba *gba,
+    uint8_t const *saved
+) {
+    uint8_t const *live;
+    size_t group_size;
+    size_t group;
+
+    live = gba->memory.vram;
+    group_size = 64 << PPU_TILE_CACHE_SHIFT;
+
+    for (group = 0; group < VRAM_SIZE; group += group_size) {
+        size_t offset;
+
+        if (!memcmp(live + group, saved + group, group_size)) {
+            continue;
+        }
+
+        for (offset = group; offset < group + group_size; offset += 1 << PPU_TILE_CACHE_SHIFT) {
+            if (memcmp(live + offset, saved + offset, 1 << PPU_TILE_CACHE_SHIFT)) {
+                ppu_tile_cache_invalidate(gba, offset, 1 << PPU_TILE_CACHE_SHIFT);
+            }
+        }
+    }
+}
+
+/*
+** Bring back the state saved by `runahead_save()`.
+**
+** The RAM blocks that differ were all written by the speculative frames, so they are already
+** marked as dirty for the rewind.
+*/
+static
+void
+runahead_load(
+    struct gba *gba
+) {
+    struct runahead_state *state;
+    struct scheduler *scheduler;
+
+    state = gba->runahead.state;
+    scheduler = &gba->scheduler;
+
+    // The speculative frames may have overwritten code that was cached
+    runahead_invalidate_code(gba, gba->memory.ewram, state->memory.ewram, sizeof(gba->memory.ewram), 0);
+    runahead_invalidate_code(gba, gba->memory.iwram, state->memory.iwram, sizeof(gba->memory.iwram), CORE_CACHE_EWRAM_PAGES);
+
+    // Same for the decoded tiles
+    runahead_invalidate_tiles(gba, state->memory.vram);
+
+    // The list of sprites of each line is cheap enough to rebuild
+    ppu_oam_cache_invalidate(gba);
+
+    memcpy(&gba->core, &state->core, sizeof(gba->core));
+    memcpy(
+        (uint8_t *)&gba->memory + RUNAHEAD_MEMORY_START,
+        (uint8_t *)&state->memory + RUNAHEAD_MEMORY_START,
+        sizeof(gba->memory) - RUNAHEAD_MEMORY_START
+    );
+    memcpy(&gba->io, &state->io, sizeof(gba->io));
+    memcpy(
+        (uint8_t *)&gba->ppu + RUNAHEAD_PPU_START,
+        (uint8_t *)&state->ppu + RUNAHEAD_PPU_START,
+        sizeof(gba->ppu) - RUNAHEAD_PPU_START
+    );
+    memcpy(&gba->apu, &state->apu, sizeof(gba->apu));
+    memcpy(&gba->gpio, &state->gpio, sizeof(gba->gpio));
+
+    if (state->backup_storage && memcmp(gba->shared_data.backup_storage.data, state->backup_storage, state->backup_storage_size)) {
+        memcpy(gba->shared_data.backup_storage.data, state->backup_storage, state->backup_storage_size);
+
+        // The frontend may have already written the speculative content to disk.
+        gba->shared_data.backup_storage.dirty = true;
+    }
+
+    scheduler->cycles = state->scheduler.cycles;
+    memcpy(scheduler->events, state->scheduler.events, state->scheduler.events_size * sizeof(struct scheduler_event));
+
+    if (scheduler->events_size == state->scheduler.events_size) {
+        scheduler->next_event = state->scheduler.next_event;
+        scheduler->active.len = state->scheduler.active_len;
+        scheduler->free.len = state->scheduler.free_len;
+        memcpy(scheduler->active.handles, state->scheduler.active, state->scheduler.active_len * sizeof(event_handler_t));
+        memcpy(scheduler->free.handles, state->scheduler.free, state->scheduler.free_len * sizeof(event_handler_t));
+    } else {
+        // The scheduler grew during the speculative frames: keep its new size and free the new events.
+        memset(
+            scheduler->events + state->scheduler.events_size,
+            0,
+            (scheduler->events_size - state->scheduler.events_size) * sizeof(struct scheduler_event)
+        );
+        sched_rebuild(gba);
+    }
+
+    // The core may be somewhere else than where the cache expects it
+    gba->core_cache.next = NULL;
+    core_idle_loop_reset(gba);
+}
+
+/*
+** Allocate or release the saved state according to `gba->settings.run_ahead`.
+** Must be called each time the state of the GBA is replaced (reset, quickload).
+*/
+void
+runahead_reset(
+    struct gba *gba
+) {
+    struct runahead *runahead;
+    uint64_t vblank_offset;
+
+    runahead = &gba->runahead;
+
+    if (!gba->settings.run_ahead) {
+        runahead_cleanup(gba);
+        return ;
+    }
+
+    if (!runahead->state) {
+        // Aligned like the arrays of `struct memory` it holds
+        runahead->state = hs_aligned_alloc(alignof(struct runahead_state), sizeof(*runahead->state));
+        hs_assert(runahead->state);
+        memset(runahead->state, 0, sizeof(*runahead->state));
+    }
+
+    if (runahead->state->backup_storage_size != gba->shared_data.backup_storage.size) {
+        free(runahead->state->backup_storage);
+        runahead->state->backup_storage = NULL;
+        runahead->state->backup_storage_size = 0;
+
+        if (gba->shared_data.backup_storage.data && gba->shared_data.backup_storage.size) {
+            runahead->state->backup_storage_size = gba->shared_data.backup_storage.size;
+            runahead->state->backup_storage = malloc(runahead->state->backup_storage_size);
+            hs_assert(runahead->state->backup_storage);
+        }
+    }
+
+    runahead_fit_events(gba);
+
+    vblank_offset = GBA_CYCLES_PER_PIXEL * GBA_SCREEN_REAL_WIDTH * GBA_SCREEN_HEIGHT;
+    runahead->vblank = (gba->scheduler.cycles + GBA_CYCLES_PER_FRAME - vblank_offset) / GBA_CYCLES_PER_FRAME;
+    runahead->speculating = false;
+    runahead->hide_frame = true;
+}
+
+/*
+** Release all the resources held by the run-ahead.
+*/
+void
+runahead_cleanup(
+    struct gba *gba
+) {
+    struct runahead *runahead;
+
+    runahead = &gba->runahead;
+    if (runahead->state) {
+        free(runahead->state->scheduler.events);
+        free(runahead->state->scheduler.active);
+        free(runahead->state->scheduler.free);
+        free(runahead->state->backup_storage);
+        hs_aligned_free(runahead->state);
+        runahead->state = NULL;
+    }
+    runahead->speculating = false;
+    runahead->hide_frame = false;
+}
+
+/*
+** Called by the emulator after running for a while.
+**
+** When a new VBlank begins, save the state of the GBA, run `settings.run_ahead` more frames, publish
+** the last one and restore the saved state.
+**
+** Does nothing while the frontend is walking back in time: the frames of the real timeline are shown instead.
+*/
+void
+runahead_update(
+    struct gba *gba
+) {
+    struct runahead *runahead;
+    uint64_t vblank_offset;
+    uint64_t vblank;
+    uint32_t frames;
+
+    runahead = &gba->runahead;
+
+    if (!runahead->state) {
+        return ;
+    }
+
+    vblank_offset = GBA_CYCLES_PER_PIXEL * GBA_SCREEN_REAL_WIDTH * GBA_SCREEN_HEIGHT;
+    vblank = (gba->scheduler.cycles + GBA_CYCLES_PER_FRAME - vblank_offset) / GBA_CYCLES_PER_FRAME;
+    if (vblank == runahead->vblank) {
+        return ;
+    }
+
+    runahead->vblank = vblank;
+
+    if (gba->rewind.rewinding) {
+        runahead->hide_frame = false;
+        return ;
+    }
+
+    frames = gba->settings.run_ahead;
+
+    runahead_save(gba);
+
+    /*
+    ** The GBA is already past the beginning of the VBlank, so running `frames` frames is enough
+    ** to reach the beginning of the VBlank of the frame to show.
+    */
+    runahead->speculating = true;
+    runahead->hide_frame = true;
+    if (frames > 1) {
+        sched_run_for(gba, (uint64_t)(frames - 1) * GBA_CYCLES_PER_FRAME);
+    }
+    runahead->hide_frame = false;
+    sched_run_for(gba, GBA_CYCLES_PER_FRAME);
+    runahead->hide_frame = true;
+    runahead->speculating = false;
+
+    runahead_load(gba);
+}
@@ -13,7 +13,7 @@
 #include "gba/memory.h"
 #include "compat.h"
 
-void (*sched_event_callbacks[])(struct gba *gba, struct event_args args) = {
+static void (* const sched_event_callbacks[SCHED_EVENT_LEN])(struct gba *gba, struct event_args args) = {
     [SCHED_EVENT_FRAME_LIMITER] = sched_frame_limiter,
     [SCHED_EVENT_PPU_HDRAW] = ppu_hdraw,
     [SCHED_EVENT_PPU_HBLANK] = ppu_hblank,
@@ -29,6 +29,135 @@ void (*sched_event_callbacks[])(struct gba *gba, struct event_args args) = {
     [SCHED_EVENT_CORE_UPDATE_IRQ_LINE] = core_update_irq_line,
 };
 
+/*
+** Return true if the event `a` should be at the top of `heap` before the event `b`.
+**
+** Active events are ordered by date and then by handle, so that events occuring at the
+** same cycle are always fired in the same order.
+** Free events are ordered by handle, so that the lowest slot is always reused first.
+*/
+static inline
+bool
+sched_heap_less(
+    struct scheduler const *scheduler,
+    struct scheduler_heap const *heap,
+    event_handler_t a,
+    event_handler_t b
+) {
+    if (heap == &scheduler->active && scheduler->events[a].at != scheduler->events[b].at) {
+        return (scheduler->events[a].at < scheduler->events[b].at);
+    }
+    return (a < b);
+}
+
+static inline
+void
+sched_heap_set(
+    struct scheduler *scheduler,
+    struct scheduler_heap *heap,
+    size_t idx,
+    event_handler_t handle
+) {
+    heap->handles[idx] = handle;
+    scheduler->events[handle].heap_idx = idx;
+}
+
+static
+void
+sched_heap_sift_up(
+    struct scheduler *scheduler,
+    struct scheduler_heap *heap,
+    size_t idx
+) {
+    event_handler_t handle;
+
+    handle = heap->handles[idx];
+    while (idx > 0) {
+        size_t parent;
+
+        parent = (idx - 1) / 2;
+        if (!sched_heap_less(scheduler, heap, handle, heap->handles[parent])) {
+            break;
+        }
+        sched_heap_set(scheduler, heap, idx, heap->handles[parent]);
+        idx = parent;
+    }
+    sched_heap_set(scheduler, heap, idx, handle);
+}
+
+static
+void
+sched_heap_sift_down(
+    struct scheduler *scheduler,
+    struct scheduler_heap *heap,
+    size_t idx
+) {
+    event_handler_t handle;
+
+    handle = heap->handles[idx];
+    while (true) {
+        size_t child;
+
+        child = 2 * idx + 1;
+        if (child >= heap->len) {
+            break;
+        }
+
+        if (child + 1 < heap->len && sched_heap_less(scheduler, heap, heap->handles[child + 1], heap->handles[child])) {
+            ++child;
+        }
+
+        if (!sched_heap_less(scheduler, heap, heap->handles[child], handle)) {
+            break;
+        }
+        sched_heap_set(scheduler, heap, idx, heap->handles[child]);
+        idx = child;
+    }
+    sched_heap_set(scheduler, heap, idx, handle);
+}
+
+static
+void
+sched_heap_push(
+    struct scheduler *scheduler,
+    struct scheduler_heap *heap,
+    event_handler_t handle
+) {
+    sched_heap_set(scheduler, heap, heap->len, handle);
+    ++heap->len;
+    sched_heap_sift_up(scheduler, heap, heap->len - 1);
+}
+
+static
+void
+sched_heap_remove(
+    struct scheduler *scheduler,
+    struct scheduler_heap *heap,
+    size_t idx
+) {
+    --heap->len;
+    if (idx != heap->len) {
+        event_handler_t moved;
+
+        // Fill the hole with the last element of the heap and move it to its rightful place.
+        moved = heap->handles[heap->len];
+        sched_heap_set(scheduler, heap, idx, moved);
+        sched_heap_sift_up(scheduler, heap, idx);
+        sched_heap_sift_down(scheduler, heap, scheduler->events[moved].heap_idx);
+    }
+}
+
+/*
+** Update `scheduler->next_event` to the date of the earliest active event.
+*/
+static inline
+void
+sched_update_next_event(
+    struct scheduler *scheduler
+) {
+    scheduler->next_event = scheduler->active.len ? scheduler->events[scheduler->active.handles[0]].at : UINT64_MAX;
+}
+
 void
 sched_process_events(
     struct gba *gba
@@ -36,35 +165,18 @@ sched_process_events(
     struct scheduler *scheduler;
 
     scheduler = &gba->scheduler;
-    while (true) {
+    while (scheduler->active.len) {
         struct scheduler_event *event;
-        uint64_t next_event;
+        struct event_args args;
+        enum sched_event_kind kind;
+        event_handler_t handle;
         uint64_t delay;
-        size_t i;
-
-        event = NULL;
-
-        next_event = UINT64_MAX;
-
-        // We want to fire all the events in the correct order, hence the complicated
-        // loop.
-        for (i = 0; i < scheduler->events_size; ++i) {
-
-            // Keep only the event that are active and should occure now
-            if (scheduler->events[i].active) {
-                if (scheduler->events[i].at <= scheduler->cycles) {
-                    if (!event || scheduler->events[i].at < event->at) {
-                        event = scheduler->events + i;
-                    }
-                } else if (scheduler->events[i].at < next_event) {
-                    next_event = scheduler->events[i].at;
-                }
-            }
-        }
 
-        scheduler->next_event = next_event;
+        // The earliest event is always at the top of the heap.
+        handle = scheduler->active.handles[0];
+        event = scheduler->events + handle;
 
-        if (!event) {
+        if (event->at > scheduler->cycles) {
             break;
         }
 
@@ -72,19 +184,26 @@ sched_process_events(
         delay = scheduler->cycles - event->at;
         scheduler->cycles -= delay;
 
+        // `event` may be moved by the callback if it adds new events, so keep a copy of what we need.
+        kind = event->kind;
+        args = event->args;
+
         if (event->repeat) {
             event->at += event->period;
-
-            if (event->at < scheduler->next_event) {
-                scheduler->next_event = event->at;
-            }
+            sched_heap_sift_down(scheduler, &scheduler->active, 0);
         } else {
             event->active = false;
+            sched_heap_remove(scheduler, &scheduler->active, 0);
+            sched_heap_push(scheduler, &scheduler->free, handle);
         }
 
-        sched_event_callbacks[event->kind](gba, event->args);
+        sched_update_next_event(scheduler);
+
+        sched_event_callbacks[kind](gba, args);
         scheduler->cycles += delay;
     }
+
+    sched_update_next_event(scheduler);
 }
 
 event_handler_t
@@ -93,51 +212,115 @@ sched_add_event(
     struct scheduler_event event
 ) {
     struct scheduler *scheduler;
-    size_t i;
+    event_handler_t handle;
 
     scheduler = &gba->scheduler;
 
     hs_assert(!event.repeat || event.period);
 
-    // Try and reuse an inactive event
-    for (i = 0; i < scheduler->events_size; ++i) {
-        if (!scheduler->events[i].active) {
-            scheduler->events[i] = event;
-            scheduler->events[i].active = true;
-            goto end;
+    // If no event are available, grow `scheduler->events` and mark all the new slots as free.
+    if (!scheduler->free.len) {
+        size_t old_size;
+        size_t i;
+
+        old_size = scheduler->events_size;
+        scheduler->events_size = old_size ? old_size * 2 : 64;
+
+        scheduler->events = realloc(scheduler->events, scheduler->events_size * sizeof(struct scheduler_event));
+        scheduler->active.handles = realloc(scheduler->active.handles, scheduler->events_size * sizeof(event_handler_t));
+        scheduler->free.handles = realloc(scheduler->free.handles, scheduler->events_size * sizeof(event_handler_t));
+        hs_assert(scheduler->events && scheduler->active.handles && scheduler->free.handles);
+
+        for (i = old_size; i < scheduler->events_size; ++i) {
+            scheduler->events[i].active = false;
+            sched_heap_push(scheduler, &scheduler->free, i);
         }
     }
 
-    // If no event are available, reallocate `scheduler->events`.
-    scheduler->events_size += 5;
-    scheduler->events = realloc(scheduler->events, scheduler->events_size * sizeof(struct scheduler_event));
-    hs_assert(scheduler->events);
+    // Reuse the lowest inactive event
+    handle = scheduler->free.handles[0];
+    sched_heap_remove(scheduler, &scheduler->free, 0);
 
-    scheduler->events[i] = event;
-    scheduler->events[i].active = true;
+    scheduler->events[handle] = event;
+    scheduler->events[handle].active = true;
+    sched_heap_push(scheduler, &scheduler->active, handle);
 
-end:
     if (event.at < scheduler->next_event) {
         scheduler->next_event = event.at;
     }
 
-    return (i);
+    return (handle);
 }
 
 void
 sched_cancel_event(
     struct gba *gba,
-    event_handler_t handler
+    event_handler_t handle
+) {
+    struct scheduler *scheduler;
+    struct scheduler_event *event;
+
+    scheduler = &gba->scheduler;
+    event = scheduler->events + handle;
+
+    if (event->active) {
+        event->active = false;
+        sched_heap_remove(scheduler, &scheduler->active, event->heap_idx);
+        sched_heap_push(scheduler, &scheduler->free, handle);
+        sched_update_next_event(scheduler);
+    }
+}
+
+/*
+** Rebuild the heaps of active and free events from the content of `scheduler->events`.
+**
+** This must be called when `scheduler->events` and `scheduler->events_size` are
+** restored from an external source, like a save state.
+*/
+void
+sched_rebuild(
+    struct gba *gba
 ) {
     struct scheduler *scheduler;
+    size_t i;
 
     scheduler = &gba->scheduler;
 
-    if (scheduler->events[handler].active) {
-        scheduler->events[handler].active = false;
+    scheduler->active.handles = realloc(scheduler->active.handles, scheduler->events_size * sizeof(event_handler_t));
+    scheduler->free.handles = realloc(scheduler->free.handles, scheduler->events_size * sizeof(event_handler_t));
+    hs_assert(!scheduler->events_size || (scheduler->active.handles && scheduler->free.handles));
+
+    scheduler->active.len = 0;
+    scheduler->free.len = 0;
+
+    for (i = 0; i < scheduler->events_size; ++i) {
+        sched_heap_push(scheduler, scheduler->events[i].active ? &scheduler->active : &scheduler->free, i);
     }
 
-    // TODO: update `scheduler->next_event`? Is it worth it?
+    sched_update_next_event(scheduler);
+}
+
+/*
+** Release all the events held by the scheduler.
+*/
+void
+sched_cleanup(
+    struct gba *gba
+) {
+    struct scheduler *scheduler;
+
+    scheduler = &gba->scheduler;
+
+    free(scheduler->events);
+    free(scheduler->active.handles);
+    free(scheduler->free.handles);
+
+    scheduler->events = NULL;
+    scheduler->events_size = 0;
+    scheduler->active.handles = NULL;
+    scheduler->active.len = 0;
+    scheduler->free.handles = NULL;
+    scheduler->free.len = 0;
 }
 
 void
@@ -162,7 +345,12 @@ sched_run_for(
         uint64_t old_cycles;
 
         old_cycles = scheduler->cycles;
-        core_next(gba);
+
+        // The JIT runs as many instructions as it can and leaves the other ones to the interpreter.
+        if (gba->settings.core_backend != CORE_BACKEND_JIT || !core_jit_run(gba, target)) {
+            core_next(gba);
+        }
+
         elapsed = scheduler->cycles - old_cycles;
 
         if (!elapsed) {
@@ -187,7 +375,8 @@ sched_frame_limiter(
     struct gba *gba,
     struct event_args args __unused
 ) {
-    if (gba->scheduler.time_per_frame) {
+    // The speculative frames (see `gba/runahead.h`) are run as fast as possible
+    if (gba->scheduler.time_per_frame && !gba->runahead.speculating) {
         uint64_t now;
 
         now = hs_time();
@@ -209,7 +398,8 @@ sched_update_speed(
 
     scheduler = &gba->scheduler;
 
-    if (gba->settings.fast_forward) {
+    // The synchronous API lets the caller pace the emulation
+    if (gba->settings.fast_forward || gba->synchronous) {
         scheduler->time_per_frame = 0;
     } else {
         scheduler->time_per_frame = 1000.f * 1000.f / (gba->settings.speed * 59.737f);
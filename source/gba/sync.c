@@ -0,0 +1,195 @@
+/******************************************************************************\
+**
+**  This file is part of the Hades GBA Emulator, and is made available under
+**  the terms of the GNU General Public License version 2.
+**
+**  Copyright (C) 2021-2024 - The Hades Authors
+**
+\******************************************************************************/
+
+#include <string.h>
+#include "hades.h"
+#include "gba/gba.h"
+#include "gba/sync.h"
+
+/*
+** Create a new GBA emulator meant to be stepped with the synchronous API.
+*/
+struct gba *
+gba_sync_create(
+    void
+) {
+    struct gba *gba;
+
+    gba = gba_create();
+    gba->synchronous = true;
+    return (gba);
+}
+
+/*
+** Reset the GBA and load the game described by `config`.
+** The GBA is ready to run once this returns.
+*/
+void
+gba_sync_reset(
+    struct gba *gba,
+    struct launch_config const *config
+) {
+    hs_assert(gba->synchronous);
+
+    gba_state_stop(gba);
+    gba_state_reset(gba, config);
+    gba_state_run(gba);
+}
+
+/*
+** Run the GBA until the beginning of the next VBlank, when a new frame has been fully rendered.
+**
+** The PPU's timings never change, so the VBlanks start at a fixed offset of each frame. Aiming for
+** that date instead of running a frame's worth of cycles prevents the overshoot of the last
+** instruction from accumulating.
+*/
+void
+gba_run_frame(
+    struct gba *gba
+) {
+    uint64_t vblank_offset;
+    uint64_t target;
+    uint64_t cycles;
+
+    vblank_offset = GBA_CYCLES_PER_PIXEL * GBA_SCREEN_REAL_WIDTH * GBA_SCREEN_HEIGHT;
+    cycles = gba->scheduler.cycles;
+    target = cycles - (cycles % GBA_CYCLES_PER_FRAME) + vblank_offset;
+
+    if (target <= cycles) {
+        target += GBA_CYCLES_PER_FRAME;
+    }
+
+    sched_run_for(gba, target - cycles);
+    rewind_update(gba);
+    runahead_update(gba);
+}
+
+/*
+** Run the GBA for at least the given amount of cycles.
+*/
+void
+gba_run_cycles(
+    struct gba *gba,
+    uint64_t cycles
+) {
+    sched_run_for(gba, cycles);
+    rewind_update(gba);
+    runahead_update(gba);
+}
+
+/*
+** Press or release the given key.
+*/
+void
+gba_set_key(
+    struct gba *gba,
+    enum keys key,
+    bool pressed
+) {
+    switch (key) {
+        case KEY_A:         gba->io.keyinput.a = !pressed; break;
+        case KEY_B:         gba->io.keyinput.b = !pressed; break;
+        case KEY_L:         gba->io.keyinput.l = !pressed; break;
+        case KEY_R:         gba->io.keyinput.r = !pressed; break;
+        case KEY_UP:        gba->io.keyinput.up = !pressed; break;
+        case KEY_DOWN:      gba->io.keyinput.down = !pressed; break;
+        case KEY_RIGHT:     gba->io.keyinput.right = !pressed; break;
+        case KEY_LEFT:      gba->io.keyinput.left = !pressed; break;
+        case KEY_START:     gba->io.keyinput.start = !pressed; break;
+        case KEY_SELECT:    gba->io.keyinput.select = !pressed; break;
+        default:            break;
+    };
+
+    if (gba->core.state == CORE_STOP && io_evaluate_keypad_cond(gba)) {
+        gba->core.state = CORE_RUN;
+        sched_reset_frame_limiter(gba);
+    }
+
+    io_scan_keypad_irq(gba);
+}
+
+/*
+** Start or stop walking back in time.
+**
+** While enabled, each new frame starts from the previous capture of the rewind instead of the
+** end of the last one. It has no effect if the rewind is disabled in the GBA's settings.
+*/
+void
+gba_set_rewind(
+    struct gba *gba,
+    bool enabled
+) {
+    gba->rewind.rewinding = enabled;
+}
+
+/*
+** Copy the last frame rendered by the PPU to `pixels`, which must hold
+** `GBA_SCREEN_WIDTH * GBA_SCREEN_HEIGHT` pixels.
+*/
+void
+gba_read_framebuffer(
+    struct gba const *gba,
+    uint32_t *pixels
+) {
+    memcpy(pixels, gba->shared_data.framebuffer.data, sizeof(gba->shared_data.framebuffer.data));
+}
+
+/*
+** Move up to `max_frames` stereo frames of audio to `samples`, which must hold `2 * max_frames`
+** interleaved left/right samples.
+**
+** A stereo frame is produced every `launch_config.audio_frequency` cycles, none if it's 0.
+**
+** Return the amount of stereo frames written.
+*/
+size_t
+gba_read_audio(
+    struct gba *gba,
+    int16_t *samples,
+    size_t max_frames
+) {
+    size_t len;
+    size_t i;
+
+    len = min(gba->shared_data.audio_rbuffer.size, max_frames);
+    for (i = 0; i < len; ++i) {
+        uint32_t sample;
+
+        sample = apu_rbuffer_pop(&gba->shared_data.audio_rbuffer);
+        samples[i * 2] = (int16_t)(sample >> 16);
+        samples[i * 2 + 1] = (int16_t)(sample & 0xFFFF);
+    }
+    return (len);
+}
+
+/*
+** Take a snapshot of the GBA's state.
+** `*data` is allocated and must be freed by the caller.
+*/
+void
+gba_snapshot(
+    struct gba *gba,
+    uint8_t **data,
+    size_t *size
+) {
+    quicksave(gba, data, size);
+}
+
+/*
+** Restore a snapshot taken with `gba_snapshot()`.
+** Return true if the snapshot couldn't be loaded.
+*/
+bool
+gba_restore(
+    struct gba *gba,
+    uint8_t *data,
+    size_t size
+) {
+    return (quickload(gba, data, size));
+}
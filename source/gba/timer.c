@@ -9,7 +9,7 @@
 
 #include "gba/gba.h"
 
-static uint64_t scalers[4] = { 0, 6, 8, 10 };
+static uint64_t const scalers[4] = { 0, 6, 8, 10 };
 
 static
 void
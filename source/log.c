@@ -7,15 +7,20 @@
 **
 \******************************************************************************/
 
+#include <stddef.h>
 #include <string.h>
 #include <ctype.h>
 #include "hades.h"
+#include "compat.h"
 
 /*
 ** A global variable used to indicate the verbosity of all the different log levels.
+**
+** They are shared by all the running instances of `struct gba` and can be toggled by the frontend
+** while the emulation threads are logging, hence the atomics.
 */
-bool g_verbose_global = true;
-bool g_verbose[HS_END] = {
+atomic_bool g_verbose_global = true;
+atomic_bool g_verbose[HS_END] = {
     [HS_INFO] = true,
     [HS_WARNING] = true,
     [HS_ERROR] = true,
@@ -68,20 +73,527 @@ disable_colors(
     g_white          = "";
 }
 
+/*
+** Print the given message, already formatted, followed by a `\n`.
+*/
+static
+void
+log_write(
+    enum modules module,
+    char const *msg
+) {
+    if (module == HS_ERROR) {
+        printf("[%s] %s%s%s%s\n", modules_str[module], g_bold, g_light_red, msg, g_reset);
+    } else {
+        printf("[%s] %s\n", modules_str[module], msg);
+    }
+}
+
+/*
+** Deferred logging.
+**
+** When enabled, `log_print()` doesn't format the message: it copies the module, the format string
+** and the arguments to a fixed-size record of a lock-free ring buffer. A drain thread formats and
+** prints the records later on, keeping verbose traces (IO, DMA...) cheap for the emulation threads.
+**
+** The ring is a bounded multi-producer queue: each record has a sequence number telling whether
+** it's free to be written or ready to be drained. When the ring is full, the records are dropped.
+**
+** Only the traces of the emulation (the modules from `HS_CORE` onward) are deferred: the arguments
+** are formatted long after the call returned, so their format string must be a literal and their
+** `%s` arguments must point to static strings (like the names returned by `mem_io_reg_name()`).
+** The other modules, whose messages may embed short-lived buffers (`strerror()`, `SDL_GetError()`,
+** paths...), are printed right away, as are the messages with more than `LOG_RECORD_MAX_ARGS`
+** arguments or with arguments that can't be stored in a record (`%n`, `*` widths...).
+*/
+
+#define LOG_RING_SIZE           4096
+#define LOG_RECORD_MAX_ARGS     8
+#define LOG_DRAIN_SLEEP_US      1000
+
+static_assert(!(LOG_RING_SIZE & (LOG_RING_SIZE - 1)));
+
+enum log_arg_types {
+    LOG_ARG_NONE,
+    LOG_ARG_INT,
+    LOG_ARG_LONG,
+    LOG_ARG_LLONG,
+    LOG_ARG_SIZE,
+    LOG_ARG_INTMAX,
+    LOG_ARG_PTRDIFF,
+    LOG_ARG_DOUBLE,
+    LOG_ARG_STR,
+    LOG_ARG_PTR,
+    LOG_ARG_INVALID,
+};
+
+struct log_conversion {
+    enum log_arg_types type;
+    bool is_signed;
+
+    // The conversion specification, from `%` to the conversion character
+    char const *start;
+    size_t len;
+};
+
+struct log_record {
+    atomic_size_t seq;
+
+    enum modules module;
+    char const *fmt;
+    uint64_t args[LOG_RECORD_MAX_ARGS];
+};
+
+static struct {
+    struct log_record records[LOG_RING_SIZE];
+
+    // Index of the next record to write, shared by all the producers
+    atomic_size_t head;
+
+    // Index of the next record to drain, only used by the drain thread
+    size_t tail;
+
+    atomic_size_t dropped;
+    atomic_bool running;
+    pthread_t thread;
+} g_log_ring;
+
+/*
+** Find the next conversion specification of `fmt`, store it in `conv` and return a pointer to
+** the character following it.
+**
+** `conv->type` is set to `LOG_ARG_NONE` if the end of the string was reached.
+*/
+static
+char const *
+log_next_conversion(
+    char const *fmt,
+    struct log_conversion *conv
+) {
+    char const *c;
+    size_t length;
+    char longs;
+
+    while (*fmt && (*fmt != '%' || fmt[1] == '%')) {
+        fmt += (*fmt == '%') ? 2 : 1;
+    }
+
+    conv->type = LOG_ARG_NONE;
+    conv->is_signed = false;
+    conv->start = fmt;
+    conv->len = 0;
+
+    if (!*fmt) {
+        return (fmt);
+    }
+
+    c = fmt + 1;
+
+    // Flags, width and precision
+    c += strspn(c, "-+ #0");
+    c += strspn(c, "0123456789");
+    if (*c == '.') {
+        ++c;
+        c += strspn(c, "0123456789");
+    }
+
+    // Length modifier
+    length = strspn(c, "hlzjtL");
+    longs = 0;
+    switch (length) {
+        case 0:  break;
+        case 1:  longs = *c; break;
+        case 2:  longs = (c[0] == 'l' && c[1] == 'l') ? 'q' : (c[0] == 'h' && c[1] == 'h') ? 'h' : '?'; break;
+        default: longs = '?'; break;
+    }
+    c += length;
+
+    switch (*c) {
+        case 'd':
+        case 'i':
+        case 'c':
+            conv->is_signed = true;
+            // fallthrough
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o': {
+            switch (longs) {
+                case 0:
+                case 'h':   conv->type = LOG_ARG_INT; break;
+                case 'l':   conv->type = LOG_ARG_LONG; break;
+                case 'q':   conv->type = LOG_ARG_LLONG; break;
+                case 'z':   conv->type = LOG_ARG_SIZE; break;
+                case 'j':   conv->type = LOG_ARG_INTMAX; break;
+                case 't':   conv->type = LOG_ARG_PTRDIFF; break;
+                default:    conv->type = LOG_ARG_INVALID; break;
+            }
+            break;
+        };
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':   conv->type = longs ? LOG_ARG_INVALID : LOG_ARG_DOUBLE; break;
+        case 's':   conv->type = longs ? LOG_ARG_INVALID : LOG_ARG_STR; break;
+        case 'p':   conv->type = longs ? LOG_ARG_INVALID : LOG_ARG_PTR; break;
+        default:    conv->type = LOG_ARG_INVALID; break;
+    }
+
+    if (conv->type == LOG_ARG_INVALID || !*c) {
+        conv->type = LOG_ARG_INVALID;
+        return (c);
+    }
+
+    conv->len = c + 1 - fmt;
+    return (c + 1);
+}
+
+/*
+** Fetch the next argument of `va`, of the type described by `conv`.
+*/
+static
+uint64_t
+log_fetch_arg(
+    struct log_conversion const *conv,
+    va_list *va
+) {
+    switch (conv->type) {
+        case LOG_ARG_INT:       return (conv->is_signed ? (uint64_t)va_arg(*va, int) : va_arg(*va, unsigned int));
+        case LOG_ARG_LONG:      return (conv->is_signed ? (uint64_t)va_arg(*va, long) : va_arg(*va, unsigned long));
+        case LOG_ARG_LLONG:     return (conv->is_signed ? (uint64_t)va_arg(*va, long long) : va_arg(*va, unsigned long long));
+        case LOG_ARG_SIZE:      return (va_arg(*va, size_t));
+        case LOG_ARG_INTMAX:    return (conv->is_signed ? (uint64_t)va_arg(*va, intmax_t) : va_arg(*va, uintmax_t));
+        case LOG_ARG_PTRDIFF:   return ((uint64_t)va_arg(*va, ptrdiff_t));
+        case LOG_ARG_STR:       return ((uintptr_t)va_arg(*va, char const *));
+        case LOG_ARG_PTR:       return ((uintptr_t)va_arg(*va, void *));
+        case LOG_ARG_DOUBLE: {
+            double d;
+            uint64_t raw;
+
+            d = va_arg(*va, double);
+            memcpy(&raw, &d, sizeof(raw));
+            return (raw);
+        };
+        default:                return (0);
+    }
+}
+
+/*
+** Format the argument `arg`, of the type described by `conv`, at the end of `buf`.
+*/
+static
+void
+log_format_arg(
+    char *buf,
+    size_t size,
+    struct log_conversion const *conv,
+    uint64_t arg
+) {
+    char spec[32];
+    size_t len;
+
+    if (conv->len >= sizeof(spec)) {
+        return ;
+    }
+
+    memcpy(spec, conv->start, conv->len);
+    spec[conv->len] = '\0';
+
+    len = strlen(buf);
+    buf += len;
+    size -= len;
+
+    switch (conv->type) {
+        case LOG_ARG_INT: {
+            if (conv->is_signed) {
+                snprintf(buf, size, spec, (int)arg);
+            } else {
+                snprintf(buf, size, spec, (unsigned int)arg);
+            }
+            break;
+        };
+        case LOG_ARG_LONG: {
+            if (conv->is_signed) {
+                snprintf(buf, size, spec, (long)arg);
+            } else {
+                snprintf(buf, size, spec, (unsigned long)arg);
+            }
+            break;
+        };
+        case LOG_ARG_LLONG: {
+            if (conv->is_signed) {
+                snprintf(buf, size, spec, (long long)arg);
+            } else {
+                snprintf(buf, size, spec, (unsigned long long)arg);
+            }
+            break;
+        };
+        case LOG_ARG_INTMAX: {
+            if (conv->is_signed) {
+                snprintf(buf, size, spec, (intmax_t)arg);
+            } else {
+                snprintf(buf, size, spec, (uintmax_t)arg);
+            }
+            break;
+        };
+        case LOG_ARG_SIZE:      snprintf(buf, size, spec, (size_t)arg); break;
+        case LOG_ARG_PTRDIFF:   snprintf(buf, size, spec, (ptrdiff_t)arg); break;
+        case LOG_ARG_STR:       snprintf(buf, size, spec, (char const *)(uintptr_t)arg); break;
+        case LOG_ARG_PTR:       snprintf(buf, size, spec, (void *)(uintptr_t)arg); break;
+        case LOG_ARG_DOUBLE: {
+            double d;
+
+            memcpy(&d, &arg, sizeof(d));
+            snprintf(buf, size, spec, d);
+            break;
+        };
+        default:                break;
+    }
+}
+
+/*
+** Append the characters of `fmt` in [start, end[ to `buf`, unescaping the `%%`.
+*/
+static
+void
+log_format_text(
+    char *buf,
+    size_t size,
+    char const *start,
+    char const *end
+) {
+    size_t len;
+
+    len = strlen(buf);
+    while (start < end && len + 1 < size) {
+        buf[len++] = *start;
+        start += (start[0] == '%' && start + 1 < end && start[1] == '%') ? 2 : 1;
+    }
+    buf[len] = '\0';
+}
+
+/*
+** Format and print the given record.
+*/
+static
+void
+log_drain_record(
+    struct log_record const *record
+) {
+    struct log_conversion conv;
+    char const *fmt;
+    char buf[1024];
+    size_t i;
+
+    buf[0] = '\0';
+    fmt = record->fmt;
+    for (i = 0; ; ++i) {
+        char const *next;
+
+        next = log_next_conversion(fmt, &conv);
+        log_format_text(buf, sizeof(buf), fmt, conv.start);
+        if (conv.type == LOG_ARG_NONE) {
+            break;
+        }
+        log_format_arg(buf, sizeof(buf), &conv, record->args[i]);
+        fmt = next;
+    }
+
+    log_write(record->module, buf);
+}
+
+/*
+** Drain all the records that are ready to be printed.
+** Return the number of records drained.
+*/
+static
+size_t
+log_drain(
+    void
+) {
+    size_t count;
+
+    for (count = 0; ; ++count) {
+        struct log_record *record;
+        size_t tail;
+
+        tail = g_log_ring.tail;
+        record = &g_log_ring.records[tail & (LOG_RING_SIZE - 1)];
+        if (atomic_load_explicit(&record->seq, memory_order_acquire) != tail + 1) {
+            break;
+        }
+
+        log_drain_record(record);
+        atomic_store_explicit(&record->seq, tail + LOG_RING_SIZE, memory_order_release);
+        g_log_ring.tail = tail + 1;
+    }
+    return (count);
+}
+
+static
+void *
+log_drain_thread(
+    void *arg __unused
+) {
+    while (atomic_load(&g_log_ring.running)) {
+        if (!log_drain()) {
+            fflush(stdout);
+            hs_usleep(LOG_DRAIN_SLEEP_US);
+        }
+    }
+    return (NULL);
+}
+
+/*
+** Copy the message to a record of the ring.
+** Return `true` if the message couldn't be stored and must be printed right away.
+*/
+static
+bool
+log_push(
+    enum modules module,
+    char const *fmt,
+    va_list va
+) {
+    struct log_conversion conv;
+    struct log_record *record;
+    uint64_t args[LOG_RECORD_MAX_ARGS];
+    char const *c;
+    va_list copy;
+    size_t head;
+    size_t i;
+
+    va_copy(copy, va);
+    c = fmt;
+    for (i = 0; ; ++i) {
+        c = log_next_conversion(c, &conv);
+        if (conv.type == LOG_ARG_NONE) {
+            break;
+        } else if (conv.type == LOG_ARG_INVALID || i >= LOG_RECORD_MAX_ARGS) {
+            va_end(copy);
+            return (true);
+        }
+        args[i] = log_fetch_arg(&conv, &copy);
+    }
+    va_end(copy);
+
+    head = atomic_load_explicit(&g_log_ring.head, memory_order_relaxed);
+    while (true) {
+        size_t seq;
+
+        record = &g_log_ring.records[head & (LOG_RING_SIZE - 1)];
+        seq = atomic_load_explicit(&record->seq, memory_order_acquire);
+
+        if (seq == head) {
+            if (atomic_compare_exchange_weak_explicit(&g_log_ring.head, &head, head + 1, memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if ((ptrdiff_t)(seq - head) < 0) {
+            // The ring is full
+            atomic_fetch_add_explicit(&g_log_ring.dropped, 1, memory_order_relaxed);
+            return (false);
+        } else {
+            head = atomic_load_explicit(&g_log_ring.head, memory_order_relaxed);
+        }
+    }
+
+    record->module = module;
+    record->fmt = fmt;
+    memcpy(record->args, args, i * sizeof(args[0]));
+    atomic_store_explicit(&record->seq, head + 1, memory_order_release);
+    return (false);
+}
+
+/*
+** Start logging to the ring buffer and the drain thread printing it.
+*/
+void
+log_deferred_start(
+    void
+) {
+    size_t i;
+
+    if (atomic_load(&g_log_ring.running)) {
+        return ;
+    }
+
+    for (i = 0; i < LOG_RING_SIZE; ++i) {
+        atomic_init(&g_log_ring.records[i].seq, i);
+    }
+    atomic_init(&g_log_ring.head, 0);
+    atomic_init(&g_log_ring.dropped, 0);
+    g_log_ring.tail = 0;
+
+    atomic_store(&g_log_ring.running, true);
+    hs_assert(!pthread_create(&g_log_ring.thread, NULL, log_drain_thread, NULL));
+}
+
+/*
+** Stop the drain thread and print the records left in the ring.
+**
+** The threads still logging may lose their last records.
+*/
+void
+log_deferred_stop(
+    void
+) {
+    size_t dropped;
+
+    if (!atomic_load(&g_log_ring.running)) {
+        return ;
+    }
+
+    atomic_store(&g_log_ring.running, false);
+
+    // The drain thread can't wait for itself, which happens if it panics.
+    if (pthread_equal(pthread_self(), g_log_ring.thread)) {
+        return ;
+    }
+
+    pthread_join(g_log_ring.thread, NULL);
+    log_drain();
+
+    dropped = atomic_load(&g_log_ring.dropped);
+    if (dropped) {
+        printf("[%s] %zu log messages were dropped.\n", modules_str[HS_WARNING], dropped);
+    }
+    fflush(stdout);
+}
+
+/*
+** Return `true` if the logs are deferred to the drain thread.
+*/
+bool
+log_deferred_running(
+    void
+) {
+    return (atomic_load(&g_log_ring.running));
+}
+
 /*
 ** Log the given formatted string, followed by a `\n`.
+**
+** Use `logln()` instead, which doesn't evaluate the arguments if the module isn't logged.
 */
 void
-logln(
+log_print(
     enum modules module,
     char const *fmt,
     ...
 ) {
     va_list va;
 
-    if (g_verbose_global && g_verbose[module]) {
-        va_start(va, fmt);
+    va_start(va, fmt);
 
+    if (
+           module < HS_CORE
+        || !atomic_load_explicit(&g_log_ring.running, memory_order_relaxed)
+        || log_push(module, fmt, va)
+    ) {
         printf("[%s] ", modules_str[module]);
 
         if (module == HS_ERROR) {
@@ -95,9 +607,9 @@ logln(
         }
 
         printf("\n");
-
-        va_end(va);
     }
+
+    va_end(va);
 }
 
 /*
@@ -112,6 +624,9 @@ panic(
 ) {
     va_list va;
 
+    // Print the deferred traces leading to the failure first
+    log_deferred_stop();
+
     va_start(va, fmt);
     printf("[%s] Abort: ", modules_str[module]);
     vprintf(fmt, va);
@@ -134,6 +649,9 @@ unimplemented(
 ) {
     va_list va;
 
+    // Print the deferred traces leading to the failure first
+    log_deferred_stop();
+
     va_start(va, fmt);
     printf("[%s] Abort: Not Implemented: ", modules_str[module]);
     vprintf(fmt, va);